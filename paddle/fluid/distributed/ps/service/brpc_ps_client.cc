@@ -65,14 +65,6 @@ class Variable;
 namespace paddle {
 namespace distributed {
 
-inline size_t get_sparse_shard(uint32_t shard_num, uint32_t server_num,
-                               uint64_t key) {
-  size_t remind = shard_num % server_num;
-  size_t local_shard_num =
-      remind == 0 ? shard_num / server_num : shard_num / server_num + 1;
-  return (key % shard_num) / local_shard_num;
-}
-
 void DownpourPsClientService::service(
     ::google::protobuf::RpcController *controller,
     const PsRequestMessage *request, PsResponseMessage *response,
@@ -45,6 +45,14 @@ namespace distributed {
 
 struct Region;
 
+inline size_t get_sparse_shard(uint32_t shard_num, uint32_t server_num,
+                               uint64_t key) {
+  size_t remind = shard_num % server_num;
+  size_t local_shard_num =
+      remind == 0 ? shard_num / server_num : shard_num / server_num + 1;
+  return (key % shard_num) / local_shard_num;
+}
+
 class DownpourPsClientService : public PsService {
  public:
   DownpourPsClientService() {}
@@ -194,6 +202,10 @@ class BrpcPsClient : public PSClient {
                                            size_t table_id,
                                            const uint64_t *keys, size_t num,
                                            bool is_training);
+  virtual std::future<int32_t> push_sparse(size_t table_id,
+                                           const uint64_t *keys,
+                                           const float **update_values,
+                                           size_t num);
   virtual std::future<int32_t> pull_sparse_param(float **select_values,
                                                  size_t table_id,
                                                  const uint64_t *keys,
@@ -301,9 +313,6 @@ class BrpcPsClient : public PSClient {
   std::future<int32_t> push_sparse_param(size_t table_id, const uint64_t *keys,
                                          const float **update_values,
                                          size_t num, void *done) override;
-  std::future<int32_t> push_sparse(size_t table_id, const uint64_t *keys,
-                                   const float **update_values,
-                                   size_t num) override;
   void push_sparse_task_consume();
 
  private:
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include <algorithm>
 #include <thread>  // NOLINT
 #include "butil/object_pool.h"
 #include "paddle/fluid/distributed/common/cost_timer.h"
@@ -95,6 +96,18 @@ uint64_t BrpcPsServer::start(const std::string &ip, uint32_t port) {
 
 int32_t BrpcPsServer::port() { return _server.listen_address().port; }
 
+BrpcPsService::~BrpcPsService() {
+  std::vector<std::shared_ptr<ShmPsServerSession>> sessions;
+  {
+    std::lock_guard<std::mutex> guard(_shm_session_mutex);
+    sessions.swap(_shm_sessions);
+  }
+  // 在锁外停止会话, 会话线程退出时 remove_shm_session 需要加锁
+  for (auto &session : sessions) {
+    session->stop();
+  }
+}
+
 int32_t BrpcPsService::initialize() {
   _is_initialize_shard_info = false;
   _service_handler_map[PS_STOP_SERVER] = &BrpcPsService::stop_server;
@@ -118,6 +131,7 @@ int32_t BrpcPsService::initialize() {
   _service_handler_map[PS_START_PROFILER] = &BrpcPsService::start_profiler;
   _service_handler_map[PS_STOP_PROFILER] = &BrpcPsService::stop_profiler;
   _service_handler_map[PS_PUSH_GLOBAL_STEP] = &BrpcPsService::push_global_step;
+  _service_handler_map[PS_SHM_CONNECT] = &BrpcPsService::shm_connect;
   auto &profiler = CostProfiler::instance();
   profiler.register_profiler("pserver_server_pull_dense");
   profiler.register_profiler("pserver_server_push_dense");
@@ -612,5 +626,45 @@ int32_t BrpcPsService::push_global_step(Table *table,
   return 0;
 }
 
+int32_t BrpcPsService::shm_connect(Table *table,
+                                   const PsRequestMessage &request,
+                                   PsResponseMessage &response,
+                                   brpc::Controller *cntl) {
+  if (request.params_size() < 1) {
+    set_response_code(response, -1,
+                      "PsRequestMessage.params is requeired at "
+                      "least 1 for name of shm channel");
+    return 0;
+  }
+  const std::string &name = request.params(0);
+  std::unique_ptr<ShmChannel> channel(new ShmChannel());
+  if (channel->open(name) != 0) {
+    set_response_code(response, -1, "open shm channel failed");
+    return 0;
+  }
+  auto session = std::make_shared<ShmPsServerSession>(
+      _server, std::move(channel),
+      [this](ShmPsServerSession *s) { remove_shm_session(s); });
+  // 先登记再启动, 保证会话立即退出时也能被移除
+  std::lock_guard<std::mutex> guard(_shm_session_mutex);
+  _shm_sessions.push_back(session);
+  session->start();
+  VLOG(0) << "shm channel " << name << " connected, client_id:"
+          << request.client_id();
+  return 0;
+}
+
+void BrpcPsService::remove_shm_session(ShmPsServerSession *session) {
+  std::lock_guard<std::mutex> guard(_shm_session_mutex);
+  auto iter = std::find_if(
+      _shm_sessions.begin(), _shm_sessions.end(),
+      [session](const std::shared_ptr<ShmPsServerSession> &s) {
+        return s.get() == session;
+      });
+  if (iter != _shm_sessions.end()) {
+    _shm_sessions.erase(iter);
+  }
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -19,6 +19,7 @@
 #include "brpc/server.h"
 #include "paddle/fluid/distributed/ps/service/brpc_utils.h"
 #include "paddle/fluid/distributed/ps/service/server.h"
+#include "paddle/fluid/distributed/ps/service/shm_ps_service.h"
 
 namespace brpc {
 class Controller;
@@ -71,6 +72,8 @@ typedef int32_t (BrpcPsService::*serviceHandlerFunc)(
 
 class BrpcPsService : public PsBaseService {
  public:
+  virtual ~BrpcPsService();
+
   virtual int32_t initialize() override;
 
   virtual void service(::google::protobuf::RpcController *controller,
@@ -124,11 +127,19 @@ class BrpcPsService : public PsBaseService {
   int32_t push_global_step(Table *table, const PsRequestMessage &request,
                            PsResponseMessage &response, brpc::Controller *cntl);
 
+  int32_t shm_connect(Table *table, const PsRequestMessage &request,
+                      PsResponseMessage &response, brpc::Controller *cntl);
+  // 会话线程退出时调用, 从 _shm_sessions 中移除并释放该会话
+  void remove_shm_session(ShmPsServerSession *session);
+
   bool _is_initialize_shard_info;
   std::mutex _initialize_shard_mutex;
   std::unordered_map<int32_t, serviceHandlerFunc> _service_handler_map;
   std::unordered_map<int32_t, serviceHandlerFunc> _msg_handler_map;
   std::vector<float> _ori_values;
+
+  std::mutex _shm_session_mutex;
+  std::vector<std::shared_ptr<ShmPsServerSession>> _shm_sessions;
 };
 
 class DownpourPServerBrpcClosure : public PServerClosure {
@@ -17,6 +17,7 @@
 #include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
 #include "paddle/fluid/distributed/ps/service/graph_brpc_client.h"
 #include "paddle/fluid/distributed/ps/service/ps_local_client.h"
+#include "paddle/fluid/distributed/ps/service/shm_ps_client.h"
 #include "paddle/fluid/distributed/ps/table/table.h"
 
 namespace paddle {
@@ -24,6 +25,7 @@ namespace distributed {
 REGISTER_PSCORE_CLASS(PSClient, BrpcPsClient);
 REGISTER_PSCORE_CLASS(PSClient, PsLocalClient);
 REGISTER_PSCORE_CLASS(PSClient, GraphBrpcClient);
+REGISTER_PSCORE_CLASS(PSClient, ShmPsClient);
 
 int32_t PSClient::configure(
     const PSParameter &config,
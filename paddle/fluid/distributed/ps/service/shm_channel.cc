@@ -0,0 +1,244 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/shm_channel.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "glog/logging.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+// 自旋若干轮后再进入 futex 等待, 本机 pull/push 的往返通常在自旋期内完成
+constexpr int kShmSpinCount = 2048;
+// futex 等待超时, 超时后重新检查对端是否关闭
+constexpr int64_t kShmWaitTimeoutNs = 100 * 1000 * 1000;
+
+inline void futex_wait(std::atomic<uint32_t> *addr, uint32_t expected) {
+  struct timespec timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_nsec = kShmWaitTimeoutNs;
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, expected,
+          &timeout, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> *addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE, INT32_MAX,
+          nullptr, nullptr, 0);
+}
+
+inline size_t align_up(size_t size, size_t align) {
+  return (size + align - 1) / align * align;
+}
+
+}  // namespace
+
+void ShmRingBuffer::initialize(size_t capacity) {
+  _header->head.store(0);
+  _header->tail.store(0);
+  _header->data_seq.store(0);
+  _header->space_seq.store(0);
+  _header->data_waiters.store(0);
+  _header->space_waiters.store(0);
+  _header->closed.store(0);
+  _header->capacity = capacity;
+}
+
+bool ShmRingBuffer::write(const void *data, size_t len) {
+  const char *src = reinterpret_cast<const char *>(data);
+  const uint64_t capacity = _header->capacity;
+  int spin = 0;
+  while (len > 0) {
+    uint32_t seq = _header->space_seq.load(std::memory_order_acquire);
+    uint64_t head = _header->head.load(std::memory_order_relaxed);
+    uint64_t tail = _header->tail.load(std::memory_order_acquire);
+    uint64_t free_size = capacity - (head - tail);
+    if (free_size == 0) {
+      if (closed()) {
+        return false;
+      }
+      if (++spin < kShmSpinCount) {
+        continue;
+      }
+      _header->space_waiters.fetch_add(1);
+      futex_wait(&_header->space_seq, seq);
+      _header->space_waiters.fetch_sub(1);
+      continue;
+    }
+    spin = 0;
+    size_t n = std::min<uint64_t>(len, free_size);
+    size_t offset = head % capacity;
+    size_t first = std::min<uint64_t>(n, capacity - offset);
+    memcpy(_data + offset, src, first);
+    if (n > first) {
+      memcpy(_data, src + first, n - first);
+    }
+    _header->head.store(head + n, std::memory_order_release);
+    _header->data_seq.fetch_add(1, std::memory_order_release);
+    if (_header->data_waiters.load() > 0) {
+      futex_wake(&_header->data_seq);
+    }
+    src += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool ShmRingBuffer::read(void *data, size_t len) {
+  char *dst = reinterpret_cast<char *>(data);
+  const uint64_t capacity = _header->capacity;
+  int spin = 0;
+  while (len > 0) {
+    uint32_t seq = _header->data_seq.load(std::memory_order_acquire);
+    uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+    uint64_t head = _header->head.load(std::memory_order_acquire);
+    uint64_t ready_size = head - tail;
+    if (ready_size == 0) {
+      if (closed()) {
+        return false;
+      }
+      if (++spin < kShmSpinCount) {
+        continue;
+      }
+      _header->data_waiters.fetch_add(1);
+      futex_wait(&_header->data_seq, seq);
+      _header->data_waiters.fetch_sub(1);
+      continue;
+    }
+    spin = 0;
+    size_t n = std::min<uint64_t>(len, ready_size);
+    size_t offset = tail % capacity;
+    size_t first = std::min<uint64_t>(n, capacity - offset);
+    memcpy(dst, _data + offset, first);
+    if (n > first) {
+      memcpy(dst + first, _data, n - first);
+    }
+    _header->tail.store(tail + n, std::memory_order_release);
+    _header->space_seq.fetch_add(1, std::memory_order_release);
+    if (_header->space_waiters.load() > 0) {
+      futex_wake(&_header->space_seq);
+    }
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
+
+void ShmRingBuffer::close() {
+  _header->closed.store(1);
+  _header->data_seq.fetch_add(1);
+  _header->space_seq.fetch_add(1);
+  futex_wake(&_header->data_seq);
+  futex_wake(&_header->space_seq);
+}
+
+ShmChannel::~ShmChannel() {
+  if (_base != nullptr) {
+    munmap(_base, _mapped_size);
+    _base = nullptr;
+  }
+  unlink();
+}
+
+int32_t ShmChannel::create(const std::string &name, size_t capacity) {
+  _name = name;
+  capacity = align_up(capacity, 64);
+  size_t mapped_size = 2 * ShmRingBuffer::mapped_size(capacity);
+  int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, (mode_t)0600);
+  if (fd == -1) {
+    LOG(ERROR) << "shm_open failed, name:" << _name << " err:" << errno;
+    return -1;
+  }
+  _owner = true;
+  if (ftruncate(fd, mapped_size) != 0) {
+    LOG(ERROR) << "ftruncate shm failed, name:" << _name
+               << " size:" << mapped_size;
+    ::close(fd);
+    return -1;
+  }
+  return map(fd, mapped_size, capacity, true);
+}
+
+int32_t ShmChannel::open(const std::string &name) {
+  _name = name;
+  int fd = shm_open(_name.c_str(), O_RDWR, (mode_t)0600);
+  if (fd == -1) {
+    LOG(ERROR) << "shm_open failed, name:" << _name << " err:" << errno;
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    LOG(ERROR) << "fstat shm failed, name:" << _name;
+    ::close(fd);
+    return -1;
+  }
+  size_t mapped_size = st.st_size;
+  size_t capacity = mapped_size / 2 - sizeof(ShmRingHeader);
+  return map(fd, mapped_size, capacity, false);
+}
+
+int32_t ShmChannel::map(int fd, size_t mapped_size, size_t capacity,
+                        bool initialize) {
+  _base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (_base == MAP_FAILED) {
+    LOG(ERROR) << "mmap shm failed, name:" << _name;
+    _base = nullptr;
+    return -1;
+  }
+  _mapped_size = mapped_size;
+
+  char *base = reinterpret_cast<char *>(_base);
+  size_t ring_size = ShmRingBuffer::mapped_size(capacity);
+  _request_ring = ShmRingBuffer(reinterpret_cast<ShmRingHeader *>(base),
+                                base + sizeof(ShmRingHeader));
+  _response_ring =
+      ShmRingBuffer(reinterpret_cast<ShmRingHeader *>(base + ring_size),
+                    base + ring_size + sizeof(ShmRingHeader));
+  if (initialize) {
+    _request_ring.initialize(capacity);
+    _response_ring.initialize(capacity);
+  }
+  VLOG(1) << "ShmChannel mapped, name:" << _name << " capacity:" << capacity;
+  return 0;
+}
+
+void ShmChannel::unlink() {
+  if (_owner) {
+    shm_unlink(_name.c_str());
+    _owner = false;
+  }
+}
+
+void ShmChannel::close() {
+  if (_base == nullptr) {
+    return;
+  }
+  _request_ring.close();
+  _response_ring.close();
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,103 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace paddle {
+namespace distributed {
+
+// 共享内存环形缓冲区的控制头, 由读写双方进程共同映射.
+// head/tail 为累计写入/读取的字节数, 两个 futex 字分别用于
+// "有数据可读" 与 "有空间可写" 的等待/唤醒.
+struct alignas(64) ShmRingHeader {
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> data_seq;
+  std::atomic<uint32_t> space_seq;
+  std::atomic<uint32_t> data_waiters;
+  std::atomic<uint32_t> space_waiters;
+  std::atomic<uint32_t> closed;
+  uint64_t capacity;
+};
+
+// 单生产者/单消费者的字节流环形缓冲区.
+// 写入超过剩余空间时会分段写入并等待读方消费, 因此消息长度不受容量限制.
+class ShmRingBuffer {
+ public:
+  ShmRingBuffer() : _header(nullptr), _data(nullptr) {}
+  ShmRingBuffer(ShmRingHeader *header, char *data)
+      : _header(header), _data(data) {}
+
+  static size_t mapped_size(size_t capacity) {
+    return sizeof(ShmRingHeader) + capacity;
+  }
+
+  void initialize(size_t capacity);
+  // 阻塞直到全部写入/读出, 对端关闭时返回false
+  bool write(const void *data, size_t len);
+  bool read(void *data, size_t len);
+  void close();
+  bool closed() const { return _header->closed.load() != 0; }
+
+ private:
+  ShmRingHeader *_header;
+  char *_data;
+};
+
+// 共享内存消息头, 请求与响应共用
+struct ShmMessageHeader {
+  int32_t cmd_id;      // 请求: PsCmdID; 响应: 错误码
+  uint32_t table_id;
+  uint32_t num;        // key 个数
+  uint32_t flag;       // pull_sparse 时为 is_training
+  uint64_t data_size;  // 紧随消息头的负载字节数
+};
+
+// 一条 client<->server 的共享内存通道, 包含请求与响应两个环形缓冲区.
+// 由 client 端 create 并负责 unlink, server 端 open 同名段.
+class ShmChannel {
+ public:
+  ShmChannel() {}
+  ~ShmChannel();
+  ShmChannel(const ShmChannel &) = delete;
+  ShmChannel &operator=(const ShmChannel &) = delete;
+
+  int32_t create(const std::string &name, size_t capacity);
+  int32_t open(const std::string &name);
+  // 关闭两个方向的环形缓冲区, 唤醒所有等待方
+  void close();
+  // 双方均已映射后即可删除共享内存名, 进程异常退出时不残留
+  void unlink();
+
+  ShmRingBuffer *request_ring() { return &_request_ring; }
+  ShmRingBuffer *response_ring() { return &_response_ring; }
+  const std::string &name() const { return _name; }
+
+ private:
+  int32_t map(int fd, size_t mapped_size, size_t capacity, bool initialize);
+
+  std::string _name;
+  bool _owner = false;
+  void *_base = nullptr;
+  size_t _mapped_size = 0;
+  ShmRingBuffer _request_ring;
+  ShmRingBuffer _response_ring;
+};
+
+}  // namespace distributed
+}  // namespace paddle
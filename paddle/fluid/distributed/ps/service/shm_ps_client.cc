@@ -0,0 +1,368 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/shm_ps_client.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+DEFINE_int32(pserver_shm_channel_capacity_mb, 64,
+             "ring buffer capacity of each shm channel to local pserver");
+
+DECLARE_int32(pserver_sparse_table_shard_num);
+
+namespace paddle {
+namespace distributed {
+
+ShmPsClient::~ShmPsClient() {
+  for (auto &shard : _local_shards) {
+    if (shard != nullptr && shard->channel != nullptr) {
+      shard->channel->close();
+    }
+  }
+}
+
+int32_t ShmPsClient::initialize() {
+  int32_t ret = BrpcPsClient::initialize();
+  if (ret != 0) {
+    return ret;
+  }
+  auto &profiler = CostProfiler::instance();
+  profiler.register_profiler("pserver_client_pull_sparse_shm");
+  profiler.register_profiler("pserver_client_push_sparse_shm");
+  return connect_local_servers();
+}
+
+int32_t ShmPsClient::connect_local_servers() {
+  std::string client_ip(butil::my_ip_cstr());
+  std::vector<PSHost> server_list = _env->get_ps_servers();
+  _local_shards.resize(server_list.size());
+  size_t capacity =
+      static_cast<size_t>(FLAGS_pserver_shm_channel_capacity_mb) << 20;
+  std::ostringstream os;
+  for (size_t i = 0; i < server_list.size(); ++i) {
+    if (server_list[i].ip != client_ip && server_list[i].ip != "127.0.0.1") {
+      continue;
+    }
+    std::string name = "/paddle_ps_shm_" + std::to_string(getpid()) + "_" +
+                       std::to_string(_client_id) + "_" + std::to_string(i);
+    std::unique_ptr<LocalShard> shard(new LocalShard());
+    shard->channel.reset(new ShmChannel());
+    if (shard->channel->create(name, capacity) != 0) {
+      LOG(WARNING) << "create shm channel failed, use brpc for server:" << i;
+      continue;
+    }
+
+    brpc::Controller cntl;
+    PsRequestMessage request;
+    PsResponseMessage response;
+    request.set_cmd_id(PS_SHM_CONNECT);
+    request.set_table_id(0);
+    request.set_client_id(_client_id);
+    request.add_params(name);
+    PsService_Stub rpc_stub(get_cmd_channel(i));
+    rpc_stub.service(&cntl, &request, &response, NULL);
+    if (cntl.Failed() || response.err_code() != 0) {
+      LOG(WARNING) << "connect shm channel failed, use brpc for server:" << i
+                   << " err:" << cntl.ErrorText() << response.err_msg();
+      // server 端可能已映射通道, 关闭后其会话随之退出
+      shard->channel->close();
+      continue;
+    }
+    // server 已映射, 删除共享内存名避免进程异常退出时残留
+    shard->channel->unlink();
+    shard->connected = true;
+    _local_shards[i] = std::move(shard);
+    os << server_list[i].ip << ":" << server_list[i].port << ",";
+  }
+  LOG(INFO) << "ShmPsClient local servers:" << os.str();
+  return 0;
+}
+
+uint64_t ShmPsClient::sparse_shard_num(size_t table_id) {
+  const auto &server_param = _config.server_param().downpour_server_param();
+  for (int i = 0; i < server_param.downpour_table_param_size(); ++i) {
+    const auto &table_param = server_param.downpour_table_param(i);
+    if (table_param.table_id() == table_id) {
+      return table_param.shard_num();
+    }
+  }
+  return FLAGS_pserver_sparse_table_shard_num;
+}
+
+std::future<int32_t> ShmPsClient::pull_sparse(float **select_values,
+                                              size_t table_id,
+                                              const uint64_t *keys, size_t num,
+                                              bool is_training) {
+  size_t server_num = get_server_nums();
+  uint64_t shard_num = sparse_shard_num(table_id);
+
+  std::vector<PullKvList> local_kvs(server_num);
+  std::vector<uint64_t> remote_keys;
+  std::vector<float *> remote_values;
+  bool has_local = false;
+  for (size_t i = 0; i < num; ++i) {
+    size_t shard_id = get_sparse_shard(shard_num, server_num, keys[i]);
+    if (is_local(shard_id)) {
+      local_kvs[shard_id].push_back({keys[i], select_values[i]});
+      has_local = true;
+    } else {
+      remote_keys.push_back(keys[i]);
+      remote_values.push_back(select_values[i]);
+    }
+  }
+  if (!has_local) {
+    return BrpcPsClient::pull_sparse(select_values, table_id, keys, num,
+                                     is_training);
+  }
+
+  // 远端请求先异步发出, 与本机共享内存请求重叠
+  std::future<int32_t> remote_fut;
+  bool has_remote = !remote_keys.empty();
+  if (has_remote) {
+    remote_fut = BrpcPsClient::pull_sparse(remote_values.data(), table_id,
+                                           remote_keys.data(),
+                                           remote_keys.size(), is_training);
+  }
+
+  int32_t ret = 0;
+  for (size_t i = 0; i < server_num; ++i) {
+    auto &kvs = local_kvs[i];
+    if (kvs.empty()) {
+      continue;
+    }
+    int32_t local_ret = pull_sparse_local(i, table_id, &kvs, is_training);
+    if (local_ret == 0) {
+      continue;
+    }
+    if (is_local(i)) {
+      // 通道正常, 错误来自 server 端 table
+      ret = local_ret;
+      continue;
+    }
+    std::vector<uint64_t> fallback_keys(kvs.size());
+    std::vector<float *> fallback_values(kvs.size());
+    for (size_t kv_idx = 0; kv_idx < kvs.size(); ++kv_idx) {
+      fallback_keys[kv_idx] = kvs[kv_idx].first;
+      fallback_values[kv_idx] = kvs[kv_idx].second;
+    }
+    auto fallback_fut =
+        BrpcPsClient::pull_sparse(fallback_values.data(), table_id,
+                                  fallback_keys.data(), fallback_keys.size(),
+                                  is_training);
+    fallback_fut.wait();
+    if (fallback_fut.get() != 0) {
+      ret = -1;
+    }
+  }
+
+  if (has_remote) {
+    remote_fut.wait();
+    if (remote_fut.get() != 0) {
+      ret = -1;
+    }
+  }
+  std::promise<int32_t> promise;
+  promise.set_value(ret);
+  return promise.get_future();
+}
+
+int32_t ShmPsClient::pull_sparse_local(size_t server_idx, size_t table_id,
+                                       PullKvList *kvs, bool is_training) {
+  CostTimer timer("pserver_client_pull_sparse_shm");
+  std::sort(kvs->begin(), kvs->end(),
+            [](const std::pair<uint64_t, float *> &k1,
+               const std::pair<uint64_t, float *> &k2) {
+              return k1.first < k2.first;
+            });
+  std::vector<uint64_t> unique_keys;
+  std::vector<uint32_t> keys_counter;
+  unique_keys.reserve(kvs->size());
+  keys_counter.reserve(kvs->size());
+  for (size_t kv_idx = 0; kv_idx < kvs->size(); ++kv_idx) {
+    if (!unique_keys.empty() && unique_keys.back() == (*kvs)[kv_idx].first) {
+      ++keys_counter.back();
+    } else {
+      unique_keys.push_back((*kvs)[kv_idx].first);
+      keys_counter.push_back(1);
+    }
+  }
+
+  auto *accessor = table_accessor(table_id);
+  size_t value_size = accessor->select_size();
+  ShmMessageHeader header;
+  header.cmd_id = PS_PULL_SPARSE_TABLE;
+  header.table_id = table_id;
+  header.num = unique_keys.size();
+  header.flag = is_training ? 1 : 0;
+  header.data_size = header.num * (sizeof(uint64_t) + sizeof(uint32_t));
+
+  auto &shard = _local_shards[server_idx];
+  std::lock_guard<std::mutex> guard(shard->mutex);
+  // 其他线程可能在加锁前已断开通道
+  if (!shard->connected) {
+    return -1;
+  }
+  auto *request_ring = shard->channel->request_ring();
+  auto *response_ring = shard->channel->response_ring();
+  ShmMessageHeader response;
+  if (!request_ring->write(&header, sizeof(header)) ||
+      !request_ring->write(unique_keys.data(),
+                           unique_keys.size() * sizeof(uint64_t)) ||
+      !request_ring->write(keys_counter.data(),
+                           keys_counter.size() * sizeof(uint32_t)) ||
+      !response_ring->read(&response, sizeof(response))) {
+    LOG(WARNING) << "shm channel to server:" << server_idx
+                 << " closed, fallback to brpc";
+    disconnect(shard.get());
+    return -1;
+  }
+  ++_shm_request_num;
+  if (response.cmd_id != 0) {
+    return response.cmd_id;
+  }
+  if (response.data_size != header.num * value_size) {
+    LOG(WARNING) << "shm pull_sparse response size mismatch, server:"
+                 << server_idx;
+    disconnect(shard.get());
+    return -1;
+  }
+
+  // 直接从环形缓冲区拷贝到调用方 buffer, 重复 key 复用首个结果
+  size_t kv_idx = 0;
+  for (size_t i = 0; i < unique_keys.size(); ++i) {
+    float *first_value = (*kvs)[kv_idx].second;
+    if (!response_ring->read(first_value, value_size)) {
+      disconnect(shard.get());
+      return -1;
+    }
+    for (uint32_t j = 1; j < keys_counter[i]; ++j) {
+      memcpy((*kvs)[kv_idx + j].second, first_value, value_size);
+    }
+    kv_idx += keys_counter[i];
+  }
+  return 0;
+}
+
+std::future<int32_t> ShmPsClient::push_sparse(size_t table_id,
+                                              const uint64_t *keys,
+                                              const float **update_values,
+                                              size_t num) {
+  size_t server_num = get_server_nums();
+  uint64_t shard_num = sparse_shard_num(table_id);
+
+  std::vector<PushKvList> local_kvs(server_num);
+  std::vector<uint64_t> remote_keys;
+  std::vector<const float *> remote_values;
+  bool has_local = false;
+  for (size_t i = 0; i < num; ++i) {
+    size_t shard_id = get_sparse_shard(shard_num, server_num, keys[i]);
+    if (is_local(shard_id)) {
+      local_kvs[shard_id].push_back({keys[i], update_values[i]});
+      has_local = true;
+    } else {
+      remote_keys.push_back(keys[i]);
+      remote_values.push_back(update_values[i]);
+    }
+  }
+  if (!has_local) {
+    return BrpcPsClient::push_sparse(table_id, keys, update_values, num);
+  }
+
+  int32_t ret = 0;
+  for (size_t i = 0; i < server_num; ++i) {
+    auto &kvs = local_kvs[i];
+    if (kvs.empty()) {
+      continue;
+    }
+    int32_t local_ret = push_sparse_local(i, table_id, kvs);
+    if (local_ret == 0) {
+      continue;
+    }
+    if (is_local(i)) {
+      ret = local_ret;
+      continue;
+    }
+    // 回退到 brpc 的异步 push 队列, 与远端 key 一起发送
+    for (auto &kv : kvs) {
+      remote_keys.push_back(kv.first);
+      remote_values.push_back(kv.second);
+    }
+  }
+  if (!remote_keys.empty() && ret == 0) {
+    // BrpcPsClient::push_sparse 在返回前已拷贝 values, 异步 future 可直接返回
+    return BrpcPsClient::push_sparse(table_id, remote_keys.data(),
+                                     remote_values.data(), remote_keys.size());
+  }
+  if (!remote_keys.empty()) {
+    BrpcPsClient::push_sparse(table_id, remote_keys.data(),
+                              remote_values.data(), remote_keys.size());
+  }
+  std::promise<int32_t> promise;
+  promise.set_value(ret);
+  return promise.get_future();
+}
+
+int32_t ShmPsClient::push_sparse_local(size_t server_idx, size_t table_id,
+                                       const PushKvList &kvs) {
+  CostTimer timer("pserver_client_push_sparse_shm");
+  auto *accessor = table_accessor(table_id);
+  size_t value_size = accessor->update_size();
+  std::vector<uint64_t> push_keys(kvs.size());
+  for (size_t kv_idx = 0; kv_idx < kvs.size(); ++kv_idx) {
+    push_keys[kv_idx] = kvs[kv_idx].first;
+  }
+
+  ShmMessageHeader header;
+  header.cmd_id = PS_PUSH_SPARSE_TABLE;
+  header.table_id = table_id;
+  header.num = kvs.size();
+  header.flag = 0;
+  header.data_size = header.num * (sizeof(uint64_t) + value_size);
+
+  auto &shard = _local_shards[server_idx];
+  std::lock_guard<std::mutex> guard(shard->mutex);
+  if (!shard->connected) {
+    return -1;
+  }
+  auto *request_ring = shard->channel->request_ring();
+  auto *response_ring = shard->channel->response_ring();
+  bool ok = request_ring->write(&header, sizeof(header)) &&
+            request_ring->write(push_keys.data(),
+                                push_keys.size() * sizeof(uint64_t));
+  // 梯度直接从调用方 buffer 写入环形缓冲区, 无需先拼接
+  for (size_t kv_idx = 0; ok && kv_idx < kvs.size(); ++kv_idx) {
+    ok = request_ring->write(kvs[kv_idx].second, value_size);
+  }
+  ShmMessageHeader response;
+  if (!ok || !response_ring->read(&response, sizeof(response))) {
+    LOG(WARNING) << "shm channel to server:" << server_idx
+                 << " closed, fallback to brpc";
+    disconnect(shard.get());
+    return -1;
+  }
+  ++_shm_request_num;
+  return response.cmd_id;
+}
+
+void ShmPsClient::disconnect(LocalShard *shard) {
+  shard->connected = false;
+  // 关闭通道, server 端会话线程退出, 不再占用映射的共享内存
+  shard->channel->close();
+}
+
+}  // namespace distributed
+}  // namespace paddle
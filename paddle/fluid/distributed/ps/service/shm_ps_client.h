@@ -0,0 +1,81 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/distributed/ps/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/ps/service/shm_channel.h"
+
+namespace paddle {
+namespace distributed {
+
+// 同机部署 trainer 与 pserver 时使用的 client.
+// 初始化时探测与本机 ip 相同的 server, 通过 brpc 下发 PS_SHM_CONNECT
+// 建立共享内存通道; 之后落在本机 shard 上的 pull/push sparse 请求
+// 直接经共享内存环形缓冲区收发, 其余请求仍走 BrpcPsClient.
+// 共享内存通道失效时自动回退到 brpc.
+class ShmPsClient : public BrpcPsClient {
+ public:
+  ShmPsClient() {}
+  virtual ~ShmPsClient();
+
+  std::future<int32_t> pull_sparse(float **select_values, size_t table_id,
+                                   const uint64_t *keys, size_t num,
+                                   bool is_training) override;
+  std::future<int32_t> push_sparse(size_t table_id, const uint64_t *keys,
+                                   const float **update_values,
+                                   size_t num) override;
+
+  // 经共享内存完成的 pull/push sparse 请求数, 每个本机 server 计一次
+  uint64_t shm_request_num() const { return _shm_request_num; }
+
+ protected:
+  int32_t initialize() override;
+
+ private:
+  typedef std::vector<std::pair<uint64_t, float *>> PullKvList;
+  typedef std::vector<std::pair<uint64_t, const float *>> PushKvList;
+
+  struct LocalShard {
+    std::unique_ptr<ShmChannel> channel;
+    std::mutex mutex;
+    std::atomic<bool> connected{false};
+  };
+
+  int32_t connect_local_servers();
+  uint64_t sparse_shard_num(size_t table_id);
+  inline bool is_local(size_t server_idx) {
+    return _local_shards[server_idx] != nullptr &&
+           _local_shards[server_idx]->connected;
+  }
+  // 返回 0 成功; 返回非 0 时调用方回退到 brpc
+  int32_t pull_sparse_local(size_t server_idx, size_t table_id,
+                            PullKvList *kvs, bool is_training);
+  int32_t push_sparse_local(size_t server_idx, size_t table_id,
+                            const PushKvList &kvs);
+  // 需持有 shard->mutex, 之后该 server 的请求回退到 brpc
+  void disconnect(LocalShard *shard);
+
+  std::vector<std::unique_ptr<LocalShard>> _local_shards;
+  std::atomic<uint64_t> _shm_request_num{0};
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,173 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/service/shm_ps_service.h"
+
+#include "paddle/fluid/distributed/common/cost_timer.h"
+#include "paddle/fluid/distributed/ps/service/sendrecv.pb.h"
+#include "paddle/fluid/distributed/ps/service/server.h"
+#include "paddle/fluid/distributed/ps/table/depends/sparse_utils.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+
+namespace paddle {
+namespace distributed {
+
+void ShmPsServerSession::start() {
+  _running = true;
+  _thread = std::thread(std::bind(&ShmPsServerSession::serve, this));
+}
+
+void ShmPsServerSession::stop() {
+  if (!_running.exchange(false)) {
+    return;
+  }
+  _channel->close();
+  if (!_thread.joinable()) {
+    return;
+  }
+  if (_thread.get_id() == std::this_thread::get_id()) {
+    // 会话线程在 on_exit 中释放自身, 线程随即返回
+    _thread.detach();
+  } else {
+    _thread.join();
+  }
+}
+
+void ShmPsServerSession::serve() {
+  auto *request_ring = _channel->request_ring();
+  ShmMessageHeader header;
+  while (_running) {
+    if (!request_ring->read(&header, sizeof(header))) {
+      break;
+    }
+    auto *table = _server->table(header.table_id);
+    int32_t ret = 0;
+    switch (header.cmd_id) {
+      case PS_PULL_SPARSE_TABLE:
+        ret = pull_sparse(table, header);
+        break;
+      case PS_PUSH_SPARSE_TABLE:
+        ret = push_sparse(table, header);
+        break;
+      default:
+        LOG(ERROR) << "unsupported shm cmd_id:" << header.cmd_id;
+        ret = -1;
+        break;
+    }
+    if (ret != 0) {
+      // 负载已无法与消息边界对齐, 关闭通道, client 回退到 brpc
+      LOG(ERROR) << "shm session " << _channel->name()
+                 << " failed, cmd_id:" << header.cmd_id;
+      break;
+    }
+  }
+  _channel->close();
+  VLOG(1) << "shm session " << _channel->name() << " exit";
+  // on_exit 可能析构本会话, 之后不能再访问成员
+  ExitCallback on_exit = _on_exit;
+  if (_running && on_exit) {
+    on_exit(this);
+  }
+}
+
+bool ShmPsServerSession::respond(int32_t ret, const ShmMessageHeader &header,
+                                 const void *data, size_t size) {
+  ShmMessageHeader response = header;
+  response.cmd_id = ret;
+  response.data_size = size;
+  auto *response_ring = _channel->response_ring();
+  if (!response_ring->write(&response, sizeof(response))) {
+    return false;
+  }
+  return size == 0 || response_ring->write(data, size);
+}
+
+int32_t ShmPsServerSession::pull_sparse(Table *table,
+                                        const ShmMessageHeader &header) {
+  /*
+  Request Content:
+  |---8*{num}B(keysData)------|
+  |---4*{num}B(Frequencies)---|
+  */
+  CostTimer timer("pserver_server_pull_sparse");
+  uint32_t num = header.num;
+  if (header.data_size != num * (sizeof(uint64_t) + sizeof(uint32_t))) {
+    LOG(ERROR) << "shm pull_sparse data size mismatch, num:" << num
+               << " data_size:" << header.data_size;
+    return -1;
+  }
+  auto *request_ring = _channel->request_ring();
+  _keys.resize(num);
+  _frequencies.resize(num);
+  if (!request_ring->read(_keys.data(), num * sizeof(uint64_t)) ||
+      !request_ring->read(_frequencies.data(), num * sizeof(uint32_t))) {
+    return -1;
+  }
+  if (table == NULL) {
+    LOG(WARNING) << "table not found with table_id:" << header.table_id;
+    return respond(-1, header) ? 0 : -1;
+  }
+
+  auto dim = table->value_accesor()->select_dim();
+  PullSparseValue value(num, dim);
+  value.is_training_ = header.flag != 0;
+  value.feasigns_ = _keys.data();
+  value.frequencies_ = _frequencies.data();
+  _values.resize(num * dim);
+  int32_t ret = table->pull_sparse(_values.data(), value);
+  if (ret != 0) {
+    return respond(ret, header) ? 0 : -1;
+  }
+  return respond(0, header, _values.data(), _values.size() * sizeof(float))
+             ? 0
+             : -1;
+}
+
+int32_t ShmPsServerSession::push_sparse(Table *table,
+                                        const ShmMessageHeader &header) {
+  /*
+  Request Content:
+  |---keysData---|---valuesData---|
+  |---8*{num}B---|----------------|
+  */
+  CostTimer timer("pserver_server_push_sparse");
+  uint32_t num = header.num;
+  if (header.data_size < num * sizeof(uint64_t)) {
+    LOG(ERROR) << "shm push_sparse data size mismatch, num:" << num
+               << " data_size:" << header.data_size;
+    return -1;
+  }
+  size_t value_bytes = header.data_size - num * sizeof(uint64_t);
+  auto *request_ring = _channel->request_ring();
+  _keys.resize(num);
+  _values.resize(value_bytes / sizeof(float));
+  if (!request_ring->read(_keys.data(), num * sizeof(uint64_t)) ||
+      !request_ring->read(_values.data(), value_bytes)) {
+    return -1;
+  }
+  if (table == NULL) {
+    LOG(WARNING) << "table not found with table_id:" << header.table_id;
+    return respond(-1, header) ? 0 : -1;
+  }
+  if (num > 0 && value_bytes != num * table->value_accesor()->update_size()) {
+    LOG(WARNING) << "shm push_sparse value size mismatch, num:" << num
+                 << " value_bytes:" << value_bytes;
+    return respond(-1, header) ? 0 : -1;
+  }
+  int32_t ret = table->push_sparse(_keys.data(), _values.data(), num);
+  return respond(ret, header) ? 0 : -1;
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paddle/fluid/distributed/ps/service/shm_channel.h"
+
+namespace paddle {
+namespace distributed {
+
+class PSServer;
+class Table;
+
+// server 端为每个同机 client 启动的共享内存会话.
+// 会话线程从请求环读取 pull/push sparse 请求, 直接调用 table 处理,
+// 结果写回响应环, 不经过 protobuf 序列化与 TCP loopback.
+// 通道被 client 关闭或出错时会话线程退出, 并调用 on_exit 通知持有者释放会话.
+class ShmPsServerSession {
+ public:
+  typedef std::function<void(ShmPsServerSession *)> ExitCallback;
+
+  ShmPsServerSession(PSServer *server, std::unique_ptr<ShmChannel> channel,
+                     ExitCallback on_exit = nullptr)
+      : _server(server),
+        _channel(std::move(channel)),
+        _on_exit(std::move(on_exit)) {}
+  ~ShmPsServerSession() { stop(); }
+
+  void start();
+  void stop();
+
+ private:
+  void serve();
+  int32_t pull_sparse(Table *table, const ShmMessageHeader &header);
+  int32_t push_sparse(Table *table, const ShmMessageHeader &header);
+  bool respond(int32_t ret, const ShmMessageHeader &header,
+               const void *data = nullptr, size_t size = 0);
+
+  PSServer *_server;
+  std::unique_ptr<ShmChannel> _channel;
+  ExitCallback _on_exit;
+  std::thread _thread;
+  std::atomic<bool> _running{false};
+
+  std::vector<uint64_t> _keys;
+  std::vector<uint32_t> _frequencies;
+  std::vector<float> _values;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,235 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/ctr_quant_accessor.h"
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/common/local_random.h"
+#include "paddle/fluid/platform/float16.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+// fp16 能表示的最大值, g2sum 超出时截断而不是变成 inf
+const float kFp16Max = 65504.0f;
+
+// 压缩段的第一个 float 存 scale, 之后每个 float 存 4 个 int8
+void quantize_int8(const float* src, int n, float* dst, bool stochastic) {
+  if (n == 0) {
+    return;
+  }
+  float max_abs = 0;
+  for (int i = 0; i < n; ++i) {
+    max_abs = std::max(max_abs, std::fabs(src[i]));
+  }
+  float scale = max_abs / 127;
+  dst[0] = scale;
+  int8_t* quant = reinterpret_cast<int8_t*>(dst + 1);
+  for (int i = 0; i < n; ++i) {
+    float x = scale > 0 ? src[i] / scale : 0;
+    // 随机舍入使小于半个量化步长的更新在期望意义上不丢失
+    if (stochastic) {
+      x = std::floor(x + local_uniform_real_distribution<float>()(
+                             local_random_engine()));
+    } else {
+      x = std::round(x);
+    }
+    quant[i] = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, x)));
+  }
+  for (int i = n; i < (n + 3) / 4 * 4; ++i) {
+    quant[i] = 0;
+  }
+}
+
+void dequantize_int8(const float* src, int n, float* dst) {
+  if (n == 0) {
+    return;
+  }
+  float scale = src[0];
+  const int8_t* quant = reinterpret_cast<const int8_t*>(src + 1);
+  for (int i = 0; i < n; ++i) {
+    dst[i] = quant[i] * scale;
+  }
+}
+
+// 每个 float 存 2 个 fp16
+void quantize_fp16(const float* src, int n, float* dst) {
+  char* half = reinterpret_cast<char*>(dst);
+  for (int i = 0; i < (n + 1) / 2 * 2; ++i) {
+    float x = i < n ? std::max(-kFp16Max, std::min(kFp16Max, src[i])) : 0;
+    uint16_t bits = platform::float16(x).x;
+    memcpy(half + i * sizeof(uint16_t), &bits, sizeof(uint16_t));
+  }
+}
+
+void dequantize_fp16(const float* src, int n, float* dst) {
+  const char* half = reinterpret_cast<const char*>(src);
+  for (int i = 0; i < n; ++i) {
+    uint16_t bits;
+    memcpy(&bits, half + i * sizeof(uint16_t), sizeof(uint16_t));
+    dst[i] = static_cast<float>(platform::raw_uint16_to_float16(bits));
+  }
+}
+
+}  // namespace
+
+int CtrQuantAccessor::initialize() {
+  CtrCommonAccessor::initialize();
+  quant_feature_value.embed_sgd_dim = common_feature_value.embed_sgd_dim;
+  quant_feature_value.embedx_dim = common_feature_value.embedx_dim;
+  quant_feature_value.embedx_sgd_dim = common_feature_value.embedx_sgd_dim;
+
+  auto quant_type = _config.ctr_accessor_param().quant_type();
+  if (quant_type == "fp16") {
+    quant_feature_value.quant_type = QUANT_FP16;
+  } else if (quant_type == "int8") {
+    quant_feature_value.quant_type = QUANT_INT8;
+  } else {
+    LOG(ERROR) << "CtrQuantAccessor unsupported quant_type:" << quant_type
+               << ", expect fp16 or int8";
+    return -1;
+  }
+  VLOG(0) << "CtrQuantAccessor quant_type:" << quant_type
+          << " value dim:" << quant_feature_value.dim()
+          << " (fp32 dim:" << common_feature_value.dim() << ")";
+  return 0;
+}
+
+size_t CtrQuantAccessor::dim() { return quant_feature_value.dim(); }
+
+size_t CtrQuantAccessor::size() { return quant_feature_value.size(); }
+
+size_t CtrQuantAccessor::mf_size() {
+  return (quant_feature_value.dim() - quant_feature_value.embedx_w_index()) *
+         sizeof(float);  // packed embedx embedx_g2sum
+}
+
+bool CtrQuantAccessor::has_mf(size_t size) {
+  return size > quant_feature_value.embedx_w_index();
+}
+
+void CtrQuantAccessor::quantize_value(const float* common_value, float* value,
+                                      bool stochastic) {
+  memcpy(value, common_value,
+         quant_feature_value.embedx_w_index() * sizeof(float));
+  const float* embedx_w = common_value + common_feature_value.embedx_w_index();
+  const float* embedx_g2sum =
+      common_value + common_feature_value.embedx_g2sum_index();
+  if (quant_feature_value.quant_type == QUANT_INT8) {
+    quantize_int8(embedx_w, quant_feature_value.embedx_dim,
+                  value + quant_feature_value.embedx_w_index(), stochastic);
+    quantize_int8(embedx_g2sum, quant_feature_value.embedx_sgd_dim,
+                  value + quant_feature_value.embedx_g2sum_index(),
+                  stochastic);
+  } else {
+    quantize_fp16(embedx_w, quant_feature_value.embedx_dim,
+                  value + quant_feature_value.embedx_w_index());
+    quantize_fp16(embedx_g2sum, quant_feature_value.embedx_sgd_dim,
+                  value + quant_feature_value.embedx_g2sum_index());
+  }
+}
+
+void CtrQuantAccessor::dequantize_value(const float* value, size_t value_size,
+                                        float* common_value) {
+  memcpy(common_value, value,
+         quant_feature_value.embedx_w_index() * sizeof(float));
+  float* embedx_w = common_value + common_feature_value.embedx_w_index();
+  float* embedx_g2sum =
+      common_value + common_feature_value.embedx_g2sum_index();
+  if (!has_mf(value_size)) {
+    size_t mf_dim =
+        common_feature_value.dim() - common_feature_value.embedx_w_index();
+    memset(embedx_w, 0, mf_dim * sizeof(float));
+    return;
+  }
+  if (quant_feature_value.quant_type == QUANT_INT8) {
+    dequantize_int8(value + quant_feature_value.embedx_w_index(),
+                    quant_feature_value.embedx_dim, embedx_w);
+    dequantize_int8(value + quant_feature_value.embedx_g2sum_index(),
+                    quant_feature_value.embedx_sgd_dim, embedx_g2sum);
+  } else {
+    dequantize_fp16(value + quant_feature_value.embedx_w_index(),
+                    quant_feature_value.embedx_dim, embedx_w);
+    dequantize_fp16(value + quant_feature_value.embedx_g2sum_index(),
+                    quant_feature_value.embedx_sgd_dim, embedx_g2sum);
+  }
+}
+
+int32_t CtrQuantAccessor::create(float** values, size_t num) {
+  float common_value[common_feature_value.dim()];  // NOLINT
+  float* common_value_ptr = common_value;
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    CtrCommonAccessor::create(&common_value_ptr, 1);
+    quantize_value(common_value, values[value_item], false);
+  }
+  return 0;
+}
+
+// from quantized CtrQuantFeatureValue to CtrCommonPullValue
+int32_t CtrQuantAccessor::select(float** select_values, const float** values,
+                                 size_t num) {
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* select_value = select_values[value_item];
+    const float* value = values[value_item];
+    select_value[CtrCommonPullValue::embed_w_index()] =
+        value[common_feature_value.embed_w_index()];
+    float* embedx_w = select_value + CtrCommonPullValue::embedx_w_index();
+    const float* packed = value + quant_feature_value.embedx_w_index();
+    if (quant_feature_value.quant_type == QUANT_INT8) {
+      dequantize_int8(packed, quant_feature_value.embedx_dim, embedx_w);
+    } else {
+      dequantize_fp16(packed, quant_feature_value.embedx_dim, embedx_w);
+    }
+  }
+  return 0;
+}
+
+// 反量化到 fp32 后复用 CtrCommonAccessor 的更新逻辑, 再随机舍入量化回去
+int32_t CtrQuantAccessor::update(float** update_values,
+                                 const float** push_values, size_t num) {
+  float common_value[common_feature_value.dim()];  // NOLINT
+  float* common_value_ptr = common_value;
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* update_value = update_values[value_item];
+    dequantize_value(update_value, quant_feature_value.dim(), common_value);
+    CtrCommonAccessor::update(&common_value_ptr, &push_values[value_item], 1);
+    quantize_value(common_value, update_value, true);
+  }
+  return 0;
+}
+
+std::string CtrQuantAccessor::parse_to_string(const float* v, int param) {
+  float common_value[common_feature_value.dim()];  // NOLINT
+  dequantize_value(v, param, common_value);
+  int common_size = has_mf(param) ? common_feature_value.dim()
+                                  : common_feature_value.embedx_w_index();
+  return CtrCommonAccessor::parse_to_string(common_value, common_size);
+}
+
+int CtrQuantAccessor::parse_from_string(const std::string& str, float* value) {
+  float common_value[common_feature_value.dim()];  // NOLINT
+  int ret = CtrCommonAccessor::parse_from_string(str, common_value);
+  quantize_value(common_value, value, false);
+  return ret > common_feature_value.embedx_w_index()
+             ? quant_feature_value.dim()
+             : quant_feature_value.embedx_w_index();
+}
+
+}  // namespace distributed
+}  // namespace paddle
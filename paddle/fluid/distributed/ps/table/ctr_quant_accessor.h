@@ -0,0 +1,110 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/ps/table/ctr_accessor.h"
+
+namespace paddle {
+namespace distributed {
+
+// 与 CtrCommonAccessor 语义一致, 但 embedx_w 与 embedx_g2sum 以 fp16 或
+// int8(每行一个 scale) 压缩存放, pull 时反量化.
+// 表中 value 的前半部分(slot ~ embed_g2sum)仍为 fp32, 与 CtrCommonAccessor
+// 完全相同, 因此 shrink/save/need_extend_mf 等只读前半部分的逻辑直接复用.
+// mf 部分照旧在 show/click 达到 embedx_threshold 后才由 table 分配.
+// save/load 的文本格式与 CtrCommonAccessor 相同, 两者的 checkpoint 可互相加载.
+class CtrQuantAccessor : public CtrCommonAccessor {
+ public:
+  enum QuantType { QUANT_FP16 = 0, QUANT_INT8 = 1 };
+
+  struct CtrQuantFeatureValue {
+    /*
+       float slot;
+       float unseen_days;
+       float delta_score;
+       float show;
+       float click;
+       float embed_w;
+       std::vector<float> embed_g2sum;
+       // int8: float scale + int8[embedx_dim], fp16: fp16[embedx_dim]
+       packed embedx_w;
+       // 同上, 长度为 embedx_sgd_dim
+       packed embedx_g2sum;
+       */
+
+    // n 个元素压缩后占用的 float 个数
+    int packed_dim(int n) {
+      if (quant_type == QUANT_INT8) {
+        return n == 0 ? 0 : 1 + (n + 3) / 4;
+      }
+      return (n + 1) / 2;
+    }
+    int dim() {
+      return embedx_w_index() + packed_dim(embedx_dim) +
+             packed_dim(embedx_sgd_dim);
+    }
+    int size() { return dim() * sizeof(float); }
+    int embed_g2sum_index() { return 6; }
+    int embedx_w_index() { return embed_g2sum_index() + embed_sgd_dim; }
+    int embedx_g2sum_index() {
+      return embedx_w_index() + packed_dim(embedx_dim);
+    }
+
+    int embed_sgd_dim;
+    int embedx_dim;
+    int embedx_sgd_dim;
+    QuantType quant_type;
+  };
+
+  CtrQuantAccessor() {}
+  virtual ~CtrQuantAccessor() {}
+  virtual int initialize();
+
+  // value维度
+  virtual size_t dim();
+  // value各维度相加总size
+  virtual size_t size();
+  // value中mf动态长度部分总size大小, sparse下生效
+  virtual size_t mf_size();
+  virtual bool has_mf(size_t size);
+  // keys不存在时，为values生成随机值
+  virtual int32_t create(float** value, size_t num);
+  // 从values中选取到select_values中, embedx 在此反量化
+  virtual int32_t select(float** select_values, const float** values,
+                         size_t num);
+  // 将update_values更新应用到values中
+  virtual int32_t update(float** values, const float** update_values,
+                         size_t num);
+
+  std::string parse_to_string(const float* value, int param) override;
+  int32_t parse_from_string(const std::string& str, float* v) override;
+
+  // 压缩后的 value 与 CtrCommonAccessor 的 fp32 value 互相转换,
+  // value_size 为压缩 value 的 float 个数, 不含 mf 时只转换前半部分
+  void dequantize_value(const float* value, size_t value_size,
+                        float* common_value);
+  void quantize_value(const float* common_value, float* value,
+                      bool stochastic);
+
+ public:  // for unit test
+  CtrQuantFeatureValue quant_feature_value;
+};
+}  // namespace distributed
+}  // namespace paddle
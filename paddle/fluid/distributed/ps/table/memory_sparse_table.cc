@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <omp.h>
+#include <functional>
 #include <sstream>
 
 #include "paddle/fluid/distributed/common/cost_timer.h"
@@ -61,12 +62,30 @@ int32_t MemorySparseTable::initialize_value() {
 
   _local_shards.reset(new shard_type[_real_local_shard_num]);
 
+  _enable_delta_save = _config.enable_delta_save();
+  _dirty_keys.resize(_real_local_shard_num);
+  _deleted_keys.resize(_real_local_shard_num);
   return 0;
 }
 
 int32_t MemorySparseTable::load(const std::string& path,
                                 const std::string& param) {
   std::string table_path = table_dir(path);
+  std::string prev_path;
+  if (read_manifest(table_path, &prev_path) == 0) {
+    // 增量目录: 先沿 manifest 回放上一环, 再叠加本次增量
+    VLOG(0) << "MemorySparseTable::load delta " << path << " based on "
+            << prev_path;
+    if (load(prev_path, param) != 0) {
+      return -1;
+    }
+    if (load_delta(table_path, atoi(param.c_str())) != 0) {
+      return -1;
+    }
+    _last_save_path = path;
+    return 0;
+  }
+
   auto file_list = _afs_client.list(table_path);
 
   std::sort(file_list.begin(), file_list.end());
@@ -151,6 +170,130 @@ int32_t MemorySparseTable::load(const std::string& path,
   LOG(INFO) << "MemorySparseTable load success, path from "
             << file_list[file_start_idx] << " to "
             << file_list[file_start_idx + _real_local_shard_num - 1];
+  _last_save_path = path;
+  return 0;
+}
+
+int32_t MemorySparseTable::load_delta(const std::string& table_path,
+                                      int load_param) {
+  size_t file_start_idx = _shard_idx * _avg_local_shard_num;
+  size_t feature_value_size = _value_accesor->size() / sizeof(float);
+  std::atomic<bool> is_read_failed{false};
+
+  int thread_num = _real_local_shard_num < 15 ? _real_local_shard_num : 15;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < _real_local_shard_num; ++i) {
+    FsChannelConfig channel_config;
+    channel_config.converter = _value_accesor->converter(load_param).converter;
+    channel_config.deconverter =
+        _value_accesor->converter(load_param).deconverter;
+    auto& shard = _local_shards[i];
+    std::string line_data;
+    char* end = NULL;
+    int err_no = 0;
+
+    // 修改过的行整行覆盖, 与全量 save 一样可能以 .gz 压缩写出
+    channel_config.path =
+        paddle::string::format_string("%s/part-%03d-%05d", table_path.c_str(),
+                                      _shard_idx, file_start_idx + i);
+    if (_afs_client.exist(channel_config.path + ".gz")) {
+      channel_config.path += ".gz";
+    }
+    auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
+    while (read_channel->read_line(line_data) == 0 && line_data.size() > 1) {
+      uint64_t key = std::strtoul(line_data.data(), &end, 10);
+      auto& value = shard[key];
+      value.resize(feature_value_size);
+      int parse_size = _value_accesor->parse_from_string(++end, value.data());
+      value.resize(parse_size);
+    }
+    read_channel->close();
+    if (err_no == -1) {
+      is_read_failed = true;
+      LOG(ERROR) << "MemorySparseTable load delta failed, path:"
+                 << channel_config.path;
+    }
+
+    // 被 shrink 删除的行
+    err_no = 0;
+    channel_config.path =
+        paddle::string::format_string("%s/delete-%03d-%05d", table_path.c_str(),
+                                      _shard_idx, file_start_idx + i);
+    read_channel = _afs_client.open_r(channel_config, 0, &err_no);
+    while (read_channel->read_line(line_data) == 0 && line_data.size() > 0) {
+      shard.erase(std::strtoul(line_data.data(), &end, 10));
+    }
+    read_channel->close();
+    if (err_no == -1) {
+      is_read_failed = true;
+      LOG(ERROR) << "MemorySparseTable load delta failed, path:"
+                 << channel_config.path;
+    }
+  }
+  if (is_read_failed) {
+    return -1;
+  }
+  LOG(INFO) << "MemorySparseTable load delta success, path:" << table_path;
+  return 0;
+}
+
+int32_t MemorySparseTable::read_manifest(const std::string& table_path,
+                                         std::string* prev_path) {
+  FsChannelConfig channel_config;
+  channel_config.path = paddle::string::format_string(
+      "%s/manifest-%03d", table_path.c_str(), _shard_idx);
+  if (!_afs_client.exist(channel_config.path)) {
+    return -1;
+  }
+  /*
+  manifest content:
+  mode delta
+  prev {path of previous base or delta}
+  */
+  int err_no = 0;
+  bool is_delta = false;
+  std::string line_data;
+  auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
+  while (read_channel->read_line(line_data) == 0 && line_data.size() > 0) {
+    auto pos = line_data.find(' ');
+    if (pos == std::string::npos) {
+      continue;
+    }
+    auto name = line_data.substr(0, pos);
+    auto value = line_data.substr(pos + 1);
+    if (name == "mode") {
+      is_delta = (value == "delta");
+    } else if (name == "prev") {
+      *prev_path = value;
+    }
+  }
+  read_channel->close();
+  if (err_no == -1 || !is_delta || prev_path->empty()) {
+    LOG(WARNING) << "MemorySparseTable invalid manifest, path:"
+                 << channel_config.path;
+    return -1;
+  }
+  return 0;
+}
+
+int32_t MemorySparseTable::write_manifest(const std::string& table_path,
+                                          const std::string& prev_path) {
+  FsChannelConfig channel_config;
+  channel_config.path = paddle::string::format_string(
+      "%s/manifest-%03d", table_path.c_str(), _shard_idx);
+  int err_no = 0;
+  auto write_channel = _afs_client.open_w(channel_config, 0, &err_no);
+  if (0 != write_channel->write_line("mode delta") ||
+      0 != write_channel->write_line("prev " + prev_path)) {
+    err_no = -1;
+  }
+  write_channel->close();
+  if (err_no == -1) {
+    LOG(ERROR) << "MemorySparseTable write manifest failed, path:"
+               << channel_config.path;
+    return -1;
+  }
   return 0;
 }
 
@@ -230,9 +373,18 @@ int32_t MemorySparseTable::save(const std::string& dirname,
   VLOG(0) << "MemorySparseTable::save dirname: " << dirname;
   int save_param =
       atoi(param.c_str());  // checkpoint:0  xbox delta:1  xbox base:2
+  if (save_param == PSERVER_SAVE_DELTA_PARAM) {
+    return save_delta(dirname);
+  }
   std::string table_path = table_dir(dirname);
   _afs_client.remove(paddle::string::format_string(
       "%s/part-%03d-*", table_path.c_str(), _shard_idx));
+  if (_enable_delta_save) {
+    _afs_client.remove(paddle::string::format_string(
+        "%s/delete-%03d-*", table_path.c_str(), _shard_idx));
+    _afs_client.remove(paddle::string::format_string(
+        "%s/manifest-%03d", table_path.c_str(), _shard_idx));
+  }
   std::atomic<uint32_t> feasign_size_all{0};
 
   size_t file_start_idx = _avg_local_shard_num * _shard_idx;
@@ -259,28 +411,30 @@ int32_t MemorySparseTable::save(const std::string& dirname,
     int retry_num = 0;
     int err_no = 0;
     auto& shard = _local_shards[i];
+    if (_enable_delta_save && save_param == 0) {
+      // 全量 checkpoint 作为新的增量基线, 丢弃此前的脏行记录
+      std::unordered_set<uint64_t> dirty_keys;
+      std::unordered_set<uint64_t> deleted_keys;
+      take_dirty_keys(i, &dirty_keys, &deleted_keys);
+    }
     do {
       err_no = 0;
       feasign_size = 0;
       is_write_failed = false;
       auto write_channel =
           _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        if (_value_accesor->save(it.value().data(), save_param)) {
-          std::string format_value = _value_accesor->parse_to_string(
-              it.value().data(), it.value().size());
-          if (0 !=
-              write_channel->write_line(paddle::string::format_string(
-                  "%lu %s", it.key(), format_value.c_str()))) {
-            ++retry_num;
-            is_write_failed = true;
-            LOG(ERROR)
-                << "MemorySparseTable save prefix failed, retry it! path:"
-                << channel_config.path << " , retry_num=" << retry_num;
-            break;
-          }
-          ++feasign_size;
+      BucketSnapshot snapshot;
+      for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+        snapshot_bucket(i, bucket, save_param, &snapshot);
+        int line_num = write_snapshot(write_channel.get(), snapshot);
+        if (line_num < 0) {
+          ++retry_num;
+          is_write_failed = true;
+          LOG(ERROR) << "MemorySparseTable save prefix failed, retry it! path:"
+                     << channel_config.path << " , retry_num=" << retry_num;
+          break;
         }
+        feasign_size += line_num;
       }
       write_channel->close();
       if (err_no == -1) {
@@ -299,16 +453,217 @@ int32_t MemorySparseTable::save(const std::string& dirname,
       }
     } while (is_write_failed);
     feasign_size_all += feasign_size;
-    for (auto it = shard.begin(); it != shard.end(); ++it) {
-      _value_accesor->update_stat_after_save(it.value().data(), save_param);
-    }
+    scan_shard_buckets(i, [this, &shard, save_param](size_t bucket) {
+      for (auto it = shard.begin(bucket); it != shard.end(bucket); ++it) {
+        _value_accesor->update_stat_after_save(it.value().data(), save_param);
+      }
+    });
     LOG(INFO) << "MemorySparseTable save prefix success, path: "
               << channel_config.path;
   }
+  if (save_param == 0) {
+    _last_save_path = dirname;
+  }
   // int32 may overflow need to change return value
   return 0;
 }
 
+void MemorySparseTable::take_dirty_keys(
+    size_t shard_id, std::unordered_set<uint64_t>* dirty_keys,
+    std::unordered_set<uint64_t>* deleted_keys) {
+  _shards_task_pool[shard_id % _task_pool_size]
+      ->enqueue([this, shard_id, dirty_keys, deleted_keys]() -> int {
+        dirty_keys->swap(_dirty_keys[shard_id]);
+        deleted_keys->swap(_deleted_keys[shard_id]);
+        return 0;
+      })
+      .wait();
+}
+
+void MemorySparseTable::scan_shard_buckets(
+    size_t shard_id, const std::function<void(size_t)>& func) {
+  auto& shard = _local_shards[shard_id];
+  for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+    _shards_task_pool[shard_id % _task_pool_size]
+        ->enqueue([&func, bucket]() -> int {
+          func(bucket);
+          return 0;
+        })
+        .wait();
+  }
+}
+
+void MemorySparseTable::snapshot_bucket(size_t shard_id, size_t bucket,
+                                        int save_param,
+                                        BucketSnapshot* snapshot) {
+  snapshot->clear();
+  _shards_task_pool[shard_id % _task_pool_size]
+      ->enqueue([this, shard_id, bucket, save_param, snapshot]() -> int {
+        auto& shard = _local_shards[shard_id];
+        for (auto it = shard.begin(bucket); it != shard.end(bucket); ++it) {
+          if (_value_accesor->save(it.value().data(), save_param)) {
+            snapshot->append(it.key(), it.value().data(), it.value().size());
+          }
+        }
+        return 0;
+      })
+      .wait();
+}
+
+void MemorySparseTable::snapshot_keys(size_t shard_id,
+                                      const std::vector<uint64_t>& keys,
+                                      BucketSnapshot* snapshot) {
+  snapshot->clear();
+  _shards_task_pool[shard_id % _task_pool_size]
+      ->enqueue([this, shard_id, &keys, snapshot]() -> int {
+        auto& shard = _local_shards[shard_id];
+        for (auto key : keys) {
+          auto itr = shard.find(key);
+          if (itr != shard.end()) {
+            snapshot->append(key, itr.value().data(), itr.value().size());
+          }
+        }
+        return 0;
+      })
+      .wait();
+}
+
+std::string MemorySparseTable::format_snapshot_row(
+    const BucketSnapshot& snapshot, size_t idx) {
+  size_t begin = snapshot.offsets[idx];
+  size_t end = idx + 1 < snapshot.offsets.size() ? snapshot.offsets[idx + 1]
+                                                 : snapshot.values.size();
+  std::string format_value = _value_accesor->parse_to_string(
+      snapshot.values.data() + begin, end - begin);
+  return paddle::string::format_string("%lu %s", snapshot.keys[idx],
+                                       format_value.c_str());
+}
+
+int32_t MemorySparseTable::write_snapshot(FsWriteChannel* write_channel,
+                                          const BucketSnapshot& snapshot) {
+  for (size_t idx = 0; idx < snapshot.keys.size(); ++idx) {
+    if (0 != write_channel->write_line(format_snapshot_row(snapshot, idx))) {
+      return -1;
+    }
+  }
+  return snapshot.keys.size();
+}
+
+int32_t MemorySparseTable::save_delta(const std::string& dirname) {
+  if (!_enable_delta_save) {
+    LOG(ERROR) << "MemorySparseTable delta save requires enable_delta_save";
+    return -1;
+  }
+  if (_last_save_path.empty()) {
+    LOG(ERROR) << "MemorySparseTable delta save has no base, "
+                  "save or load a full checkpoint first";
+    return -1;
+  }
+  std::string table_path = table_dir(dirname);
+  _afs_client.remove(paddle::string::format_string(
+      "%s/part-%03d-*", table_path.c_str(), _shard_idx));
+  _afs_client.remove(paddle::string::format_string(
+      "%s/delete-%03d-*", table_path.c_str(), _shard_idx));
+  std::atomic<uint32_t> feasign_size_all{0};
+  std::atomic<uint32_t> deleted_size_all{0};
+
+  size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+
+  int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < _real_local_shard_num; ++i) {
+    std::unordered_set<uint64_t> dirty_keys;
+    std::unordered_set<uint64_t> deleted_keys;
+    take_dirty_keys(i, &dirty_keys, &deleted_keys);
+    auto& shard = _local_shards[i];
+
+    FsChannelConfig channel_config;
+    channel_config.converter = _value_accesor->converter(0).converter;
+    channel_config.deconverter = _value_accesor->converter(0).deconverter;
+    // 按 checkpoint(param 0) 格式写出, 只遍历脏行而非整张表
+    auto write_file = [&](const std::string& path,
+                          std::function<int(FsWriteChannel*)> write_lines) {
+      channel_config.path = path;
+      int retry_num = 0;
+      int err_no = 0;
+      int line_num = 0;
+      do {
+        err_no = 0;
+        auto write_channel =
+            _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+        line_num = write_lines(write_channel.get());
+        write_channel->close();
+        if (line_num < 0 || err_no == -1) {
+          ++retry_num;
+          _afs_client.remove(channel_config.path);
+          LOG(ERROR) << "MemorySparseTable save delta failed, retry it! path:"
+                     << channel_config.path << " , retry_num=" << retry_num;
+          if (retry_num >
+              paddle::distributed::FLAGS_pserver_table_save_max_retry) {
+            LOG(ERROR) << "MemorySparseTable save delta reach max limit!";
+            exit(-1);
+          }
+          continue;
+        }
+        break;
+      } while (true);
+      return line_num;
+    };
+
+    // 脏行按 bucket 分组, 与全量 save 一样每次只在任务线程中拷贝一个 bucket
+    std::vector<std::vector<uint64_t>> bucket_keys(shard.bucket_count());
+    std::hash<uint64_t> hasher;
+    for (auto key : dirty_keys) {
+      bucket_keys[shard.compute_bucket(hasher(key))].push_back(key);
+    }
+    // 与全量 save 的 checkpoint 一样按 compress_in_save 决定是否压缩
+    feasign_size_all += write_file(
+        paddle::string::format_string(
+            _config.compress_in_save() ? "%s/part-%03d-%05d.gz"
+                                       : "%s/part-%03d-%05d",
+            table_path.c_str(), _shard_idx, file_start_idx + i),
+        [&](FsWriteChannel* write_channel) -> int {
+          int feasign_size = 0;
+          BucketSnapshot snapshot;
+          for (auto& keys : bucket_keys) {
+            if (keys.empty()) {
+              continue;
+            }
+            snapshot_keys(i, keys, &snapshot);
+            int line_num = write_snapshot(write_channel, snapshot);
+            if (line_num < 0) {
+              return -1;
+            }
+            feasign_size += line_num;
+          }
+          return feasign_size;
+        });
+    deleted_size_all += write_file(
+        paddle::string::format_string("%s/delete-%03d-%05d", table_path.c_str(),
+                                      _shard_idx, file_start_idx + i),
+        [&](FsWriteChannel* write_channel) -> int {
+          for (auto key : deleted_keys) {
+            if (0 != write_channel->write_line(
+                         paddle::string::format_string("%lu", key))) {
+              return -1;
+            }
+          }
+          return deleted_keys.size();
+        });
+  }
+
+  if (write_manifest(table_path, _last_save_path) != 0) {
+    return -1;
+  }
+  LOG(INFO) << "MemorySparseTable save delta success, path:" << table_path
+            << " prev:" << _last_save_path
+            << " updated:" << feasign_size_all
+            << " deleted:" << deleted_size_all;
+  _last_save_path = dirname;
+  return 0;
+}
+
 int32_t MemorySparseTable::save_local_fs(const std::string& dirname,
                                          const std::string& param,
                                          const std::string& prefix) {
@@ -331,12 +686,11 @@ int32_t MemorySparseTable::save_local_fs(const std::string& dirname,
         file_start_idx + i);
     std::ofstream os;
     os.open(file_name);
-    for (auto it = shard.begin(); it != shard.end(); ++it) {
-      if (_value_accesor->save(it.value().data(), save_param)) {
-        std::string format_value = _value_accesor->parse_to_string(
-            it.value().data(), it.value().size());
-        std::string out_line = paddle::string::format_string(
-            "%lu %s\n", it.key(), format_value.c_str());
+    BucketSnapshot snapshot;
+    for (size_t bucket = 0; bucket < shard.bucket_count(); ++bucket) {
+      snapshot_bucket(i, bucket, save_param, &snapshot);
+      for (size_t idx = 0; idx < snapshot.keys.size(); ++idx) {
+        std::string out_line = format_snapshot_row(snapshot, idx) + "\n";
         // VLOG(2) << out_line.c_str();
         os.write(out_line.c_str(), sizeof(char) * out_line.size());
         ++feasign_cnt;
@@ -433,6 +787,7 @@ int32_t MemorySparseTable::pull_sparse(float* pull_values,
                     _value_accesor->create(&data_buffer_ptr, 1);
                     memcpy(data_ptr, data_buffer_ptr,
                            data_size * sizeof(float));
+                    mark_dirty(shard_id, key);
                   }
                 } else {
                   data_size = itr.value().size();
@@ -525,6 +880,7 @@ int32_t MemorySparseTable::push_sparse(const uint64_t* keys,
               }
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
+            mark_dirty(shard_id, key);
           }
           return 0;
         });
@@ -598,6 +954,7 @@ int32_t MemorySparseTable::_push_sparse(const uint64_t* keys,
               }
               memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
             }
+            mark_dirty(shard_id, key);
           }
           return 0;
         });
@@ -613,17 +970,22 @@ int32_t MemorySparseTable::flush() { return 0; }
 
 int32_t MemorySparseTable::shrink(const std::string& param) {
   VLOG(0) << "MemorySparseTable::shrink";
-  // TODO(zhaocaibei123): implement with multi-thread
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    // shrink
+  // 逐 bucket 在 shard 的任务线程中执行, 与 push/pull 交错, 便于记录删除的行
+  int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
     auto& shard = _local_shards[shard_id];
-    for (auto it = shard.begin(); it != shard.end();) {
-      if (_value_accesor->shrink(it.value().data())) {
-        it = shard.erase(it);
-      } else {
-        ++it;
+    scan_shard_buckets(shard_id, [this, &shard, shard_id](size_t bucket) {
+      for (auto it = shard.begin(bucket); it != shard.end(bucket);) {
+        if (_value_accesor->shrink(it.value().data())) {
+          mark_deleted(shard_id, it.key());
+          it = shard.erase(bucket, it);
+        } else {
+          ++it;
+        }
       }
-    }
+    });
   }
   return 0;
 }
@@ -17,10 +17,12 @@
 #include <ThreadPool.h>
 #include <assert.h>
 #include <pthread.h>
+#include <functional>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include "Eigen/Dense"
@@ -30,6 +32,8 @@
 #include "paddle/fluid/string/string_helper.h"
 
 #define PSERVER_SAVE_SUFFIX ".shard"
+// save/load 的 param 取该值时表示增量 checkpoint
+#define PSERVER_SAVE_DELTA_PARAM 6
 
 namespace paddle {
 namespace distributed {
@@ -60,6 +64,10 @@ class MemorySparseTable : public SparseTable {
   int32_t save_local_fs(const std::string& path, const std::string& param,
                         const std::string& prefix);
 
+  // 增量 checkpoint: 只写出上次 save 之后被修改或删除的行,
+  // 并通过 manifest 记录上一环(全量或增量)的路径
+  int32_t save_delta(const std::string& path);
+
   int64_t local_size();
   int64_t local_mf_size();
 
@@ -83,6 +91,65 @@ class MemorySparseTable : public SparseTable {
   virtual int32_t _push_sparse(const uint64_t* keys, const float** values,
                                size_t num);
 
+  // 只能在 shard 所属的 _shards_task_pool 线程中调用
+  inline void mark_dirty(size_t shard_id, uint64_t key) {
+    if (_enable_delta_save) {
+      _dirty_keys[shard_id].insert(key);
+      // 删除后又被重新创建的行, 不能再记为删除, 否则 load 时会被丢弃
+      auto& deleted = _deleted_keys[shard_id];
+      if (!deleted.empty()) {
+        deleted.erase(key);
+      }
+    }
+  }
+  inline void mark_deleted(size_t shard_id, uint64_t key) {
+    if (_enable_delta_save) {
+      _dirty_keys[shard_id].erase(key);
+      _deleted_keys[shard_id].insert(key);
+    }
+  }
+  // 在 shard 的任务线程中取走脏行集合, 之后的修改记入下一次增量
+  void take_dirty_keys(size_t shard_id, std::unordered_set<uint64_t>* dirty,
+                       std::unordered_set<uint64_t>* deleted);
+  int32_t load_delta(const std::string& table_path, int load_param);
+
+  // save/shrink 以 bucket 为单位扫描 shard: 每个 bucket 作为一个独立任务
+  // 投递到 shard 的任务线程, 与 pull/push 任务交错执行, 读写请求最多等待
+  // 一个 bucket 的扫描. 保存的文件中各 bucket 分别取自其被拷贝的时刻,
+  // 此后的更新由下一次 save 写出.
+  struct BucketSnapshot {
+    std::vector<uint64_t> keys;
+    std::vector<size_t> offsets;
+    std::vector<float> values;
+    void clear() {
+      keys.clear();
+      offsets.clear();
+      values.clear();
+    }
+    void append(uint64_t key, const float* data, size_t size) {
+      keys.push_back(key);
+      offsets.push_back(values.size());
+      values.insert(values.end(), data, data + size);
+    }
+  };
+  // 在 shard 的任务线程中依次对每个 bucket 调用 func
+  void scan_shard_buckets(size_t shard_id,
+                          const std::function<void(size_t)>& func);
+  // 拷贝 bucket 中满足 save_param 的行
+  void snapshot_bucket(size_t shard_id, size_t bucket, int save_param,
+                       BucketSnapshot* snapshot);
+  // 拷贝 keys 对应的行, 不存在的 key 被跳过
+  void snapshot_keys(size_t shard_id, const std::vector<uint64_t>& keys,
+                     BucketSnapshot* snapshot);
+  // 格式化拷贝出的行, 返回行数; 写失败返回 -1
+  int32_t write_snapshot(FsWriteChannel* write_channel,
+                         const BucketSnapshot& snapshot);
+  std::string format_snapshot_row(const BucketSnapshot& snapshot, size_t idx);
+
+  int32_t read_manifest(const std::string& table_path, std::string* prev_path);
+  int32_t write_manifest(const std::string& table_path,
+                         const std::string& prev_path);
+
  protected:
   const int _task_pool_size = 24;
   size_t _avg_local_shard_num;
@@ -90,6 +157,12 @@ class MemorySparseTable : public SparseTable {
   size_t _sparse_table_shard_num;
   std::vector<std::shared_ptr<::ThreadPool>> _shards_task_pool;
   std::unique_ptr<shard_type[]> _local_shards;
+
+  bool _enable_delta_save = false;
+  std::vector<std::unordered_set<uint64_t>> _dirty_keys;
+  std::vector<std::unordered_set<uint64_t>> _deleted_keys;
+  // 增量链上一环的路径, 全量 save/load 或增量 save 后更新
+  std::string _last_save_path;
 };
 
 }  // namespace distributed
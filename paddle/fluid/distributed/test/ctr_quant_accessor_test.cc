@@ -0,0 +1,202 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/ctr_quant_accessor.h"
+#include <cmath>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
+
+namespace paddle {
+namespace distributed {
+REGISTER_PSCORE_CLASS(SparseValueSGDRule, SparseAdaGradSGDRule);
+
+TableAccessorParameter gen_quant_param(const std::string& quant_type,
+                                       int embedx_dim) {
+  TableAccessorParameter param;
+  param.set_accessor_class("CtrQuantAccessor");
+  param.set_fea_dim(11);
+  param.set_embedx_dim(embedx_dim);
+  param.set_embedx_threshold(5);
+  param.mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  param.mutable_ctr_accessor_param()->set_click_coeff(1);
+  param.mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  param.mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  param.mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  param.mutable_ctr_accessor_param()->set_show_click_decay_rate(0.99);
+  param.mutable_ctr_accessor_param()->set_quant_type(quant_type);
+
+  param.mutable_embed_sgd_param()->set_name("SparseAdaGradSGDRule");
+  auto* adagrad_param = param.mutable_embed_sgd_param()->mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->add_weight_bounds(-10.0);
+  adagrad_param->add_weight_bounds(10.0);
+
+  param.mutable_embedx_sgd_param()->set_name("SparseAdaGradSGDRule");
+  adagrad_param = param.mutable_embedx_sgd_param()->mutable_adagrad();
+  adagrad_param->set_learning_rate(0.1);
+  adagrad_param->set_initial_range(0.3);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->add_weight_bounds(-10.0);
+  adagrad_param->add_weight_bounds(10.0);
+  return param;
+}
+
+// int8 误差不超过半个量化步长, fp16 相对误差约 1e-3
+float quant_tolerance(const std::string& quant_type, const float* values,
+                      int num) {
+  float max_abs = 0;
+  for (int i = 0; i < num; ++i) {
+    max_abs = std::max(max_abs, std::fabs(values[i]));
+  }
+  return quant_type == "int8" ? max_abs / 127 : max_abs * 1e-3 + 1e-6;
+}
+
+TEST(ctr_quant_accessor_test, test_dim) {
+  CtrCommonAccessor common_acc;
+  ASSERT_EQ(common_acc.configure(gen_quant_param("fp16", 64)), 0);
+  ASSERT_EQ(common_acc.initialize(), 0);
+  // slot unseen_days delta_score show click embed_w embed_g2sum
+  // embedx_w[64] embedx_g2sum
+  ASSERT_EQ(common_acc.dim(), 72u);
+
+  CtrQuantAccessor fp16_acc;
+  ASSERT_EQ(fp16_acc.configure(gen_quant_param("fp16", 64)), 0);
+  ASSERT_EQ(fp16_acc.initialize(), 0);
+  ASSERT_EQ(fp16_acc.dim(), 7u + 32u + 1u);
+  ASSERT_EQ(fp16_acc.mf_size(), (32u + 1u) * sizeof(float));
+  ASSERT_FALSE(fp16_acc.has_mf(7));
+  ASSERT_TRUE(fp16_acc.has_mf(fp16_acc.dim()));
+
+  CtrQuantAccessor int8_acc;
+  ASSERT_EQ(int8_acc.configure(gen_quant_param("int8", 64)), 0);
+  ASSERT_EQ(int8_acc.initialize(), 0);
+  // scale + 64 int8, scale + 1 int8
+  ASSERT_EQ(int8_acc.dim(), 7u + 17u + 2u);
+
+  CtrQuantAccessor bad_acc;
+  ASSERT_EQ(bad_acc.configure(gen_quant_param("int4", 64)), 0);
+  ASSERT_NE(bad_acc.initialize(), 0);
+}
+
+void check_create_select_update(const std::string& quant_type) {
+  const int embedx_dim = 8;
+  CtrQuantAccessor acc;
+  ASSERT_EQ(acc.configure(gen_quant_param(quant_type, embedx_dim)), 0);
+  ASSERT_EQ(acc.initialize(), 0);
+  CtrCommonAccessor common_acc;
+  ASSERT_EQ(common_acc.configure(gen_quant_param(quant_type, embedx_dim)), 0);
+  ASSERT_EQ(common_acc.initialize(), 0);
+
+  std::vector<float> value(acc.dim());
+  float* value_ptr = value.data();
+  ASSERT_EQ(acc.create(&value_ptr, 1), 0);
+
+  // select 得到的 embedx 与完整反量化结果一致, 且落在初始化范围内
+  std::vector<float> common_value(common_acc.dim());
+  acc.dequantize_value(value.data(), value.size(), common_value.data());
+  std::vector<float> pull_value(1 + embedx_dim);
+  float* pull_value_ptr = pull_value.data();
+  const float* const_value_ptr = value.data();
+  ASSERT_EQ(acc.select(&pull_value_ptr, &const_value_ptr, 1), 0);
+  int embedx_w_index = common_acc.common_feature_value.embedx_w_index();
+  for (int i = 0; i < embedx_dim; ++i) {
+    ASSERT_FLOAT_EQ(pull_value[1 + i], common_value[embedx_w_index + i]);
+    ASSERT_LE(std::fabs(pull_value[1 + i]), 0.3 + 1e-3);
+  }
+
+  // 与 fp32 的 CtrCommonAccessor 从同一初值出发做相同更新, 结果在量化误差内
+  std::vector<float> push_value(4 + embedx_dim);
+  push_value[0] = 0;  // slot
+  push_value[1] = 1;  // show
+  push_value[2] = 0;  // click
+  for (int i = 3; i < static_cast<int>(push_value.size()); ++i) {
+    push_value[i] = 0.05 * (i - 6);
+  }
+  const float* push_value_ptr = push_value.data();
+  float* common_value_ptr = common_value.data();
+  ASSERT_EQ(acc.update(&value_ptr, &push_value_ptr, 1), 0);
+  ASSERT_EQ(common_acc.update(&common_value_ptr, &push_value_ptr, 1), 0);
+
+  std::vector<float> updated(common_acc.dim());
+  acc.dequantize_value(value.data(), value.size(), updated.data());
+  auto& feature_value = common_acc.common_feature_value;
+  ASSERT_FLOAT_EQ(updated[feature_value.show_index()], 1);
+  ASSERT_FLOAT_EQ(updated[feature_value.embed_w_index()],
+                  common_value[feature_value.embed_w_index()]);
+  float tolerance = quant_tolerance(
+      quant_type, common_value.data() + embedx_w_index, embedx_dim);
+  for (int i = 0; i < embedx_dim; ++i) {
+    ASSERT_NEAR(updated[embedx_w_index + i],
+                common_value[embedx_w_index + i], 2 * tolerance);
+  }
+}
+
+TEST(ctr_quant_accessor_test, test_fp16_create_select_update) {
+  check_create_select_update("fp16");
+}
+
+TEST(ctr_quant_accessor_test, test_int8_create_select_update) {
+  check_create_select_update("int8");
+}
+
+TEST(ctr_quant_accessor_test, test_parse) {
+  const int embedx_dim = 8;
+  CtrQuantAccessor acc;
+  ASSERT_EQ(acc.configure(gen_quant_param("int8", embedx_dim)), 0);
+  ASSERT_EQ(acc.initialize(), 0);
+  CtrCommonAccessor common_acc;
+  ASSERT_EQ(common_acc.configure(gen_quant_param("int8", embedx_dim)), 0);
+  ASSERT_EQ(common_acc.initialize(), 0);
+
+  std::vector<float> value(acc.dim());
+  float* value_ptr = value.data();
+  ASSERT_EQ(acc.create(&value_ptr, 1), 0);
+  // show 超过 embedx_threshold 才会保存 embedx
+  value[common_acc.common_feature_value.show_index()] = 100;
+
+  // 文本格式与 CtrCommonAccessor 一致
+  std::string str = acc.parse_to_string(value.data(), value.size());
+  std::vector<float> common_value(common_acc.dim());
+  acc.dequantize_value(value.data(), value.size(), common_value.data());
+  ASSERT_EQ(str, common_acc.parse_to_string(common_value.data(),
+                                            common_value.size()));
+
+  std::vector<float> loaded(acc.dim());
+  ASSERT_EQ(acc.parse_from_string(str, loaded.data()),
+            static_cast<int>(acc.dim()));
+  std::vector<float> loaded_common(common_acc.dim());
+  acc.dequantize_value(loaded.data(), loaded.size(), loaded_common.data());
+  float tolerance = quant_tolerance(
+      "int8",
+      common_value.data() + common_acc.common_feature_value.embedx_w_index(),
+      embedx_dim);
+  for (size_t i = 0; i < common_value.size(); ++i) {
+    ASSERT_NEAR(loaded_common[i], common_value[i], tolerance + 1e-4);
+  }
+
+  // 未达到阈值时只保存不含 mf 的部分
+  value[common_acc.common_feature_value.show_index()] = 0;
+  str = acc.parse_to_string(value.data(), value.size());
+  ASSERT_EQ(acc.parse_from_string(str, loaded.data()),
+            common_acc.common_feature_value.embedx_w_index());
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -15,6 +15,10 @@ limitations under the License. */
 #include <ThreadPool.h>
 
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <fstream>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -136,5 +140,246 @@ TEST(MemorySparseTable, SGD) {
   ctr_table->save_local_fs("./work/table.save", "0", "test");
 }
 
+static void init_delta_table_config(TableParameter *table_config) {
+  table_config->set_table_class("MemorySparseTable");
+  table_config->set_shard_num(10);
+  table_config->set_enable_delta_save(true);
+  TableAccessorParameter *accessor_config = table_config->mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(11);
+  accessor_config->set_embedx_dim(8);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  accessor_config->mutable_embed_sgd_param()->set_name("SparseNaiveSGDRule");
+  auto *naive_param =
+      accessor_config->mutable_embed_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+  accessor_config->mutable_embedx_sgd_param()->set_name("SparseNaiveSGDRule");
+  naive_param = accessor_config->mutable_embedx_sgd_param()->mutable_naive();
+  naive_param->set_learning_rate(0.1);
+  naive_param->set_initial_range(0.3);
+}
+
+static int count_lines(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  int lines = 0;
+  while (std::getline(file, line)) {
+    ++lines;
+  }
+  return lines;
+}
+
+TEST(MemorySparseTable, DeltaSave) {
+  int emb_dim = 8;
+  TableParameter table_config;
+  init_delta_table_config(&table_config);
+  FsClientParameter fs_config;
+  Table *table = new MemorySparseTable();
+  table->set_shard(0, 1);
+  ASSERT_EQ(table->initialize(table_config, fs_config), 0);
+
+  auto push = [table, emb_dim](const std::vector<uint64_t> &keys) {
+    std::vector<float> grads(keys.size() * (emb_dim + 4), 0.1);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      grads[i * (emb_dim + 4)] = 0;      // slot
+      grads[i * (emb_dim + 4) + 1] = 1;  // show
+    }
+    table->push_sparse(keys.data(), grads.data(), keys.size());
+  };
+
+  // delta save without a base checkpoint is rejected
+  ASSERT_NE(table->save("./work/delta_table.fail", "6"), 0);
+
+  push({0, 1, 2, 3, 4});
+  ASSERT_EQ(table->save("./work/delta_table.base", "0"), 0);
+  push({3, 4, 5, 6, 7});
+  ASSERT_EQ(table->save("./work/delta_table.delta1", "6"), 0);
+  push({7, 8});
+  ASSERT_EQ(table->save("./work/delta_table.delta2", "6"), 0);
+
+  // each delta only contains rows touched since the previous save
+  int delta1_rows = 0;
+  int delta2_rows = 0;
+  for (int i = 0; i < 10; ++i) {
+    delta1_rows += count_lines(paddle::string::format_string(
+        "./work/delta_table.delta1/000/part-000-%05d", i));
+    delta2_rows += count_lines(paddle::string::format_string(
+        "./work/delta_table.delta2/000/part-000-%05d", i));
+  }
+  ASSERT_EQ(delta1_rows, 5);
+  ASSERT_EQ(delta2_rows, 2);
+
+  // replay base + delta1 + delta2 through the manifest chain
+  Table *loaded = new MemorySparseTable();
+  loaded->set_shard(0, 1);
+  ASSERT_EQ(loaded->initialize(table_config, fs_config), 0);
+  ASSERT_EQ(loaded->load("./work/delta_table.delta2", "0"), 0);
+
+  std::vector<uint64_t> keys = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+  std::vector<uint32_t> fres(keys.size(), 1);
+  auto value = PullSparseValue(keys, fres, emb_dim);
+  std::vector<float> expect(keys.size() * (emb_dim + 1));
+  std::vector<float> actual(keys.size() * (emb_dim + 1));
+  table->pull_sparse(expect.data(), value);
+  loaded->pull_sparse(actual.data(), value);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    // values round-trip through the text checkpoint format
+    ASSERT_NEAR(expect[i], actual[i], 1e-4);
+  }
+  ASSERT_EQ(dynamic_cast<MemorySparseTable *>(loaded)->local_size(),
+            static_cast<int64_t>(keys.size()));
+}
+
+TEST(MemorySparseTable, DeltaSaveRecreateAfterShrink) {
+  int emb_dim = 8;
+  TableParameter table_config;
+  init_delta_table_config(&table_config);
+  // every row is deleted by shrink
+  table_config.mutable_accessor()
+      ->mutable_ctr_accessor_param()
+      ->set_delete_threshold(1e6);
+  FsClientParameter fs_config;
+  Table *table = new MemorySparseTable();
+  table->set_shard(0, 1);
+  ASSERT_EQ(table->initialize(table_config, fs_config), 0);
+
+  auto push = [table, emb_dim](const std::vector<uint64_t> &keys) {
+    std::vector<float> grads(keys.size() * (emb_dim + 4), 0.1);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      grads[i * (emb_dim + 4)] = 0;      // slot
+      grads[i * (emb_dim + 4) + 1] = 1;  // show
+    }
+    table->push_sparse(keys.data(), grads.data(), keys.size());
+  };
+
+  push({0, 1, 2});
+  ASSERT_EQ(table->save("./work/recreate_table.base", "0"), 0);
+  // shrink then re-create 1 and 2 in the same delta
+  ASSERT_EQ(table->shrink(""), 0);
+  ASSERT_EQ(dynamic_cast<MemorySparseTable *>(table)->local_size(), 0);
+  push({1, 2});
+  ASSERT_EQ(table->save("./work/recreate_table.delta1", "6"), 0);
+
+  Table *loaded = new MemorySparseTable();
+  loaded->set_shard(0, 1);
+  ASSERT_EQ(loaded->initialize(table_config, fs_config), 0);
+  ASSERT_EQ(loaded->load("./work/recreate_table.delta1", "0"), 0);
+  // 0 stays deleted, 1 and 2 are live
+  ASSERT_EQ(dynamic_cast<MemorySparseTable *>(loaded)->local_size(), 2);
+
+  std::vector<uint64_t> keys = {1, 2};
+  std::vector<uint32_t> fres(keys.size(), 1);
+  auto value = PullSparseValue(keys, fres, emb_dim);
+  std::vector<float> expect(keys.size() * (emb_dim + 1));
+  std::vector<float> actual(keys.size() * (emb_dim + 1));
+  table->pull_sparse(expect.data(), value);
+  loaded->pull_sparse(actual.data(), value);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_NEAR(expect[i], actual[i], 1e-4);
+  }
+}
+
+TEST(MemorySparseTable, PullPushDuringSave) {
+  int emb_dim = 8;
+  TableParameter table_config;
+  init_delta_table_config(&table_config);
+  table_config.set_enable_delta_save(false);
+  FsClientParameter fs_config;
+  Table *table = new MemorySparseTable();
+  table->set_shard(0, 1);
+  ASSERT_EQ(table->initialize(table_config, fs_config), 0);
+
+  // spread keys over all buckets of every shard
+  const size_t key_num = 200000;
+  std::vector<uint64_t> all_keys(key_num);
+  for (size_t i = 0; i < key_num; ++i) {
+    all_keys[i] = (i + 1) * 0x9E3779B97F4A7C15UL;
+  }
+  std::vector<float> grads(key_num * (emb_dim + 4), 0.1);
+  for (size_t i = 0; i < key_num; ++i) {
+    grads[i * (emb_dim + 4)] = 0;      // slot
+    grads[i * (emb_dim + 4) + 1] = 1;  // show
+  }
+  table->push_sparse(all_keys.data(), grads.data(), key_num);
+
+  // The save starts after the first pull and push, so that at least one
+  // request is served during the save.
+  std::atomic<bool> first_request_done{false};
+  std::atomic<bool> saving{true};
+  std::atomic<int32_t> save_status{0};
+  std::thread save_thread(
+      [table, &first_request_done, &saving, &save_status]() {
+        while (!first_request_done) {
+          std::this_thread::yield();
+        }
+        save_status = table->save("./work/concurrent_save_table", "0");
+        saving = false;
+      });
+
+  const size_t batch = 100;
+  std::vector<uint32_t> fres(batch, 1);
+  std::vector<float> pull_values(batch * (emb_dim + 1));
+  std::vector<double> pull_latency;
+  std::vector<double> push_latency;
+  size_t offset = 0;
+  // A failed request does not return before the save thread is joined.
+  int32_t pull_status = 0;
+  int32_t push_status = 0;
+  while (saving && pull_status == 0 && push_status == 0) {
+    std::vector<uint64_t> keys(all_keys.begin() + offset,
+                               all_keys.begin() + offset + batch);
+    offset = (offset + batch) % (key_num - batch);
+
+    auto start = std::chrono::steady_clock::now();
+    auto value = PullSparseValue(keys, fres, emb_dim);
+    pull_status = table->pull_sparse(pull_values.data(), value);
+    auto pulled = std::chrono::steady_clock::now();
+    push_status = table->push_sparse(keys.data(), grads.data(), batch);
+    auto pushed = std::chrono::steady_clock::now();
+    pull_latency.push_back(
+        std::chrono::duration<double, std::micro>(pulled - start).count());
+    push_latency.push_back(
+        std::chrono::duration<double, std::micro>(pushed - pulled).count());
+    first_request_done = true;
+  }
+  // Not to wait forever for the save thread if no request is sent.
+  first_request_done = true;
+  save_thread.join();
+  ASSERT_EQ(pull_status, 0);
+  ASSERT_EQ(push_status, 0);
+  ASSERT_EQ(save_status, 0);
+
+  auto percentile = [](std::vector<double> *latency, double p) {
+    std::sort(latency->begin(), latency->end());
+    size_t idx = static_cast<size_t>(p * (latency->size() - 1));
+    return (*latency)[idx];
+  };
+  // pull/push keep being served while the table is scanned
+  ASSERT_GT(pull_latency.size(), 0UL);
+  LOG(INFO) << "requests during save: " << pull_latency.size()
+            << ", pull latency(us) p50:" << percentile(&pull_latency, 0.5)
+            << " p99:" << percentile(&pull_latency, 0.99)
+            << " max:" << percentile(&pull_latency, 1.0)
+            << ", push latency(us) p50:" << percentile(&push_latency, 0.5)
+            << " p99:" << percentile(&push_latency, 0.99)
+            << " max:" << percentile(&push_latency, 1.0);
+
+  // every row is saved exactly once
+  int saved_rows = 0;
+  for (int i = 0; i < 10; ++i) {
+    saved_rows += count_lines(paddle::string::format_string(
+        "./work/concurrent_save_table/000/part-000-%05d", i));
+  }
+  ASSERT_EQ(saved_rows, static_cast<int>(key_num));
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -0,0 +1,119 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps/service/shm_channel.h"
+
+namespace paddle {
+namespace distributed {
+
+static std::string shm_test_name(const std::string& tag) {
+  return "/paddle_shm_channel_test_" + tag + "_" + std::to_string(getpid());
+}
+
+TEST(ShmChannel, PingPong) {
+  ShmChannel client;
+  ASSERT_EQ(client.create(shm_test_name("pingpong"), 4096), 0);
+  ShmChannel server;
+  ASSERT_EQ(server.open(client.name()), 0);
+  client.unlink();
+
+  const int rounds = 1000;
+  std::thread server_thread([&server, rounds]() {
+    ShmMessageHeader header;
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < rounds; ++i) {
+      ASSERT_TRUE(server.request_ring()->read(&header, sizeof(header)));
+      keys.resize(header.num);
+      ASSERT_TRUE(server.request_ring()->read(keys.data(), header.data_size));
+      for (auto& key : keys) {
+        key *= 2;
+      }
+      header.cmd_id = 0;
+      ASSERT_TRUE(server.response_ring()->write(&header, sizeof(header)));
+      ASSERT_TRUE(server.response_ring()->write(keys.data(), header.data_size));
+    }
+  });
+
+  for (int i = 0; i < rounds; ++i) {
+    std::vector<uint64_t> keys(i % 37 + 1);
+    for (size_t j = 0; j < keys.size(); ++j) {
+      keys[j] = i + j;
+    }
+    ShmMessageHeader header;
+    header.cmd_id = 2;
+    header.table_id = 0;
+    header.num = keys.size();
+    header.flag = 1;
+    header.data_size = keys.size() * sizeof(uint64_t);
+    ASSERT_TRUE(client.request_ring()->write(&header, sizeof(header)));
+    ASSERT_TRUE(client.request_ring()->write(keys.data(), header.data_size));
+
+    ShmMessageHeader response;
+    std::vector<uint64_t> values(keys.size());
+    ASSERT_TRUE(client.response_ring()->read(&response, sizeof(response)));
+    ASSERT_EQ(response.cmd_id, 0);
+    ASSERT_EQ(response.num, keys.size());
+    ASSERT_TRUE(client.response_ring()->read(values.data(), header.data_size));
+    for (size_t j = 0; j < keys.size(); ++j) {
+      ASSERT_EQ(values[j], keys[j] * 2);
+    }
+  }
+  server_thread.join();
+}
+
+TEST(ShmChannel, MessageLargerThanCapacity) {
+  ShmChannel client;
+  ASSERT_EQ(client.create(shm_test_name("large"), 256), 0);
+  ShmChannel server;
+  ASSERT_EQ(server.open(client.name()), 0);
+
+  std::vector<float> sent(100000);
+  for (size_t i = 0; i < sent.size(); ++i) {
+    sent[i] = static_cast<float>(i) * 0.5f;
+  }
+  std::vector<float> received(sent.size());
+  std::thread reader([&server, &received]() {
+    ASSERT_TRUE(server.request_ring()->read(received.data(),
+                                            received.size() * sizeof(float)));
+  });
+  ASSERT_TRUE(
+      client.request_ring()->write(sent.data(), sent.size() * sizeof(float)));
+  reader.join();
+  ASSERT_EQ(sent, received);
+}
+
+TEST(ShmChannel, CloseWakesReader) {
+  ShmChannel client;
+  ASSERT_EQ(client.create(shm_test_name("close"), 1024), 0);
+  ShmChannel server;
+  ASSERT_EQ(server.open(client.name()), 0);
+
+  std::thread reader([&server]() {
+    ShmMessageHeader header;
+    ASSERT_FALSE(server.request_ring()->read(&header, sizeof(header)));
+  });
+  usleep(10000);
+  client.close();
+  reader.join();
+  ASSERT_TRUE(server.request_ring()->closed());
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,194 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/ps/service/brpc_ps_server.h"
+#include "paddle/fluid/distributed/ps/service/env.h"
+#include "paddle/fluid/distributed/ps/service/shm_ps_client.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+namespace framework = paddle::framework;
+namespace distributed = paddle::distributed;
+
+namespace {
+
+const size_t kEmbedxDim = 10;
+
+void GetSparseTableProto(distributed::TableParameter* sparse_table_proto) {
+  sparse_table_proto->set_table_id(0);
+  sparse_table_proto->set_table_class("CommonSparseTable");
+  sparse_table_proto->set_shard_num(256);
+  sparse_table_proto->set_type(distributed::PS_SPARSE_TABLE);
+  auto* accessor_proto = sparse_table_proto->mutable_accessor();
+  auto* common_proto = sparse_table_proto->mutable_common();
+
+  accessor_proto->set_accessor_class("CommMergeAccessor");
+  accessor_proto->set_fea_dim(0);
+  accessor_proto->set_embedx_dim(kEmbedxDim);
+
+  common_proto->set_name("sgd");
+  common_proto->set_table_name("MergedDense");
+  common_proto->set_trainer_num(1);
+  common_proto->set_sync(false);
+  common_proto->set_entry("none");
+  common_proto->add_params("Param");
+  common_proto->add_dims(kEmbedxDim);
+  common_proto->add_initializers("uniform_random&0&-1.0&1.0");
+  common_proto->add_params("LearningRate");
+  common_proto->add_dims(1);
+  common_proto->add_initializers("fill_constant&1.0");
+}
+
+void GetServerParam(distributed::ServerParameter* server_proto) {
+  auto* downpour_server_proto = server_proto->mutable_downpour_server_param();
+  auto* server_service_proto = downpour_server_proto->mutable_service_param();
+  server_service_proto->set_service_class("BrpcPsService");
+  server_service_proto->set_server_class("BrpcPsServer");
+  server_service_proto->set_client_class("ShmPsClient");
+  server_service_proto->set_start_server_port(0);
+  server_service_proto->set_server_thread_num(12);
+  GetSparseTableProto(downpour_server_proto->add_downpour_table_param());
+}
+
+distributed::PSParameter GetServerProto() {
+  distributed::PSParameter server_fleet_desc;
+  GetServerParam(server_fleet_desc.mutable_server_param());
+  return server_fleet_desc;
+}
+
+distributed::PSParameter GetWorkerProto() {
+  distributed::PSParameter worker_fleet_desc;
+  auto* downpour_worker_proto = worker_fleet_desc.mutable_worker_param()
+                                    ->mutable_downpour_worker_param();
+  GetSparseTableProto(downpour_worker_proto->add_downpour_table_param());
+  GetServerParam(worker_fleet_desc.mutable_server_param());
+  return worker_fleet_desc;
+}
+
+std::string ip_ = "127.0.0.1";
+uint32_t port_ = 4219;
+
+std::vector<std::string> host_sign_list_;
+std::shared_ptr<distributed::PSServer> pserver_ptr_;
+std::shared_ptr<distributed::PSClient> worker_ptr_;
+
+void RunServer() {
+  distributed::PSParameter server_proto = GetServerProto();
+  auto _ps_env = distributed::PaddlePSEnvironment();
+  _ps_env.set_ps_servers(&host_sign_list_, 1);
+  pserver_ptr_ = std::shared_ptr<distributed::PSServer>(
+      distributed::PSServerFactory::create(server_proto));
+  std::vector<framework::ProgramDesc> empty_vec;
+  framework::ProgramDesc empty_prog;
+  empty_vec.push_back(empty_prog);
+  pserver_ptr_->configure(server_proto, _ps_env, 0, empty_vec);
+  pserver_ptr_->start(ip_, port_);
+}
+
+void RunClient(
+    std::map<uint64_t, std::vector<distributed::Region>>& dense_regions) {
+  distributed::PSParameter worker_proto = GetWorkerProto();
+  distributed::PaddlePSEnvironment _ps_env;
+  _ps_env.set_ps_servers(&host_sign_list_, host_sign_list_.size());
+  worker_ptr_ = std::shared_ptr<distributed::PSClient>(
+      distributed::PSClientFactory::create(worker_proto));
+  worker_ptr_->configure(worker_proto, dense_regions, _ps_env, 0);
+}
+
+void PullSparse(const std::vector<uint64_t>& keys,
+                std::vector<float>* values) {
+  values->resize(keys.size() * kEmbedxDim);
+  std::vector<float*> value_ptrs(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    value_ptrs[i] = values->data() + i * kEmbedxDim;
+  }
+  auto status = worker_ptr_->pull_sparse(value_ptrs.data(), 0, keys.data(),
+                                         keys.size(), true);
+  status.wait();
+  ASSERT_EQ(status.get(), 0);
+}
+
+}  // namespace
+
+// The server and the client are on the same host, so the sparse requests go
+// through the shm channel to the server tables.
+TEST(ShmPsClient, PullPushSparse) {
+  setenv("http_proxy", "", 1);
+  setenv("https_proxy", "", 1);
+  auto ph_host = distributed::PSHost(ip_, port_, 0);
+  host_sign_list_.push_back(ph_host.serialize_to_string());
+
+  std::thread server_thread(RunServer);
+  sleep(1);
+
+  std::map<uint64_t, std::vector<distributed::Region>> dense_regions;
+  dense_regions.insert(
+      std::pair<uint64_t, std::vector<distributed::Region>>(0, {}));
+  RunClient(dense_regions);
+  auto* shm_client =
+      dynamic_cast<distributed::ShmPsClient*>(worker_ptr_.get());
+  ASSERT_NE(shm_client, nullptr);
+  EXPECT_EQ(shm_client->shm_request_num(), 0UL);
+
+  std::vector<uint64_t> keys(10);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = i;
+  }
+  std::vector<float> values;
+  PullSparse(keys, &values);
+  // The only server is local, so the request does not fall back to brpc.
+  EXPECT_EQ(shm_client->shm_request_num(), 1UL);
+
+  // The duplicated keys get the values of the first one.
+  std::vector<uint64_t> dup_keys = {3, 7, 3, 3};
+  std::vector<float> dup_values;
+  PullSparse(dup_keys, &dup_values);
+  EXPECT_EQ(shm_client->shm_request_num(), 2UL);
+  for (size_t i = 0; i < dup_keys.size(); ++i) {
+    for (size_t j = 0; j < kEmbedxDim; ++j) {
+      EXPECT_FLOAT_EQ(dup_values[i * kEmbedxDim + j],
+                      values[dup_keys[i] * kEmbedxDim + j]);
+    }
+  }
+
+  // sgd with learning rate 1.0
+  std::vector<float> grads(keys.size() * kEmbedxDim, 1.0);
+  std::vector<const float*> grad_ptrs(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grad_ptrs[i] = grads.data() + i * kEmbedxDim;
+  }
+  auto push_status =
+      worker_ptr_->push_sparse(0, keys.data(), grad_ptrs.data(), keys.size());
+  push_status.wait();
+  EXPECT_EQ(push_status.get(), 0);
+  EXPECT_EQ(shm_client->shm_request_num(), 3UL);
+
+  std::vector<float> updated_values;
+  PullSparse(keys, &updated_values);
+  EXPECT_EQ(shm_client->shm_request_num(), 4UL);
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(updated_values[i], values[i] - 1.0);
+  }
+
+  worker_ptr_->stop_server();
+  worker_ptr_->finalize_worker();
+  server_thread.join();
+}
@@ -64,6 +64,7 @@ operator()(
 
   if (!weak_grad_.expired()) {
     auto grad = weak_grad_.lock();
+    std::lock_guard<std::mutex> guard(mutex_);
     CopyOrAddTensor(grad.get(), grad_out);
   }
 
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
+
 #include "paddle/fluid/eager/autograd_meta.h"
 #include "paddle/fluid/eager/grad_node_info.h"
 #include "paddle/fluid/eager/hooks.h"
@@ -53,6 +55,9 @@ class GradNodeAccumulation : public GradNodeBase {
 
  private:
   std::weak_ptr<paddle::experimental::Tensor> weak_grad_;
+  // Guards the accumulation into the grad of the leaf tensor, which the
+  // backwards running concurrently may share.
+  std::mutex mutex_;
 
   std::function<paddle::experimental::Tensor(
       const paddle::experimental::Tensor&)>
@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <memory>
+#include "paddle/fluid/eager/saved_tensors_hooks.h"
 #include "paddle/fluid/imperative/tracer.h"
 #include "paddle/phi/api/ext/op_meta_info.h"
 namespace egr {
@@ -85,6 +86,15 @@ class Controller {
     return custom_edges_slot_map_;
   }
 
+  // The hooks are read when the TensorWrappers are created, nullptr to keep
+  // the saved tensors as they are.
+  const std::shared_ptr<SavedTensorsHooks>& GetSavedTensorsHooks() const {
+    return saved_tensors_hooks_;
+  }
+  void SetSavedTensorsHooks(const std::shared_ptr<SavedTensorsHooks>& hooks) {
+    saved_tensors_hooks_ = hooks;
+  }
+
  private:
   Controller() = default;
   static Controller* controller_;
@@ -97,6 +107,7 @@ class Controller {
   /* op_type : {{grad_outputs}, {grad_inputs}, {input}, {output}, {attrs}}*/
   std::unordered_map<std::string, std::vector<std::unordered_map<int, int>>>
       custom_edges_slot_map_;
+  std::shared_ptr<SavedTensorsHooks> saved_tensors_hooks_;
   DISABLE_COPY_AND_ASSIGN(Controller);
 };
 
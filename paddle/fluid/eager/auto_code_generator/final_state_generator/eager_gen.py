@@ -37,6 +37,13 @@ yaml_types_mapping = {
     'ScalarArray' : 'paddle::experimental::ScalarArray'
 }
 
+# Attribute types cheap enough to be passed by value
+trivial_attr_types = set([
+    'int', 'int32_t', 'int64_t', 'size_t', 'float', 'double', 'bool',
+    'paddle::experimental::Backend', 'paddle::experimental::DataLayout',
+    'paddle::experimental::DataType'
+])
+
 
 def ParseArguments():
     parser = argparse.ArgumentParser(
@@ -94,6 +101,14 @@ def GetConstReference(string):
     return ret
 
 
+def GetAttrArgType(string):
+    # Non-trivial attributes are passed by const reference, the same as the
+    # C++ API, so that they are not copied per call.
+    if string in trivial_attr_types:
+        return string
+    return GetConstReference(string)
+
+
 def RemoveConstAndReference(string):
     ret = string
     if string.startswith("const "):
@@ -614,16 +629,17 @@ def GenerateNodeDefinition(fwd_api_name, bwd_api_name, backward_fwd_input_map,
     for _, (ttype, fwd_position,
             grad_api_position) in backward_grad_output_map.items():
         # Infer Grad API Return Type
+        # The grad api returns are moved, which are not used any more
         if num_bwd_outputs == 1:
             # Single tensor output, return as is
             if IsPlainTensorType(ttype):
-                returns_str += "returns[0] = { grad_api_returns };\n"
+                returns_str += "returns[0].emplace_back(std::move(grad_api_returns));\n"
             else:
                 assert IsVectorTensorType(ttype)
-                returns_str += "returns[0] = grad_api_returns;\n"
+                returns_str += "returns[0] = std::move(grad_api_returns);\n"
         else:
             # Rearrange output order accordingly
-            returns_str += f"returns[{fwd_position}] =  grad_api_returns[{grad_api_position}];\n"
+            returns_str += f"returns[{fwd_position}] = std::move(grad_api_returns[{grad_api_position}]);\n"
     returns_str += f"return returns;\n"
 
     grad_node_name = GetGradNodeName(fwd_api_name)
@@ -866,12 +882,13 @@ def GenerateForwardDefinition(fwd_api_name, bwd_api_name,
 
     for name, atype, default_val, pos in forward_attrs_list:
         inputs_call_list[pos] = name
+        arg_type = GetAttrArgType(atype)
         if default_val is not None:
             inputs_args_declaration_list[
-                pos] = f"{atype} {name} = {default_val}"
+                pos] = f"{arg_type} {name} = {default_val}"
         else:
-            inputs_args_declaration_list[pos] = f"{atype} {name}"
-        inputs_args_definition_list[pos] = f"{atype} {name}"
+            inputs_args_declaration_list[pos] = f"{arg_type} {name}"
+        inputs_args_definition_list[pos] = f"{arg_type} {name}"
 
     inputs_args_declaration_str = ", ".join(inputs_args_declaration_list)
     inputs_args_definition_str = ", ".join(inputs_args_definition_list)
@@ -13,22 +13,52 @@
 // limitations under the License.
 
 #include "paddle/fluid/eager/backward.h"
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <exception>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <queue>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "paddle/fluid/eager/api/utils/global_utils.h"
 #include "paddle/fluid/eager/autograd_meta.h"
 #include "paddle/fluid/eager/grad_node_info.h"
 #include "paddle/fluid/eager/grad_tensor_holder.h"
 #include "paddle/fluid/eager/utils.h"
 
+#include "paddle/fluid/framework/threadpool.h"
+#include "paddle/fluid/memory/malloc.h"
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/platform/errors.h"
+#include "paddle/fluid/platform/flags.h"
 
 #include "glog/logging.h"
 
+PADDLE_DEFINE_EXPORTED_int32(
+    eager_backward_num_threads, 1,
+    "The number of threads to run the independent grad nodes of the eager "
+    "backward concurrently, 1 to run the backward on the calling thread. It "
+    "is read by the first backward only. The gradient hooks must be thread "
+    "safe when it is greater than 1.");
+PADDLE_DEFINE_EXPORTED_bool(
+    eager_backward_deterministic, false,
+    "Whether the multi-threaded eager backward accumulates the gradients "
+    "flowing into a grad node in a fixed order, so that the results do not "
+    "depend on the thread scheduling.");
+
 namespace egr {
 
+using GradTensorHolderMap =
+    std::unordered_map<GradNodeBase*, std::unique_ptr<GradTensorHolder>>;
+
 std::unordered_map<GradNodeBase*, int> getInDegreeMap(
-    const std::queue<GradNodeBase*>& init_queue) {
+    const std::queue<GradNodeBase*>& init_queue,
+    std::unordered_map<GradNodeBase*, size_t>* node_order_map = nullptr) {
   // Calculate in_degree for each node
   // We can completely remove this pass, if in_degree were set during forward
   // pass
@@ -46,6 +76,11 @@ std::unordered_map<GradNodeBase*, int> getInDegreeMap(
     if (visited.count(node)) {
       continue;
     }
+    // The visiting order only depends on the graph, so it is used to order
+    // the gradients accumulated by the multi-threaded backward.
+    if (node_order_map) {
+      (*node_order_map)[node] = visited.size();
+    }
     visited.insert(node);
 
     PADDLE_ENFORCE_NOT_NULL(
@@ -74,10 +109,231 @@ std::unordered_map<GradNodeBase*, int> getInDegreeMap(
   return node_in_degree_map;
 }
 
+namespace {
+
+// The grad nodes run on a pool of their own, which is not shared with the
+// tasks of the framework.
+paddle::framework::ThreadPool* BackwardThreadPool() {
+  static std::unique_ptr<paddle::framework::ThreadPool> pool(
+      new paddle::framework::ThreadPool(FLAGS_eager_backward_num_threads));
+  return pool.get();
+}
+
+// Whether the current thread is running a grad node for the backward thread
+// pool. A grad node may run a backward itself, e.g. the node of a recomputed
+// segment or a PyLayer calling backward. That nested backward runs on the
+// worker itself: if every worker waited for the nodes it scheduled, the pool
+// could run out of free workers and deadlock.
+thread_local bool in_backward_worker = false;
+
+// Marks the current thread as a backward worker while a grad node runs.
+class BackwardWorkerGuard {
+ public:
+  BackwardWorkerGuard() : prev_(in_backward_worker) {
+    in_backward_worker = true;
+  }
+  ~BackwardWorkerGuard() { in_backward_worker = prev_; }
+
+ private:
+  bool prev_;
+};
+
+// Runs the grad nodes whose in-degrees drop to zero on the backward thread
+// pool, so that the independent branches of the backward graph, e.g. the
+// towers of a multi-tower model, run concurrently.
+class ParallelBackwardRunner {
+ public:
+  ParallelBackwardRunner(
+      GradTensorHolderMap* node_input_buffers_dict,
+      std::unordered_map<GradNodeBase*, int>* node_in_degree_map,
+      const std::unordered_map<GradNodeBase*, size_t>* node_order_map)
+      : node_input_buffers_dict_(node_input_buffers_dict),
+        node_in_degree_map_(node_in_degree_map),
+        node_order_map_(node_order_map),
+        tracer_(Controller::Instance().GetCurrentTracer()),
+        has_grad_(tracer_->HasGrad()),
+        amp_level_(tracer_->GetAmpLevel()),
+        amp_dtype_(tracer_->GetAmpDtype()) {}
+
+  void Run(const std::vector<GradNodeBase*>& ready_nodes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto* node : ready_nodes) {
+      Schedule(node);
+    }
+    finished_.wait(lock, [this] { return pending_num_ == 0; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  // A gradient flowing into a grad node, ordered by the node produced it and
+  // the edge it flows through.
+  struct PendingGrad {
+    std::tuple<size_t, size_t, size_t> order;
+    size_t slot_id;
+    size_t rank;
+    paddle::experimental::Tensor tensor;
+  };
+
+  // Requires mutex_ to be held.
+  void Schedule(GradNodeBase* node) {
+    if (error_) return;
+    ++pending_num_;
+    BackwardThreadPool()->RunAndGetException([this, node] {
+      try {
+        BackwardWorkerGuard worker_guard;
+        RunNode(node);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!error_) error_ = std::current_exception();
+      }
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--pending_num_ == 0) {
+        finished_.notify_all();
+      }
+    });
+  }
+
+  // Requires mutex_ to be held.
+  GradTensorHolder* GetOrCreateBuffer(GradNodeBase* node) {
+    auto& buffer = (*node_input_buffers_dict_)[node];
+    if (!buffer) {
+      VLOG(6) << "Construct GradTensorHolder for grad node: " << node->name();
+      buffer = std::make_unique<GradTensorHolder>(node->InputMeta());
+    }
+    return buffer.get();
+  }
+
+  void RunNode(GradNodeBase* node) {
+    // The tracer states read by the grad nodes are thread local.
+    tracer_->SetHasGrad(has_grad_);
+    tracer_->SetAmpLevel(amp_level_);
+    tracer_->SetAmpDtype(amp_dtype_);
+
+    std::unique_ptr<GradTensorHolder> node_input_buffer;
+    std::vector<PendingGrad> pending_grads;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      GetOrCreateBuffer(node);
+      node_input_buffer = std::move((*node_input_buffers_dict_)[node]);
+      node_input_buffers_dict_->erase(node);
+      auto it = pending_grads_.find(node);
+      if (it != pending_grads_.end()) {
+        pending_grads = std::move(it->second);
+        pending_grads_.erase(it);
+      }
+    }
+    std::sort(pending_grads.begin(), pending_grads.end(),
+              [](const PendingGrad& a, const PendingGrad& b) {
+                return a.order < b.order;
+              });
+    for (auto& grad : pending_grads) {
+      node_input_buffer->add(grad.slot_id, grad.rank, grad.tensor);
+    }
+
+    VLOG(6) << "Run Backward Kernel of " << node->name() << " on a worker";
+    std::vector<std::vector<paddle::experimental::Tensor>> grad_output_tensors =
+        (*node)(node_input_buffer->Buffers());
+    node_input_buffer.reset();
+
+    const std::vector<std::vector<Edge>>& edges = node->GetEdges();
+    PADDLE_ENFORCE(edges.size() == grad_output_tensors.size() || edges.empty(),
+                   paddle::platform::errors::Fatal(
+                       "Number of edges should be either empty ( for leaf node "
+                       ") or the same as number of output grad tensors, but we "
+                       "got edges size is: %d, grad_output size is: %d",
+                       edges.size(), grad_output_tensors.size()));
+    for (size_t i = 0; i < edges.size(); i++) {
+      for (size_t j = 0; j < edges[i].size(); j++) {
+        const Edge& edge = edges[i][j];
+        auto edge_rank = edge.GetEdgeRankInfo();
+        auto* next_node = edge.GetMutableGradNode().get();
+        if (!next_node || grad_output_tensors[i].empty()) {
+          continue;
+        }
+        PADDLE_ENFORCE_LT(
+            j, grad_output_tensors[i].size(),
+            paddle::platform::errors::Fatal(
+                "Rank of grad_output_tensors should be less than "
+                "grad_output_tensors[i].size(), which is: %d. This error may "
+                "indicate autoprune or autograd api error. ",
+                grad_output_tensors.size()));
+        auto& grad_output_tensor = grad_output_tensors[i][j];
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (FLAGS_eager_backward_deterministic) {
+          // Accumulated in order by the worker running next_node.
+          pending_grads_[next_node].push_back(
+              {std::make_tuple(node_order_map_->at(node), i, j),
+               edge_rank.first, edge_rank.second, grad_output_tensor});
+        } else {
+          // GradTensorHolder::add is thread safe, so the gradients flowing
+          // into the same node are accumulated without holding mutex_. The
+          // buffer stays until the in-degree of next_node drops to zero.
+          auto* buffer = GetOrCreateBuffer(next_node);
+          lock.unlock();
+          buffer->add(edge_rank.first, edge_rank.second, grad_output_tensor);
+          lock.lock();
+        }
+        int in_degree = --(*node_in_degree_map_)[next_node];
+        PADDLE_ENFORCE(
+            in_degree >= 0,
+            paddle::platform::errors::Fatal(
+                "Detected in-degree value smaller than zero. For Node: %s"
+                "Node's in-degree cannot be negative",
+                next_node->name()));
+        if (in_degree == 0) {
+          Schedule(next_node);
+        }
+      }
+    }
+  }
+
+  GradTensorHolderMap* node_input_buffers_dict_;
+  std::unordered_map<GradNodeBase*, int>* node_in_degree_map_;
+  const std::unordered_map<GradNodeBase*, size_t>* node_order_map_;
+  std::unordered_map<GradNodeBase*, std::vector<PendingGrad>> pending_grads_;
+
+  std::shared_ptr<paddle::imperative::Tracer> tracer_;
+  bool has_grad_;
+  paddle::imperative::AmpLevel amp_level_;
+  std::string amp_dtype_;
+
+  std::mutex mutex_;
+  std::condition_variable finished_;
+  size_t pending_num_{0};
+  std::exception_ptr error_;
+};
+
+// The depth of the backwards running on the current thread. The backward of
+// a recomputed segment or a PyLayer runs inside the backward of the step.
+thread_local int backward_depth = 0;
+
+class BackwardDepthGuard {
+ public:
+  BackwardDepthGuard() { ++backward_depth; }
+  ~BackwardDepthGuard() { --backward_depth; }
+};
+
+// The outermost backward starts a step of the CPU allocations cached across
+// the steps if FLAGS_cpu_step_cached_bytes is set, since a training step runs
+// it once. The nested backwards, on this thread or on a backward worker, are
+// part of the step.
+void NextAllocatorStep() {
+  if (backward_depth == 0 && !in_backward_worker) {
+    paddle::memory::NextStep(paddle::platform::CPUPlace());
+  }
+}
+
+}  // namespace
+
 void RunBackward(const std::vector<paddle::experimental::Tensor>& tensors,
                  const std::vector<paddle::experimental::Tensor>& grad_tensors,
                  bool retain_graph) {
   VLOG(6) << "Start Backward";
+  NextAllocatorStep();
+  BackwardDepthGuard depth_guard;
   // *Gradient Hook should happen at node-level
   // *Inplace version check should perform at node-level
   // *Cross-batch accumulation happens at forward pass
@@ -86,8 +342,7 @@ void RunBackward(const std::vector<paddle::experimental::Tensor>& tensors,
   // 1. Init queue with starting nodes
   // 2. Prepare initial input buffers
   std::queue<GradNodeBase*> queue;
-  std::unordered_map<GradNodeBase*, std::unique_ptr<GradTensorHolder>>
-      node_input_buffers_dict;
+  GradTensorHolderMap node_input_buffers_dict;
   for (size_t i = 0; i < tensors.size(); i++) {
     const paddle::experimental::Tensor& tensor = tensors[i];
 
@@ -147,8 +402,26 @@ void RunBackward(const std::vector<paddle::experimental::Tensor>& tensors,
 
   VLOG(6) << "Update In degree Map for backward";
   // 3. Compute in_degree for each node
+  std::unordered_map<GradNodeBase*, size_t> node_order_map;
   std::unordered_map<GradNodeBase*, int> node_in_degree_map =
-      getInDegreeMap(queue);
+      getInDegreeMap(queue, &node_order_map);
+
+  if (FLAGS_eager_backward_num_threads > 1 && !in_backward_worker) {
+    VLOG(6) << "Run Backward with " << FLAGS_eager_backward_num_threads
+            << " threads";
+    std::vector<GradNodeBase*> ready_nodes;
+    std::unordered_set<GradNodeBase*> visited;
+    for (; !queue.empty(); queue.pop()) {
+      auto* node = queue.front();
+      if (node_in_degree_map[node] == 0 && visited.insert(node).second) {
+        ready_nodes.push_back(node);
+      }
+    }
+    ParallelBackwardRunner runner(&node_input_buffers_dict,
+                                  &node_in_degree_map, &node_order_map);
+    runner.Run(ready_nodes);
+    return;
+  }
 
   /* --- Topological Visit --- */
   // 1. Pop queue
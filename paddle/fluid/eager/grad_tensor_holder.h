@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
+
 #include "paddle/fluid/eager/grad_node_info.h"
 
 namespace egr {
@@ -23,7 +25,9 @@ namespace egr {
  * Since we will have one output used by multi preceding ops in forward pass,
  * we will meet a problem that we need to accumulate multiple grads into one.
  *
- * GradTensorHolder should have as same format as forward output **/
+ * GradTensorHolder should have as same format as forward output.
+ * add() is thread safe, since the grads from the grad nodes running
+ * concurrently may flow into the same GradTensorHolder. **/
 class GradTensorHolder {
  public:
   explicit GradTensorHolder(const std::vector<GradSlotMeta>& meta) {
@@ -35,13 +39,16 @@ class GradTensorHolder {
     }
   }
 
-  GradTensorHolder(const GradTensorHolder& other) = default;
+  GradTensorHolder(const GradTensorHolder& other) : buffer_(other.buffer_) {}
 
   explicit GradTensorHolder(
       std::vector<std::vector<paddle::experimental::Tensor>>&& inputs)
       : buffer_(std::move(inputs)) {}
 
-  GradTensorHolder& operator=(const GradTensorHolder& other) = default;
+  GradTensorHolder& operator=(const GradTensorHolder& other) {
+    buffer_ = other.buffer_;
+    return *this;
+  }
 
   // Create new tensor and copy tensor->impl
   void add(size_t slot_id, size_t rank, const paddle::experimental::Tensor& t,
@@ -58,6 +65,7 @@ class GradTensorHolder {
 
  private:
   std::vector<std::vector<paddle::experimental::Tensor>> buffer_;
+  std::mutex mutex_;
 };
 
 }  // namespace egr
@@ -0,0 +1,272 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/eager/offload/saved_tensors_offloader.h"
+
+#include <cstring>
+#include <future>  // NOLINT
+#include <vector>
+
+#include "paddle/fluid/memory/malloc.h"
+#include "paddle/fluid/memory/memcpy.h"
+#include "paddle/fluid/platform/device_context.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/errors.h"
+#include "paddle/phi/common/float16.h"
+#include "paddle/phi/core/dense_tensor.h"
+
+#include "glog/logging.h"
+#include "zlib.h"  // NOLINT
+
+namespace egr {
+
+using Compression = SavedTensorsOffloader::Compression;
+
+namespace {
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+void* GPUStream(const phi::Place& place) {
+  return static_cast<paddle::platform::CUDADeviceContext*>(
+             paddle::platform::DeviceContextPool::Instance().Get(place))
+      ->stream();
+}
+#endif
+
+}  // namespace
+
+// A tensor kept in the host memory by the SavedTensorsOffloader.
+class OffloadedTensor : public SavedTensor,
+                        public std::enable_shared_from_this<OffloadedTensor> {
+ public:
+  OffloadedTensor(const std::weak_ptr<SavedTensorsOffloader>& offloader,
+                  uint64_t id, const phi::DenseTensor& tensor,
+                  Compression compression);
+
+  ~OffloadedTensor() override;
+
+  paddle::experimental::Tensor Unpack() override;
+
+  // Starts restoring the tensor, unless it is restored or being restored.
+  void Prefetch(paddle::framework::ThreadPool* pool);
+
+  size_t host_size() const { return host_size_; }
+
+ private:
+  std::shared_ptr<phi::DenseTensor> Restore() const;
+
+  std::weak_ptr<SavedTensorsOffloader> offloader_;
+  uint64_t id_;
+  phi::DenseTensorMeta meta_;
+  phi::Place place_;
+  Compression compression_;
+  size_t bytes_;
+  paddle::memory::AllocationPtr host_;
+  size_t host_size_{0};
+
+  std::mutex mutex_;
+  std::shared_ptr<phi::DenseTensor> prefetched_;
+  std::future<void> pending_;
+};
+
+OffloadedTensor::OffloadedTensor(
+    const std::weak_ptr<SavedTensorsOffloader>& offloader, uint64_t id,
+    const phi::DenseTensor& tensor, Compression compression)
+    : offloader_(offloader),
+      id_(id),
+      meta_(tensor.meta()),
+      place_(tensor.place()),
+      compression_(compression),
+      bytes_(tensor.numel() * phi::SizeOf(tensor.dtype())) {
+  meta_.offset = 0;
+  const void* src = tensor.data();
+  if (paddle::platform::is_gpu_place(place_)) {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    // Ordered before the kernels reusing the memory of the tensor, which run
+    // on the same stream.
+    phi::Place pinned_place = paddle::platform::CUDAPinnedPlace();
+    host_ = paddle::memory::Alloc(pinned_place, bytes_);
+    paddle::memory::Copy(pinned_place, host_->ptr(), place_, src, bytes_,
+                         GPUStream(place_));
+    host_size_ = bytes_;
+#endif
+    return;
+  }
+
+  if (compression_ == Compression::kFP16) {
+    auto numel = tensor.numel();
+    host_size_ = numel * sizeof(phi::dtype::float16);
+    host_ = paddle::memory::Alloc(paddle::platform::CPUPlace(), host_size_);
+    auto* in = static_cast<const float*>(src);
+    auto* out = static_cast<phi::dtype::float16*>(host_->ptr());
+    for (int64_t i = 0; i < numel; ++i) {
+      out[i] = static_cast<phi::dtype::float16>(in[i]);
+    }
+  } else if (compression_ == Compression::kZlib) {
+    uLongf size = compressBound(bytes_);
+    std::vector<Bytef> buffer(size);
+    int ret = compress2(buffer.data(), &size, static_cast<const Bytef*>(src),
+                        bytes_, Z_BEST_SPEED);
+    PADDLE_ENFORCE_EQ(ret, Z_OK,
+                      paddle::platform::errors::External(
+                          "Failed to compress the saved tensor, zlib error %d.",
+                          ret));
+    host_size_ = size;
+    host_ = paddle::memory::Alloc(paddle::platform::CPUPlace(), host_size_);
+    std::memcpy(host_->ptr(), buffer.data(), host_size_);
+  }
+}
+
+OffloadedTensor::~OffloadedTensor() {
+  if (auto offloader = offloader_.lock()) {
+    std::lock_guard<std::mutex> guard(offloader->mutex_);
+    offloader->tensors_.erase(id_);
+  }
+}
+
+std::shared_ptr<phi::DenseTensor> OffloadedTensor::Restore() const {
+  auto tensor = std::make_shared<phi::DenseTensor>();
+  tensor->set_meta(meta_);
+  void* dst = tensor->mutable_data(place_, meta_.dtype);
+  if (paddle::platform::is_gpu_place(place_)) {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    phi::Place pinned_place = paddle::platform::CUDAPinnedPlace();
+    paddle::memory::Copy(place_, dst, pinned_place, host_->ptr(), bytes_,
+                         GPUStream(place_));
+#endif
+  } else if (compression_ == Compression::kFP16) {
+    auto* in = static_cast<const phi::dtype::float16*>(host_->ptr());
+    auto* out = static_cast<float*>(dst);
+    for (int64_t i = 0; i < tensor->numel(); ++i) {
+      out[i] = static_cast<float>(in[i]);
+    }
+  } else if (compression_ == Compression::kZlib) {
+    uLongf size = bytes_;
+    int ret = uncompress(static_cast<Bytef*>(dst), &size,
+                         static_cast<const Bytef*>(host_->ptr()), host_size_);
+    PADDLE_ENFORCE_EQ(
+        ret == Z_OK && size == bytes_, true,
+        paddle::platform::errors::External(
+            "Failed to decompress the saved tensor, zlib error %d.", ret));
+  }
+  return tensor;
+}
+
+paddle::experimental::Tensor OffloadedTensor::Unpack() {
+  std::future<void> pending;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pending = std::move(pending_);
+  }
+  if (pending.valid()) {
+    pending.get();
+  }
+  std::shared_ptr<phi::DenseTensor> tensor;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    tensor = std::move(prefetched_);
+  }
+  if (!tensor) {
+    VLOG(6) << "Restore the saved tensor " << id_ << " without prefetching";
+    tensor = Restore();
+  }
+  if (auto offloader = offloader_.lock()) {
+    offloader->Prefetch(id_);
+  }
+  return paddle::experimental::Tensor(tensor);
+}
+
+void OffloadedTensor::Prefetch(paddle::framework::ThreadPool* pool) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (prefetched_ || pending_.valid()) {
+    return;
+  }
+  // The copy to the GPU is asynchronous already.
+  if (paddle::platform::is_gpu_place(place_)) {
+    prefetched_ = Restore();
+    return;
+  }
+  auto self = shared_from_this();
+  pending_ = pool->Run([self] {
+    auto tensor = self->Restore();
+    std::lock_guard<std::mutex> guard(self->mutex_);
+    self->prefetched_ = tensor;
+  });
+}
+
+SavedTensorsOffloader::SavedTensorsOffloader(const Options& options)
+    : options_(options), pool_(new paddle::framework::ThreadPool(1)) {}
+
+std::shared_ptr<SavedTensor> SavedTensorsOffloader::Pack(
+    const paddle::experimental::Tensor& tensor) {
+  if (!tensor.is_dense_tensor() || !tensor.initialized()) {
+    return nullptr;
+  }
+  auto* dense = static_cast<phi::DenseTensor*>(tensor.impl().get());
+  int64_t bytes = dense->numel() * phi::SizeOf(dense->dtype());
+  if (bytes < options_.min_bytes) {
+    return nullptr;
+  }
+  Compression compression = Compression::kNone;
+  if (paddle::platform::is_cpu_place(dense->place())) {
+    compression = options_.compression;
+    if (compression == Compression::kNone ||
+        (compression == Compression::kFP16 &&
+         dense->dtype() != phi::DataType::FLOAT32)) {
+      return nullptr;
+    }
+  } else if (!paddle::platform::is_gpu_place(dense->place())) {
+    return nullptr;
+  }
+
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    id = next_id_++;
+  }
+  auto offloaded = std::make_shared<OffloadedTensor>(shared_from_this(), id,
+                                                     *dense, compression);
+  if (compression != Compression::kNone &&
+      static_cast<int64_t>(offloaded->host_size()) >= bytes) {
+    VLOG(6) << "Keep the saved tensor " << tensor.name()
+            << " not compressed by " << static_cast<int>(compression);
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    tensors_[id] = offloaded;
+  }
+  offloaded_bytes_ += bytes;
+  host_bytes_ += offloaded->host_size();
+  return offloaded;
+}
+
+void SavedTensorsOffloader::Prefetch(uint64_t id) {
+  std::vector<std::shared_ptr<OffloadedTensor>> tensors;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    // The tensors saved right before the one unpacked.
+    auto it = tensors_.lower_bound(id);
+    for (int i = 0; i < options_.prefetch_num && it != tensors_.begin(); ++i) {
+      --it;
+      if (auto tensor = it->second.lock()) {
+        tensors.push_back(tensor);
+      }
+    }
+  }
+  for (auto& tensor : tensors) {
+    tensor->Prefetch(pool_.get());
+  }
+}
+
+}  // namespace egr
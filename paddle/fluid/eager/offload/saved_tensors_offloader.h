@@ -0,0 +1,91 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+
+#include "paddle/fluid/eager/saved_tensors_hooks.h"
+#include "paddle/fluid/framework/threadpool.h"
+
+namespace egr {
+
+class OffloadedTensor;
+
+// The saved tensors hooks moving the tensors saved for the backward to the
+// host memory, allocated from the pinned memory pool for the GPU tensors and
+// from the CPU memory pool otherwise. Since moving a CPU tensor to the host
+// frees no memory, the CPU tensors are offloaded only if they are
+// compressed.
+//
+// The backward uses the saved tensors in about the reverse order they are
+// saved, so unpacking a tensor prefetches the ones saved right before it:
+// the copies to the GPU are enqueued on the stream ahead of use, and the
+// CPU tensors are decompressed on a thread of the offloader.
+//
+//   auto offloader = std::make_shared<SavedTensorsOffloader>(options);
+//   Controller::Instance().SetSavedTensorsHooks(offloader);
+class SavedTensorsOffloader
+    : public SavedTensorsHooks,
+      public std::enable_shared_from_this<SavedTensorsOffloader> {
+ public:
+  enum class Compression {
+    kNone,
+    // Lossy, the FP32 tensors are kept in FP16.
+    kFP16,
+    // Lossless, with the fastest level of zlib.
+    kZlib,
+  };
+
+  struct Options {
+    // The smaller tensors are kept as they are.
+    int64_t min_bytes{1 << 20};
+    // Applies to the CPU tensors only.
+    Compression compression{Compression::kNone};
+    // The number of tensors to prefetch ahead of the one unpacked.
+    int prefetch_num{2};
+  };
+
+  explicit SavedTensorsOffloader(const Options& options);
+
+  std::shared_ptr<SavedTensor> Pack(
+      const paddle::experimental::Tensor& tensor) override;
+
+  // The bytes of the tensors offloaded, and the bytes they take in the host
+  // memory, which are less if they are compressed.
+  int64_t offloaded_bytes() const { return offloaded_bytes_; }
+  int64_t host_bytes() const { return host_bytes_; }
+
+ private:
+  friend class OffloadedTensor;
+
+  void Prefetch(uint64_t id);
+
+  Options options_;
+  std::atomic<int64_t> offloaded_bytes_{0};
+  std::atomic<int64_t> host_bytes_{0};
+
+  std::mutex mutex_;
+  uint64_t next_id_{0};
+  // The tensors offloaded and not released yet, in the order they are
+  // saved.
+  std::map<uint64_t, std::weak_ptr<OffloadedTensor>> tensors_;
+  std::unique_ptr<paddle::framework::ThreadPool> pool_;
+};
+
+}  // namespace egr
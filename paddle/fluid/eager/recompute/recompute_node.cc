@@ -0,0 +1,255 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/eager/recompute/recompute_node.h"
+
+#include "paddle/fluid/eager/accumulation/accumulation_node.h"
+#include "paddle/fluid/eager/api/utils/global_utils.h"
+#include "paddle/fluid/eager/autograd_meta.h"
+#include "paddle/fluid/eager/backward.h"
+#include "paddle/fluid/eager/utils.h"
+
+#include "paddle/fluid/framework/generator.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/errors.h"
+
+#include "glog/logging.h"
+
+namespace egr {
+
+namespace {
+
+// Sets whether the ops run on the current thread are traced for the
+// backward, and restores it on destruction.
+class HasGradGuard {
+ public:
+  explicit HasGradGuard(bool has_grad)
+      : prev_has_grad_(Controller::Instance().HasGrad()) {
+    Controller::Instance().SetHasGrad(has_grad);
+  }
+  ~HasGradGuard() { Controller::Instance().SetHasGrad(prev_has_grad_); }
+
+ private:
+  bool prev_has_grad_;
+};
+
+// Sets the AMP states of the ops run on the current thread, and restores them
+// on destruction.
+class AmpStateGuard {
+ public:
+  AmpStateGuard(paddle::imperative::AmpLevel amp_level,
+                const std::string& amp_dtype)
+      : tracer_(Controller::Instance().GetCurrentTracer()),
+        prev_amp_level_(tracer_->GetAmpLevel()),
+        prev_amp_dtype_(tracer_->GetAmpDtype()) {
+    tracer_->SetAmpLevel(amp_level);
+    tracer_->SetAmpDtype(amp_dtype);
+  }
+  ~AmpStateGuard() {
+    tracer_->SetAmpLevel(prev_amp_level_);
+    tracer_->SetAmpDtype(prev_amp_dtype_);
+  }
+
+ private:
+  std::shared_ptr<paddle::imperative::Tracer> tracer_;
+  paddle::imperative::AmpLevel prev_amp_level_;
+  std::string prev_amp_dtype_;
+};
+
+paddle::platform::Place InputsPlace(
+    const std::vector<paddle::experimental::Tensor>& inputs) {
+  for (auto& input : inputs) {
+    if (input.defined()) {
+      return input.inner_place();
+    }
+  }
+  return Controller::Instance().GetExpectedPlace();
+}
+
+}  // namespace
+
+RNGStateTracker::RNGStateTracker(const paddle::platform::Place& place) {
+  cpu_state_ = paddle::framework::DefaultCPUGenerator()->GetState();
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+  if (paddle::platform::is_gpu_place(place)) {
+    has_gpu_state_ = true;
+    gpu_device_id_ = place.GetDeviceId();
+    gpu_state_ =
+        paddle::framework::GetDefaultCUDAGenerator(gpu_device_id_)->GetState();
+  }
+#endif
+}
+
+void RNGStateTracker::Swap() {
+  auto& cpu_generator = paddle::framework::DefaultCPUGenerator();
+  auto cpu_state = cpu_generator->GetState();
+  cpu_generator->SetState(cpu_state_);
+  cpu_state_ = cpu_state;
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+  if (has_gpu_state_) {
+    auto& gpu_generator =
+        paddle::framework::GetDefaultCUDAGenerator(gpu_device_id_);
+    auto gpu_state = gpu_generator->GetState();
+    gpu_generator->SetState(gpu_state_);
+    gpu_state_ = gpu_state;
+  }
+#endif
+}
+
+GradNodeRecompute::GradNodeRecompute(
+    const RecomputeFunction& fn,
+    const std::vector<paddle::experimental::Tensor>& inputs,
+    const std::vector<bool>& requires_grad, bool preserve_rng_state)
+    : GradNodeBase(1, 1),
+      fn_(fn),
+      requires_grad_(requires_grad),
+      amp_level_(Controller::Instance().GetAMPLevel()),
+      amp_dtype_(Controller::Instance().GetCurrentTracer()->GetAmpDtype()) {
+  // Only the data of the inputs is kept, the recomputed segment builds a
+  // graph of its own.
+  for (auto& input : inputs) {
+    paddle::experimental::Tensor saved(input.impl());
+    saved.set_name(input.name() + "@Saved");
+    inputs_.emplace_back(std::move(saved));
+  }
+  if (preserve_rng_state) {
+    rng_state_.reset(new RNGStateTracker(InputsPlace(inputs)));
+  }
+}
+
+std::vector<std::vector<paddle::experimental::Tensor>> GradNodeRecompute::
+operator()(
+    const std::vector<std::vector<paddle::experimental::Tensor>>& grads) {
+  VLOG(3) << "Running Eager Backward Node: GradNodeRecompute";
+  PADDLE_ENFORCE_EQ(grads.size(), 1,
+                    paddle::platform::errors::InvalidArgument(
+                        "The grads of GradNodeRecompute should have 1 slot, "
+                        "but got %d.",
+                        grads.size()));
+
+  std::vector<paddle::experimental::Tensor> inputs;
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    paddle::experimental::Tensor input(inputs_[i].impl());
+    input.set_name(inputs_[i].name());
+    auto* meta = EagerUtils::autograd_meta(&input);
+    meta->SetStopGradient(!requires_grad_[i]);
+    if (requires_grad_[i]) {
+      meta->SetGradNode(std::make_shared<GradNodeAccumulation>(meta));
+    }
+    inputs.emplace_back(std::move(input));
+  }
+
+  std::vector<paddle::experimental::Tensor> outputs;
+  {
+    HasGradGuard has_grad_guard(true);
+    // The backward may run with other AMP states, e.g. out of auto_cast, or
+    // on a backward thread.
+    AmpStateGuard amp_state_guard(amp_level_, amp_dtype_);
+    if (rng_state_) rng_state_->Swap();
+    try {
+      outputs = fn_(inputs);
+    } catch (...) {
+      if (rng_state_) rng_state_->Swap();
+      throw;
+    }
+    if (rng_state_) rng_state_->Swap();
+  }
+  PADDLE_ENFORCE_EQ(
+      outputs.size(), grads[0].size(),
+      paddle::platform::errors::InvalidArgument(
+          "The recomputed segment has %d outputs, but the forward had %d.",
+          outputs.size(), grads[0].size()));
+
+  // The outputs that got no grad or do not need grad are pruned.
+  std::vector<paddle::experimental::Tensor> targets;
+  std::vector<paddle::experimental::Tensor> target_grads;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    auto* meta = EagerUtils::nullable_autograd_meta(outputs[i]);
+    if (meta == nullptr || meta->StopGradient() ||
+        meta->GetMutableGradNode() == nullptr || !grads[0][i].defined() ||
+        !grads[0][i].initialized()) {
+      continue;
+    }
+    targets.emplace_back(outputs[i]);
+    target_grads.emplace_back(grads[0][i]);
+  }
+  if (!targets.empty()) {
+    RunBackward(targets, target_grads);
+  }
+
+  std::vector<paddle::experimental::Tensor> input_grads;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (requires_grad_[i]) {
+      input_grads.emplace_back(
+          EagerUtils::unsafe_autograd_meta(inputs[i])->Grad());
+    }
+  }
+  VLOG(3) << "End Eager Backward Node: GradNodeRecompute";
+  return {input_grads};
+}
+
+std::vector<paddle::experimental::Tensor> Recompute(
+    const RecomputeFunction& fn,
+    const std::vector<paddle::experimental::Tensor>& inputs,
+    bool preserve_rng_state) {
+  // Even if no input requires grad, the tensors captured by fn, e.g. the
+  // parameters, may do.
+  if (!Controller::Instance().HasGrad()) {
+    return fn(inputs);
+  }
+  std::vector<AutogradMeta*> p_autograd_inputs =
+      EagerUtils::nullable_autograd_meta(inputs);
+
+  std::vector<bool> requires_grad;
+  std::vector<AutogradMeta*> p_autograd_grad_inputs;
+  for (auto* meta : p_autograd_inputs) {
+    requires_grad.push_back(meta != nullptr && !meta->StopGradient());
+    if (requires_grad.back()) p_autograd_grad_inputs.push_back(meta);
+  }
+  // Created before running fn, which may consume the random numbers.
+  auto grad_node = std::make_shared<GradNodeRecompute>(
+      fn, inputs, requires_grad, preserve_rng_state);
+
+  std::vector<paddle::experimental::Tensor> outputs;
+  {
+    HasGradGuard has_grad_guard(false);
+    outputs = fn(inputs);
+  }
+  // The outputs returned as is share the autograd meta of the inputs.
+  for (auto& output : outputs) {
+    for (auto& input : inputs) {
+      if (output.defined() && output.impl() == input.impl()) {
+        paddle::experimental::Tensor copy(output.impl());
+        copy.set_name(output.name());
+        output = std::move(copy);
+        break;
+      }
+    }
+  }
+
+  std::vector<AutogradMeta*> p_autograd_outputs =
+      EagerUtils::autograd_meta(&outputs);
+  EagerUtils::PassStopGradient(false, &p_autograd_outputs);
+
+  grad_node->SetGradOutMeta(&p_autograd_grad_inputs, /*slot id*/ 0);
+  grad_node->SetGradInMeta(&p_autograd_outputs, /*slot id*/ 0);
+  grad_node->AddEdges(&p_autograd_grad_inputs, /*slot id*/ 0);
+
+  EagerUtils::SetOutRankWithSlot(&p_autograd_outputs, 0);
+  EagerUtils::SetHistory(&p_autograd_outputs, grad_node);
+  EagerUtils::CheckAndRetainGrad(outputs);
+  return outputs;
+}
+
+}  // namespace egr
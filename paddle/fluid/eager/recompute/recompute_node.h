@@ -0,0 +1,87 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/eager/grad_node_info.h"
+#include "paddle/fluid/imperative/amp_auto_cast.h"
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/generator.h"
+
+namespace egr {
+
+using RecomputeFunction =
+    std::function<std::vector<paddle::experimental::Tensor>(
+        const std::vector<paddle::experimental::Tensor>&)>;
+
+// The states of the default generators of a place, to run the random ops of
+// a recomputed segment, e.g. dropout, with the same random numbers.
+class RNGStateTracker {
+ public:
+  explicit RNGStateTracker(const paddle::platform::Place& place);
+
+  // Swaps the saved states with the current states of the generators.
+  void Swap();
+
+ private:
+  phi::Generator::GeneratorState cpu_state_;
+  bool has_gpu_state_{false};
+  int gpu_device_id_{-1};
+  phi::Generator::GeneratorState gpu_state_;
+};
+
+// The grad node of a segment of the forward whose activations are not saved.
+// The backward runs the segment again with the grad enabled, under the AMP
+// states of the forward, and then the backward of the recomputed segment.
+class GradNodeRecompute : public GradNodeBase {
+ public:
+  GradNodeRecompute(const RecomputeFunction& fn,
+                    const std::vector<paddle::experimental::Tensor>& inputs,
+                    const std::vector<bool>& requires_grad,
+                    bool preserve_rng_state);
+
+  ~GradNodeRecompute() override = default;
+
+  // Returns the grads of the inputs requiring grad, in the order of the
+  // inputs.
+  std::vector<std::vector<paddle::experimental::Tensor>> operator()(
+      const std::vector<std::vector<paddle::experimental::Tensor>>& grads)
+      override;
+
+  std::string name() override { return "GradNodeRecompute"; }
+
+ private:
+  RecomputeFunction fn_;
+  std::vector<paddle::experimental::Tensor> inputs_;
+  std::vector<bool> requires_grad_;
+  std::unique_ptr<RNGStateTracker> rng_state_;
+  paddle::imperative::AmpLevel amp_level_;
+  std::string amp_dtype_;
+};
+
+// Runs fn on inputs without saving the activations for the backward, only
+// the inputs are kept. fn must be deterministic given the RNG states. The
+// tensors captured by fn, e.g. the parameters, get their grads from the
+// backward of the recomputed segment.
+std::vector<paddle::experimental::Tensor> Recompute(
+    const RecomputeFunction& fn,
+    const std::vector<paddle::experimental::Tensor>& inputs,
+    bool preserve_rng_state = true);
+
+}  // namespace egr
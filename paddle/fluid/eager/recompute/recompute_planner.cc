@@ -0,0 +1,137 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/eager/recompute/recompute_planner.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <unordered_set>
+
+#include "paddle/fluid/eager/api/utils/global_utils.h"
+#include "paddle/fluid/eager/tensor_wrapper.h"
+#include "paddle/fluid/platform/device_context.h"
+
+#include "glog/logging.h"
+
+namespace egr {
+
+namespace {
+
+void WaitPlace(const std::vector<paddle::experimental::Tensor>& tensors) {
+  for (auto& tensor : tensors) {
+    if (tensor.defined() && tensor.initialized()) {
+      paddle::platform::DeviceContextPool::Instance()
+          .Get(tensor.inner_place())
+          ->Wait();
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+std::vector<bool> PlanRecompute(const std::vector<RecomputeSegmentStat>& stats,
+                                int64_t budget_bytes) {
+  std::vector<bool> plan(stats.size(), false);
+  int64_t kept_bytes = 0;
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    kept_bytes += stats[i].activation_bytes;
+    if (stats[i].activation_bytes > 0) candidates.push_back(i);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&stats](size_t a, size_t b) {
+                     return stats[a].activation_bytes * stats[b].forward_ms >
+                            stats[b].activation_bytes * stats[a].forward_ms;
+                   });
+  for (size_t i = 0; i < candidates.size() && kept_bytes > budget_bytes;
+       ++i) {
+    plan[candidates[i]] = true;
+    kept_bytes -= stats[candidates[i]].activation_bytes;
+  }
+  return plan;
+}
+
+std::vector<paddle::experimental::Tensor> RecomputePlanner::Run(
+    const RecomputeFunction& fn,
+    const std::vector<paddle::experimental::Tensor>& inputs) {
+  // The segments run without grad, e.g. in evaluation, are not counted.
+  if (!Controller::Instance().HasGrad()) {
+    return fn(inputs);
+  }
+  size_t idx = segment_idx_++;
+  if (!planned_) {
+    return Profile(fn, inputs);
+  }
+  if (idx < plan_.size() && plan_[idx]) {
+    return Recompute(fn, inputs, preserve_rng_state_);
+  }
+  return fn(inputs);
+}
+
+std::vector<paddle::experimental::Tensor> RecomputePlanner::Profile(
+    const RecomputeFunction& fn,
+    const std::vector<paddle::experimental::Tensor>& inputs) {
+  SavedTensorsProfile profile;
+  for (auto& input : inputs) {
+    profile.tensors.insert(input.impl().get());
+  }
+  auto* prev_profile = SavedTensorsProfile::Current();
+  SavedTensorsProfile::Current() = &profile;
+
+  WaitPlace(inputs);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<paddle::experimental::Tensor> outputs;
+  try {
+    outputs = fn(inputs);
+  } catch (...) {
+    SavedTensorsProfile::Current() = prev_profile;
+    throw;
+  }
+  WaitPlace(outputs);
+  auto end = std::chrono::steady_clock::now();
+  SavedTensorsProfile::Current() = prev_profile;
+
+  // The outputs saved by the segment are kept anyway, by the next segment.
+  RecomputeSegmentStat stat;
+  stat.activation_bytes = profile.bytes;
+  std::unordered_set<const phi::TensorBase*> kept;
+  for (auto& input : inputs) {
+    kept.insert(input.impl().get());
+  }
+  for (auto& output : outputs) {
+    if (output.is_dense_tensor() && output.initialized() &&
+        profile.tensors.count(output.impl().get()) &&
+        kept.insert(output.impl().get()).second) {
+      stat.activation_bytes -= output.numel() * phi::SizeOf(output.dtype());
+    }
+  }
+  stat.forward_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+  stats_.push_back(stat);
+  return outputs;
+}
+
+void RecomputePlanner::StepEnd() {
+  if (!planned_ && !stats_.empty()) {
+    plan_ = PlanRecompute(stats_, budget_bytes_);
+    planned_ = true;
+    VLOG(3) << "Recompute " << std::count(plan_.begin(), plan_.end(), true)
+            << " of " << plan_.size() << " segments to keep the activations "
+            << "within " << budget_bytes_ << " bytes";
+  }
+  segment_idx_ = 0;
+}
+
+}  // namespace egr
@@ -0,0 +1,83 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "paddle/fluid/eager/recompute/recompute_node.h"
+
+namespace egr {
+
+// The cost of a segment of the forward, measured by profiling it.
+struct RecomputeSegmentStat {
+  // The bytes of the activations saved for the backward by the segment,
+  // except its inputs and outputs, which are kept anyway.
+  int64_t activation_bytes{0};
+  double forward_ms{0.};
+};
+
+// Returns whether to recompute each segment, so that the activations kept
+// fit in budget_bytes. The segments freeing the most bytes per millisecond
+// of recomputation are recomputed first. All the segments saving any
+// activations are recomputed if the budget cannot be met.
+std::vector<bool> PlanRecompute(const std::vector<RecomputeSegmentStat>& stats,
+                                int64_t budget_bytes);
+
+// Picks the segments of the forward to recompute to meet a memory budget.
+// The segments are identified by the order they run in a step, so the
+// forward must run the same segments in every step. The first step runs
+// all the segments as usual to profile them, and the plan is made at its
+// end.
+//
+//   RecomputePlanner planner(budget_bytes);
+//   for (...) {
+//     auto h = planner.Run(block0, {x});
+//     auto y = planner.Run(block1, h);
+//     RunBackward(loss(y), {});
+//     planner.StepEnd();
+//   }
+class RecomputePlanner {
+ public:
+  explicit RecomputePlanner(int64_t budget_bytes,
+                            bool preserve_rng_state = true)
+      : budget_bytes_(budget_bytes), preserve_rng_state_(preserve_rng_state) {}
+
+  // Runs the next segment of the step, recomputed in the backward if it is
+  // picked by the plan.
+  std::vector<paddle::experimental::Tensor> Run(
+      const RecomputeFunction& fn,
+      const std::vector<paddle::experimental::Tensor>& inputs);
+
+  void StepEnd();
+
+  bool planned() const { return planned_; }
+  const std::vector<RecomputeSegmentStat>& stats() const { return stats_; }
+  const std::vector<bool>& plan() const { return plan_; }
+
+ private:
+  std::vector<paddle::experimental::Tensor> Profile(
+      const RecomputeFunction& fn,
+      const std::vector<paddle::experimental::Tensor>& inputs);
+
+  int64_t budget_bytes_;
+  bool preserve_rng_state_;
+  bool planned_{false};
+  size_t segment_idx_{0};
+  std::vector<RecomputeSegmentStat> stats_;
+  std::vector<bool> plan_;
+};
+
+}  // namespace egr
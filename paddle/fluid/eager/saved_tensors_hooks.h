@@ -0,0 +1,45 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+
+#include "paddle/phi/api/include/tensor.h"
+
+namespace egr {
+
+// A tensor saved for the backward by a TensorWrapper, kept by the saved
+// tensors hooks in a form of their own, e.g. in the host memory.
+class SavedTensor {
+ public:
+  virtual ~SavedTensor() = default;
+
+  // Returns the tensor to run the backward with. It may be called more than
+  // once, and from the threads running the backward.
+  virtual paddle::experimental::Tensor Unpack() = 0;
+};
+
+// The hooks deciding how the TensorWrappers keep the tensors saved for the
+// backward, installed by Controller::SetSavedTensorsHooks.
+class SavedTensorsHooks {
+ public:
+  virtual ~SavedTensorsHooks() = default;
+
+  // Returns nullptr to keep the tensor in the TensorWrapper as usual.
+  virtual std::shared_ptr<SavedTensor> Pack(
+      const paddle::experimental::Tensor& tensor) = 0;
+};
+
+}  // namespace egr
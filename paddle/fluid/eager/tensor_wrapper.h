@@ -25,11 +25,40 @@
  * with no grad **/
 
 #pragma once
+#include <unordered_set>
+
+#include "paddle/fluid/eager/api/utils/global_utils.h"
 #include "paddle/fluid/eager/autograd_meta.h"
 #include "paddle/fluid/eager/grad_node_info.h"
+#include "paddle/fluid/eager/saved_tensors_hooks.h"
 #include "paddle/fluid/eager/utils.h"
 
 namespace egr {
+
+// The tensors saved by the TensorWrappers created on the current thread while
+// it is installed, to measure the activation memory kept by a part of the
+// forward, e.g. by the recompute planner.
+struct SavedTensorsProfile {
+  std::unordered_set<const phi::TensorBase*> tensors;
+  int64_t bytes{0};
+
+  static SavedTensorsProfile*& Current() {
+    static thread_local SavedTensorsProfile* profile = nullptr;
+    return profile;
+  }
+
+  static void Record(const paddle::experimental::Tensor& tensor) {
+    auto* profile = Current();
+    if (profile == nullptr || !tensor.is_dense_tensor() ||
+        !tensor.initialized()) {
+      return;
+    }
+    if (profile->tensors.insert(tensor.impl().get()).second) {
+      profile->bytes += tensor.numel() * phi::SizeOf(tensor.dtype());
+    }
+  }
+};
+
 class TensorWrapper {
  public:
   TensorWrapper() = default;
@@ -45,6 +74,7 @@ class TensorWrapper {
     if (full_reserved_) {
       VLOG(6) << "Fully reserved tensor: " << tensor.name();
       intermidiate_tensor_ = tensor;
+      SavedTensorsProfile::Record(tensor);
       return;
     }
 
@@ -62,7 +92,14 @@ class TensorWrapper {
             "Unrecognized tensor type for no_need_buffer feature"));
       }
     } else {
-      intermidiate_tensor_.set_impl(tensor.impl());
+      SavedTensorsProfile::Record(tensor);
+      auto& hooks = Controller::Instance().GetSavedTensorsHooks();
+      if (hooks) {
+        packed_tensor_ = hooks->Pack(tensor);
+      }
+      if (!packed_tensor_) {
+        intermidiate_tensor_.set_impl(tensor.impl());
+      }
     }
 
     intermidiate_tensor_.set_name(tensor.name() + "@Saved");
@@ -79,6 +116,18 @@ class TensorWrapper {
       const std::shared_ptr<GradNodeBase>& grad_node) {
     VLOG(6) << "Recover tensor: " << intermidiate_tensor_.name()
             << " for wrapper";
+    if (packed_tensor_) {
+      // Unpacked for this use only, so that the wrapper does not hold the
+      // memory again.
+      paddle::experimental::Tensor unpacked(packed_tensor_->Unpack().impl(),
+                                            intermidiate_tensor_.name());
+      auto p_ab_autograd_meta =
+          std::make_shared<AutogradMeta>(Edge(grad_node, out_rank_info_));
+      unpacked.set_autograd_meta(
+          std::static_pointer_cast<paddle::experimental::AbstractAutogradMeta>(
+              p_ab_autograd_meta));
+      return unpacked;
+    }
     if (!intermidiate_tensor_.defined()) {
       VLOG(6) << "Return NULL tensor Here. ";
       return paddle::experimental::Tensor();
@@ -102,5 +151,7 @@ class TensorWrapper {
   bool full_reserved_ = false;
   std::pair<size_t, size_t> out_rank_info_;
   paddle::experimental::Tensor intermidiate_tensor_;
+  // Set if the saved tensors hooks keep the tensor instead.
+  std::shared_ptr<SavedTensor> packed_tensor_;
 };
 }  // namespace egr
@@ -123,6 +123,54 @@ TEST(Benchmark, EagerMatmulCPU) {
   }
 }
 
+TEST(Benchmark, EagerMatmulChainCPU) {
+  // Prepare Device Contexts
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+
+  auto tracer = std::make_shared<paddle::imperative::Tracer>();
+  paddle::imperative::SetCurrentTracer(tracer);
+
+  for (const std::string& mode : {"Accuracy", "Performance"}) {
+    paddle::framework::DDim ddimX = phi::make_ddim({MLP_M, MLP_N});
+    paddle::experimental::Tensor X = CreateTensorWithValue(
+        ddimX, paddle::platform::CPUPlace(), phi::DataType::FLOAT32,
+        phi::DataLayout::NCHW, 1.0, true);
+    RetainGradForTensor(X);
+
+    std::vector<paddle::experimental::Tensor> Ws;
+    for (size_t i = 0; i < MLP_NUM_LINEAR; i++) {
+      paddle::framework::DDim ddimW = phi::make_ddim({MLP_N, MLP_K});
+      paddle::experimental::Tensor W = CreateTensorWithValue(
+          ddimW, paddle::platform::CPUPlace(), phi::DataType::FLOAT32,
+          phi::DataLayout::NCHW, 1.0 / MLP_N, true);
+      RetainGradForTensor(W);
+      Ws.emplace_back(std::move(W));
+    }
+
+    if (mode == "Accuracy") {
+      benchmark_eager_matmul_chain(X, Ws, true /* accuracy_check */);
+
+    } else if (mode == "Performance") {
+      auto t_start = std::chrono::high_resolution_clock::now();
+#ifdef WITH_GPERFTOOLS
+      ProfilerStart("eager_matmul_chain_cpu.out");
+#endif
+      benchmark_eager_matmul_chain(X, Ws);
+
+#ifdef WITH_GPERFTOOLS
+      ProfilerStop();
+#endif
+      auto t_end = std::chrono::high_resolution_clock::now();
+      double elapsed_time_ms =
+          std::chrono::duration<double, std::milli>(t_end - t_start).count();
+      std::cout << "Duration: " << elapsed_time_ms << " ms" << std::endl;
+
+    } else {
+      PADDLE_THROW(paddle::platform::errors::Fatal("Unknown benchmark mode"));
+    }
+  }
+}
+
 TEST(Benchmark, EagerIntermediateMatmulCPU) {
   // Prepare Device Contexts
   eager_test::InitEnv(paddle::platform::CPUPlace());
@@ -91,6 +91,30 @@ void benchmark_eager_matmul(const paddle::experimental::Tensor& X,
   }
 }
 
+/* ---------------------------- */
+/* ---- Eager Matmul Chain ---- */
+/* ---------------------------- */
+void benchmark_eager_matmul_chain(
+    const paddle::experimental::Tensor& X,
+    const std::vector<paddle::experimental::Tensor>& Ws, bool accuracy_check) {
+  paddle::experimental::Tensor input0 = X;
+
+  for (size_t i = 0; i < Ws.size(); i++) {
+    input0 = matmul_final_state_dygraph_function(input0, Ws[i], false, false);
+  }
+
+  std::vector<paddle::experimental::Tensor> target_tensors = {input0};
+  RunBackward(target_tensors, {});
+
+  if (accuracy_check) {
+    // Every W is filled with 1 / MLP_N, so each matmul keeps the ones of X
+    // and of the grads.
+    eager_test::CompareTensorWithValue<float>(input0, 1.0);
+    eager_test::CompareGradTensorWithValue<float>(X, 1.0);
+    eager_test::CompareGradTensorWithValue<float>(Ws[0], MLP_M);
+  }
+}
+
 /* ----------------------------------- */
 /* ---- Eager Intermediate Matmul ---- */
 /* ----------------------------------- */
@@ -55,6 +55,13 @@ void benchmark_eager_matmul(const paddle::experimental::Tensor& X,
                             const paddle::experimental::Tensor& Y,
                             bool accuracy_check = false);
 
+// Only the final state matmul of small tensors, so that the duration is
+// dominated by the generated forward function and grad node.
+void benchmark_eager_matmul_chain(
+    const paddle::experimental::Tensor& X,
+    const std::vector<paddle::experimental::Tensor>& Ws,
+    bool accuracy_check = false);
+
 void benchmark_eager_intermediate_matmul(const paddle::experimental::Tensor& X,
                                          const paddle::experimental::Tensor& Y,
                                          bool accuracy_check = false);
@@ -14,6 +14,7 @@
 
 #include <sstream>
 
+#include "gflags/gflags.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
@@ -34,6 +35,9 @@
 
 PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
 
+DECLARE_int32(eager_backward_num_threads);
+DECLARE_bool(eager_backward_deterministic);
+
 namespace egr {
 
 TEST(Backward, SingleNodeEmptyGrad) {
@@ -224,7 +228,7 @@ Node0   Node1
   |      |
  inp0   inp1
 */
-TEST(Backward, WithAccumulation) {
+static void TestBackwardWithAccumulation() {
   // Prepare Device Contexts
   eager_test::InitEnv(paddle::platform::CPUPlace());
 
@@ -320,4 +324,94 @@ TEST(Backward, WithAccumulation) {
   eager_test::CompareGradTensorWithValue<float>(leaf_tensor, 2500.0);
 }
 
+TEST(Backward, WithAccumulation) { TestBackwardWithAccumulation(); }
+
+TEST(Backward, WithAccumulationMultiThreads) {
+  // Node0 and Node1 run concurrently, and both flow into Node2.
+  FLAGS_eager_backward_num_threads = 4;
+  for (bool deterministic : {false, true}) {
+    FLAGS_eager_backward_deterministic = deterministic;
+    TestBackwardWithAccumulation();
+  }
+  FLAGS_eager_backward_num_threads = 1;
+  FLAGS_eager_backward_deterministic = false;
+}
+
+namespace {
+
+// Connects the target tensor to the leaf tensor through the grad node.
+void ConnectThroughNode(paddle::experimental::Tensor* target,
+                        const std::shared_ptr<GradNodeBase>& node,
+                        paddle::experimental::Tensor* leaf) {
+  node->SetDefaultGradInOutMeta();
+  AutogradMeta* target_meta = EagerUtils::autograd_meta(target);
+  target_meta->SetGradNode(node);
+  target_meta->SetSingleOutRankWithSlot(0, 0);
+  target_meta->SetStopGradient(false);
+
+  AutogradMeta* leaf_meta = EagerUtils::autograd_meta(leaf);
+  auto acc_node_ptr = std::make_shared<egr::GradNodeAccumulation>(leaf_meta);
+  leaf_meta->SetGradNode(std::dynamic_pointer_cast<GradNodeBase>(acc_node_ptr));
+  leaf_meta->SetSingleOutRankWithSlot(0, 0);
+  leaf_meta->SetStopGradient(false);
+  std::vector<egr::AutogradMeta*> res = {leaf_meta};
+  node->AddEdges(&res, 0);
+}
+
+// A grad node running the backward of a graph of its own, like the node of
+// a recomputed segment, and passing its grads through.
+class NestedBackwardNode : public GradNodeBase {
+ public:
+  NestedBackwardNode() : GradNodeBase(1, 1) {}
+
+  std::string name() override { return "NestedBackwardNode"; }
+
+  std::vector<std::vector<paddle::experimental::Tensor>> operator()(
+      const std::vector<std::vector<paddle::experimental::Tensor>>& grads)
+      override {
+    paddle::experimental::Tensor inner_target =
+        egr_utils_api::CreateTensorWithValue(
+            phi::make_ddim({4, 16}), paddle::platform::CPUPlace(),
+            phi::DataType::FLOAT32, phi::DataLayout::NCHW, 1.0 /*value*/,
+            false /*is_leaf*/);
+    auto scale_node = std::make_shared<GradNodeScale>(1, 1);
+    scale_node->SetAttributes_scale(3.0 /*scale*/);
+    ConnectThroughNode(&inner_target, scale_node, &inner_leaf);
+    RunBackward({inner_target}, {});
+    return grads;
+  }
+
+  paddle::experimental::Tensor inner_leaf;
+};
+
+}  // namespace
+
+TEST(Backward, NestedBackwardMultiThreads) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  FLAGS_eager_backward_num_threads = 4;
+
+  // More nested backwards run at the same time than the workers of the
+  // pool, each of which would wait for a free worker if the nested backward
+  // scheduled its nodes on the pool.
+  const int branch_num = 8;
+  std::vector<paddle::experimental::Tensor> targets;
+  std::vector<paddle::experimental::Tensor> leaves(branch_num);
+  std::vector<std::shared_ptr<NestedBackwardNode>> nodes;
+  for (int i = 0; i < branch_num; ++i) {
+    targets.emplace_back(egr_utils_api::CreateTensorWithValue(
+        phi::make_ddim({4, 16}), paddle::platform::CPUPlace(),
+        phi::DataType::FLOAT32, phi::DataLayout::NCHW, 1.0 /*value*/,
+        false /*is_leaf*/));
+    nodes.emplace_back(std::make_shared<NestedBackwardNode>());
+    ConnectThroughNode(&targets[i], nodes[i], &leaves[i]);
+  }
+  RunBackward(targets, {});
+
+  for (int i = 0; i < branch_num; ++i) {
+    eager_test::CompareGradTensorWithValue<float>(leaves[i], 1.0);
+    eager_test::CompareGradTensorWithValue<float>(nodes[i]->inner_leaf, 3.0);
+  }
+  FLAGS_eager_backward_num_threads = 1;
+}
+
 }  // namespace egr
@@ -0,0 +1,143 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "paddle/fluid/eager/api/all.h"
+#include "paddle/fluid/eager/backward.h"
+#include "paddle/fluid/eager/recompute/recompute_node.h"
+#include "paddle/fluid/eager/recompute/recompute_planner.h"
+#include "paddle/fluid/eager/tests/test_utils.h"
+
+#include "paddle/phi/core/kernel_registry.h"
+
+PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
+
+namespace egr {
+
+namespace {
+
+// out = (x * 2) * 3, counting the runs.
+RecomputeFunction ScaleTwice(int* num_runs) {
+  return [num_runs](const std::vector<paddle::experimental::Tensor>& inputs) {
+    ++*num_runs;
+    bool trace_backward = Controller::Instance().HasGrad();
+    auto hidden = egr::scale(inputs[0], 2.0, 0.0, true, trace_backward);
+    return std::vector<paddle::experimental::Tensor>{
+        egr::scale(hidden, 3.0, 0.0, true, trace_backward)};
+  };
+}
+
+paddle::experimental::Tensor CreateLeaf(float value) {
+  paddle::experimental::Tensor tensor = egr_utils_api::CreateTensorWithValue(
+      phi::make_ddim({4, 16, 16, 32}), paddle::platform::CPUPlace(),
+      phi::DataType::FLOAT32, phi::DataLayout::NCHW, value, true /*is_leaf*/);
+  egr_utils_api::RetainGradForTensor(tensor);
+  return tensor;
+}
+
+}  // namespace
+
+TEST(Recompute, ScaleSegment) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  paddle::experimental::Tensor x = CreateLeaf(5.0);
+
+  int num_runs = 0;
+  auto outs = Recompute(ScaleTwice(&num_runs), {x});
+  ASSERT_EQ(outs.size(), 1UL);
+  eager_test::CompareTensorWithValue<float>(outs[0], 30.0);
+  EXPECT_EQ(num_runs, 1);
+
+  // The segment is run again in the backward.
+  auto y = egr::scale(outs[0], 4.0, 1.0, true, true);
+  RunBackward({y}, {});
+  EXPECT_EQ(num_runs, 2);
+  eager_test::CompareGradTensorWithValue<float>(x, 24.0);
+}
+
+TEST(Recompute, AmpStates) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  paddle::experimental::Tensor x = CreateLeaf(5.0);
+  auto tracer = Controller::Instance().GetCurrentTracer();
+
+  int num_runs = 0;
+  std::vector<paddle::imperative::AmpLevel> amp_levels;
+  std::vector<std::string> amp_dtypes;
+  auto scale_twice = ScaleTwice(&num_runs);
+  auto fn = [&](const std::vector<paddle::experimental::Tensor>& inputs) {
+    amp_levels.push_back(tracer->GetAmpLevel());
+    amp_dtypes.push_back(tracer->GetAmpDtype());
+    return scale_twice(inputs);
+  };
+
+  tracer->SetAmpLevel(paddle::imperative::AmpLevel::O1);
+  tracer->SetAmpDtype("bfloat16");
+  auto outs = Recompute(fn, {x});
+  tracer->SetAmpLevel(paddle::imperative::AmpLevel::O0);
+  tracer->SetAmpDtype("float32");
+
+  // The segment is recomputed under the AMP states of the forward, which
+  // are restored after it.
+  RunBackward(outs, {});
+  EXPECT_EQ(amp_levels, std::vector<paddle::imperative::AmpLevel>(
+                            2, paddle::imperative::AmpLevel::O1));
+  EXPECT_EQ(amp_dtypes, std::vector<std::string>(2, "bfloat16"));
+  EXPECT_EQ(tracer->GetAmpLevel(), paddle::imperative::AmpLevel::O0);
+  EXPECT_EQ(tracer->GetAmpDtype(), "float32");
+  eager_test::CompareGradTensorWithValue<float>(x, 6.0);
+}
+
+TEST(Recompute, PlanRecompute) {
+  std::vector<RecomputeSegmentStat> stats(3);
+  stats[0].activation_bytes = 100;
+  stats[0].forward_ms = 1.0;
+  stats[1].activation_bytes = 300;
+  stats[1].forward_ms = 1.0;
+  stats[2].activation_bytes = 200;
+  stats[2].forward_ms = 4.0;
+
+  EXPECT_EQ(PlanRecompute(stats, 600),
+            std::vector<bool>({false, false, false}));
+  EXPECT_EQ(PlanRecompute(stats, 350), std::vector<bool>({false, true, false}));
+  EXPECT_EQ(PlanRecompute(stats, 200), std::vector<bool>({true, true, false}));
+  EXPECT_EQ(PlanRecompute(stats, 0), std::vector<bool>({true, true, true}));
+}
+
+TEST(Recompute, Planner) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  int num_runs = 0;
+  RecomputePlanner planner(0 /*budget_bytes*/);
+  for (int step = 0; step < 2; ++step) {
+    paddle::experimental::Tensor x = CreateLeaf(1.0);
+    auto outs = planner.Run(ScaleTwice(&num_runs), {x});
+    RunBackward(outs, {});
+    planner.StepEnd();
+    eager_test::CompareGradTensorWithValue<float>(x, 6.0);
+  }
+
+  // The hidden tensor saved by the second scale is the only activation.
+  ASSERT_TRUE(planner.planned());
+  ASSERT_EQ(planner.stats().size(), 1UL);
+  EXPECT_EQ(planner.stats()[0].activation_bytes,
+            4 * 16 * 16 * 32 * static_cast<int64_t>(sizeof(float)));
+  EXPECT_EQ(planner.plan(), std::vector<bool>({true}));
+  // Profiled in the first step, and recomputed in the second.
+  EXPECT_EQ(num_runs, 3);
+}
+
+}  // namespace egr
@@ -0,0 +1,89 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "paddle/fluid/eager/api/all.h"
+#include "paddle/fluid/eager/offload/saved_tensors_offloader.h"
+#include "paddle/fluid/eager/tensor_wrapper.h"
+#include "paddle/fluid/eager/tests/test_utils.h"
+
+#include "paddle/phi/core/kernel_registry.h"
+
+PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
+
+namespace egr {
+
+namespace {
+
+constexpr int64_t kNumel = 4 * 16 * 16 * 32;
+
+paddle::experimental::Tensor CreateTensor(phi::DataType dtype, float value) {
+  return egr_utils_api::CreateTensorWithValue(
+      phi::make_ddim({4, 16, 16, 32}), paddle::platform::CPUPlace(), dtype,
+      phi::DataLayout::NCHW, value, false /*is_leaf*/);
+}
+
+std::shared_ptr<SavedTensorsOffloader> InstallOffloader(
+    SavedTensorsOffloader::Compression compression) {
+  SavedTensorsOffloader::Options options;
+  options.min_bytes = 0;
+  options.compression = compression;
+  auto offloader = std::make_shared<SavedTensorsOffloader>(options);
+  Controller::Instance().SetSavedTensorsHooks(offloader);
+  return offloader;
+}
+
+}  // namespace
+
+TEST(SavedTensorsOffload, Zlib) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  auto offloader = InstallOffloader(SavedTensorsOffloader::Compression::kZlib);
+
+  std::vector<TensorWrapper> wrappers;
+  for (int i = 0; i < 4; ++i) {
+    wrappers.emplace_back(CreateTensor(phi::DataType::FLOAT32, i));
+  }
+  Controller::Instance().SetSavedTensorsHooks(nullptr);
+
+  EXPECT_EQ(offloader->offloaded_bytes(), 4 * kNumel * 4);
+  EXPECT_LT(offloader->host_bytes(), offloader->offloaded_bytes());
+  // In the reverse order, as the backward does, so that the others are
+  // prefetched.
+  for (int i = 3; i >= 0; --i) {
+    auto tensor = wrappers[i].recover(nullptr);
+    eager_test::CompareTensorWithValue<float>(tensor, i);
+  }
+}
+
+TEST(SavedTensorsOffload, FP16) {
+  eager_test::InitEnv(paddle::platform::CPUPlace());
+  auto offloader = InstallOffloader(SavedTensorsOffloader::Compression::kFP16);
+
+  TensorWrapper wrapper(CreateTensor(phi::DataType::FLOAT32, 0.5));
+  // Only the FP32 tensors are kept in FP16.
+  TensorWrapper kept(CreateTensor(phi::DataType::FLOAT64, 0.5));
+  Controller::Instance().SetSavedTensorsHooks(nullptr);
+
+  EXPECT_EQ(offloader->offloaded_bytes(), kNumel * 4);
+  EXPECT_EQ(offloader->host_bytes(), kNumel * 2);
+  eager_test::CompareTensorWithValue<float>(wrapper.recover(nullptr), 0.5);
+  eager_test::CompareTensorWithValue<double>(kept.recover(nullptr), 0.5);
+}
+
+}  // namespace egr
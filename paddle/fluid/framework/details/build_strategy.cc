@@ -18,6 +18,7 @@ limitations under the License. */
 #include <glog/logging.h>
 #include "paddle/fluid/framework/details/reduce_op_handle.h"
 #include "paddle/fluid/framework/ir/graph_printer.h"
+#include "paddle/fluid/framework/ir/op_cost_table.h"
 #include "paddle/fluid/framework/ir/multi_devices_graph_pass/multi_devices_graph_pass.h"
 
 DECLARE_bool(convert_all_blocks);
@@ -172,8 +173,7 @@ class ParallelExecutorPassBuilder : public ir::PassBuilder {
                         "fuse_relu_depthwise_conv_pass");
     AppendPassWithCheck(strategy_.fuse_bn_act_ops_, "fuse_bn_act_pass");
     AppendPassWithCheck(strategy_.fuse_bn_add_act_ops_, "fuse_bn_add_act_pass");
-#if (defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)) && \
-    !defined(_WIN32) && !defined(__APPLE__)
+#if !defined(_WIN32) && !defined(__APPLE__)
     AppendPassWithCheck(strategy_.enable_auto_fusion_, "fusion_group_pass");
 #endif
 
@@ -342,6 +342,12 @@ ir::Graph *BuildStrategy::Apply(ir::Graph *graph,
   // Create a default one if not finalized by user.
   CreatePassesFromStrategy(false);
 
+  if (!cost_data_path_.empty() && !graph->Has(ir::kOpCostTable)) {
+    std::unique_ptr<ir::OpCostTable> cost_table(new ir::OpCostTable());
+    cost_table->Load(cost_data_path_);
+    graph->Set(ir::kOpCostTable, cost_table.release());
+  }
+
   for (std::shared_ptr<ir::Pass> &pass : pass_builder_->AllPasses()) {
     VLOG(1) << "BuildStrategy::Apply pass:" << pass->Type();
     if (IsMultiDevPass(pass->Type())) {
@@ -432,8 +438,9 @@ ir::Graph *BuildStrategy::Apply(ir::Graph *graph,
       }
     } else if (pass->Type() == "fusion_group_pass") {
       pass->Set<bool>("use_gpu", new bool((use_device == p::kCUDA)));
-      if (use_device != p::kCUDA) {
-        VLOG(1) << "fusion_group_pass is only supported on GPU, skipped.";
+      if (use_device != p::kCUDA && use_device != p::kCPU) {
+        VLOG(1) << "fusion_group_pass is only supported on GPU and CPU, "
+                   "skipped.";
         continue;
       }
     } else if (pass->Type() == "fuse_bn_act_pass") {
@@ -509,8 +516,7 @@ USE_PASS(build_cinn_pass);
 #ifdef PADDLE_WITH_MKLDNN
 USE_PASS(mkldnn_placement_pass);
 #endif
-#if (defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)) && \
-    !defined(_WIN32) && !defined(__APPLE__)
+#if !defined(_WIN32) && !defined(__APPLE__)
 USE_PASS(fusion_group_pass);
 #endif
 #if (defined(PADDLE_WITH_CUDA) && CUDA_VERSION >= 11060)
@@ -88,6 +88,11 @@ struct BuildStrategy {
 
   std::string debug_graphviz_path_{""};
 
+  // Path of the op costs saved from CostData::GetOpCostTable(). If set, the
+  // costs are attached to the graph so that passes such as the placement
+  // passes and fusion_group_pass make decisions by the measured costs.
+  std::string cost_data_path_{""};
+
   // Add dependency between backward ops and optimization ops, make sure that
   // all the backward ops are finished before running the optimization ops.
   // It might make the training speed of data parallelism faster.
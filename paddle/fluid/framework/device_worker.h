@@ -65,6 +65,36 @@ class FleetWrapper;
 class HeterWrapper;
 #endif
 
+// The buffers of the dense params of a table for the double buffered dense
+// pull. The pull thread writes a buffer that no scope shares and publishes
+// it once written, and trainer threads share the published tensors into
+// their own scopes between batches, so that a batch never sees a buffer
+// being written.
+class DenseParamBuffer {
+ public:
+  DenseParamBuffer(const std::vector<std::string>& names, int thread_num)
+      : names_(names), thread_versions_(thread_num, 0) {}
+
+  // Returns a buffer that no scope shares, or a new one shaped as the vars
+  // of root_scope. The published buffer is never returned.
+  Scope* GetFree(const Scope& root_scope);
+  // Publishes a fully written buffer, and points root_scope at it for save
+  // and dump.
+  void Publish(Scope* buffer, Scope* root_scope);
+  // Points the vars of thread_scope at the latest published buffer if it is
+  // newer than the one the thread reads. It never waits for a pull.
+  void Swap(int thread_id, Scope* thread_scope);
+  size_t BufferNum();
+
+ private:
+  std::vector<std::string> names_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Scope>> buffers_;
+  Scope* latest_ = nullptr;
+  std::atomic<uint64_t> version_{0};
+  std::vector<uint64_t> thread_versions_;
+};
+
 class PullDenseWorker {
  public:
   virtual ~PullDenseWorker() {}
@@ -92,6 +122,11 @@ class PullDenseWorker {
   void MergeDenseParam();
   int GetThreadIdByScope(const Scope* scope);
   void SetThreadIdByScope(const Scope* scope, int tid);
+  // In double buffer mode, point the dense vars of thread_scope at the
+  // latest pulled buffer. Called by trainer threads at batch boundaries;
+  // it never waits for an in-flight pull.
+  void SwapDenseBuffer(int thread_id, Scope* thread_scope);
+  bool DoubleBuffer() const { return double_buffer_; }
   static std::shared_ptr<PullDenseWorker> GetInstance() {
     if (NULL == s_instance_) {
       s_instance_.reset(new paddle::framework::PullDenseWorker());
@@ -105,6 +140,7 @@ class PullDenseWorker {
   PullDenseWorker() : root_scope_(NULL) {}
   void Run();
   bool CheckUpdateParam(uint64_t table_id);
+  void PullDenseToBuffer(bool force_update);
 
  private:
   std::shared_ptr<paddle::framework::FleetWrapper> fleet_ptr_;
@@ -139,6 +175,13 @@ class PullDenseWorker {
 #endif
   std::vector<paddle::platform::Place> places_;
   std::vector<Scope*> thread_scopes_;
+
+  // Double buffer mode: every pull lands in a buffer scope that no trainer
+  // thread is reading, and is published once the pull succeeds. Trainer
+  // threads share the published tensors into their own scope between
+  // batches, so neither the copy nor the wait is on their critical path.
+  bool double_buffer_ = false;
+  std::map<uint64_t, std::unique_ptr<DenseParamBuffer>> dense_buffers_;
 };
 
 // should incorporate different type of device
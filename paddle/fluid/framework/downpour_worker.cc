@@ -485,6 +485,8 @@ void DownpourWorker::TrainFilesWithProfiler() {
     timeline.Pause();
     read_time += timeline.ElapsedSec();
     total_time += timeline.ElapsedSec();
+    // switch to the latest pulled dense params between batches
+    pull_dense_worker_->SwapDenseBuffer(thread_id_, thread_scope_);
 
     timeline.Start();
     if (copy_table_config_.need_copy()) {
@@ -764,6 +766,8 @@ void DownpourWorker::TrainFiles() {
   int batch_cnt = 0;
   int cur_batch;
   while ((cur_batch = device_reader_->Next()) > 0) {
+    // switch to the latest pulled dense params between batches
+    pull_dense_worker_->SwapDenseBuffer(thread_id_, thread_scope_);
     if (copy_table_config_.need_copy()) {
       if (batch_cnt % copy_table_config_.batch_num() == 0) {
         CopySparseTable();
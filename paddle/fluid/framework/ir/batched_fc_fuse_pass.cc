@@ -0,0 +1,228 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/batched_fc_fuse_pass.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/op_version_registry.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+namespace {
+
+// An fc, or a mul taken as an fc without bias.
+struct FCMember {
+  Node* op{nullptr};
+  Node* x{nullptr};
+  Node* w{nullptr};
+  Node* bias{nullptr};
+  Node* out{nullptr};
+  int in_num_col_dims{1};
+  std::string activation_type;
+};
+
+Node* GetVarNode(Node* op, const std::string& name) {
+  for (auto* var : op->inputs) {
+    if (var->IsVar() && var->Name() == name) {
+      return var;
+    }
+  }
+  for (auto* var : op->outputs) {
+    if (var->IsVar() && var->Name() == name) {
+      return var;
+    }
+  }
+  return nullptr;
+}
+
+Node* GetSingleVarNode(Node* op, const VariableNameMap& params,
+                       const std::string& param) {
+  auto iter = params.find(param);
+  if (iter == params.end() || iter->second.size() != 1) {
+    return nullptr;
+  }
+  return GetVarNode(op, iter->second[0]);
+}
+
+bool ToFCMember(Node* op, FCMember* member) {
+  auto* op_desc = op->Op();
+  if (op_desc->GetAttrIfExists<bool>("use_mkldnn") ||
+      op_desc->HasAttr("enable_int8")) {
+    return false;
+  }
+  member->op = op;
+  if (op_desc->Type() == "fc") {
+    if (op_desc->GetAttrIfExists<bool>("padding_weights")) {
+      return false;
+    }
+    auto packed_w = op_desc->Inputs().find("PackedW");
+    if (packed_w != op_desc->Inputs().end() && !packed_w->second.empty()) {
+      return false;
+    }
+    member->x = GetSingleVarNode(op, op_desc->Inputs(), "Input");
+    member->w = GetSingleVarNode(op, op_desc->Inputs(), "W");
+    member->bias = GetSingleVarNode(op, op_desc->Inputs(), "Bias");
+    member->in_num_col_dims = op_desc->GetAttrIfExists<int>("in_num_col_dims");
+    member->activation_type =
+        op_desc->GetAttrIfExists<std::string>("activation_type");
+    if (member->activation_type != "" && member->activation_type != "relu") {
+      return false;
+    }
+  } else if (op_desc->Type() == "mul") {
+    if (op_desc->GetAttrIfExists<int>("y_num_col_dims") != 1) {
+      return false;
+    }
+    member->x = GetSingleVarNode(op, op_desc->Inputs(), "X");
+    member->w = GetSingleVarNode(op, op_desc->Inputs(), "Y");
+    member->in_num_col_dims = op_desc->GetAttrIfExists<int>("x_num_col_dims");
+  } else {
+    return false;
+  }
+  member->out = GetSingleVarNode(op, op_desc->Outputs(), "Out");
+  if (member->x == nullptr || member->w == nullptr || member->out == nullptr ||
+      member->in_num_col_dims < 1 || member->x->Var() == nullptr ||
+      member->w->Var() == nullptr) {
+    return false;
+  }
+  auto w_shape = member->w->Var()->GetShape();
+  auto dtype = member->w->Var()->GetDataType();
+  return w_shape.size() == 2 && w_shape[0] > 0 && w_shape[1] > 0 &&
+         (dtype == proto::VarType::FP32 || dtype == proto::VarType::FP64);
+}
+
+// The ops with the same key can be computed by one batched GEMM.
+std::string BatchKey(const FCMember& member, int level) {
+  std::ostringstream key;
+  auto w_shape = member.w->Var()->GetShape();
+  key << level << ";" << w_shape[0] << "x" << w_shape[1] << ";"
+      << member.w->Var()->GetDataType() << ";" << member.in_num_col_dims << ";"
+      << member.activation_type << ";" << (member.bias != nullptr);
+  return key.str();
+}
+
+void LinkToOnce(Node* var, Node* op, std::unordered_set<Node*>* linked) {
+  if (linked->insert(var).second) {
+    IR_NODE_LINK_TO(var, op);
+  }
+}
+
+}  // namespace
+
+std::unordered_map<Node*, int> BatchedFCFusePass::OpLevels(
+    const Graph& graph) const {
+  std::unordered_map<Node*, int> levels;
+  for (auto* op : TopologySortOperations(graph)) {
+    int level = 0;
+    for (auto* in : op->inputs) {
+      for (auto* pred : in->inputs) {
+        auto iter = levels.find(pred);
+        if (iter != levels.end()) {
+          level = std::max(level, iter->second + 1);
+        }
+      }
+    }
+    levels[op] = level;
+  }
+  return levels;
+}
+
+void BatchedFCFusePass::ApplyImpl(Graph* graph) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      graph, platform::errors::PreconditionNotMet("graph should not be null."));
+  FusePassBase::Init("batched_fc_fuse", graph);
+
+  auto levels = OpLevels(*graph);
+  // The members are kept in the topological order, so that the fused ops
+  // do not depend on the order of the nodes in the graph.
+  std::map<std::string, std::vector<FCMember>> batches;
+  for (auto* op : TopologySortOperations(*graph)) {
+    if (op->Op() == nullptr) continue;
+    FCMember member;
+    if (ToFCMember(op, &member)) {
+      batches[BatchKey(member, levels.at(op))].push_back(member);
+    }
+  }
+
+  int fused_count = 0;
+  for (auto& batch : batches) {
+    auto& members = batch.second;
+    if (members.size() < 2) {
+      continue;
+    }
+    std::vector<std::string> x_names, w_names, bias_names, out_names;
+    for (auto& member : members) {
+      x_names.push_back(member.x->Name());
+      w_names.push_back(member.w->Name());
+      if (member.bias != nullptr) {
+        bias_names.push_back(member.bias->Name());
+      }
+      out_names.push_back(member.out->Name());
+    }
+    OpDesc desc(members[0].op->Op()->Block());
+    desc.SetType("fusion_batched_fc");
+    desc.SetInput("X", x_names);
+    desc.SetInput("W", w_names);
+    desc.SetInput("Bias", bias_names);
+    desc.SetOutput("Out", out_names);
+    desc.SetAttr("in_num_col_dims", members[0].in_num_col_dims);
+    desc.SetAttr("activation_type", members[0].activation_type);
+    desc.Flush();
+    auto* fused_op = graph->CreateOpNode(&desc);
+
+    std::unordered_set<const Node*> nodes_to_remove;
+    std::unordered_set<Node*> linked_vars;
+    for (auto& member : members) {
+      nodes_to_remove.insert(member.op);
+      LinkToOnce(member.x, fused_op, &linked_vars);
+      LinkToOnce(member.w, fused_op, &linked_vars);
+      if (member.bias != nullptr) {
+        LinkToOnce(member.bias, fused_op, &linked_vars);
+      }
+      IR_NODE_LINK_TO(fused_op, member.out);
+    }
+    // The control dependencies of the fused ops are kept as well.
+    for (auto& member : members) {
+      for (auto* in : member.op->inputs) {
+        if (in->IsCtrlVar()) LinkToOnce(in, fused_op, &linked_vars);
+      }
+      for (auto* out : member.op->outputs) {
+        if (out->IsCtrlVar()) IR_NODE_LINK_TO(fused_op, out);
+      }
+    }
+    GraphSafeRemoveNodes(graph, nodes_to_remove);
+    VLOG(4) << "Batch " << members.size() << " fc ops of " << batch.first;
+    ++fused_count;
+  }
+  AddStatis(fused_count);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(batched_fc_fuse_pass, paddle::framework::ir::BatchedFCFusePass);
+REGISTER_PASS_CAPABILITY(batched_fc_fuse_pass)
+    .AddCombination(
+        paddle::framework::compatible::OpVersionComparatorCombination()
+            .EQ("mul", 0)
+            .EQ("fc", 0));
@@ -0,0 +1,58 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "paddle/fluid/framework/ir/fuse_pass_base.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+class Graph;
+class Node;
+
+/*
+ * Fuses the independent fc and mul ops with weights in the same shape into
+ * one fusion_batched_fc op, whose CPU kernel runs their small GEMMs as one
+ * batched GEMM, e.g. the towers or heads of recommendation models. The ops
+ * may share the input or not.
+ *
+ * Two ops are independent when neither of them depends on the other. It
+ * holds for the ops of the same level, the length of the longest path from
+ * the graph inputs to the op, so only the ops of the same level with the
+ * same weight shape, data type, activation, in_num_col_dims and presence of
+ * bias are batched.
+ *
+ * It is not in the default passes of CPU, turn it on with
+ * AnalysisConfig::SwitchBatchedFCFuse.
+ */
+class BatchedFCFusePass : public FusePassBase {
+ public:
+  virtual ~BatchedFCFusePass() {}
+
+ protected:
+  void ApplyImpl(Graph* graph) const override;
+
+ private:
+  // The level of every op node in graph.
+  std::unordered_map<Node*, int> OpLevels(const Graph& graph) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+TEST(BatchedFCFusePass, basic) {
+  // inputs                     operator            output
+  // --------------------------------------------------------
+  // (x_0, w_0, bias_0)         fc               -> fc_out_0
+  // (x_1, w_1, bias_1)         fc               -> fc_out_1
+  // (x_1, w_2, bias_2)         fc               -> fc_out_2
+  // (fc_out_0, w_3, bias_3)    fc               -> fc_out_3
+  // (x_0, w_4)                 mul              -> mul_out_0
+  // (x_1, w_5)                 mul              -> mul_out_1
+  // (x_0, w_6, bias_6)         fc               -> fc_out_6
+  Layers layers;
+  auto* x_0 = layers.data("x_0", {-1, 16});
+  auto* x_1 = layers.data("x_1", {-1, 16});
+  std::vector<VarDesc*> w;
+  std::vector<VarDesc*> bias;
+  for (int i = 0; i < 7; ++i) {
+    int64_t k = i == 3 ? 8 : 16;
+    int64_t n = i == 6 ? 4 : 8;
+    w.push_back(layers.data("w_" + std::to_string(i), {k, n}, true));
+    bias.push_back(layers.data("bias_" + std::to_string(i), {n}, true));
+  }
+  auto* fc_out_0 = layers.fc(x_0, w[0], bias[0]);
+  layers.fc(x_1, w[1], bias[1]);
+  layers.fc(x_1, w[2], bias[2]);
+  layers.fc(fc_out_0, w[3], bias[3]);
+  layers.mul(x_0, w[4]);
+  layers.mul(x_1, w[5]);
+  layers.fc(x_0, w[6], bias[6]);
+
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+  auto pass = PassRegistry::Instance().Get("batched_fc_fuse_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // The first three fc ops and the two mul ops are batched. The fc on
+  // fc_out_0 depends on the first fc and the last fc has another weight
+  // shape.
+  ASSERT_EQ(GetNumOpNodes(graph, "fusion_batched_fc"), 2);
+  ASSERT_EQ(GetNumOpNodes(graph, "fc"), 2);
+  ASSERT_EQ(GetNumOpNodes(graph, "mul"), 0);
+  for (auto* node : graph->Nodes()) {
+    if (!node->IsOp() || node->Op()->Type() != "fusion_batched_fc") {
+      continue;
+    }
+    auto* op = node->Op();
+    if (op->Input("Bias").empty()) {
+      ASSERT_EQ(op->Input("W"), std::vector<std::string>({"w_4", "w_5"}));
+      ASSERT_EQ(op->Output("Out").size(), 2UL);
+    } else {
+      ASSERT_EQ(op->Input("W"),
+                std::vector<std::string>({"w_0", "w_1", "w_2"}));
+      ASSERT_EQ(op->Input("X"),
+                std::vector<std::string>({"x_0", "x_1", "x_1"}));
+      ASSERT_EQ(op->Output("Out")[0], fc_out_0->Name());
+    }
+  }
+  // The shared inputs are linked to the fused op once.
+  for (auto* node : graph->Nodes()) {
+    if (node->IsVar() && node->Name() == "x_1") {
+      ASSERT_EQ(node->outputs.size(), 2UL);
+    }
+  }
+  // The fused graph is still acyclic.
+  ASSERT_EQ(TopologySortOperations(*graph).size(), 4UL);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(batched_fc_fuse_pass);
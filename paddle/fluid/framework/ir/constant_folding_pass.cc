@@ -0,0 +1,174 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/constant_folding_pass.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/op_registry.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+// The ops which have side effects or random outputs, so that running them
+// once at analysis time is not the same as running them every time.
+static const std::unordered_set<std::string> &UnfoldableOps() {
+  static const std::unordered_set<std::string> ops = {
+      "feed",
+      "fetch",
+      "save",
+      "save_combine",
+      "load",
+      "load_combine",
+      "print",
+      "dropout",
+      "uniform_random",
+      "gaussian_random",
+      "truncated_gaussian_random",
+      "randint",
+      "randperm",
+      "bernoulli",
+      "sampling_id"};
+  return ops;
+}
+
+static bool IsInitializedTensor(Scope *scope, const std::string &name) {
+  auto *var = scope->FindVar(name);
+  return var != nullptr && var->IsType<LoDTensor>() &&
+         var->Get<LoDTensor>().IsInitialized();
+}
+
+bool ConstantFoldingPass::IsFoldable(Node *op, Scope *scope) const {
+  auto *op_desc = op->Op();
+  if (op_desc == nullptr || op->inputs.empty() ||
+      UnfoldableOps().count(op_desc->Type())) {
+    return false;
+  }
+  // The quantization ops on weights carry the scales which the quantization
+  // passes collect later.
+  if (op_desc->Type().find("fake_") == 0) {
+    return false;
+  }
+  for (auto &attr : op_desc->GetAttrMap()) {
+    auto type = op_desc->GetAttrType(attr.first);
+    if (type == proto::AttrType::BLOCK || type == proto::AttrType::BLOCKS) {
+      return false;
+    }
+  }
+  for (auto *in : op->inputs) {
+    if (!in->IsVar() || in->Var() == nullptr || !in->Var()->Persistable() ||
+        !IsInitializedTensor(scope, in->Name())) {
+      return false;
+    }
+  }
+  for (auto *out : op->outputs) {
+    // The outputs written by other ops too can not be taken as constants.
+    if (!out->IsVar() || out->Var() == nullptr || out->inputs.size() != 1 ||
+        out->Var()->Persistable() ||
+        out->Var()->GetType() != proto::VarType::LOD_TENSOR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ConstantFoldingPass::Fold(Node *op, Scope *scope) const {
+  OpDesc op_desc(*op->Op(), op->Op()->Block());
+  // The folded tensors may be read by kernels of any library later, so they
+  // should be in the plain layout.
+  if (op_desc.HasAttr("use_mkldnn")) {
+    op_desc.SetAttr("use_mkldnn", false);
+  }
+  std::vector<std::string> out_names;
+  for (auto *out : op->outputs) {
+    out_names.push_back(out->Name());
+    scope->Var(out->Name())->GetMutable<LoDTensor>();
+  }
+  try {
+    auto run_op = OpRegistry::CreateOp(op_desc);
+    run_op->Run(*scope, platform::CPUPlace());
+  } catch (std::exception &e) {
+    VLOG(3) << "Can not fold " << op_desc.Type() << ": " << e.what();
+    scope->EraseVars(out_names);
+    return false;
+  }
+  for (auto *out : op->outputs) {
+    if (!out->outputs.empty() && !IsInitializedTensor(scope, out->Name())) {
+      VLOG(3) << "Can not fold " << op_desc.Type() << ", its output "
+              << out->Name() << " is not computed.";
+      scope->EraseVars(out_names);
+      return false;
+    }
+  }
+  return true;
+}
+
+void ConstantFoldingPass::ApplyImpl(Graph *graph) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      graph, platform::errors::PreconditionNotMet("graph should not be null."));
+  FusePassBase::Init("constant_folding", graph);
+  auto *scope = param_scope();
+  PADDLE_ENFORCE_NOT_NULL(
+      scope, platform::errors::PreconditionNotMet(
+                 "The param scope of constant_folding_pass should be set."));
+  // The ops of sub blocks are not in the graph, the inputs of the folded ops
+  // may be still read by them.
+  bool keep_inputs = graph->OriginProgram().Size() > 1;
+
+  int folded_count = 0;
+  for (auto *op : TopologySortOperations(*graph)) {
+    if (!IsFoldable(op, scope) || !Fold(op, scope)) {
+      continue;
+    }
+    VLOG(4) << "Fold " << op->Op()->Type() << " at analysis time.";
+    std::unordered_set<const Node *> nodes_to_remove = {op};
+    std::vector<std::string> vars_to_erase;
+    for (auto *out : op->outputs) {
+      if (out->outputs.empty()) {
+        // The outputs like XShape of reshape2 are not read by any op.
+        nodes_to_remove.insert(out);
+        vars_to_erase.push_back(out->Name());
+        continue;
+      }
+      auto &tensor = scope->FindVar(out->Name())->Get<LoDTensor>();
+      out->Var()->SetPersistable(true);
+      out->Var()->SetShape(phi::vectorize(tensor.dims()));
+      out->Var()->SetDataType(framework::TransToProtoVarType(tensor.dtype()));
+    }
+    for (auto *in : op->inputs) {
+      if (in->outputs.size() == 1 && !keep_inputs &&
+          !nodes_to_remove.count(in)) {
+        nodes_to_remove.insert(in);
+        vars_to_erase.push_back(in->Name());
+      }
+    }
+    GraphSafeRemoveNodes(graph, nodes_to_remove);
+    scope->EraseVars(vars_to_erase);
+    ++folded_count;
+  }
+  AddStatis(folded_count);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(constant_folding_pass,
+              paddle::framework::ir::ConstantFoldingPass);
@@ -0,0 +1,51 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "paddle/fluid/framework/ir/fuse_pass_base.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+class Graph;
+class Node;
+
+/*
+ * Evaluates the ops whose inputs are all persistable, such as transpose2,
+ * reshape2, scale or cast applied to weights, once at analysis time with
+ * their CPU kernels. The outputs of such an op become persistable tensors
+ * in the param scope and the op is removed from the graph. Since the ops
+ * are visited in topological order, a chain of such ops is folded as a
+ * whole.
+ *
+ * The inputs which are not read by any op anymore are removed as well,
+ * unless the program has sub blocks which may still read them.
+ */
+class ConstantFoldingPass : public FusePassBase {
+ public:
+  virtual ~ConstantFoldingPass() {}
+
+ protected:
+  void ApplyImpl(Graph* graph) const override;
+
+ private:
+  bool IsFoldable(Node* op, Scope* scope) const;
+  bool Fold(Node* op, Scope* scope) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
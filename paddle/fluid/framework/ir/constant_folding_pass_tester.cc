@@ -0,0 +1,121 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
+#include "paddle/fluid/framework/op_registry.h"
+
+USE_OP_ITSELF(scale);
+PD_DECLARE_KERNEL(scale, CPU, ALL_LAYOUT);
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+static void AddVarToScope(Scope* param_scope, const std::string& name,
+                          const DDim& dims, float value) {
+  auto* tensor = param_scope->Var(name)->GetMutable<LoDTensor>();
+  tensor->Resize(dims);
+  auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = value;
+  }
+}
+
+static Node* GetVarNode(const Graph& graph, const std::string& name) {
+  for (auto* node : graph.Nodes()) {
+    if (node->IsVar() && node->Name() == name) {
+      return node;
+    }
+  }
+  return nullptr;
+}
+
+TEST(ConstantFoldingPass, fold_chain_of_weights) {
+  // inputs                     operator            output
+  // --------------------------------------------------------
+  // w                          scale(x2)        -> w_1
+  // w_1                        scale(+1)        -> w_2
+  // (x, w_2)                   mul              -> mul_out
+  // mul_out                    scale(x2)        -> out
+  Layers layers;
+  auto* x = layers.data("x", {4, 2});
+  auto* w = layers.data("w", {2, 3}, true);
+  auto* w_1 = layers.scale(w, 2.f, 0.f, true);
+  auto* w_2 = layers.scale(w_1, 1.f, 1.f, true);
+  auto* mul_out = layers.mul(x, w_2);
+  layers.scale(mul_out, 2.f, 0.f, true);
+
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "w", {2, 3}, 1.f);
+  graph->Set(kParamScopeAttr, scope);
+  ASSERT_EQ(GetNumOpNodes(graph, "scale"), 3);
+
+  auto pass = PassRegistry::Instance().Get("constant_folding_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // Only the scale on the output of mul is kept.
+  ASSERT_EQ(GetNumOpNodes(graph, "scale"), 1);
+  ASSERT_EQ(GetNumOpNodes(graph, "mul"), 1);
+  ASSERT_EQ(GetVarNode(*graph, "w"), nullptr);
+  ASSERT_EQ(GetVarNode(*graph, w_1->Name()), nullptr);
+  ASSERT_EQ(scope->FindVar("w"), nullptr);
+  ASSERT_EQ(scope->FindVar(w_1->Name()), nullptr);
+
+  auto* w_2_node = GetVarNode(*graph, w_2->Name());
+  ASSERT_NE(w_2_node, nullptr);
+  ASSERT_TRUE(w_2_node->Var()->Persistable());
+  ASSERT_EQ(w_2_node->Var()->GetShape(), std::vector<int64_t>({2, 3}));
+  auto& w_2_tensor = scope->FindVar(w_2->Name())->Get<LoDTensor>();
+  ASSERT_EQ(w_2_tensor.numel(), 6);
+  for (int64_t i = 0; i < w_2_tensor.numel(); ++i) {
+    ASSERT_FLOAT_EQ(w_2_tensor.data<float>()[i], 3.f);
+  }
+}
+
+TEST(ConstantFoldingPass, keep_shared_weight) {
+  // inputs                     operator            output
+  // --------------------------------------------------------
+  // w                          scale(x2)        -> w_1
+  // (x, w_1)                   mul              -> mul_out_0
+  // (x, w)                     mul              -> mul_out_1
+  Layers layers;
+  auto* x = layers.data("x", {4, 2});
+  auto* w = layers.data("w", {2, 3}, true);
+  auto* w_1 = layers.scale(w, 2.f, 0.f, true);
+  layers.mul(x, w_1);
+  layers.mul(x, w);
+
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "w", {2, 3}, 1.f);
+  graph->Set(kParamScopeAttr, scope);
+
+  auto pass = PassRegistry::Instance().Get("constant_folding_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  ASSERT_EQ(GetNumOpNodes(graph, "scale"), 0);
+  // w is still read by the second mul.
+  ASSERT_NE(GetVarNode(*graph, "w"), nullptr);
+  ASSERT_NE(scope->FindVar("w"), nullptr);
+  ASSERT_TRUE(GetVarNode(*graph, w_1->Name())->Var()->Persistable());
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(constant_folding_pass);
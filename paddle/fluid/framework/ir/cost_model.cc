@@ -43,6 +43,9 @@ double CostData::GetWholeMemoryBytes() const { return whole_memory_bytes_; }
 
 const Graph* CostData::GetGraph() const { return graph_; }
 const ProgramDesc* CostData::GetProgram() const { return program_; }
+const ir::OpCostTable& CostData::GetOpCostTable() const {
+  return op_cost_table_;
+}
 
 bool CostData::SetCostData(const ProgramDesc& program,
                            const std::vector<std::vector<Event>>& time_events) {
@@ -120,6 +123,7 @@ bool CostData::SetCostData(const ProgramDesc& program,
 #endif
     double time_ms = gpu_time_ms + cpu_time_ms;
     op_time_ms_[i] = time_ms;
+    op_cost_table_.SetOpTimeMs(ir::OpCostTable::Key(*op_desc), time_ms);
   }
 
   event_index = 0;
@@ -143,6 +147,7 @@ bool CostData::SetCostData(const ProgramDesc& program,
         main_thread_events[stop_profiler_idx]);
 #endif
     whole_time_ms_ = gpu_time_ms + cpu_time_ms;
+    op_cost_table_.SetWholeTimeMs(whole_time_ms_);
   } else {
     LOG(WARNING) << "Input time_events for whole time have wrong format";
     event_to_cost_success = false;
@@ -24,6 +24,7 @@
 
 #include "paddle/fluid/framework/ir/graph.h"
 #include "paddle/fluid/framework/ir/node.h"
+#include "paddle/fluid/framework/ir/op_cost_table.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/platform/profiler.h"
 #include "paddle/fluid/platform/profiler/event_tracing.h"
@@ -48,6 +49,10 @@ class CostData {
   const ir::Graph* GetGraph() const;
   const ProgramDesc* GetProgram() const;
 
+  // The measured op times keyed by ir::OpCostTable::Key, which can be saved
+  // and attached to a graph for passes.
+  const ir::OpCostTable& GetOpCostTable() const;
+
   // Support Time Event only
   // TODO(zhhsplendid): add memory
   bool SetCostData(
@@ -69,6 +74,7 @@ class CostData {
       NOT_MEASURED};  // memory cost of the whole program or graph
   double whole_comm_{
       NOT_MEASURED};  // communication cost of the whole program or graph
+  ir::OpCostTable op_cost_table_;
 };
 
 class CostModel {
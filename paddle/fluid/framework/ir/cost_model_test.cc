@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include "paddle/fluid/framework/ir/cost_model.h"
+#include <cstdio>
+#include <fstream>
 #include "gtest/gtest.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/operator.h"
@@ -131,6 +133,32 @@ TEST(CostModelTest, TestProfileMeasure_Program) {
   EXPECT_GT(cost_data.GetWholeTimeMs(), op0_time_ms + op1_time_ms);
 }
 
+TEST(CostModelTest, TestProfileMeasure_OpCostTable) {
+  CostModel cost_model;
+  ProgramDesc program = CreateTestProgram();
+  ProgramDesc empty_program;
+  CostData cost_data =
+      cost_model.ProfileMeasure(program, empty_program, "cpu", {"time"});
+  const ir::OpCostTable &cost_table = cost_data.GetOpCostTable();
+  EXPECT_EQ(cost_table.size(), 2UL);
+  const BlockDesc &global_block = program.Block(0);
+  EXPECT_EQ(cost_table.GetOpTimeMs(*global_block.Op(0)),
+            cost_data.GetOpTimeMs(0));
+  EXPECT_EQ(cost_table.GetOpTimeMs(*global_block.Op(1)),
+            cost_data.GetOpTimeMs(1));
+  EXPECT_EQ(cost_table.GetWholeTimeMs(), cost_data.GetWholeTimeMs());
+
+  std::string path = "./cost_model_test_op_costs.txt";
+  EXPECT_TRUE(cost_table.Save(path));
+  ir::OpCostTable loaded;
+  loaded.Load(path);
+  EXPECT_EQ(loaded.size(), 2UL);
+  EXPECT_EQ(loaded.GetOpTimeMs(*global_block.Op(0)),
+            cost_data.GetOpTimeMs(0));
+  EXPECT_EQ(loaded.GetWholeTimeMs(), cost_data.GetWholeTimeMs());
+  std::remove(path.c_str());
+}
+
 TEST(CostModelTest, TestProfileMeasure_UnsupportedDevice) {
   CostModel cost_model;
   ProgramDesc program = CreateTestProgram();
@@ -205,5 +233,62 @@ TEST(CostDataTest, TestNoWholeEvent) {
   EXPECT_EQ(cost_data.SetCostData(program, time_events), false);
 }
 
+TEST(OpCostTableTest, TestKeyAndMerge) {
+  OpDesc op;
+  op.SetType("conv2d");
+  op.SetOutput("Output", {"y"});
+  op.SetAttr("use_mkldnn", true);
+  EXPECT_EQ(ir::OpCostTable::Key(op), "conv2d(Output=y)@mkldnn");
+  EXPECT_EQ(ir::OpCostTable::Key(op, ""), "conv2d(Output=y)");
+
+  ir::OpCostTable native;
+  native.SetOpTimeMs(ir::OpCostTable::Key(op, ""), 2.0);
+  ir::OpCostTable mkldnn;
+  mkldnn.SetOpTimeMs(ir::OpCostTable::Key(op), 1.0);
+  mkldnn.SetWholeTimeMs(10.0);
+  native.Merge(mkldnn);
+  EXPECT_EQ(native.size(), 2UL);
+  EXPECT_EQ(native.GetOpTimeMs(op), 1.0);
+  EXPECT_EQ(native.GetOpTimeMs(ir::OpCostTable::Key(op, "")), 2.0);
+  EXPECT_EQ(native.GetOpTimeMs("not exist"), ir::OpCostTable::NOT_MEASURED);
+  EXPECT_EQ(native.GetWholeTimeMs(), 10.0);
+}
+
+TEST(OpCostTableTest, TestLoadInvalidCost) {
+  std::string path = "./cost_model_test_invalid_op_costs.txt";
+  {
+    std::ofstream fout(path);
+    fout << "__whole_time_ms__\t10\n";
+    fout << "conv2d(Output=y)\tfast\n";
+  }
+  ir::OpCostTable table;
+  try {
+    table.Load(path);
+    FAIL() << "Loading an invalid op cost should throw.";
+  } catch (paddle::platform::EnforceNotMet &err) {
+    std::string err_msg = err.what();
+    EXPECT_NE(err_msg.find(path + ":2"), std::string::npos);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(OpCostTableTest, TestLoadInvalidLine) {
+  std::string path = "./cost_model_test_invalid_op_lines.txt";
+  {
+    std::ofstream fout(path);
+    fout << "__whole_time_ms__\t10\n\n";
+    fout << "conv2d(Output=y)\n";
+  }
+  ir::OpCostTable table;
+  try {
+    table.Load(path);
+    FAIL() << "Loading a line without the op cost should throw.";
+  } catch (paddle::platform::EnforceNotMet &err) {
+    std::string err_msg = err.what();
+    EXPECT_NE(err_msg.find(path + ":3"), std::string::npos);
+  }
+  std::remove(path.c_str());
+}
+
 }  // namespace framework
 }  // namespace paddle
@@ -0,0 +1,179 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/fc_weight_pack_pass.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/operators/math/fc.h"
+#include "paddle/fluid/platform/device_context.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+static platform::CPUDeviceContext* CPUContext() {
+  return static_cast<platform::CPUDeviceContext*>(
+      platform::DeviceContextPool::Instance().Get(platform::CPUPlace()));
+}
+
+template <typename T>
+using CPUWeightPacker =
+    operators::math::FCWeightPacker<platform::CPUDeviceContext, T>;
+
+template <typename T>
+static void PackWeight(const LoDTensor& w, int64_t numel, LoDTensor* packed_w) {
+  packed_w->Resize({numel});
+  T* packed_data = packed_w->mutable_data<T>(platform::CPUPlace());
+  // W of fc is in the shape of (K, N).
+  CPUWeightPacker<T>::Pack(*CPUContext(), w.dims()[1], w.dims()[0],
+                           w.data<T>(), packed_data);
+}
+
+int64_t FCWeightPackPass::PackedNumel(Node* fc, const LoDTensor& w) const {
+  auto* op_desc = fc->Op();
+  // The kernels of mkldnn and the padded weights do not consume PackedW.
+  if (op_desc->GetAttrIfExists<bool>("use_mkldnn") ||
+      op_desc->GetAttrIfExists<bool>("padding_weights") ||
+      w.dims().size() != 2) {
+    return 0;
+  }
+  int N = w.dims()[1];
+  int K = w.dims()[0];
+  auto dtype = framework::TransToProtoVarType(w.dtype());
+  if (dtype == proto::VarType::FP32) {
+    return CPUWeightPacker<float>::PackedNumel(*CPUContext(), N, K);
+  } else if (dtype == proto::VarType::FP64) {
+    return CPUWeightPacker<double>::PackedNumel(*CPUContext(), N, K);
+  }
+  return 0;
+}
+
+// A PackedW loaded with the program may be packed on another CPU, so it is
+// unlinked from fc and W is packed again.
+static void DropPackedW(Graph* graph, Node* fc) {
+  auto* op_desc = fc->Op();
+  if (!op_desc->Inputs().count("PackedW")) {
+    return;
+  }
+  for (auto& packed_name : op_desc->Input("PackedW")) {
+    for (auto* input : fc->inputs) {
+      if (input->IsVar() && input->Name() == packed_name) {
+        input->outputs.erase(
+            std::remove(input->outputs.begin(), input->outputs.end(), fc),
+            input->outputs.end());
+        fc->inputs.erase(
+            std::remove(fc->inputs.begin(), fc->inputs.end(), input),
+            fc->inputs.end());
+        if (input->outputs.empty() && input->inputs.empty()) {
+          graph->RemoveNode(input);
+        }
+        break;
+      }
+    }
+  }
+  op_desc->RemoveInput("PackedW");
+  op_desc->Flush();
+}
+
+void FCWeightPackPass::RemovePackedW(ProgramDesc* program) {
+  for (size_t i = 0; i < program->Size(); ++i) {
+    auto* block = program->MutableBlock(i);
+    for (auto* op : block->AllOps()) {
+      if (op->Type() != "fc" || !op->Inputs().count("PackedW")) {
+        continue;
+      }
+      for (auto& packed_name : op->Input("PackedW")) {
+        block->RemoveVar(packed_name);
+      }
+      op->RemoveInput("PackedW");
+      op->Flush();
+    }
+  }
+}
+
+void FCWeightPackPass::ApplyImpl(Graph* graph) const {
+  PADDLE_ENFORCE_NOT_NULL(
+      graph, platform::errors::PreconditionNotMet("graph should not be null."));
+  FusePassBase::Init("fc_weight_pack", graph);
+  auto* scope = param_scope();
+  PADDLE_ENFORCE_NOT_NULL(
+      scope, platform::errors::PreconditionNotMet(
+                 "The param scope of fc_weight_pack_pass should be set."));
+
+  std::vector<Node*> fc_nodes;
+  for (auto* node : graph->Nodes()) {
+    if (node->IsOp() && node->Op() != nullptr && node->Op()->Type() == "fc") {
+      fc_nodes.push_back(node);
+    }
+  }
+
+  // The fc ops sharing one W share the packed W as well.
+  std::unordered_map<std::string, Node*> packed_w_nodes;
+  int packed_count = 0;
+  for (auto* fc : fc_nodes) {
+    DropPackedW(graph, fc);
+    auto* op_desc = fc->Op();
+    const std::string& w_name = op_desc->Input("W")[0];
+    auto* w_var = scope->FindVar(w_name);
+    if (w_var == nullptr || !w_var->IsType<LoDTensor>() ||
+        !w_var->Get<LoDTensor>().IsInitialized()) {
+      continue;
+    }
+    auto& w = w_var->Get<LoDTensor>();
+    int64_t numel = PackedNumel(fc, w);
+    if (numel <= 0) {
+      continue;
+    }
+
+    std::string packed_name = PackedName(w_name);
+    auto iter = packed_w_nodes.find(packed_name);
+    Node* packed_w_node = nullptr;
+    if (iter != packed_w_nodes.end()) {
+      packed_w_node = iter->second;
+    } else {
+      // The packed W of the previous run of the pass is overwritten.
+      auto* packed_w = scope->Var(packed_name)->GetMutable<LoDTensor>();
+      auto dtype = framework::TransToProtoVarType(w.dtype());
+      if (dtype == proto::VarType::FP32) {
+        PackWeight<float>(w, numel, packed_w);
+      } else {
+        PackWeight<double>(w, numel, packed_w);
+      }
+      VarDesc packed_w_desc(packed_name);
+      packed_w_desc.SetType(proto::VarType::LOD_TENSOR);
+      packed_w_desc.SetDataType(dtype);
+      packed_w_desc.SetShape({numel});
+      packed_w_desc.SetPersistable(true);
+      packed_w_node = graph->CreateVarNode(&packed_w_desc);
+      packed_w_nodes[packed_name] = packed_w_node;
+    }
+
+    op_desc->SetInput("PackedW", {packed_name});
+    op_desc->Flush();
+    IR_NODE_LINK_TO(packed_w_node, fc);
+    ++packed_count;
+  }
+  AddStatis(packed_count);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(fc_weight_pack_pass, paddle::framework::ir::FCWeightPackPass);
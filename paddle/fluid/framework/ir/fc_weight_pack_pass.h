@@ -0,0 +1,61 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "paddle/fluid/framework/ir/fuse_pass_base.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+class Graph;
+class Node;
+
+/*
+ * Packs the weight W of the native CPU fc ops into the opaque layout of
+ * MKL packed GEMM once at analysis time, and feeds the packed tensor to fc
+ * as the input PackedW, so that the GEMM of every run does not pack W
+ * again. The original W is kept for the shape inference of fc.
+ *
+ * The packed layout depends on the CPU the pass runs on, so W@PACKED is
+ * never trusted: the pass packs W again even if fc already has a PackedW,
+ * and RemovePackedW strips it from the programs written to disk. The pass
+ * is not in the default CpuPassStrategy, append it to the pass builder to
+ * enable it.
+ */
+class FCWeightPackPass : public FusePassBase {
+ public:
+  virtual ~FCWeightPackPass() {}
+
+  static std::string PackedName(const std::string& w_name) {
+    return w_name + "@PACKED";
+  }
+
+  // Removes PackedW of the fc ops and the packed vars from the program.
+  static void RemovePackedW(ProgramDesc* program);
+
+ protected:
+  void ApplyImpl(Graph* graph) const override;
+
+ private:
+  // Returns the number of elements of the packed W, 0 if fc can not use it.
+  int64_t PackedNumel(Node* fc, const LoDTensor& w) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,157 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/fc_weight_pack_pass.h"
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/pass_tester_helper.h"
+#include "paddle/fluid/operators/math/fc.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+static void AddVarToScope(Scope* param_scope, const std::string& name,
+                          const DDim& dims) {
+  auto* tensor = param_scope->Var(name)->GetMutable<LoDTensor>();
+  tensor->Resize(dims);
+  auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = static_cast<float>(i % 7) / 7.f;
+  }
+}
+
+TEST(FCWeightPackPass, basic) {
+  // inputs                     operator            output
+  // --------------------------------------------------------
+  // (x, w, bias)               fc               -> fc_out_0
+  // (fc_out_0, w, bias)        fc               -> fc_out_1
+  const int K = 64;
+  Layers layers;
+  auto* x = layers.data("x", {8, K});
+  auto* w = layers.data("w", {K, K}, true);
+  auto* bias = layers.data("bias", {K}, true);
+  auto* fc_out_0 = layers.fc(x, w, bias);
+  layers.fc(fc_out_0, w, bias);
+
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "w", {K, K});
+  AddVarToScope(scope, "bias", {K});
+  graph->Set(kParamScopeAttr, scope);
+  int num_nodes_before = graph->Nodes().size();
+
+  auto pass = PassRegistry::Instance().Get("fc_weight_pack_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // Both fc ops read the same packed W.
+  std::string packed_name = FCWeightPackPass::PackedName("w");
+  ASSERT_EQ(static_cast<int>(graph->Nodes().size()), num_nodes_before + 1);
+  for (auto* node : graph->Nodes()) {
+    if (node->IsOp() && node->Op()->Type() == "fc") {
+      ASSERT_EQ(node->Op()->Input("PackedW"),
+                std::vector<std::string>({packed_name}));
+    } else if (node->IsVar() && node->Name() == packed_name) {
+      ASSERT_TRUE(node->Var()->Persistable());
+      ASSERT_EQ(node->outputs.size(), 2UL);
+    }
+  }
+
+  // The GEMM with the packed W gives the same result as the plain one.
+  const int M = 8;
+  std::vector<float> input(M * K, 0.5f);
+  std::vector<float> out(M * K);
+  std::vector<float> packed_out(M * K);
+  auto* dev_ctx = static_cast<platform::CPUDeviceContext*>(
+      platform::DeviceContextPool::Instance().Get(platform::CPUPlace()));
+  auto& w_tensor = scope->FindVar("w")->Get<LoDTensor>();
+  auto& bias_tensor = scope->FindVar("bias")->Get<LoDTensor>();
+  auto& packed_w_tensor = scope->FindVar(packed_name)->Get<LoDTensor>();
+  operators::math::FCFunctor<platform::CPUDeviceContext, float> fc;
+  fc(*dev_ctx, M, K, K, input.data(), w_tensor.data<float>(), out.data(),
+     bias_tensor.data<float>(), true);
+  fc(*dev_ctx, M, K, K, input.data(), w_tensor.data<float>(),
+     packed_out.data(), bias_tensor.data<float>(), true, false,
+     packed_w_tensor.data<float>());
+  for (int i = 0; i < M * K; ++i) {
+    ASSERT_NEAR(out[i], packed_out[i], 1e-5);
+  }
+}
+
+TEST(FCWeightPackPass, RepackLoadedPackedW) {
+  const int K = 64;
+  Layers layers;
+  auto* x = layers.data("x", {8, K});
+  auto* w = layers.data("w", {K, K}, true);
+  auto* bias = layers.data("bias", {K}, true);
+  layers.fc(x, w, bias);
+
+  std::unique_ptr<Graph> graph(new Graph(layers.main_program()));
+  auto* scope = new Scope();
+  AddVarToScope(scope, "w", {K, K});
+  AddVarToScope(scope, "bias", {K});
+  graph->Set(kParamScopeAttr, scope);
+  auto pass = PassRegistry::Instance().Get("fc_weight_pack_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  std::string packed_name = FCWeightPackPass::PackedName("w");
+  auto* packed_var = scope->FindVar(packed_name);
+  if (packed_var == nullptr) {
+    // The BLAS library does not support packing.
+    return;
+  }
+  std::vector<float> packed(
+      packed_var->Get<LoDTensor>().data<float>(),
+      packed_var->Get<LoDTensor>().data<float>() +
+          packed_var->Get<LoDTensor>().numel());
+
+  // The program saved with PackedW does not hold it any more.
+  ProgramDesc program;
+  GraphToProgram(*graph, &program);
+  FCWeightPackPass::RemovePackedW(&program);
+  for (auto* op : program.Block(0).AllOps()) {
+    ASSERT_EQ(op->Inputs().count("PackedW"), 0UL);
+  }
+  ASSERT_FALSE(program.Block(0).HasVar(packed_name));
+
+  // A stale PackedW loaded with the program is packed again.
+  ProgramDesc loaded_program;
+  GraphToProgram(*graph, &loaded_program);
+  std::unique_ptr<Graph> loaded_graph(new Graph(loaded_program));
+  loaded_graph->Set(kParamScopeAttr, scope);
+  auto* stale = packed_var->GetMutable<LoDTensor>()->data<float>();
+  for (size_t i = 0; i < packed.size(); ++i) {
+    stale[i] = 0.f;
+  }
+  loaded_graph.reset(pass->Apply(loaded_graph.release()));
+  int packed_w_nodes = 0;
+  for (auto* node : loaded_graph->Nodes()) {
+    if (node->IsVar() && node->Name() == packed_name) {
+      ++packed_w_nodes;
+    }
+  }
+  ASSERT_EQ(packed_w_nodes, 1);
+  auto* repacked = packed_var->Get<LoDTensor>().data<float>();
+  for (size_t i = 0; i < packed.size(); ++i) {
+    ASSERT_EQ(repacked[i], packed[i]);
+  }
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(fc_weight_pack_pass);
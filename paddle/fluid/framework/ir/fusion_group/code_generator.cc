@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/ir/fusion_group/code_generator.h"
 #include "paddle/fluid/framework/ir/fusion_group/code_generator_helper.h"
+#include "paddle/fluid/framework/ir/fusion_group/cpu_resources.h"
 #include "paddle/fluid/framework/ir/fusion_group/cuda_resources.h"
 
 namespace paddle {
@@ -42,11 +43,12 @@ std::string ExtractDataType(const std::vector<Node*>& nodes) {
   return dtype_str;
 }
 
-CodeGenerator::CodeGenerator() {
+CodeGenerator::CodeGenerator(bool use_cpu) : use_cpu_(use_cpu) {
   // Only support elementwise operations now.
   code_templates_.resize(1);
 
-  CodeTemplate elementwise_t(cuda_kernel_template_1d);
+  CodeTemplate elementwise_t(use_cpu ? cpu_kernel_template_1d
+                                     : cuda_kernel_template_1d);
   code_templates_[0] = elementwise_t;
 }
 
@@ -183,6 +185,18 @@ std::string CodeGenerator::Generate(
   for (const auto& type : dtypes) {
     all_dtype.insert(type.second);
   }
+  if (use_cpu_) {
+    // The CPU kernels are emitted with Xbyak, which only computes in float,
+    // return an empty string to tell the caller that this subgraph cannot be
+    // fused.
+    if (all_dtype.size() != 1U || all_dtype.count("float") == 0) {
+      VLOG(3) << "Subgraph " << func_name
+              << " has vars other than float, which is not supported on CPU.";
+      return "";
+    }
+    return code_templates_[0].Format(template_var);
+  }
+
   std::string predefined_cuda_functions = "";
   if (all_dtype.find("float") != all_dtype.end() &&
       all_dtype.find("__half") == all_dtype.end()) {
@@ -271,6 +285,26 @@ std::string CodeGenerator::EmitParameters(
     const std::set<int>& intermediate_ids,
     const std::unordered_map<int, std::string>& dtypes) const {
   std::stringstream ret;
+  if (use_cpu_) {
+    // The names of the data pointers, in the same order as the parameters of
+    // the CUDA kernel.
+    std::vector<std::string> arg_names;
+    for (auto id : input_ids) {
+      if (output_ids.find(id) == output_ids.end()) {
+        arg_names.push_back(ArgName(id));
+      }
+    }
+    for (auto id : output_ids) {
+      if (intermediate_ids.find(id) == intermediate_ids.end()) {
+        arg_names.push_back(ArgName(id));
+      }
+    }
+    for (size_t i = 0; i < arg_names.size(); ++i) {
+      ret << (i == 0 ? "" : ", ") << arg_names[i];
+    }
+    return ret.str();
+  }
+
   ret << "int N, ";
 
   // If a id is in the input and output list at the same time, then remove it
@@ -317,9 +351,13 @@ std::string CodeGenerator::EmitComputeBody(
   for (auto id : input_ids) {
     if (output_ids.find(id) == output_ids.end() &&
         used.find(id) != used.end()) {
-      load << dtypes.at(id) << " " << TmpName(id) << " = "
-           << "__ldg(&" << VarName(id) << ")"
-           << ";";
+      load << dtypes.at(id) << " " << TmpName(id) << " = ";
+      if (use_cpu_) {
+        load << VarName(id) << ";";
+      } else {
+        load << "__ldg(&" << VarName(id) << ")"
+             << ";";
+      }
     }
   }
   // Store temporal variables to memory.
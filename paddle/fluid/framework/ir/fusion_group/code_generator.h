@@ -32,7 +32,9 @@ class SubGraph;
 
 class CodeGenerator {
  public:
-  CodeGenerator();
+  // When use_cpu is true, the kernel is generated for CPUDeviceCode instead
+  // of CUDA.
+  explicit CodeGenerator(bool use_cpu = false);
 
   std::string Generate(std::string func_name,
                        const std::vector<OperationExpression>& expressions);
@@ -68,6 +70,7 @@ class CodeGenerator {
 
  private:
   std::vector<CodeTemplate> code_templates_;
+  bool use_cpu_{false};
 };
 
 }  // namespace fusion_group
@@ -17,6 +17,7 @@ limitations under the License. */
 #include <string>
 
 #include "paddle/fluid/framework/ir/fusion_group/code_generator.h"
+#include "paddle/fluid/framework/ir/fusion_group/cpu_device_code.h"
 #include "paddle/fluid/framework/ir/fusion_group/operation.h"
 #include "paddle/fluid/framework/ir/pass_tester_helper.h"
 #include "paddle/fluid/platform/device_code.h"
@@ -26,8 +27,6 @@ namespace phi {
 class DenseTensor;
 }  // namespace phi
 
-#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
-
 namespace paddle {
 namespace framework {
 namespace ir {
@@ -169,6 +168,115 @@ void SetupRandomCPUTensor(LoDTensor* tensor) {
 
 namespace fusion_group = paddle::framework::ir::fusion_group;
 
+void TestCPUMain(std::string func_name,
+                 std::vector<fusion_group::OperationExpression> expressions,
+                 std::vector<int> input_ids, std::vector<int> output_ids,
+                 const phi::DDim& dims) {
+  fusion_group::OperationMap::Init();
+  fusion_group::CodeGenerator code_generator(true);
+  std::string code_str = code_generator.Generate(func_name, expressions);
+  VLOG(3) << code_str;
+
+  paddle::platform::CPUPlace place;
+  fusion_group::CPUDeviceCode device_code(place, func_name, code_str);
+  ASSERT_EQ(device_code.Compile(), true);
+
+  std::unordered_set<int> ids(input_ids.begin(), input_ids.end());
+  ids.insert(output_ids.begin(), output_ids.end());
+  std::vector<paddle::framework::LoDTensor> cpu_tensors(ids.size());
+  for (size_t i = 0; i < cpu_tensors.size(); ++i) {
+    cpu_tensors[i].mutable_data<float>(dims, place);
+  }
+
+  size_t n = cpu_tensors[0].numel();
+  std::vector<float*> ptrs(cpu_tensors.size());
+  std::vector<void*> args;
+  args.push_back(&n);
+  for (auto id : input_ids) {
+    if (id >= 0) {
+      fusion_group::SetupRandomCPUTensor<float>(&cpu_tensors[id]);
+      ptrs[id] = cpu_tensors[id].data<float>();
+      args.push_back(&ptrs[id]);
+    }
+  }
+  for (auto id : output_ids) {
+    ptrs[id] = cpu_tensors[id].data<float>();
+    args.push_back(&ptrs[id]);
+  }
+  device_code.Launch(n, &args);
+
+  for (size_t i = 0; i < n; i++) {
+    fusion_group::CheckOutput(expressions, cpu_tensors, input_ids, output_ids,
+                              i, 1E-5);
+  }
+}
+
+TEST(code_generator, elementwise_cpu) {
+  if (!fusion_group::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  // t2 = t0 * t1
+  // t4 = t2 + t3
+  // t6 = t4 - t5
+  // t7 = relu(t6)
+  // t8 = sigmoid(t7)
+  std::string dtype = "float";
+  fusion_group::OperationExpression exp1("elementwise_mul", {0, 1}, {2}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp2("elementwise_add", {2, 3}, {4}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp3("elementwise_sub", {4, 5}, {6}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp4("relu", {6}, {7}, dtype, dtype);
+  fusion_group::OperationExpression exp5("sigmoid", {7}, {8}, dtype, dtype);
+  std::vector<fusion_group::OperationExpression> expressions = {
+      exp1, exp2, exp3, exp4, exp5};
+  std::vector<int> input_ids = {0, 1, 3, 5};
+  std::vector<int> output_ids = {2, 4, 6, 7, 8};
+  TestCPUMain("elementwise_cpu_kernel_0", expressions, input_ids, output_ids,
+              phi::make_ddim({256, 1024}));
+
+  // The same computation with another function name reuses the compiled
+  // kernel, and the elements out of the last full block are computed too.
+  size_t num_kernels = fusion_group::CPUDeviceCode::NumCompiledKernels();
+  TestCPUMain("elementwise_cpu_kernel_1", expressions, input_ids, output_ids,
+              phi::make_ddim({3, 7}));
+  EXPECT_EQ(fusion_group::CPUDeviceCode::NumCompiledKernels(), num_kernels);
+
+  // Only float is supported on CPU.
+  for (std::string other_dtype : {"__half", "double"}) {
+    fusion_group::OperationExpression exp6("relu", {0}, {1}, other_dtype,
+                                           other_dtype);
+    fusion_group::CodeGenerator code_generator(true);
+    EXPECT_EQ(code_generator.Generate("elementwise_cpu_kernel_2", {exp6}), "");
+  }
+}
+
+TEST(code_generator, elementwise_grad_cpu) {
+  if (!fusion_group::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  // The var order: t0, t1, t2, t3, t0', t1', t2', t3', t8
+  // t2' = relu_grad(t2, t3, t3')
+  // t0', t1' = elementwise_mul_grad(t0, t1, t2, t2')
+  // t8 = tanh(t0)
+  std::string dtype = "float";
+  fusion_group::OperationExpression exp1("relu_grad", {-1, 3, 7}, {6}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp2("elementwise_mul_grad", {0, 1, 2, 6},
+                                         {4, 5}, dtype, dtype);
+  fusion_group::OperationExpression exp3("tanh", {0}, {8}, dtype, dtype);
+  std::vector<fusion_group::OperationExpression> expressions = {exp1, exp2,
+                                                                exp3};
+  std::vector<int> input_ids = {0, 1, 2, 3, 7};
+  std::vector<int> output_ids = {4, 5, 6, 8};
+  TestCPUMain("elementwise_grad_cpu_kernel_0", expressions, input_ids,
+              output_ids, phi::make_ddim({129, 5}));
+}
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 template <typename T>
 void TestMainImpl(std::string func_name, std::string code_str,
                   std::vector<paddle::framework::LoDTensor> cpu_tensors, int n,
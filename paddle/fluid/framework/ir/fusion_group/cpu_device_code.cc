@@ -0,0 +1,575 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/framework/ir/fusion_group/cpu_device_code.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+
+#include "paddle/fluid/operators/jit/macro.h"
+#include "paddle/fluid/platform/cpu_info.h"
+#include "paddle/fluid/platform/enforce.h"
+#ifdef PADDLE_WITH_XBYAK
+#include "paddle/fluid/operators/jit/gen/fused_elementwise.h"
+#endif
+
+namespace paddle {
+namespace framework {
+namespace ir {
+namespace fusion_group {
+
+struct CPUKernel {
+#ifdef PADDLE_WITH_XBYAK
+  std::unique_ptr<operators::jit::gen::FusedElementwiseJitCode> code;
+  operators::jit::gen::FusedElementwiseFunc func{nullptr};
+#endif
+  // Whether the i-th argument is written by the kernel.
+  std::vector<bool> is_output;
+};
+
+// The compiled kernels are shared by all CPUDeviceCode objects and live
+// until the process exits, keyed by the kernel without the function name.
+static std::mutex& CPUKernelCacheMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static std::unordered_map<std::string, std::unique_ptr<CPUKernel>>&
+CPUKernelCache() {
+  static std::unordered_map<std::string, std::unique_ptr<CPUKernel>> cache;
+  return cache;
+}
+
+#ifdef PADDLE_WITH_XBYAK
+using operators::jit::gen::fused_instr_t;
+using operators::jit::gen::fused_op_type;
+using operators::jit::gen::fused_program_t;
+
+// Lowers a kernel generated by CodeGenerator for CPU, which looks like
+//   func_name(arg0, arg1, arg2) {
+//     float tmp0 = arg0[idx]; ... float tmp2 = tmp0 + tmp1; arg2[idx] = tmp2;
+//   }
+// to a fused elementwise program. The right-hand sides are the C expressions
+// of the operation templates: literals, the tmp vars, unary minus, the
+// arithmetic, comparison and conditional operators, and Exp, Sqrt and Max.
+// Expressions of literals are folded.
+class KernelLowering {
+ public:
+  explicit KernelLowering(const std::string& kernel) {
+    Tokenize(kernel);
+    if (error_.empty()) {
+      Lower();
+    }
+  }
+
+  bool Succeeded() const { return error_.empty(); }
+  const std::string& Error() const { return error_; }
+  const fused_program_t& Program() const { return program_; }
+  const std::vector<bool>& IsOutput() const { return is_output_; }
+  // The tokens after the function name.
+  const std::string& Key() const { return key_; }
+
+ private:
+  struct Value {
+    bool is_const{true};
+    float value{0.f};
+    int slot{-1};
+  };
+
+  void Fail(const std::string& message) {
+    if (error_.empty()) {
+      error_ = message + " (at token " + std::to_string(pos_) + ")";
+    }
+  }
+
+  void Tokenize(const std::string& kernel) {
+    size_t i = 0;
+    while (i < kernel.size()) {
+      unsigned char c = kernel[i];
+      if (std::isspace(c)) {
+        ++i;
+      } else if (std::isalpha(c) || c == '_') {
+        size_t start = i;
+        while (i < kernel.size() &&
+               (std::isalnum(static_cast<unsigned char>(kernel[i])) ||
+                kernel[i] == '_')) {
+          ++i;
+        }
+        tokens_.push_back(kernel.substr(start, i - start));
+      } else if (std::isdigit(c) || c == '.') {
+        const char* start = kernel.c_str() + i;
+        char* end = nullptr;
+        std::strtof(start, &end);
+        if (end == start) {
+          Fail("Invalid number in the kernel");
+          return;
+        }
+        tokens_.push_back(kernel.substr(i, end - start));
+        i += end - start;
+      } else if (i + 1 < kernel.size() && kernel[i + 1] == '=' &&
+                 std::strchr("<>=!", c) != nullptr) {
+        tokens_.push_back(kernel.substr(i, 2));
+        i += 2;
+      } else if (std::strchr("()[]{}?:+-*/<>=,;", c) != nullptr) {
+        tokens_.push_back(std::string(1, c));
+        ++i;
+      } else {
+        Fail(std::string("Unexpected character ") + kernel[i] +
+             " in the kernel");
+        return;
+      }
+    }
+  }
+
+  const std::string& Peek() const {
+    static const std::string end_of_kernel;
+    return pos_ < tokens_.size() ? tokens_[pos_] : end_of_kernel;
+  }
+  bool Accept(const std::string& token) {
+    if (Peek() == token) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+  void Expect(const std::string& token) {
+    if (!Accept(token)) {
+      Fail("Expected " + token + " but received " + Peek());
+    }
+  }
+  std::string Next() { return pos_ < tokens_.size() ? tokens_[pos_++] : ""; }
+
+  int NewSlot() { return program_.num_slots++; }
+
+  int Emit(fused_op_type type, int src0 = 0, int src1 = 0, int src2 = 0) {
+    fused_instr_t instr;
+    instr.type = type;
+    instr.dst = NewSlot();
+    instr.src0 = src0;
+    instr.src1 = src1;
+    instr.src2 = src2;
+    program_.instrs.push_back(instr);
+    return instr.dst;
+  }
+
+  int SlotOf(const Value& v) {
+    if (!v.is_const) {
+      return v.slot;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &v.value, sizeof(bits));
+    auto iter = const_slots_.find(bits);
+    if (iter != const_slots_.end()) {
+      return iter->second;
+    }
+    fused_instr_t instr;
+    instr.type = operators::jit::gen::kFusedConst;
+    instr.dst = NewSlot();
+    instr.value = v.value;
+    program_.instrs.push_back(instr);
+    const_slots_[bits] = instr.dst;
+    return instr.dst;
+  }
+
+  static Value Const(float value) {
+    Value v;
+    v.value = value;
+    return v;
+  }
+
+  static float Fold(fused_op_type type, float a, float b) {
+    using namespace operators::jit::gen;  // NOLINT
+    switch (type) {
+      case kFusedAdd:
+        return a + b;
+      case kFusedSub:
+        return a - b;
+      case kFusedMul:
+        return a * b;
+      case kFusedDiv:
+        return a / b;
+      case kFusedMax:
+        return std::fmax(a, b);
+      case kFusedLT:
+        return a < b;
+      case kFusedLE:
+        return a <= b;
+      case kFusedGT:
+        return a > b;
+      case kFusedGE:
+        return a >= b;
+      case kFusedEQ:
+        return a == b;
+      case kFusedNE:
+        return a != b;
+      default:
+        return 0.f;
+    }
+  }
+
+  Value Binary(fused_op_type type, const Value& a, const Value& b) {
+    if (a.is_const && b.is_const) {
+      return Const(Fold(type, a.value, b.value));
+    }
+    Value v;
+    v.is_const = false;
+    v.slot = Emit(type, SlotOf(a), SlotOf(b));
+    return v;
+  }
+
+  Value Unary(fused_op_type type, const Value& a) {
+    if (a.is_const) {
+      return Const(type == operators::jit::gen::kFusedExp
+                       ? std::exp(a.value)
+                       : std::sqrt(a.value));
+    }
+    Value v;
+    v.is_const = false;
+    v.slot = Emit(type, a.slot);
+    return v;
+  }
+
+  Value ParsePrimary() {
+    using namespace operators::jit::gen;  // NOLINT
+    if (!error_.empty()) {
+      return Value();
+    }
+    std::string token = Next();
+    if (token == "(") {
+      Value v = ParseTernary();
+      Expect(")");
+      return v;
+    }
+    if (std::isdigit(static_cast<unsigned char>(token[0])) ||
+        token[0] == '.') {
+      return Const(std::strtof(token.c_str(), nullptr));
+    }
+    if (token == "true" || token == "false") {
+      return Const(token == "true" ? 1.f : 0.f);
+    }
+    if (token == "Exp" || token == "Sqrt") {
+      Expect("(");
+      Value a = ParseTernary();
+      Expect(")");
+      return Unary(token == "Exp" ? kFusedExp : kFusedSqrt, a);
+    }
+    if (token == "Max") {
+      Expect("(");
+      Value a = ParseTernary();
+      Expect(",");
+      Value b = ParseTernary();
+      Expect(")");
+      return Binary(kFusedMax, a, b);
+    }
+    auto iter = tmps_.find(token);
+    if (iter == tmps_.end()) {
+      Fail("Unsupported operand " + token);
+      return Value();
+    }
+    return iter->second;
+  }
+
+  Value ParseUnary() {
+    if (Accept("-")) {
+      Value a = ParseUnary();
+      if (a.is_const) {
+        return Const(-a.value);
+      }
+      return Binary(operators::jit::gen::kFusedSub, Const(0.f), a);
+    }
+    return ParsePrimary();
+  }
+
+  Value ParseMultiplicative() {
+    using namespace operators::jit::gen;  // NOLINT
+    Value v = ParseUnary();
+    while (error_.empty()) {
+      if (Accept("*")) {
+        v = Binary(kFusedMul, v, ParseUnary());
+      } else if (Accept("/")) {
+        v = Binary(kFusedDiv, v, ParseUnary());
+      } else {
+        break;
+      }
+    }
+    return v;
+  }
+
+  Value ParseAdditive() {
+    using namespace operators::jit::gen;  // NOLINT
+    Value v = ParseMultiplicative();
+    while (error_.empty()) {
+      if (Accept("+")) {
+        v = Binary(kFusedAdd, v, ParseMultiplicative());
+      } else if (Accept("-")) {
+        v = Binary(kFusedSub, v, ParseMultiplicative());
+      } else {
+        break;
+      }
+    }
+    return v;
+  }
+
+  Value ParseRelational() {
+    using namespace operators::jit::gen;  // NOLINT
+    static const std::map<std::string, fused_op_type> ops = {
+        {"<", kFusedLT}, {"<=", kFusedLE}, {">", kFusedGT}, {">=", kFusedGE}};
+    Value v = ParseAdditive();
+    for (auto iter = ops.find(Peek()); error_.empty() && iter != ops.end();
+         iter = ops.find(Peek())) {
+      ++pos_;
+      v = Binary(iter->second, v, ParseAdditive());
+    }
+    return v;
+  }
+
+  Value ParseEquality() {
+    using namespace operators::jit::gen;  // NOLINT
+    Value v = ParseRelational();
+    while (error_.empty()) {
+      if (Accept("==")) {
+        v = Binary(kFusedEQ, v, ParseRelational());
+      } else if (Accept("!=")) {
+        v = Binary(kFusedNE, v, ParseRelational());
+      } else {
+        break;
+      }
+    }
+    return v;
+  }
+
+  Value ParseTernary() {
+    Value cond = ParseEquality();
+    if (!error_.empty() || !Accept("?")) {
+      return cond;
+    }
+    Value a = ParseTernary();
+    Expect(":");
+    Value b = ParseTernary();
+    if (cond.is_const) {
+      return cond.value != 0.f ? a : b;
+    }
+    Value v;
+    v.is_const = false;
+    v.slot = Emit(operators::jit::gen::kFusedSelect, cond.slot, SlotOf(a),
+                  SlotOf(b));
+    return v;
+  }
+
+  void LowerStatement() {
+    std::string token = Next();
+    auto arg = args_.find(token);
+    if (arg != args_.end()) {
+      // argK[idx] = tmpN;
+      Expect("[");
+      Expect("idx");
+      Expect("]");
+      Expect("=");
+      Value v = ParsePrimary();
+      if (!error_.empty()) {
+        return;
+      }
+      fused_instr_t instr;
+      instr.type = operators::jit::gen::kFusedStore;
+      instr.src0 = SlotOf(v);
+      instr.arg = arg->second;
+      program_.instrs.push_back(instr);
+      is_output_[arg->second] = true;
+      return;
+    }
+    if (token != "float") {
+      Fail("Only float is supported on CPU, but received " + token);
+      return;
+    }
+    std::string name = Next();
+    Expect("=");
+    if (!error_.empty()) {
+      return;
+    }
+    arg = args_.find(Peek());
+    if (arg != args_.end() && pos_ + 1 < tokens_.size() &&
+        tokens_[pos_ + 1] == "[") {
+      // float tmpN = argK[idx];
+      ++pos_;
+      Expect("[");
+      Expect("idx");
+      Expect("]");
+      Value v;
+      v.is_const = false;
+      v.slot = Emit(operators::jit::gen::kFusedLoad);
+      program_.instrs.back().arg = arg->second;
+      tmps_[name] = v;
+      return;
+    }
+    tmps_[name] = ParseTernary();
+  }
+
+  void Lower() {
+    Next();  // The function name
+    for (size_t i = pos_; i < tokens_.size(); ++i) {
+      key_ += tokens_[i] + " ";
+    }
+    Expect("(");
+    while (error_.empty() && !Accept(")")) {
+      if (!args_.empty()) {
+        Expect(",");
+      }
+      std::string name = Next();
+      args_.emplace(name, static_cast<int>(args_.size()));
+    }
+    is_output_.resize(args_.size(), false);
+    Expect("{");
+    while (error_.empty() && !Accept("}")) {
+      LowerStatement();
+      Expect(";");
+    }
+    if (error_.empty() && pos_ != tokens_.size()) {
+      Fail("Unexpected " + Peek() + " after the kernel");
+    }
+  }
+
+  std::vector<std::string> tokens_;
+  size_t pos_{0};
+  std::string error_;
+  std::string key_;
+
+  std::unordered_map<std::string, int> args_;
+  std::unordered_map<std::string, Value> tmps_;
+  std::map<uint32_t, int> const_slots_;
+  fused_program_t program_;
+  std::vector<bool> is_output_;
+};
+#endif
+
+bool CPUDeviceCode::IsAvailable() {
+#ifdef PADDLE_WITH_XBYAK
+  return platform::MayIUse(platform::avx);
+#else
+  return false;
+#endif
+}
+
+size_t CPUDeviceCode::NumCompiledKernels() {
+  std::lock_guard<std::mutex> guard(CPUKernelCacheMutex());
+  return CPUKernelCache().size();
+}
+
+CPUDeviceCode::CPUDeviceCode(const platform::Place& place,
+                             const std::string& name,
+                             const std::string& kernel) {
+  if (!platform::is_cpu_place(place)) {
+    PADDLE_THROW(platform::errors::PermissionDenied(
+        "CPUDeviceCode can only launch on CPU place."));
+  }
+
+  place_ = place;
+  name_ = name;
+  kernel_ = kernel;
+}
+
+bool CPUDeviceCode::Compile(bool include_path) {
+  is_compiled_ = false;
+  if (!IsAvailable()) {
+    LOG_FIRST_N(WARNING, 1) << "JIT compiling of CPU code needs Xbyak and a "
+                               "CPU supporting AVX.";
+    return false;
+  }
+#ifdef PADDLE_WITH_XBYAK
+  KernelLowering lowering(kernel_);
+  if (!lowering.Succeeded()) {
+    LOG(WARNING) << "JIT compiling of CPU code failed:"
+                 << "\n  Kernel name: " << name_ << "\n  Kernel body:\n"
+                 << kernel_ << "\n  Error: " << lowering.Error();
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(CPUKernelCacheMutex());
+  auto& cache = CPUKernelCache();
+  auto iter = cache.find(lowering.Key());
+  if (iter != cache.end()) {
+    VLOG(3) << "Reuse the compiled CPU kernel for " << name_;
+  } else {
+    using operators::jit::gen::FusedElementwiseJitCode;
+    std::unique_ptr<CPUKernel> compiled(new CPUKernel);
+    const auto& program = lowering.Program();
+    compiled->code.reset(new FusedElementwiseJitCode(
+        program, FusedElementwiseJitCode::CodeSize(program)));
+    compiled->func = compiled->code->getCode<
+        operators::jit::gen::FusedElementwiseFunc>();
+    compiled->is_output = lowering.IsOutput();
+    iter = cache.emplace(lowering.Key(), std::move(compiled)).first;
+  }
+  compiled_kernel_ = iter->second.get();
+  is_compiled_ = true;
+#endif
+  return is_compiled_;
+}
+
+void CPUDeviceCode::Launch(const size_t n, std::vector<void*>* args) const {
+  PADDLE_ENFORCE_EQ(
+      is_compiled_, true,
+      platform::errors::PreconditionNotMet(
+          "Please compile the code before launching the kernel."));
+#ifdef PADDLE_WITH_XBYAK
+  // args->at(0) is the address of n, the others are the addresses of the
+  // data pointers.
+  const auto& is_output = compiled_kernel_->is_output;
+  size_t num_args = is_output.size();
+  PADDLE_ENFORCE_EQ(args->size(), num_args + 1,
+                    platform::errors::InvalidArgument(
+                        "Kernel %s expects %d data pointers, but received %d.",
+                        name_, num_args, args->size() - 1));
+  std::vector<float*> ptrs(num_args);
+  for (size_t i = 0; i < num_args; ++i) {
+    ptrs[i] = *reinterpret_cast<float**>(args->at(i + 1));
+  }
+
+  size_t num_main = n / YMM_FLOAT_BLOCK * YMM_FLOAT_BLOCK;
+  if (num_main > 0) {
+    compiled_kernel_->func(num_main, ptrs.data());
+  }
+  if (num_main == n) {
+    return;
+  }
+  // Run the rest in a zero padded block.
+  std::vector<float> block(num_args * YMM_FLOAT_BLOCK, 0.f);
+  std::vector<float*> block_ptrs(num_args);
+  for (size_t i = 0; i < num_args; ++i) {
+    block_ptrs[i] = block.data() + i * YMM_FLOAT_BLOCK;
+    if (!is_output[i]) {
+      std::copy(ptrs[i] + num_main, ptrs[i] + n, block_ptrs[i]);
+    }
+  }
+  compiled_kernel_->func(YMM_FLOAT_BLOCK, block_ptrs.data());
+  for (size_t i = 0; i < num_args; ++i) {
+    if (is_output[i]) {
+      std::copy(block_ptrs[i], block_ptrs[i] + (n - num_main),
+                ptrs[i] + num_main);
+    }
+  }
+#endif
+}
+
+}  // namespace fusion_group
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
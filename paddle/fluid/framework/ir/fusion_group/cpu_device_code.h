@@ -0,0 +1,53 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/platform/device_code.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+namespace fusion_group {
+
+struct CPUKernel;
+
+// Runs the kernels generated by CodeGenerator for CPU. Compile lowers the
+// statements of the kernel to a fused elementwise program and emits it with
+// the Xbyak JitCode of operators/jit, so only float kernels are supported and
+// AVX is needed. Kernels which only differ in the function name share the
+// same code.
+class CPUDeviceCode : public platform::DeviceCode {
+ public:
+  explicit CPUDeviceCode(const platform::Place& place, const std::string& name,
+                         const std::string& kernel);
+  bool Compile(bool include_path = false) override;
+  void Launch(const size_t n, std::vector<void*>* args) const override;
+
+  static bool IsAvailable();
+  // Number of distinct kernels compiled in this process, for unit test.
+  static size_t NumCompiledKernels();
+
+ private:
+  bool is_compiled_{false};
+  const CPUKernel* compiled_kernel_{nullptr};
+};
+
+}  // namespace fusion_group
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,33 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+namespace paddle {
+namespace framework {
+namespace ir {
+namespace fusion_group {
+
+// The statements of the loop body over idx, with the names of the data
+// pointers as the parameters, in the same order as the CUDA kernels.
+// CPUDeviceCode lowers them to a fused elementwise program of operators/jit.
+static constexpr char cpu_kernel_template_1d[] = R"(
+$func_name($parameters) {
+  $compute_body
+}
+)";
+}  // namespace fusion_group
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -14,8 +14,10 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/ir/fusion_group/fusion_group_pass.h"
 #include "paddle/fluid/framework/ir/fusion_group/code_generator.h"
+#include "paddle/fluid/framework/ir/fusion_group/cpu_device_code.h"
 #include "paddle/fluid/framework/ir/fusion_group/elementwise_group_detector.h"
 #include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/ir/op_cost_table.h"
 #include "paddle/fluid/framework/ir/pass_tester_helper.h"
 #include "paddle/fluid/framework/op_proto_maker.h"
 #include "paddle/fluid/platform/device_code.h"
@@ -43,16 +45,61 @@ void FusionGroupPass::ApplyImpl(ir::Graph* graph) const {
     // }
 
     fusion_group::OperationMap::Init();
-    int num_elementwise_groups = DetectFusionGroup(graph, 0);
+    int num_elementwise_groups =
+        DetectFusionGroup(graph, platform::CUDAPlace(0), 0);
     AddStatis(num_elementwise_groups);
     LOG(INFO) << "Detect " << num_elementwise_groups
               << " elementwise fusion groups.";
+  } else {
+    platform::CPUPlace place;
+    platform::DeviceCodePool::Init({place});
+    if (!fusion_group::CPUDeviceCode::IsAvailable()) {
+      LOG(WARNING) << "Disable fusion_group on CPU because it needs Xbyak and "
+                      "a CPU supporting AVX.";
+      return;
+    }
+
+    fusion_group::OperationMap::Init();
+    int num_elementwise_groups = DetectFusionGroup(graph, place, 0);
+    AddStatis(num_elementwise_groups);
+    LOG(INFO) << "Detect " << num_elementwise_groups
+              << " elementwise fusion groups on CPU.";
   }
 }
 
-int FusionGroupPass::DetectFusionGroup(Graph* graph, int type) const {
-  // TODO(liuyiqun): supported different places
-  platform::CUDAPlace place = platform::CUDAPlace(0);
+// Compiling a subgraph at runtime costs much more than running it once, so
+// when measured op costs are attached to the graph, the subgraphs taking
+// less than kMinFusedTimeRatio of the whole program are left unfused.
+static constexpr double kMinFusedTimeRatio = 1e-3;
+
+static bool IsWorthFusing(const Graph& graph,
+                          fusion_group::SubGraph* subgraph) {
+  if (!graph.Has(kOpCostTable)) {
+    return true;
+  }
+  const auto& cost_table = graph.Get<OpCostTable>(kOpCostTable);
+  double whole_time_ms = cost_table.GetWholeTimeMs();
+  if (whole_time_ms <= 0) {
+    return true;
+  }
+  double subgraph_time_ms = 0;
+  for (auto* n : subgraph->Nodes()) {
+    if (n && n->IsOp() && n->Op()) {
+      double time_ms = cost_table.GetOpTimeMs(*n->Op());
+      if (time_ms == OpCostTable::NOT_MEASURED) {
+        return true;
+      }
+      subgraph_time_ms += time_ms;
+    }
+  }
+  VLOG(3) << "Subgraph takes " << subgraph_time_ms << " ms of "
+          << whole_time_ms << " ms.";
+  return subgraph_time_ms >= kMinFusedTimeRatio * whole_time_ms;
+}
+
+int FusionGroupPass::DetectFusionGroup(Graph* graph,
+                                       const platform::Place& place,
+                                       int type) const {
   int index = platform::DeviceCodePool::Init({place}).size(place);
 
   std::vector<std::vector<Node*>> subgraphs =
@@ -67,9 +114,10 @@ int FusionGroupPass::DetectFusionGroup(Graph* graph, int type) const {
         std::unordered_set<Node*>(vec.begin(), vec.end()));
     VLOG(3) << "subgraph: {\n" << DebugString(subgraph.SortedNodes()) << "}\n";
 
-    if (subgraph.IsValid(min_subgraph_size)) {
+    if (subgraph.IsValid(min_subgraph_size) &&
+        IsWorthFusing(*graph, &subgraph)) {
       subgraph.SetFuncName("fused_elementwise_" + std::to_string(index++));
-      if (GenerateCode(&subgraph)) {
+      if (GenerateCode(&subgraph, place)) {
         InsertFusionGroupOp(graph, &subgraph);
         num_subgraphs++;
       }
@@ -78,15 +126,28 @@ int FusionGroupPass::DetectFusionGroup(Graph* graph, int type) const {
   return num_subgraphs;
 }
 
-bool FusionGroupPass::GenerateCode(fusion_group::SubGraph* subgraph) const {
-  fusion_group::CodeGenerator code_generator;
+bool FusionGroupPass::GenerateCode(fusion_group::SubGraph* subgraph,
+                                   const platform::Place& place) const {
+  bool use_cpu = platform::is_cpu_place(place);
+  fusion_group::CodeGenerator code_generator(use_cpu);
   std::string code_str = code_generator.Generate(subgraph);
   VLOG(4) << code_str;
+  if (code_str.empty()) {
+    return false;
+  }
 
-  // TODO(liuyiqun): supported different places
-  platform::CUDAPlace place = platform::CUDAPlace(0);
-  std::unique_ptr<platform::CUDADeviceCode> device_code(
-      new platform::CUDADeviceCode(place, subgraph->GetFuncName(), code_str));
+  std::unique_ptr<platform::DeviceCode> device_code;
+  if (use_cpu) {
+    device_code.reset(new fusion_group::CPUDeviceCode(
+        place, subgraph->GetFuncName(), code_str));
+  } else {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    device_code.reset(
+        new platform::CUDADeviceCode(place, subgraph->GetFuncName(), code_str));
+#else
+    return false;
+#endif
+  }
   bool is_compiled = device_code->Compile();
   if (is_compiled) {
     platform::DeviceCodePool& pool = platform::DeviceCodePool::Init({place});
@@ -357,6 +357,9 @@ std::unique_ptr<Graph> Graph::CloneSubGraph(const size_t idx) {
         cloned_node,
         platform::errors::InvalidArgument(
             "Failed to clone new node from original node in graph."));
+    // The desc order decides the order of the ops converted back to the
+    // program, so it is kept.
+    cloned_node->SetDescOrder(n->DescOrder());
     origin_to_cloned[n] = cloned_node;
   }
   for (auto *n : this->sub_graphs_.at(idx)->Nodes()) {
@@ -370,6 +373,58 @@ std::unique_ptr<Graph> Graph::CloneSubGraph(const size_t idx) {
   return cloned_sub_graph;
 }
 
+const std::unordered_set<ir::Node *> &Graph::OpNodesOfType(
+    const std::string &op_type) const {
+  if (FLAGS_convert_all_blocks) {
+    if (IsMainGraph()) {
+      return GetSubGraph(0)->OpNodesOfType(op_type);
+    }
+  }
+  static const std::unordered_set<ir::Node *> empty_nodes;
+  auto iter = op_nodes_by_type_.find(op_type);
+  return iter == op_nodes_by_type_.end() ? empty_nodes : iter->second;
+}
+
+void Graph::SyncOpTypeIndex() {
+  if (FLAGS_convert_all_blocks) {
+    if (IsMainGraph()) {
+      GetSubGraph(0)->SyncOpTypeIndex();
+      return;
+    }
+  }
+  std::vector<ir::Node *> retyped_nodes;
+  for (auto &item : indexed_op_types_) {
+    if (item.first->Op()->Type() != item.second) {
+      retyped_nodes.push_back(item.first);
+    }
+  }
+  for (auto *node : retyped_nodes) {
+    VLOG(4) << "re-index op node " << node->Name() << " from "
+            << indexed_op_types_.at(node) << " to " << node->Op()->Type();
+    UnindexOpNode(node);
+    IndexOpNode(node);
+  }
+}
+
+void Graph::IndexOpNode(ir::Node *node) {
+  // Empty op nodes have no OpDesc, no pattern can match them by type.
+  if (!node->IsOp() || node->Op() == nullptr) return;
+  const std::string &op_type = node->Op()->Type();
+  op_nodes_by_type_[op_type].insert(node);
+  indexed_op_types_[node] = op_type;
+}
+
+void Graph::UnindexOpNode(ir::Node *node) {
+  auto iter = indexed_op_types_.find(node);
+  if (iter == indexed_op_types_.end()) return;
+  auto type_iter = op_nodes_by_type_.find(iter->second);
+  type_iter->second.erase(node);
+  if (type_iter->second.empty()) {
+    op_nodes_by_type_.erase(type_iter);
+  }
+  indexed_op_types_.erase(iter);
+}
+
 bool IsControlDepVar(const ir::Node &var) {
   return var.Name().find(ir::Node::kControlDepVarName) != std::string::npos;
 }
@@ -18,6 +18,7 @@ limitations under the License. */
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -293,6 +294,8 @@ class Graph {
     }
     nodes_.clear();
     node_set_.clear();
+    op_nodes_by_type_.clear();
+    indexed_op_types_.clear();
     return ret;
   }
 
@@ -309,6 +312,7 @@ class Graph {
     ret.reset(nodes_.at(node).release());
     nodes_.erase(node);
     node_set_.erase(node);
+    UnindexOpNode(node);
     return ret;
   }
 
@@ -352,9 +356,20 @@ class Graph {
                           "The node to be added already exists."));
     nodes_[node].reset(node);
     node_set_.insert(node);
+    IndexOpNode(node);
     return node;
   }
 
+  // Returns the op nodes of op_type, which are indexed when they are added,
+  // so that passes can find their candidates without scanning all nodes.
+  // NOTE: an op retyped by OpDesc::SetType is still indexed with its old
+  // type until SyncOpTypeIndex() is called.
+  const std::unordered_set<ir::Node *> &OpNodesOfType(
+      const std::string &op_type) const;
+
+  // Re-index the op nodes whose type changed after they were added.
+  void SyncOpTypeIndex();
+
   void ResolveHazard(
       const std::map<std::string, std::vector<ir::Node *>> &var_nodes);
 
@@ -390,6 +405,38 @@ class Graph {
     return sub_graphs_.size();
   }
 
+  // Create a duplicated graph of the sub_graph idx, without its attributes.
+  std::unique_ptr<Graph> CloneSubGraph(const size_t idx);
+
+  // Replace the sub_graph idx, e.g. with a clone made before it was changed.
+  // The attrs cannot be cloned, so those of the replaced sub_graph are moved
+  // to the new one unless it has them. The sub_graphs with the other indices
+  // are not touched, so the sub_graphs can be replaced concurrently.
+  void ReplaceSubGraph(const size_t idx, std::unique_ptr<Graph> sub_graph) {
+    PADDLE_ENFORCE_EQ(
+        this->IsMainGraph(), true,
+        platform::errors::InvalidArgument("This graph is not main_graph"));
+    PADDLE_ENFORCE_LT(
+        idx, this->sub_graphs_.size(),
+        platform::errors::InvalidArgument("Invalid sub_graph index"));
+    PADDLE_ENFORCE_EQ(idx, static_cast<size_t>(sub_graph->block_id_),
+                      platform::errors::InvalidArgument(
+                          "sub_graph idx is not equal to block_id_"));
+    auto &replaced = sub_graphs_[idx];
+    for (auto &attr : replaced->attrs_) {
+      if (sub_graph->attrs_.count(attr.first) == 0) {
+        sub_graph->attrs_[attr.first] = attr.second;
+        sub_graph->attr_dels_[attr.first] =
+            std::move(replaced->attr_dels_[attr.first]);
+      } else {
+        replaced->attr_dels_[attr.first]();
+      }
+    }
+    replaced->attrs_.clear();
+    replaced->attr_dels_.clear();
+    sub_graphs_[idx] = std::move(sub_graph);
+  }
+
  private:
   // TODO(levi): delete this interface after when we can convert all
   // blocks into sub_graphs.
@@ -418,7 +465,8 @@ class Graph {
     sub_graphs_.push_back(std::move(sub_graph));
   }
 
-  std::unique_ptr<Graph> CloneSubGraph(const size_t idx);
+  void IndexOpNode(ir::Node *node);
+  void UnindexOpNode(ir::Node *node);
 
   // NOTE: program_ shouldn't be exposed to user.
   const ProgramDesc program_;
@@ -431,6 +479,11 @@ class Graph {
   std::map<std::string, std::function<void(void)>> attr_dels_;
   std::map<ir::Node *, std::unique_ptr<ir::Node>> nodes_;
   std::unordered_set<ir::Node *> node_set_;
+  // op type -> op nodes of the type, and op node -> the type it is indexed
+  // with, both are kept in sync with node_set_.
+  std::unordered_map<std::string, std::unordered_set<ir::Node *>>
+      op_nodes_by_type_;
+  std::unordered_map<ir::Node *, std::string> indexed_op_types_;
   size_t num_node_created_{0};  // help to generate a unique node id.
   // NOTE(Aurelius84): Whether is constructed with partial ProgramDesc.
   // In case of @to_static, whole trainning program is splited into two
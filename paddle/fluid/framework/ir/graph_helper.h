@@ -30,6 +30,10 @@ namespace ir {
 constexpr char kGraphToProgramVarsToRemove[] =
     "__graph_to_program_vars_to_remove__";
 constexpr char kGraphToProgramSortKind[] = "__graph_to_program_sort_kind__";
+// Set when the ops are reordered by rewriting their desc orders, the passes
+// depending on the op order should sort the ops by their desc orders then.
+constexpr char kGraphOpsScheduledByDescOrder[] =
+    "__graph_ops_scheduled_by_desc_order__";
 
 // Compare nodes via node id.
 class Graph;
@@ -26,7 +26,7 @@ namespace ir {
 using string::PrettyLog;
 using string::Style;
 
-size_t PDPattern::id_ = 0UL;
+std::atomic<size_t> PDPattern::id_{0UL};
 
 PDNode *PDPattern::NewNode(const std::string &name) {
   if (!name.empty()) {
@@ -77,6 +77,8 @@ void PDPattern::AddEdge(PDNode *a, PDNode *b) {
 
 void GraphPatternDetector::operator()(Graph *graph,
                                       GraphPatternDetector::handle_t handler) {
+  // The previous handlers may have retyped some ops.
+  graph->SyncOpTypeIndex();
   if (!MarkPDNodesInGraph(*graph)) {
     return;
   }
@@ -100,11 +102,45 @@ bool GraphPatternDetector::MarkPDNodesInGraph(const ir::Graph &graph) {
   VLOG(3) << "mark pdnodes in graph";
   if (graph.Nodes().empty()) return false;
 
-  for (auto &node : GraphTraits::DFS(graph)) {
-    for (const auto &pdnode : pattern_.nodes()) {
-      if (pdnode->Tell(&node)) {
-        VLOG(4) << "Node " << node.Name() << " marked as " << pdnode->name();
-        pdnodes2nodes_[pdnode.get()].insert(&node);
+  auto mark = [this](PDNode *pdnode, Node *node) {
+    if (pdnode->Tell(node)) {
+      VLOG(4) << "Node " << node->Name() << " marked as " << pdnode->name();
+      pdnodes2nodes_[pdnode].insert(node);
+    }
+  };
+
+  // The PDNodes restricted to some op types only test the nodes around the
+  // ops found by the op type index, which are usually a small part of graph.
+  std::vector<PDNode *> unrestricted_pdnodes;
+  for (const auto &pdnode : pattern_.nodes()) {
+    auto candidates = pdnode->candidates();
+    if (candidates == PDNode::Candidates::kAnyNode) {
+      unrestricted_pdnodes.push_back(pdnode.get());
+      continue;
+    }
+    std::unordered_set<Node *> tested;
+    for (auto &op_type : pdnode->candidate_op_types()) {
+      for (auto *op : graph.OpNodesOfType(op_type)) {
+        if (candidates == PDNode::Candidates::kOps) {
+          mark(pdnode.get(), op);
+          continue;
+        }
+        auto &vars = candidates == PDNode::Candidates::kOpsInputs
+                         ? op->inputs
+                         : op->outputs;
+        for (auto *var : vars) {
+          if (tested.insert(var).second) {
+            mark(pdnode.get(), var);
+          }
+        }
+      }
+    }
+  }
+
+  if (!unrestricted_pdnodes.empty()) {
+    for (auto &node : GraphTraits::DFS(graph)) {
+      for (auto *pdnode : unrestricted_pdnodes) {
+        mark(pdnode, &node);
       }
     }
   }
@@ -402,6 +438,7 @@ PDNode *PDNode::assert_is_op() {
 }
 
 PDNode *PDNode::assert_is_op(const std::string &op_type) {
+  RestrictCandidates(Candidates::kOps, {op_type});
   asserts_.emplace_back([op_type](Node *x) {
     return x && x->IsOp() && x->Op()->Type() == op_type;
   });
@@ -454,6 +491,7 @@ PDNode *PDNode::assert_is_op_nth_input(const std::string &op_type,
 
 PDNode *PDNode::assert_is_op_nth_output(const std::string &op_type,
                                         const std::string &argument, int nth) {
+  RestrictCandidates(Candidates::kOpsOutputs, {op_type});
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
@@ -467,6 +505,7 @@ PDNode *PDNode::assert_is_op_nth_output(const std::string &op_type,
 }
 
 PDNode *PDNode::assert_is_only_input_of_op(const std::string &op_type) {
+  RestrictCandidates(Candidates::kOpsInputs, {op_type});
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
@@ -481,6 +520,7 @@ PDNode *PDNode::assert_is_only_input_of_op(const std::string &op_type) {
 }
 
 PDNode *PDNode::assert_is_only_output_of_op(const std::string &op_type) {
+  RestrictCandidates(Candidates::kOpsOutputs, {op_type});
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
@@ -495,6 +535,7 @@ PDNode *PDNode::assert_is_only_output_of_op(const std::string &op_type) {
 }
 
 PDNode *PDNode::assert_is_op_output(const std::string &op_type) {
+  RestrictCandidates(Candidates::kOpsOutputs, {op_type});
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
@@ -515,6 +556,7 @@ PDNode *PDNode::assert_is_op_output(const std::string &op_type,
 }
 
 PDNode *PDNode::assert_is_op_input(const std::string &op_type) {
+  RestrictCandidates(Candidates::kOpsInputs, {op_type});
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
@@ -572,6 +614,7 @@ PDNode *PDNode::assert_more(PDNode::teller_t &&teller) {
 }
 
 PDNode *PDNode::assert_is_ops(const std::unordered_set<std::string> &op_types) {
+  RestrictCandidates(Candidates::kOps, op_types);
   asserts_.emplace_back([op_types](Node *x) {
     return x && x->IsOp() && op_types.count(x->Op()->Type());
   });
@@ -597,6 +640,7 @@ PDNode *PDNode::assert_is_ops_nth_input(
 PDNode *PDNode::assert_is_ops_nth_output(
     const std::unordered_set<std::string> &op_types,
     const std::string &argument, int nth) {
+  RestrictCandidates(Candidates::kOpsOutputs, op_types);
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
@@ -610,6 +654,7 @@ PDNode *PDNode::assert_is_ops_nth_output(
 }
 PDNode *PDNode::assert_is_ops_output(
     const std::unordered_set<std::string> &op_types) {
+  RestrictCandidates(Candidates::kOpsOutputs, op_types);
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
@@ -632,6 +677,7 @@ PDNode *PDNode::assert_is_ops_output(
 
 PDNode *PDNode::assert_is_ops_input(
     const std::unordered_set<std::string> &op_types) {
+  RestrictCandidates(Candidates::kOpsInputs, op_types);
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
@@ -654,6 +700,7 @@ PDNode *PDNode::assert_is_ops_input(
 
 PDNode *PDNode::assert_is_only_input_of_ops(
     const std::unordered_set<std::string> &op_types) {
+  RestrictCandidates(Candidates::kOpsInputs, op_types);
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->outputs) {
@@ -669,6 +716,7 @@ PDNode *PDNode::assert_is_only_input_of_ops(
 
 PDNode *PDNode::assert_is_only_output_of_ops(
     const std::unordered_set<std::string> &op_types) {
+  RestrictCandidates(Candidates::kOpsOutputs, op_types);
   assert_is_var();
   asserts_.emplace_back([=](Node *x) {
     for (auto *op : x->inputs) {
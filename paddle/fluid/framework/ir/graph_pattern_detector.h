@@ -18,8 +18,10 @@
 #include <gtest/gtest_prod.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <set>
 #include <string>
@@ -80,6 +82,23 @@ struct PDNode {
   bool IsOp() const { return type_ == Type::kOp; }
   bool IsVar() const { return type_ == Type::kVar; }
 
+  // Where the ir::Nodes which may be told true are, it is recorded by the
+  // assertions on op types, so that GraphPatternDetector can start from the
+  // op type index of the graph instead of testing every node.
+  enum class Candidates {
+    kAnyNode,     // no restriction, all the nodes should be tested,
+    kOps,         // the op nodes of candidate_op_types(),
+    kOpsInputs,   // the inputs of the op nodes of candidate_op_types(),
+    kOpsOutputs,  // the outputs of the op nodes of candidate_op_types().
+  };
+  Candidates candidates() const {
+    // A user defined teller may accept any node.
+    return teller_ ? Candidates::kAnyNode : candidates_;
+  }
+  const std::unordered_set<std::string>& candidate_op_types() const {
+    return candidate_op_types_;
+  }
+
   const std::string& name() const { return name_; }
 
   PDNode& operator=(const PDNode&) = delete;
@@ -179,6 +198,14 @@ struct PDNode {
 
   PDNode(PDNode&& other) = default;
 
+  // All the assertions must hold, so the first restriction is kept.
+  void RestrictCandidates(Candidates candidates,
+                          const std::unordered_set<std::string>& op_types) {
+    if (candidates_ != Candidates::kAnyNode) return;
+    candidates_ = candidates;
+    candidate_op_types_ = op_types;
+  }
+
   friend class PDPattern;
 
   // Will removed latter.
@@ -188,6 +215,8 @@ struct PDNode {
   std::string name_;
   Type type_;
   Role role_{Role::kUnknown};
+  Candidates candidates_{Candidates::kAnyNode};
+  std::unordered_set<std::string> candidate_op_types_;
 };
 
 /*
@@ -246,7 +275,7 @@ class PDPattern {
   std::vector<std::unique_ptr<PDNode>> nodes_;
   std::vector<edge_t> edges_;
   std::map<std::string, PDNode*> node_map_;
-  static size_t id_;
+  static std::atomic<size_t> id_;
 };
 
 /*
@@ -315,6 +344,7 @@ class GraphPatternDetector {
 #ifdef PADDLE_WITH_TESTING
   FRIEND_TEST(GraphPatternDetecter, MarkPDNodesInGraph);
   FRIEND_TEST(GraphPatternDetecter, DetectPatterns);
+  FRIEND_TEST(GraphPatternDetecter, MarkWithOpTypeIndex);
 #endif
 
  private:
@@ -359,10 +389,15 @@ struct KeyCounter {
     return x;
   }
 
-  int IncCounter(const std::string& key) { return dic_[key]++; }
+  int IncCounter(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dic_[key]++;
+  }
 
  private:
   std::unordered_map<std::string, size_t> dic_;
+  // The passes may run on the graphs of different blocks concurrently.
+  std::mutex mutex_;
 };
 
 // Generate a unique PDNode's name with name_scope and id.
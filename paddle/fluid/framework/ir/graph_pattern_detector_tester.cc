@@ -14,6 +14,8 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>  // NOLINT
+
 #include "paddle/fluid/framework/ir/graph_pattern_detector.h"
 
 namespace paddle {
@@ -203,6 +205,119 @@ TEST(GraphPatternDetector, IntermediateCheck) {
   ASSERT_EQ(count, 1);
 }
 
+
+// A transformer-like program, each layer has 6 fc (mul + elementwise_add
+// + an optional activation) and some other ops which never match.
+void BuildTransformerLikeProgram(ProgramDesc* program, int num_layers) {
+  auto* block = program->MutableBlock(0);
+  auto append_op = [block](const std::string& type,
+                           const std::vector<std::string>& inputs,
+                           const std::string& output) {
+    auto* op = block->AppendOp();
+    op->SetType(type);
+    op->SetInput("X", {inputs[0]});
+    if (inputs.size() > 1) {
+      op->SetInput("Y", {inputs[1]});
+    }
+    op->SetOutput("Out", {output});
+    for (auto& name : inputs) block->Var(name);
+    block->Var(output);
+  };
+  std::string x = "x";
+  for (int i = 0; i < num_layers; ++i) {
+    std::string prefix = "layer" + std::to_string(i) + "_";
+    std::vector<std::string> qkv;
+    for (auto name : {"q", "k", "v", "o", "ffn0", "ffn1"}) {
+      std::string fc = prefix + name;
+      std::string in = qkv.size() < 3 ? x : qkv.back();
+      append_op("mul", {in, fc + "_w"}, fc + "_mul");
+      append_op("elementwise_add", {fc + "_mul", fc + "_b"}, fc + "_add");
+      if (std::string(name) == "ffn0") {
+        append_op("gelu", {fc + "_add"}, fc + "_out");
+        qkv.push_back(fc + "_out");
+      } else {
+        qkv.push_back(fc + "_add");
+      }
+      if (qkv.size() == 3) {
+        append_op("matmul", {qkv[0], qkv[1]}, prefix + "qk");
+        append_op("scale", {prefix + "qk"}, prefix + "qk_scale");
+        append_op("softmax", {prefix + "qk_scale"}, prefix + "prob");
+        append_op("dropout", {prefix + "prob"}, prefix + "prob_drop");
+        append_op("matmul", {prefix + "prob_drop", qkv[2]}, prefix + "ctx");
+        qkv.push_back(prefix + "ctx");
+      }
+    }
+    append_op("elementwise_add", {x, qkv.back()}, prefix + "res");
+    append_op("layer_norm", {prefix + "res"}, prefix + "out");
+    x = prefix + "out";
+  }
+}
+
+TEST(GraphPatternDetecter, MarkWithOpTypeIndex) {
+  const int num_layers = 24;
+  ProgramDesc program;
+  BuildTransformerLikeProgram(&program, num_layers);
+  Graph graph(program);
+
+  GraphPatternDetector x;
+  auto* pattern = x.mutable_pattern();
+  auto* mul = pattern->NewNode("mul")->assert_is_op("mul");
+  auto* mul_w = pattern->NewNode("mul_w")->assert_is_op_input("mul", "Y");
+  auto* mul_out = pattern->NewNode("mul_out")
+                      ->assert_is_op_output("mul")
+                      ->assert_is_op_input("elementwise_add")
+                      ->AsIntermediate();
+  auto* add = pattern->NewNode("add")->assert_is_ops({"elementwise_add"});
+  auto* add_out = pattern->NewNode("add_out")
+                      ->assert_is_ops_output({"elementwise_add"})
+                      ->assert_is_only_input_of_op("gelu")
+                      ->AsIntermediate();
+  auto* act = pattern->NewNode("act")->assert_is_op("gelu");
+  // Not restricted by op type, all the nodes are tested.
+  auto* act_out = pattern->NewNode("act_out")->assert_is_var();
+  for (auto& pdnode : pattern->nodes()) {
+    ASSERT_EQ(pdnode->candidates() == PDNode::Candidates::kAnyNode,
+              pdnode.get() == act_out);
+  }
+  mul->LinksFrom({mul_w}).LinksTo({mul_out});
+  add->LinksFrom({mul_out}).LinksTo({add_out});
+  act->LinksFrom({add_out}).LinksTo({act_out});
+
+  // The marked nodes are the same as testing every node.
+  auto start = std::chrono::steady_clock::now();
+  std::map<const PDNode*, std::set<Node*>> expected;
+  for (auto* node : graph.Nodes()) {
+    for (auto& pdnode : pattern->nodes()) {
+      if (pdnode->Tell(node)) expected[pdnode.get()].insert(node);
+    }
+  }
+  auto scan_end = std::chrono::steady_clock::now();
+  ASSERT_TRUE(x.MarkPDNodesInGraph(graph));
+  auto mark_end = std::chrono::steady_clock::now();
+  ASSERT_EQ(x.pdnodes2nodes_, expected);
+  ASSERT_EQ(x.pdnodes2nodes_.at(mul).size(), 6UL * num_layers);
+  ASSERT_EQ(x.pdnodes2nodes_.at(act).size(), 1UL * num_layers);
+  LOG(INFO) << graph.Nodes().size() << " nodes, full scan: "
+            << std::chrono::duration<double, std::milli>(scan_end - start)
+                   .count()
+            << " ms, with op type index: "
+            << std::chrono::duration<double, std::milli>(mark_end - scan_end)
+                   .count()
+            << " ms";
+
+  // Detection still follows the ops retyped by previous handlers.
+  for (auto* op : graph.OpNodesOfType("gelu")) {
+    op->Op()->SetType("relu");
+  }
+  int count = 0;
+  GraphPatternDetector y;
+  y.mutable_pattern()->NewNode("act")->assert_is_op("relu");
+  y(&graph, [&](const GraphPatternDetector::subgraph_t& s, Graph* g) {
+    ++count;
+  });
+  ASSERT_EQ(count, num_layers);
+}
+
 }  // namespace ir
 }  // namespace framework
 }  // namespace paddle
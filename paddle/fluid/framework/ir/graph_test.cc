@@ -436,9 +436,71 @@ TEST(GraphTest, TestMultiBlock) {
   ASSERT_EQ(clone_g->IsMainGraph(), true);
   ASSERT_EQ(clone_g->SubGraphsSize(), 3UL);
 
+  // Step4: Replace sub_graph_1 with its clone, which keeps the desc orders
+  // and takes over the attrs.
+  g->GetSubGraph(1)->Set("test_attr", new int(1));
+  std::map<std::string, int> desc_orders;
+  for (ir::Node *n : g->GetSubGraph(1)->Nodes()) {
+    if (n->IsOp()) {
+      desc_orders[n->Name()] = n->DescOrder();
+    }
+  }
+  g->ReplaceSubGraph(1, g->CloneSubGraph(1));
+  ASSERT_TRUE(g->GetSubGraph(1)->Has("test_attr"));
+  ASSERT_EQ(g->GetSubGraph(1)->Get<int>("test_attr"), 1);
+  for (ir::Node *n : g->GetSubGraph(1)->Nodes()) {
+    if (n->IsOp()) {
+      ASSERT_EQ(n->DescOrder(), desc_orders[n->Name()]);
+    }
+  }
+
   // Recover FLAGS_convert_all_blocks.
   FLAGS_convert_all_blocks = flag_temp;
 }
 
+TEST(GraphTest, TestOpTypeIndex) {
+  ProgramDesc prog;
+  for (auto type : {"sum", "dummy", "sum"}) {
+    auto *op = prog.MutableBlock(0)->AppendOp();
+    op->SetType(type);
+    op->SetInput("X", {"test_a"});
+    op->SetOutput("Out", {std::string("test_out_") + type});
+  }
+  prog.MutableBlock(0)->Var("test_a");
+  prog.MutableBlock(0)->Var("test_out_sum");
+  prog.MutableBlock(0)->Var("test_out_dummy");
+
+  ir::Graph g(prog);
+  ASSERT_EQ(g.OpNodesOfType("sum").size(), 2UL);
+  ASSERT_EQ(g.OpNodesOfType("dummy").size(), 1UL);
+  ASSERT_EQ(g.OpNodesOfType("not_exist").size(), 0UL);
+
+  // Removed nodes are no longer indexed.
+  ir::Node *dummy = *g.OpNodesOfType("dummy").begin();
+  g.RemoveNode(dummy);
+  ASSERT_EQ(g.OpNodesOfType("dummy").size(), 0UL);
+
+  // Retyped op nodes are re-indexed by SyncOpTypeIndex.
+  ir::Node *sum = *g.OpNodesOfType("sum").begin();
+  sum->Op()->SetType("dummy");
+  ASSERT_EQ(g.OpNodesOfType("sum").size(), 2UL);
+  g.SyncOpTypeIndex();
+  ASSERT_EQ(g.OpNodesOfType("sum").size(), 1UL);
+  ASSERT_EQ(g.OpNodesOfType("dummy").size(), 1UL);
+  ASSERT_EQ(*g.OpNodesOfType("dummy").begin(), sum);
+
+  // Added, cloned and empty op nodes.
+  ir::Node *added = g.CreateOpNode(prog.MutableBlock(0)->AppendOp());
+  ASSERT_EQ(g.OpNodesOfType(added->Op()->Type()).count(added), 1UL);
+  g.CreateEmptyNode("empty_op", ir::Node::Type::kOperation);
+  ASSERT_EQ(g.OpNodesOfType("empty_op").size(), 0UL);
+  auto cloned = g.Clone();
+  ASSERT_EQ(cloned->OpNodesOfType("sum").size(), 1UL);
+  ASSERT_EQ(cloned->OpNodesOfType("dummy").size(), 1UL);
+
+  g.ReleaseNodes();
+  ASSERT_EQ(g.OpNodesOfType("sum").size(), 0UL);
+}
+
 }  // namespace framework
 }  // namespace paddle
@@ -0,0 +1,211 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/memory_optimize_pass/memory_schedule_pass.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "paddle/fluid/framework/data_type.h"
+#include "paddle/fluid/framework/ir/graph.h"
+#include "paddle/fluid/framework/ir/graph_helper.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+static int64_t SizeOfVar(const MemorySchedulePass::VarSizeMap &var_sizes,
+                         Node *var) {
+  auto iter = var_sizes.find(var);
+  return iter == var_sizes.end() ? 0 : iter->second;
+}
+
+// The number of reads of each tensor by ops.
+static std::unordered_map<Node *, int> CountReads(
+    const std::vector<Node *> &ops) {
+  std::unordered_map<Node *, int> reads;
+  for (auto *op : ops) {
+    for (auto *in : op->inputs) {
+      ++reads[in];
+    }
+  }
+  return reads;
+}
+
+int64_t MemorySchedulePass::PeakMemory(const std::vector<Node *> &ops,
+                                       const VarSizeMap &var_sizes) {
+  auto remaining_reads = CountReads(ops);
+  std::unordered_set<Node *> written_vars;
+  for (auto *op : ops) {
+    written_vars.insert(op->outputs.begin(), op->outputs.end());
+  }
+  // The tensors not written by any op, e.g. those set by users before
+  // running, are alive from the beginning.
+  int64_t live = 0;
+  for (auto &item : remaining_reads) {
+    if (!written_vars.count(item.first)) {
+      live += SizeOfVar(var_sizes, item.first);
+    }
+  }
+
+  int64_t peak = live;
+  for (auto *op : ops) {
+    for (auto *out : op->outputs) {
+      live += SizeOfVar(var_sizes, out);
+    }
+    peak = std::max(peak, live);
+    for (auto *in : op->inputs) {
+      if (--remaining_reads[in] == 0) {
+        live -= SizeOfVar(var_sizes, in);
+      }
+    }
+    for (auto *out : op->outputs) {
+      if (!remaining_reads.count(out)) {
+        live -= SizeOfVar(var_sizes, out);
+      }
+    }
+  }
+  return peak;
+}
+
+MemorySchedulePass::VarSizeMap MemorySchedulePass::CollectVarSizes(
+    const Graph &graph) const {
+  VarSizeMap var_sizes;
+  for (auto *node : graph.Nodes()) {
+    if (!node->IsVar() || node->Var() == nullptr) continue;
+    auto *var = node->Var();
+    if (var->Persistable() || var->GetType() != proto::VarType::LOD_TENSOR) {
+      continue;
+    }
+    int64_t numel = 1;
+    for (auto dim : var->GetShape()) {
+      numel *= dim < 0 ? 1 : dim;
+    }
+    var_sizes[node] =
+        numel * static_cast<int64_t>(SizeOfType(var->GetDataType()));
+  }
+  return var_sizes;
+}
+
+std::vector<Node *> MemorySchedulePass::Schedule(
+    const std::vector<Node *> &ops, const VarSizeMap &var_sizes) const {
+  std::unordered_map<Node *, size_t> positions;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    positions[ops[i]] = i;
+  }
+  std::unordered_map<Node *, std::unordered_set<Node *>> successors;
+  std::unordered_map<Node *, size_t> num_pending_preds;
+  for (auto *op : ops) {
+    for (auto *in : op->inputs) {
+      for (auto *pred : in->inputs) {
+        if (positions.count(pred) && successors[pred].insert(op).second) {
+          ++num_pending_preds[op];
+        }
+      }
+    }
+  }
+
+  auto remaining_reads = CountReads(ops);
+  // The bytes allocated by running op minus the bytes released after it.
+  auto memory_delta = [&](Node *op) {
+    int64_t delta = 0;
+    for (auto *out : op->outputs) {
+      delta += SizeOfVar(var_sizes, out);
+    }
+    std::unordered_map<Node *, int> reads;
+    for (auto *in : op->inputs) {
+      ++reads[in];
+    }
+    for (auto &item : reads) {
+      if (remaining_reads.at(item.first) == item.second) {
+        delta -= SizeOfVar(var_sizes, item.first);
+      }
+    }
+    return delta;
+  };
+
+  std::vector<Node *> ready_ops;
+  for (auto *op : ops) {
+    if (!num_pending_preds.count(op)) {
+      ready_ops.push_back(op);
+    }
+  }
+  std::vector<Node *> scheduled_ops;
+  scheduled_ops.reserve(ops.size());
+  while (!ready_ops.empty()) {
+    size_t best = 0;
+    int64_t best_delta = memory_delta(ready_ops[0]);
+    for (size_t i = 1; i < ready_ops.size(); ++i) {
+      int64_t delta = memory_delta(ready_ops[i]);
+      if (delta < best_delta ||
+          (delta == best_delta &&
+           positions.at(ready_ops[i]) < positions.at(ready_ops[best]))) {
+        best = i;
+        best_delta = delta;
+      }
+    }
+    Node *op = ready_ops[best];
+    ready_ops.erase(ready_ops.begin() + best);
+    scheduled_ops.push_back(op);
+
+    for (auto *in : op->inputs) {
+      --remaining_reads.at(in);
+    }
+    for (auto *succ : successors[op]) {
+      if (--num_pending_preds.at(succ) == 0) {
+        ready_ops.push_back(succ);
+      }
+    }
+  }
+  PADDLE_ENFORCE_EQ(scheduled_ops.size(), ops.size(),
+                    platform::errors::PreconditionNotMet(
+                        "The graph to schedule should not contain cycle."));
+  return scheduled_ops;
+}
+
+void MemorySchedulePass::ApplyImpl(Graph *graph) const {
+  // Without converting all blocks, GraphToProgram sorts the ops by their
+  // ids instead of their desc orders, so the schedule would be dropped.
+  if (!FLAGS_convert_all_blocks) {
+    VLOG(3) << "Skip memory_schedule_pass when convert_all_blocks is off.";
+    return;
+  }
+  auto ops = TopologySortGraphByDescOrder(*graph);
+  auto var_sizes = CollectVarSizes(*graph);
+  int64_t peak = PeakMemory(ops, var_sizes);
+  auto scheduled_ops = Schedule(ops, var_sizes);
+  int64_t scheduled_peak = PeakMemory(scheduled_ops, var_sizes);
+
+  const double MB = 1024.0 * 1024.0;
+  if (scheduled_peak >= peak) {
+    VLOG(3) << "Keep the op order, its estimated peak memory is "
+            << peak / MB << " MB.";
+    return;
+  }
+  for (size_t i = 0; i < scheduled_ops.size(); ++i) {
+    scheduled_ops[i]->SetDescOrder(static_cast<int>(i));
+  }
+  if (!graph->Has(kGraphOpsScheduledByDescOrder)) {
+    graph->Set(kGraphOpsScheduledByDescOrder, new bool(true));
+  }
+  LOG(INFO) << "Reorder " << scheduled_ops.size()
+            << " ops, the estimated peak memory is reduced from "
+            << peak / MB << " MB to " << scheduled_peak / MB << " MB.";
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(memory_schedule_pass, paddle::framework::ir::MemorySchedulePass);
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/framework/ir/pass.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+class Graph;
+class Node;
+
+/*
+ * MemorySchedulePass reorders the independent ops of a graph to lower the
+ * peak bytes of the live non-persistable tensors, before the memory reuse
+ * passes make their plans for a fixed op order.
+ *
+ * The size of a tensor is inferred from its VarDesc, where the unknown
+ * dimensions are taken as 1 (the batch size of the estimation). A tensor
+ * is alive from the op writing it to the last op reading it. The ops are
+ * list scheduled: among the ops whose inputs are all ready, the one which
+ * allocates the fewest bytes minus the bytes it releases goes first, and
+ * ties are broken by the original order.
+ *
+ * The new order is written to the desc order of the op nodes, which
+ * GraphToProgram follows, and only when the estimated peak is lower than
+ * the one of the original order. The graph is marked with
+ * kGraphOpsScheduledByDescOrder then.
+ */
+class MemorySchedulePass : public Pass {
+ public:
+  using VarSizeMap = std::unordered_map<Node *, int64_t>;
+
+  // Returns the estimated peak bytes when ops run in the order of ops.
+  static int64_t PeakMemory(const std::vector<Node *> &ops,
+                            const VarSizeMap &var_sizes);
+
+ protected:
+  void ApplyImpl(Graph *graph) const override;
+
+ private:
+  VarSizeMap CollectVarSizes(const Graph &graph) const;
+
+  std::vector<Node *> Schedule(const std::vector<Node *> &ops,
+                               const VarSizeMap &var_sizes) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
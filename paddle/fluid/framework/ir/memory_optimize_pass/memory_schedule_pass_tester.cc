@@ -0,0 +1,123 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/memory_optimize_pass/memory_schedule_pass.h"
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/ir/graph_helper.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+void SetOp(ProgramDesc* prog, const std::string& type,
+           const std::vector<std::string>& inputs, const std::string& output) {
+  auto* op = prog->MutableBlock(0)->AppendOp();
+  op->SetType(type);
+  op->SetInput("X", inputs);
+  op->SetOutput("Out", {output});
+}
+
+void SetVar(ProgramDesc* prog, const std::string& name, int64_t width) {
+  auto* var = prog->MutableBlock(0)->Var(name);
+  var->SetType(proto::VarType::LOD_TENSOR);
+  var->SetDataType(proto::VarType::FP32);
+  var->SetShape({-1, width});
+}
+
+std::vector<std::string> OpOutputs(const Graph& graph) {
+  std::vector<std::string> outputs;
+  for (auto* op : TopologySortGraphByDescOrder(graph)) {
+    outputs.push_back(op->Op()->Output("Out")[0]);
+  }
+  return outputs;
+}
+
+// Both branches of x are expanded before either is reduced:
+//   x -> relu -> a1 -> reduce_sum -> a2
+//   x -> relu -> b1 -> reduce_sum -> b2
+//   (a2, b2) -> elementwise_add -> out
+ProgramDesc BuildBranchProgram() {
+  ProgramDesc prog;
+  for (auto name : {"x", "a1", "b1"}) SetVar(&prog, name, 1000);
+  for (auto name : {"a2", "b2", "out"}) SetVar(&prog, name, 1);
+  SetOp(&prog, "relu", {"x"}, "a1");
+  SetOp(&prog, "relu", {"x"}, "b1");
+  SetOp(&prog, "reduce_sum", {"a1"}, "a2");
+  SetOp(&prog, "reduce_sum", {"b1"}, "b2");
+  SetOp(&prog, "elementwise_add", {"a2", "b2"}, "out");
+  return prog;
+}
+
+TEST(MemorySchedulePass, reorder_branches) {
+  ProgramDesc prog = BuildBranchProgram();
+  std::unique_ptr<Graph> graph(new Graph(prog));
+  ASSERT_EQ(OpOutputs(*graph),
+            std::vector<std::string>({"a1", "b1", "a2", "b2", "out"}));
+
+  auto pass = PassRegistry::Instance().Get("memory_schedule_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // a1 is reduced before b1 is computed, so they are never alive together.
+  ASSERT_EQ(OpOutputs(*graph),
+            std::vector<std::string>({"a1", "a2", "b1", "b2", "out"}));
+  ASSERT_TRUE(graph->Has(kGraphOpsScheduledByDescOrder));
+}
+
+TEST(MemorySchedulePass, keep_order_of_chain) {
+  ProgramDesc prog;
+  for (auto name : {"x", "a", "b", "c"}) SetVar(&prog, name, 1000);
+  SetOp(&prog, "relu", {"x"}, "a");
+  SetOp(&prog, "relu", {"a"}, "b");
+  SetOp(&prog, "relu", {"b"}, "c");
+  std::unique_ptr<Graph> graph(new Graph(prog));
+
+  auto pass = PassRegistry::Instance().Get("memory_schedule_pass");
+  graph.reset(pass->Apply(graph.release()));
+  ASSERT_EQ(OpOutputs(*graph), std::vector<std::string>({"a", "b", "c"}));
+  ASSERT_FALSE(graph->Has(kGraphOpsScheduledByDescOrder));
+}
+
+TEST(MemorySchedulePass, peak_memory) {
+  ProgramDesc prog = BuildBranchProgram();
+  Graph graph(prog);
+  MemorySchedulePass::VarSizeMap var_sizes;
+  std::unordered_map<std::string, Node*> ops;
+  for (auto* node : graph.Nodes()) {
+    if (node->IsVar()) {
+      var_sizes[node] = node->Name().size() == 1 || node->Name()[1] == '1'
+                            ? 4000
+                            : 4;
+    } else {
+      ops[node->Op()->Output("Out")[0]] = node;
+    }
+  }
+  // x, a1 and b1 are alive when running the second relu.
+  ASSERT_EQ(MemorySchedulePass::PeakMemory(
+                {ops["a1"], ops["b1"], ops["a2"], ops["b2"], ops["out"]},
+                var_sizes),
+            12000);
+  // x and one of a1, b1, a2 and b2 are alive at most.
+  ASSERT_EQ(MemorySchedulePass::PeakMemory(
+                {ops["a1"], ops["a2"], ops["b1"], ops["b2"], ops["out"]},
+                var_sizes),
+            8004);
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(memory_schedule_pass);
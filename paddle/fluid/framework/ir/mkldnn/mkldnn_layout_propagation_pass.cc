@@ -0,0 +1,254 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/mkldnn/mkldnn_layout_propagation_pass.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "paddle/fluid/framework/data_layout.h"
+#include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/graph_pattern_detector.h"
+#include "paddle/fluid/framework/operator.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+namespace {
+
+// The MKL-DNN kernels of these ops are not faster than the native ones, and
+// they do not change the data in a layout specific way.
+const std::unordered_set<std::string> kLayoutAgnosticOps = {
+    // activations
+    "relu", "relu6", "leaky_relu", "sigmoid", "tanh", "gelu", "swish",
+    "hard_swish", "scale", "clip",
+    // elementwise
+    "elementwise_add", "elementwise_sub", "elementwise_mul", "elementwise_div",
+    // shape and data movement
+    "reshape2", "squeeze2", "unsqueeze2", "flatten2", "concat", "split",
+    "slice", "stack", "shape"};
+
+bool IsTensor(const Node* node) {
+  return node->IsVar() && node->Var() != nullptr &&
+         node->Var()->GetType() == proto::VarType::LOD_TENSOR &&
+         !node->Var()->Persistable();
+}
+
+// Whether the op has an MKL-DNN kernel, of any data type if data_type is
+// not given.
+bool HasMKLDNNKernel(const std::string& op_type,
+                     const proto::VarType::Type* data_type = nullptr) {
+  auto& all_kernels = OperatorWithKernel::AllOpKernels();
+  auto it = all_kernels.find(op_type);
+  if (it == all_kernels.end()) {
+    return false;
+  }
+  return std::any_of(
+      it->second.begin(), it->second.end(),
+      [data_type](OpKernelMap::const_reference kernel_pair) {
+        return platform::is_cpu_place(kernel_pair.first.place_) &&
+               kernel_pair.first.library_type_ == LibraryType::kMKLDNN &&
+               (data_type == nullptr ||
+                kernel_pair.first.data_type_ == *data_type);
+      });
+}
+
+// Whether the native op can read the plain copy of var instead of var.
+bool CanReadPlainCopy(const Node* op, const Node* var) {
+  auto* op_desc = op->Op();
+  if (op_desc->Type() == "feed" || op_desc->Type() == "fetch" ||
+      op_desc->Type() == "transfer_layout") {
+    return false;
+  }
+  // The ops with sub-blocks may read var inside the sub-blocks.
+  for (auto& attr : op_desc->GetAttrMap()) {
+    auto type = op_desc->GetAttrType(attr.first);
+    if (type == proto::AttrType::BLOCK || type == proto::AttrType::BLOCKS) {
+      return false;
+    }
+  }
+  // The in-place ops write var.
+  return std::find(op->outputs.begin(), op->outputs.end(), var) ==
+         op->outputs.end();
+}
+
+}  // namespace
+
+bool MKLDNNLayoutPropagationPass::RunsOnMKLDNN(const Node* op) const {
+  return op->IsOp() && op->Op() != nullptr &&
+         op->Op()->GetAttrIfExists<bool>("use_mkldnn") &&
+         HasMKLDNNKernel(op->Op()->Type());
+}
+
+bool MKLDNNLayoutPropagationPass::OutputsMKLDNNLayout(const Node* op,
+                                                      const Node* var) const {
+  if (!RunsOnMKLDNN(op)) {
+    return false;
+  }
+  // The op falls back to the native kernel at runtime for the data types
+  // without an MKL-DNN kernel, e.g. the reshape2 of int64 ids, whose output
+  // is plain already.
+  auto data_type = var->Var()->GetDataType();
+  return HasMKLDNNKernel(op->Op()->Type(), &data_type);
+}
+
+bool MKLDNNLayoutPropagationPass::IsLayoutAgnostic(const Node* op) const {
+  auto* op_desc = op->Op();
+  if (kLayoutAgnosticOps.count(op_desc->Type()) == 0) {
+    return false;
+  }
+  // The ops quantized or fused by the MKL-DNN passes need the MKL-DNN
+  // kernels.
+  auto data_type = op_desc->GetAttrIfExists<std::string>("mkldnn_data_type");
+  if (!data_type.empty() && data_type != "float32") {
+    return false;
+  }
+  for (auto& name :
+       {"fuse_activation", "fuse_activation_type", "activation_type"}) {
+    if (!op_desc->GetAttrIfExists<std::string>(name).empty()) {
+      return false;
+    }
+  }
+  for (auto& name :
+       {"fuse_relu", "fuse_residual_connection", "force_fp32_output"}) {
+    if (op_desc->GetAttrIfExists<bool>(name)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int MKLDNNLayoutPropagationPass::PropagatePlainLayout(ir::Graph* graph) const {
+  auto ops = TopologySortOperations(*graph);
+  // Whether the output of an op reaches a native op, directly or through
+  // the layout agnostic MKL-DNN ops.
+  std::unordered_map<const Node*, bool> reaches_native;
+  for (auto it = ops.rbegin(); it != ops.rend(); ++it) {
+    bool reaches = false;
+    for (auto* out : (*it)->outputs) {
+      if (!IsTensor(out)) continue;
+      for (auto* next : out->outputs) {
+        if (!next->IsOp() || next->Op() == nullptr) continue;
+        if (RunsOnMKLDNN(next)) {
+          reaches |= IsLayoutAgnostic(next) && reaches_native[next];
+        } else {
+          reaches |= next->Op()->Type() != "fetch";
+        }
+      }
+    }
+    reaches_native[*it] = reaches;
+  }
+
+  // In the topological order, so that the plain layout propagates through
+  // the chains of the layout agnostic ops.
+  int moved_count = 0;
+  for (auto* op : ops) {
+    if (!RunsOnMKLDNN(op) || !IsLayoutAgnostic(op) || !reaches_native[op]) {
+      continue;
+    }
+    bool plain_inputs = true;
+    for (auto* in : op->inputs) {
+      if (!IsTensor(in)) continue;
+      for (auto* prev : in->inputs) {
+        plain_inputs = plain_inputs && !RunsOnMKLDNN(prev);
+      }
+    }
+    if (plain_inputs) {
+      VLOG(4) << "Run the native kernel of " << op->Op()->Type();
+      op->Op()->SetAttr("use_mkldnn", false);
+      ++moved_count;
+    }
+  }
+  return moved_count;
+}
+
+int MKLDNNLayoutPropagationPass::InsertTransferOps(ir::Graph* graph) const {
+  std::vector<Node*> vars;
+  for (auto* node : graph->Nodes()) {
+    if (IsTensor(node)) vars.push_back(node);
+  }
+
+  int transfer_count = 0;
+  for (auto* var : vars) {
+    bool from_mkldnn =
+        std::any_of(var->inputs.begin(), var->inputs.end(),
+                    [this, var](const Node* prev) {
+                      return OutputsMKLDNNLayout(prev, var);
+                    });
+    if (!from_mkldnn) continue;
+    std::vector<Node*> native_consumers;
+    for (auto* next : var->outputs) {
+      if (next->IsOp() && next->Op() != nullptr && !RunsOnMKLDNN(next) &&
+          CanReadPlainCopy(next, var)) {
+        native_consumers.push_back(next);
+      }
+    }
+    if (native_consumers.empty()) continue;
+
+    auto plain_name = PlainName(var->Name());
+    VarDesc plain_desc(plain_name);
+    plain_desc.SetType(var->Var()->GetType());
+    plain_desc.SetDataType(var->Var()->GetDataType());
+    plain_desc.SetShape(var->Var()->GetShape());
+    plain_desc.SetLoDLevel(var->Var()->GetLoDLevel());
+    plain_desc.SetPersistable(false);
+    auto* plain_var = graph->CreateVarNode(&plain_desc);
+
+    OpDesc transfer_desc(native_consumers[0]->Op()->Block());
+    transfer_desc.SetType("transfer_layout");
+    transfer_desc.SetInput("X", {var->Name()});
+    transfer_desc.SetOutput("Out", {plain_name});
+    transfer_desc.SetAttr("dst_layout", static_cast<int>(DataLayout::kNCHW));
+    // Only reorders var out of the MKL-DNN layout, in case the producer runs
+    // the native kernel.
+    transfer_desc.SetAttr("src_layout", static_cast<int>(DataLayout::kMKLDNN));
+    transfer_desc.Flush();
+    auto* transfer_op = graph->CreateOpNode(&transfer_desc);
+    IR_NODE_LINK_TO(var, transfer_op);
+    IR_NODE_LINK_TO(transfer_op, plain_var);
+
+    for (auto* next : native_consumers) {
+      next->Op()->RenameInput(var->Name(), plain_name);
+      std::replace(next->inputs.begin(), next->inputs.end(), var, plain_var);
+      var->outputs.erase(
+          std::remove(var->outputs.begin(), var->outputs.end(), next),
+          var->outputs.end());
+      plain_var->outputs.push_back(next);
+    }
+    VLOG(4) << "Reorder " << var->Name() << " once for "
+            << native_consumers.size() << " native ops";
+    ++transfer_count;
+  }
+  return transfer_count;
+}
+
+void MKLDNNLayoutPropagationPass::ApplyImpl(ir::Graph* graph) const {
+  PADDLE_ENFORCE_NOT_NULL(graph,
+                          platform::errors::InvalidArgument(
+                              "Pointer to graph argument should not be NULL."));
+  int moved_count = PropagatePlainLayout(graph);
+  int transfer_count = InsertTransferOps(graph);
+  VLOG(3) << "Moved " << moved_count << " ops to the native kernels and "
+          << "inserted " << transfer_count << " transfer_layout ops.";
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_PASS(mkldnn_layout_propagation_pass,
+              paddle::framework::ir::MKLDNNLayoutPropagationPass);
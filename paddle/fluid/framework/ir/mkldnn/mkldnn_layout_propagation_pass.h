@@ -0,0 +1,71 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "paddle/fluid/framework/ir/graph.h"
+#include "paddle/fluid/framework/ir/pass.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+/*
+ * Plans the layouts of the tensors between the MKL-DNN ops and the native
+ * ops, so that the reorders from the MKL-DNN layout to the plain layout,
+ * done in OperatorWithKernel::PrepareData for every consumer and every run,
+ * happen as few times as possible:
+ *
+ * 1. The cheap layout agnostic ops, e.g. activations and reshapes, with all
+ *    their inputs in the plain layout and some native consumers downstream,
+ *    run the native kernels instead, so the plain layout propagates through
+ *    them.
+ * 2. The tensors in the MKL-DNN layout read by native ops are reordered
+ *    once by an explicit transfer_layout op, and all the native consumers
+ *    read its output, for which no transform is needed at runtime. The
+ *    outputs of the MKL-DNN ops of the data types without an MKL-DNN kernel
+ *    are left to the runtime transform, since those ops run the native
+ *    kernels.
+ */
+class MKLDNNLayoutPropagationPass : public Pass {
+ public:
+  static std::string PlainName(const std::string& var_name) {
+    return var_name + "@PLAIN";
+  }
+
+  virtual ~MKLDNNLayoutPropagationPass() {}
+
+ protected:
+  void ApplyImpl(ir::Graph* graph) const override;
+
+ private:
+  // Whether the op runs the MKL-DNN kernel.
+  bool RunsOnMKLDNN(const Node* op) const;
+  // Whether var written by the op is in the MKL-DNN layout, i.e. the op runs
+  // the MKL-DNN kernel of the data type of var.
+  bool OutputsMKLDNNLayout(const Node* op, const Node* var) const;
+  // Whether the MKL-DNN kernel of the op can be swapped for the native one
+  // without loss.
+  bool IsLayoutAgnostic(const Node* op) const;
+  // Returns the number of the ops moved to the native kernels.
+  int PropagatePlainLayout(ir::Graph* graph) const;
+  // Returns the number of the transfer_layout ops inserted.
+  int InsertTransferOps(ir::Graph* graph) const;
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
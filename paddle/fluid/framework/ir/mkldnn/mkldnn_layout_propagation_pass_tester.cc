@@ -0,0 +1,137 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/mkldnn/mkldnn_layout_propagation_pass.h"
+
+#include <gtest/gtest.h>
+
+#include "paddle/fluid/framework/data_layout.h"
+#include "paddle/fluid/framework/ir/pass_test_util.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/scope.h"
+
+USE_OP_ITSELF(pool2d);
+USE_OP_DEVICE_KERNEL(pool2d, MKLDNN);
+USE_OP_ITSELF(relu);
+USE_OP_DEVICE_KERNEL(relu, MKLDNN);
+USE_OP(transfer_layout);
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+// a->pool2d(mkldnn)->b
+// b->pool2d->c
+// b->pool2d->d
+// b->pool2d(mkldnn)->e
+// c->relu(mkldnn)->f
+// f->pool2d->g
+// e->relu(mkldnn)->h
+ProgramDesc BuildProgramDesc() {
+  auto prog = test::BuildProgramDesc({"a", "b", "c", "d", "e", "f", "g", "h"},
+                                     {});
+  test::CreateOp(&prog, "pool2d", {{"X", "a"}}, {{"Out", "b"}}, true);
+  test::CreateOp(&prog, "pool2d", {{"X", "b"}}, {{"Out", "c"}}, false);
+  test::CreateOp(&prog, "pool2d", {{"X", "b"}}, {{"Out", "d"}}, false);
+  test::CreateOp(&prog, "pool2d", {{"X", "b"}}, {{"Out", "e"}}, true);
+  test::CreateOp(&prog, "relu", {{"X", "c"}}, {{"Out", "f"}}, true);
+  test::CreateOp(&prog, "pool2d", {{"X", "f"}}, {{"Out", "g"}}, false);
+  test::CreateOp(&prog, "relu", {{"X", "e"}}, {{"Out", "h"}}, true);
+  return prog;
+}
+
+TEST(MKLDNNLayoutPropagationPass, basic) {
+  std::unique_ptr<Graph> graph(new Graph(BuildProgramDesc()));
+  auto pass = PassRegistry::Instance().Get("mkldnn_layout_propagation_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // b is reordered once for both of the native pool2d ops reading it, and
+  // the relu on c runs the native kernel, so f needs no reorder.
+  EXPECT_TRUE(test::AssertOpsCount(
+      *graph, {{"transfer_layout", 1}, {"pool2d", 5}, {"relu", 2}}));
+  auto plain_b = MKLDNNLayoutPropagationPass::PlainName("b");
+  for (auto* node : graph->Nodes()) {
+    if (!node->IsOp()) continue;
+    auto* op = node->Op();
+    if (op->Type() == "transfer_layout") {
+      EXPECT_EQ(op->Input("X")[0], "b");
+      EXPECT_EQ(op->Output("Out")[0], plain_b);
+    } else if (op->Type() == "pool2d") {
+      auto out = op->Output("Out")[0];
+      if (out == "c" || out == "d") {
+        EXPECT_EQ(op->Input("X")[0], plain_b);
+      } else {
+        EXPECT_NE(op->Input("X")[0], plain_b);
+      }
+    } else if (op->Type() == "relu") {
+      EXPECT_EQ(op->GetAttrIfExists<bool>("use_mkldnn"),
+                op->Output("Out")[0] == "h");
+    }
+  }
+  EXPECT_TRUE(test::TestIsReachable(*graph, "b", plain_b));
+}
+
+// a->relu(mkldnn)->b, of int64
+// b->pool2d->c
+TEST(MKLDNNLayoutPropagationPass, native_fallback) {
+  auto prog = test::BuildProgramDesc({"a", "b", "c"}, {});
+  for (auto& name : {"a", "b"}) {
+    prog.MutableBlock(0)->Var(name)->SetDataType(proto::VarType::INT64);
+  }
+  test::CreateOp(&prog, "relu", {{"X", "a"}}, {{"Out", "b"}}, true);
+  test::CreateOp(&prog, "pool2d", {{"X", "b"}}, {{"Out", "c"}}, false);
+
+  std::unique_ptr<Graph> graph(new Graph(prog));
+  auto pass = PassRegistry::Instance().Get("mkldnn_layout_propagation_pass");
+  graph.reset(pass->Apply(graph.release()));
+
+  // The relu of int64 runs the native kernel, whose output is plain.
+  EXPECT_TRUE(test::AssertOpsCount(
+      *graph, {{"transfer_layout", 0}, {"pool2d", 1}, {"relu", 1}}));
+}
+
+// The transfer_layout inserted by the pass passes the plain tensors written
+// by the producers falling back to the native kernels through.
+TEST(MKLDNNLayoutPropagationPass, transfer_plain_input) {
+  platform::CPUPlace place;
+  for (auto layout : {DataLayout::kNCHW, DataLayout::kNHWC}) {
+    Scope scope;
+    auto* x = scope.Var("x")->GetMutable<LoDTensor>();
+    auto* x_data = x->mutable_data<int64_t>(phi::make_ddim({1, 2, 3, 4}),
+                                            place);
+    for (int64_t i = 0; i < x->numel(); ++i) {
+      x_data[i] = i;
+    }
+    x->set_layout(layout);
+    scope.Var("y");
+
+    AttributeMap attrs;
+    attrs["dst_layout"] = static_cast<int>(DataLayout::kNCHW);
+    attrs["src_layout"] = static_cast<int>(DataLayout::kMKLDNN);
+    auto op = OpRegistry::CreateOp("transfer_layout", {{"X", {"x"}}},
+                                   {{"Out", {"y"}}}, attrs);
+    op->Run(scope, place);
+
+    const auto& y = scope.FindVar("y")->Get<LoDTensor>();
+    EXPECT_EQ(y.layout(), layout);
+    EXPECT_EQ(y.dims(), x->dims());
+    EXPECT_EQ(y.data<int64_t>(), x_data);
+  }
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
+
+USE_PASS(mkldnn_layout_propagation_pass);
@@ -15,6 +15,7 @@
 #include "paddle/fluid/framework/ir/mkldnn/mkldnn_placement_pass.h"
 
 #include <gtest/gtest.h>
+#include "paddle/fluid/framework/ir/op_cost_table.h"
 #include <boost/logic/tribool.hpp>
 
 namespace paddle {
@@ -93,10 +94,14 @@ class PlacementPassTest {
 
  public:
   void MainTest(std::initializer_list<std::string> mkldnn_enabled_op_types,
-                unsigned expected_use_mkldnn_true_count) {
+                unsigned expected_use_mkldnn_true_count,
+                const OpCostTable* cost_table = nullptr) {
     auto prog = BuildProgramDesc();
 
     std::unique_ptr<ir::Graph> graph(new ir::Graph(prog));
+    if (cost_table) {
+      graph->Set(kOpCostTable, new OpCostTable(*cost_table));
+    }
 
     auto pass = PassRegistry::Instance().Get("mkldnn_placement_pass");
 
@@ -142,6 +147,23 @@ TEST(MKLDNNPlacementPass, enable_all) {
   PlacementPassTest().MainTest({}, 4);
 }
 
+TEST(MKLDNNPlacementPass, measured_slower) {
+  // pool1 is measured slower with mkldnn, relu1 is measured faster
+  OpCostTable cost_table;
+  OpDesc pool;
+  pool.SetType("pool2d");
+  pool.SetOutput("Out", {"h"});
+  cost_table.SetOpTimeMs(OpCostTable::Key(pool, ""), 1.0);
+  cost_table.SetOpTimeMs(OpCostTable::Key(pool, "mkldnn"), 2.0);
+  OpDesc relu;
+  relu.SetType("relu");
+  relu.SetOutput("Out", {"g"});
+  cost_table.SetOpTimeMs(OpCostTable::Key(relu, ""), 2.0);
+  cost_table.SetOpTimeMs(OpCostTable::Key(relu, "mkldnn"), 1.0);
+  // 1 conv (1 conv is always true) + 2 relu (1 relu is always true) + 0 pool
+  PlacementPassTest().MainTest({}, 3, &cost_table);
+}
+
 TEST(MKLDNNPlacementPass, placement_name) {
   PlacementPassTest().PlacementNameTest();
 }
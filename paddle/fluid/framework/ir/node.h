@@ -252,10 +252,11 @@ class Node {
   void SetId(int id) { id_ = id; }
 
   // desc_order can only set by a Graph when constructing a Graph from a
-  // BlockDesc.
+  // BlockDesc, or by MemorySchedulePass when reordering the ops.
   void SetDescOrder(int desc_order) { desc_order_ = desc_order; }
 
   friend class Graph;
+  friend class MemorySchedulePass;
   friend std::unique_ptr<Node> CreateNodeForTest(const std::string& name,
                                                  Node::Type type);
   friend std::unique_ptr<Node> CreateNodeForTest(VarDesc* var_desc);
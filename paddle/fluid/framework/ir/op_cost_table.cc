@@ -0,0 +1,146 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/ir/op_cost_table.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+const double OpCostTable::NOT_MEASURED = -1;
+
+// The first line of a saved table holds the time of the whole program.
+static constexpr char kWholeTimeKey[] = "__whole_time_ms__";
+
+static bool IsAttrTrue(const OpDesc& op, const std::string& name) {
+  return op.HasAttr(name) && op.GetAttrType(name) == proto::AttrType::BOOLEAN &&
+         BOOST_GET_CONST(bool, op.GetAttr(name));
+}
+
+std::string OpCostTable::Key(const OpDesc& op) {
+  std::string library = "";
+  if (IsAttrTrue(op, "use_mkldnn")) {
+    library = "mkldnn";
+  } else if (IsAttrTrue(op, "use_cudnn")) {
+    library = "cudnn";
+  }
+  return Key(op, library);
+}
+
+std::string OpCostTable::Key(const OpDesc& op, const std::string& library) {
+  std::ostringstream key;
+  key << op.Type() << "(";
+  bool first_param = true;
+  // Outputs() is an ordered map, so the key does not depend on the order in
+  // which the outputs are set.
+  for (auto& output : op.Outputs()) {
+    if (!first_param) {
+      key << ";";
+    }
+    first_param = false;
+    key << output.first << "=";
+    for (size_t i = 0; i < output.second.size(); ++i) {
+      key << (i == 0 ? "" : ",") << output.second[i];
+    }
+  }
+  key << ")";
+  if (!library.empty()) {
+    key << "@" << library;
+  }
+  return key.str();
+}
+
+void OpCostTable::SetOpTimeMs(const std::string& key, double time_ms) {
+  op_time_ms_[key] = time_ms;
+}
+
+double OpCostTable::GetOpTimeMs(const std::string& key) const {
+  auto iter = op_time_ms_.find(key);
+  return iter == op_time_ms_.end() ? NOT_MEASURED : iter->second;
+}
+
+void OpCostTable::Merge(const OpCostTable& other) {
+  for (auto& item : other.op_time_ms_) {
+    op_time_ms_[item.first] = item.second;
+  }
+  if (other.whole_time_ms_ != NOT_MEASURED) {
+    whole_time_ms_ = other.whole_time_ms_;
+  }
+}
+
+bool OpCostTable::Save(const std::string& path) const {
+  std::ofstream fout(path);
+  if (!fout.is_open()) {
+    LOG(WARNING) << "Cannot open " << path << " to save the op cost table.";
+    return false;
+  }
+  fout.precision(std::numeric_limits<double>::max_digits10);
+  fout << kWholeTimeKey << "\t" << whole_time_ms_ << "\n";
+  for (auto& item : op_time_ms_) {
+    fout << item.first << "\t" << item.second << "\n";
+  }
+  fout.close();
+  VLOG(3) << "Save " << op_time_ms_.size() << " op costs to " << path;
+  return !fout.fail();
+}
+
+void OpCostTable::Load(const std::string& path) {
+  std::ifstream fin(path);
+  PADDLE_ENFORCE_EQ(fin.is_open(), true,
+                    platform::errors::NotFound(
+                        "Cannot open %s to load the op cost table.", path));
+  std::string line;
+  int line_no = 0;
+  while (std::getline(fin, line)) {
+    ++line_no;
+    if (line.empty()) {
+      continue;
+    }
+    size_t pos = line.rfind('\t');
+    PADDLE_ENFORCE_NE(pos, std::string::npos,
+                      platform::errors::InvalidArgument(
+                          "Invalid line \"%s\" without the op cost at %s:%d.",
+                          line, path, line_no));
+    std::string key = line.substr(0, pos);
+    std::string time_str = line.substr(pos + 1);
+    double time_ms = 0;
+    size_t parsed_size = 0;
+    try {
+      time_ms = std::stod(time_str, &parsed_size);
+    } catch (std::logic_error&) {
+      // std::invalid_argument or std::out_of_range
+      parsed_size = 0;
+    }
+    if (time_str.empty() || parsed_size != time_str.size()) {
+      PADDLE_THROW(platform::errors::InvalidArgument(
+          "Invalid op cost \"%s\" of %s at %s:%d.", time_str, key, path,
+          line_no));
+    }
+    if (key == kWholeTimeKey) {
+      whole_time_ms_ = time_ms;
+    } else {
+      op_time_ms_[key] = time_ms;
+    }
+  }
+  VLOG(3) << "Load " << op_time_ms_.size() << " op costs from " << path;
+}
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,70 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "paddle/fluid/framework/op_desc.h"
+
+namespace paddle {
+namespace framework {
+namespace ir {
+
+// Graph attribute holding the OpCostTable which passes may query.
+constexpr char kOpCostTable[] = "__op_cost_table__";
+
+/*
+ * Measured per-op costs which can be persisted and handed to passes.
+ *
+ * An op is keyed by its type, its output variables and the kernel library
+ * it runs with (mkldnn, cudnn or the native one). Unlike the op index used
+ * by CostData, this key stays valid after passes which do not touch the op,
+ * and the costs of the same op measured with different libraries can be
+ * merged into one table to drive placement decisions.
+ */
+class OpCostTable {
+ public:
+  static const double NOT_MEASURED;
+
+  // Key of op with the library it is configured to run with.
+  static std::string Key(const OpDesc& op);
+  // Key of op as if it runs with library, "" means the native kernel.
+  static std::string Key(const OpDesc& op, const std::string& library);
+
+  void SetOpTimeMs(const std::string& key, double time_ms);
+  double GetOpTimeMs(const std::string& key) const;
+  double GetOpTimeMs(const OpDesc& op) const { return GetOpTimeMs(Key(op)); }
+
+  void SetWholeTimeMs(double time_ms) { whole_time_ms_ = time_ms; }
+  double GetWholeTimeMs() const { return whole_time_ms_; }
+
+  // Adds the costs of other, those already in this table are overwritten.
+  void Merge(const OpCostTable& other);
+
+  bool Save(const std::string& path) const;
+  // Throws if the file cannot be opened or has an invalid line.
+  void Load(const std::string& path);
+
+  size_t size() const { return op_time_ms_.size(); }
+
+ private:
+  std::unordered_map<std::string, double> op_time_ms_;
+  double whole_time_ms_{NOT_MEASURED};
+};
+
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/ir/placement_pass_base.h"
 #include <string>
+#include "paddle/fluid/framework/ir/op_cost_table.h"
 #include "paddle/fluid/framework/operator.h"
 
 namespace paddle {
@@ -31,7 +32,7 @@ void PlacementPassBase::ApplyImpl(ir::Graph* graph) const {
     if (n->IsOp()) {
       auto* op = n->Op();
       if ((op->HasAttr(attr_name) || op->HasProtoAttr(attr_name)) &&
-          IsSupport(op->Type())) {
+          IsSupport(op->Type()) && IsProfitable(*graph, *op)) {
         if (op_types_list.empty() && IsDefaultOpTypes(op->Type())) {
           op->SetAttr(attr_name, true);
         } else if (std::find(op_types_list.begin(), op_types_list.end(),
@@ -67,6 +68,29 @@ bool PlacementPassBase::IsSupport(const std::string& op_type) const {
   return false;
 }
 
+bool PlacementPassBase::IsProfitable(const ir::Graph& graph,
+                                     const OpDesc& op) const {
+  if (!graph.Has(kOpCostTable)) {
+    return true;
+  }
+  const auto& cost_table = graph.Get<OpCostTable>(kOpCostTable);
+  // "use_mkldnn" -> "mkldnn", "use_cudnn" -> "cudnn"
+  std::string library = GetAttrName().substr(4);
+  double native_time_ms = cost_table.GetOpTimeMs(OpCostTable::Key(op, ""));
+  double placed_time_ms = cost_table.GetOpTimeMs(OpCostTable::Key(op, library));
+  if (native_time_ms == OpCostTable::NOT_MEASURED ||
+      placed_time_ms == OpCostTable::NOT_MEASURED) {
+    return true;
+  }
+  if (placed_time_ms > native_time_ms) {
+    VLOG(3) << "Keep the native kernel of " << op.Type() << " which takes "
+            << native_time_ms << " ms, while " << placed_time_ms
+            << " ms with " << library;
+    return false;
+  }
+  return true;
+}
+
 bool PlacementPassBase::IsDefaultOpTypes(const std::string& op_type) const {
   if (GetAttrName() == "use_cudnn") {
     return true;
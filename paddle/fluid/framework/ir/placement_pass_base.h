@@ -19,6 +19,12 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/ir/pass.h"
 
+namespace paddle {
+namespace framework {
+class OpDesc;
+}  // namespace framework
+}  // namespace paddle
+
 namespace paddle {
 namespace framework {
 namespace ir {
@@ -39,6 +45,9 @@ class PlacementPassBase : public Pass {
  private:
   bool IsSupport(const std::string& op_type) const;
   bool IsDefaultOpTypes(const std::string& op_type) const;
+  // Whether the op is not measured slower with the placement than with the
+  // native kernel, according to the OpCostTable attached to the graph.
+  bool IsProfitable(const ir::Graph& graph, const OpDesc& op) const;
 
 #if PADDLE_WITH_TESTING
   friend class PlacementPassTest;
@@ -39,6 +39,15 @@ void PullDenseWorker::Initialize(const TrainerDesc& param) {
   threshold_ = param_.threshold();
   thread_num_ = param_.device_num();
   sleep_time_ms_ = param_.sleep_time_ms();
+  double_buffer_ = param_.double_buffer();
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP) || \
+    defined(PADDLE_WITH_XPU)
+  if (double_buffer_) {
+    LOG(WARNING) << "double buffer dense pull only works for parameters "
+                    "in CPU memory, fall back to pulling in place";
+    double_buffer_ = false;
+  }
+#endif
   for (int i = 0; i < dwp_param_.program_config(0).pull_dense_table_id_size();
        ++i) {
     uint64_t tid = static_cast<uint64_t>(
@@ -60,6 +69,9 @@ void PullDenseWorker::Initialize(const TrainerDesc& param) {
     training_versions_[tid].resize(thread_num_, 0);
     last_versions_[tid] = 0;
     current_version_[tid] = 0;
+    // setup dense buffers for each table
+    dense_buffers_[tid].reset(
+        new DenseParamBuffer(dense_value_names_[tid], thread_num_));
   }
   fleet_ptr_ = FleetWrapper::GetInstance();
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
@@ -159,6 +171,10 @@ void PullDenseWorker::Stop() {
 }
 
 void PullDenseWorker::PullDense(bool force_update) {
+  if (double_buffer_) {
+    PullDenseToBuffer(force_update);
+    return;
+  }
   pull_dense_status_.resize(0);
   for (int i = 0; i < dwp_param_.program_config(0).pull_dense_table_id_size();
        ++i) {
@@ -182,6 +198,118 @@ void PullDenseWorker::PullDense(bool force_update) {
   }
 }
 
+Scope* DenseParamBuffer::GetFree(const Scope& root_scope) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // a buffer is free once no thread scope (nor the root scope) shares its
+  // tensors; the published buffer may still be picked up, so skip it
+  for (auto& buffer : buffers_) {
+    if (buffer.get() == latest_) {
+      continue;
+    }
+    bool in_use = false;
+    for (auto& name : names_) {
+      auto& tensor = buffer->FindVar(name)->Get<LoDTensor>();
+      if (tensor.Holder().use_count() > 1) {
+        in_use = true;
+        break;
+      }
+    }
+    if (!in_use) {
+      return buffer.get();
+    }
+  }
+  Scope* buffer = new Scope();
+  for (auto& name : names_) {
+    auto& root_tensor = root_scope.FindVar(name)->Get<LoDTensor>();
+    auto* tensor = buffer->Var(name)->GetMutable<LoDTensor>();
+    tensor->mutable_data<float>(root_tensor.dims(), platform::CPUPlace());
+  }
+  buffers_.emplace_back(buffer);
+  VLOG(3) << "create dense buffer, " << buffers_.size() << " buffers in total";
+  return buffer;
+}
+
+void DenseParamBuffer::Publish(Scope* buffer, Scope* root_scope) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  latest_ = buffer;
+  // keep the root scope on the latest version for save and dump
+  for (auto& name : names_) {
+    root_scope->FindVar(name)->GetMutable<LoDTensor>()->ShareDataWith(
+        buffer->FindVar(name)->Get<LoDTensor>());
+  }
+  ++version_;
+}
+
+void DenseParamBuffer::Swap(int thread_id, Scope* thread_scope) {
+  auto& thread_version = thread_versions_[thread_id];
+  if (version_.load() == thread_version) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (latest_ == nullptr) {
+    return;
+  }
+  // thread local vars shadow the ones in root scope
+  for (auto& name : names_) {
+    thread_scope->Var(name)->GetMutable<LoDTensor>()->ShareDataWith(
+        latest_->FindVar(name)->Get<LoDTensor>());
+  }
+  thread_version = version_.load();
+}
+
+size_t DenseParamBuffer::BufferNum() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffers_.size();
+}
+
+void PullDenseWorker::PullDenseToBuffer(bool force_update) {
+  pull_dense_status_.resize(0);
+  std::vector<uint64_t> pull_tables;
+  std::vector<Scope*> pull_buffers;
+  for (int i = 0; i < dwp_param_.program_config(0).pull_dense_table_id_size();
+       ++i) {
+    uint64_t tid = static_cast<uint64_t>(
+        dwp_param_.program_config(0).pull_dense_table_id(i));
+    if (force_update || CheckUpdateParam(tid)) {
+      Scope* buffer = dense_buffers_[tid]->GetFree(*root_scope_);
+      fleet_ptr_->PullDenseVarsAsync(*buffer, tid, dense_value_names_[tid],
+                                     &pull_dense_status_, true);
+      ResetThreadVersion(tid);
+      pull_tables.push_back(tid);
+      pull_buffers.push_back(buffer);
+    }
+  }
+  for (size_t i = 0; i < pull_dense_status_.size(); ++i) {
+    auto status = pull_dense_status_[i].get();
+    if (status != 0) {
+      // keep serving the previous version, the next round pulls again
+      LOG(WARNING) << "Current Pull Dense Thread Failed Times"
+                   << ++pull_dense_fail_times_;
+      continue;
+    }
+    dense_buffers_[pull_tables[i]]->Publish(pull_buffers[i], root_scope_);
+  }
+  pull_dense_status_.resize(0);
+
+  size_t MAX_FAIL_NUM = 20;
+  if (pull_dense_fail_times_ > MAX_FAIL_NUM) {
+    PADDLE_THROW(platform::errors::Fatal(
+        "Pull dense failed more than %d times.", MAX_FAIL_NUM));
+  }
+}
+
+void PullDenseWorker::SwapDenseBuffer(int thread_id, Scope* thread_scope) {
+  if (!double_buffer_) {
+    return;
+  }
+  for (int i = 0; i < dwp_param_.program_config(0).pull_dense_table_id_size();
+       ++i) {
+    uint64_t tid = static_cast<uint64_t>(
+        dwp_param_.program_config(0).pull_dense_table_id(i));
+    dense_buffers_.at(tid)->Swap(thread_id, thread_scope);
+  }
+}
+
 int PullDenseWorker::Start() {
   running_ = true;
   // before training, we can pull dense from pserver first.
@@ -0,0 +1,128 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/device_worker.h"
+
+namespace paddle {
+namespace framework {
+
+TEST(DenseParamBuffer, SwapNeverExposesPartialWrite) {
+  const std::vector<std::string> names = {"w0", "w1"};
+  const int64_t numel = 4096;
+  const int thread_num = 4;
+  const int version_num = 200;
+
+  Scope root_scope;
+  for (auto& name : names) {
+    root_scope.Var(name)->GetMutable<LoDTensor>()->mutable_data<float>(
+        phi::make_ddim({numel}), platform::CPUPlace());
+  }
+  DenseParamBuffer buffers(names, thread_num);
+
+  // The pull thread writes every element of the buffers with the version,
+  // as the pull of a version.
+  std::atomic<bool> writing{true};
+  std::thread writer([&]() {
+    for (int version = 1; version <= version_num; ++version) {
+      Scope* buffer = buffers.GetFree(root_scope);
+      for (auto& name : names) {
+        float* data =
+            buffer->FindVar(name)->GetMutable<LoDTensor>()->data<float>();
+        for (int64_t i = 0; i < numel; ++i) {
+          data[i] = version;
+          if (i == numel / 2) {
+            std::this_thread::yield();
+          }
+        }
+      }
+      buffers.Publish(buffer, &root_scope);
+    }
+    writing = false;
+  });
+
+  // Each batch of the trainer threads reads one whole version.
+  std::atomic<int> bad_batches{0};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < thread_num; ++tid) {
+    readers.emplace_back([&, tid]() {
+      Scope* thread_scope = &root_scope.NewScope();
+      float last_version = 0;
+      while (writing) {
+        buffers.Swap(tid, thread_scope);
+        if (thread_scope->FindLocalVar(names[0]) == nullptr) {
+          continue;
+        }
+        float version =
+            thread_scope->FindLocalVar(names[0])->Get<LoDTensor>().data<float>()
+                [0];
+        bool consistent = version >= last_version;
+        for (auto& name : names) {
+          const float* data =
+              thread_scope->FindLocalVar(name)->Get<LoDTensor>().data<float>();
+          for (int64_t i = 0; i < numel; ++i) {
+            consistent = consistent && data[i] == version;
+          }
+        }
+        if (!consistent) {
+          ++bad_batches;
+        }
+        last_version = version;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(bad_batches.load(), 0);
+  // the published buffer, the one being written and one per lagging thread
+  EXPECT_LE(buffers.BufferNum(), static_cast<size_t>(thread_num + 2));
+
+  // the root scope is on the latest version
+  EXPECT_EQ(root_scope.FindVar(names[1])->Get<LoDTensor>().data<float>()[0],
+            version_num);
+}
+
+TEST(DenseParamBuffer, ReuseFreeBuffer) {
+  const std::vector<std::string> names = {"w"};
+  Scope root_scope;
+  root_scope.Var("w")->GetMutable<LoDTensor>()->mutable_data<float>(
+      phi::make_ddim({16}), platform::CPUPlace());
+  DenseParamBuffer buffers(names, 1);
+  Scope* thread_scope = &root_scope.NewScope();
+
+  Scope* first = buffers.GetFree(root_scope);
+  buffers.Publish(first, &root_scope);
+  buffers.Swap(0, thread_scope);
+  // the published buffer is not handed out
+  Scope* second = buffers.GetFree(root_scope);
+  EXPECT_NE(first, second);
+  buffers.Publish(second, &root_scope);
+  // the first buffer is still read by the thread
+  EXPECT_NE(buffers.GetFree(root_scope), first);
+  EXPECT_EQ(buffers.BufferNum(), 3UL);
+
+  buffers.Swap(0, thread_scope);
+  EXPECT_EQ(buffers.GetFree(root_scope), first);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -26,6 +26,7 @@
 
 #include "paddle/fluid/framework/convert_utils.h"
 #include "paddle/fluid/imperative/gradient_accumulator.h"
+#include "paddle/fluid/imperative/jit/program_desc_tracer.h"
 #include "paddle/fluid/imperative/layer.h"
 #include "paddle/fluid/imperative/op_base.h"
 #include "paddle/fluid/imperative/tracer.h"
@@ -110,6 +111,16 @@ void BasicEngine::Init(
           grad_tensor->Var().Get<framework::LoDTensor>(), fwd_var.place(),
           *dev_ctx, grad_var);
     }
+    if (program_desc_tracer_) {
+      if (grad_tensor == nullptr) {
+        program_desc_tracer_->InsertGradFill(var->GradVarBase()->SharedVar(),
+                                             1.0);
+      } else {
+        program_desc_tracer_->InsertGradSum(grad_tensor->SharedVar(),
+                                            var->GradVarBase()->SharedVar(),
+                                            false);
+      }
+    }
 
     VariableWrapper* init_grad_var = var->GradVarBase()->SharedVar().get();
     auto& accumulator =
@@ -159,6 +170,9 @@ void BasicEngine::CheckBackwardInputs(const OpBase& op) {
                 << " as zero with dtype "
                 << framework::DataTypeToString(var->ForwardDataType());
         phi::funcs::set_constant(*dev_ctx, tensor, 0.0);
+        if (program_desc_tracer_) {
+          program_desc_tracer_->InsertGradFill(var, 0.0);
+        }
       }
     }
   }
@@ -476,6 +490,10 @@ void BasicEngine::Execute() {
                     "Cannot find gradient of variable %s", var->Name()));
           }
 
+          if (program_desc_tracer_) {
+            traced_grad_vars_.emplace(iter->second.get(), var);
+          }
+
           // leaf_accumulators_ : hooks and accumulate-grad for leaf tensor,
           // it should be orderly and not reapeated.
           if (var->IsLeafGrad()) {
@@ -558,6 +576,11 @@ void BasicEngine::Execute() {
        *   hold hooks
        */
       auto tmp_ins_ptr = CallGradientHooks(bwd_ins, cur_op.Type());
+      if (program_desc_tracer_ &&
+          (tmp_ins_ptr || cur_op.HasVoidFunctionPostHook())) {
+        program_desc_tracer_->SetUncapturable("the grad op " + cur_op.Type() +
+                                              " runs hooks");
+      }
 
       if (!tmp_ins_ptr) {
         PerformBackwardInplace(cur_op.Type(), bwd_ins, &tmp_outs);
@@ -583,6 +606,15 @@ void BasicEngine::Execute() {
         }
       }
 
+      if (program_desc_tracer_) {
+        auto attrs = cur_op.DefaultAttrsMap();
+        for (auto& pair : cur_op.Attrs()) {
+          attrs[pair.first] = pair.second;
+        }
+        program_desc_tracer_->InsertGradOp(cur_op.Type(), bwd_ins, tmp_outs,
+                                           attrs);
+      }
+
       // Function Post Hook
       if (cur_op.HasVoidFunctionPostHook()) {
         for (const auto& hook : cur_op.GetVoidFunctionPostHooks()) {
@@ -592,11 +624,29 @@ void BasicEngine::Execute() {
 
       for (auto& pair : inplace_output_grad_var_list_) {
         *pair.first = std::move(*pair.second);
+        if (program_desc_tracer_) {
+          program_desc_tracer_->InsertGradSum(pair.second, pair.first, false);
+        }
       }
 
       // Step 2: Sum Gradient of This graph
       for (auto& pair : need_accu_var_list_) {
-        pair.first->SumGrad(std::move(pair.second), cur_op.id());
+        if (!program_desc_tracer_) {
+          pair.first->SumGrad(std::move(pair.second), cur_op.id());
+          continue;
+        }
+        auto* accumulator = pair.first;
+        auto src = pair.second;
+        auto dst = accumulator->HasInnerVar()
+                       ? accumulator->InnerVar()
+                       : traced_grad_vars_.at(accumulator);
+        bool accumulate = accumulator->CurCnt() > 0;
+        accumulator->SumGrad(std::move(pair.second), cur_op.id());
+        if (dst->OverridedStopGradient()) {
+          program_desc_tracer_->InsertGradFill(dst, 0.0);
+        } else {
+          program_desc_tracer_->InsertGradSum(src, dst, accumulate);
+        }
       }
 
       // Step 3: Call Hooks && Sum Gradient with Pre-Graph && Call BackwardHooks
@@ -608,7 +658,19 @@ void BasicEngine::Execute() {
         accumulator->CallGradientHooks();
 
         // 2. Sum Gradient `inner_var_` to `var_` of Current or Previous Graph
-        accumulator->AccumulateGrad();
+        if (program_desc_tracer_) {
+          auto src = accumulator->InnerVar();
+          auto& dst = traced_grad_vars_.at(accumulator);
+          bool accumulate = !dst->IsEmpty();
+          if (dst->HasVariableWrapperHook() || dst->HasVoidHook()) {
+            program_desc_tracer_->SetUncapturable("the grad var " +
+                                                  dst->Name() + " has hooks");
+          }
+          accumulator->AccumulateGrad();
+          program_desc_tracer_->InsertGradSum(src, dst, accumulate);
+        } else {
+          accumulator->AccumulateGrad();
+        }
 
         // 3. Call backward Hooks for `var_`
         accumulator->CallReduceHooks();
@@ -651,6 +713,7 @@ void BasicEngine::Clear() {
   accumulators_with_grad_node_.clear();
   need_accu_var_list_.clear();
   leaf_accumulators_.clear();
+  traced_grad_vars_.clear();
 }
 
 }  // namespace imperative
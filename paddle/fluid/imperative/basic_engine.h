@@ -28,6 +28,10 @@ namespace imperative {
 class VarBase;
 class OpBase;
 
+namespace jit {
+class ProgramDescTracer;
+}  // namespace jit
+
 class BasicEngine : public Engine {
  public:
   void Init(const std::vector<std::shared_ptr<VarBase>>& tensors,
@@ -36,6 +40,12 @@ class BasicEngine : public Engine {
 
   void Execute() override;
 
+  // Traces the grad ops run and the gradient accumulation into the tracer as
+  // well, unless it is nullptr.
+  void SetProgramDescTracer(jit::ProgramDescTracer* tracer) {
+    program_desc_tracer_ = tracer;
+  }
+
  private:
   void PrepareDeps();
 
@@ -76,6 +86,12 @@ class BasicEngine : public Engine {
   std::vector<GradientAccumulator*> leaf_accumulators_;
 
   bool retain_graph_;
+
+  jit::ProgramDescTracer* program_desc_tracer_{nullptr};
+  // The grad vars of the accumulators, by which the gradient accumulation is
+  // traced.
+  std::unordered_map<GradientAccumulator*, std::shared_ptr<VariableWrapper>>
+      traced_grad_vars_;
 };
 
 }  // namespace imperative
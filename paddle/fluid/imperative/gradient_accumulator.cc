@@ -15,8 +15,11 @@
 #include "paddle/fluid/imperative/gradient_accumulator.h"
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
+#include <numeric>
 #include <utility>
+#include <vector>
 
 #include "paddle/fluid/framework/convert_utils.h"
 #include "paddle/fluid/framework/lod_tensor.h"
@@ -604,8 +607,212 @@ template std::shared_ptr<paddle::experimental::Tensor> SelectedRowsMerge(
 template std::shared_ptr<paddle::imperative::VariableWrapper> SelectedRowsMerge(
     const framework::Variable& src1, const framework::Variable& src2);
 
+bool SelectedRowsAccumulator::IsSupported(
+    const phi::SelectedRows& selected_rows) {
+  const auto& value = selected_rows.value();
+  return value.IsInitialized() && platform::is_cpu_place(value.place()) &&
+         (value.dtype() == phi::DataType::FLOAT32 ||
+          value.dtype() == phi::DataType::FLOAT64) &&
+         value.dims().size() == 2 &&
+         value.dims()[0] == static_cast<int64_t>(selected_rows.rows().size());
+}
+
+bool SelectedRowsAccumulator::IsIndexed(const phi::SelectedRows& dst) const {
+  return dst_ == &dst && dst_data_ == dst.value().data() &&
+         row_index_.size() == dst.rows().size();
+}
+
+template <typename T>
+void SelectedRowsAccumulator::Index(phi::SelectedRows* dst) {
+  auto* rows = dst->mutable_rows();
+  auto* value = dst->mutable_value();
+  int64_t width = value->dims()[1];
+  T* data = value->data<T>();
+  auto* dev_ctx = static_cast<platform::CPUDeviceContext*>(
+      platform::DeviceContextPool::Instance().Get(value->place()));
+  auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(*dev_ctx);
+
+  row_index_.clear();
+  row_index_.reserve(rows->size());
+  int64_t row_num = 0;
+  for (size_t i = 0; i < rows->size(); ++i) {
+    auto pair = row_index_.emplace((*rows)[i], row_num);
+    if (!pair.second) {
+      blas.AXPY(width, static_cast<T>(1), data + i * width,
+                data + pair.first->second * width);
+      continue;
+    }
+    // Moves the row forward, over the rows merged before it.
+    if (row_num != static_cast<int64_t>(i)) {
+      std::memcpy(data + row_num * width, data + i * width, width * sizeof(T));
+      (*rows)[row_num] = (*rows)[i];
+    }
+    ++row_num;
+  }
+  VLOG(6) << "Merge " << rows->size() << " rows of SelectedRows into "
+          << row_num << " rows";
+  row_capacity_ = static_cast<int64_t>(rows->size());
+  rows->resize(row_num);
+  value->Resize(phi::make_ddim({row_num, width}));
+
+  dst_ = dst;
+  dst_data_ = value->data();
+  add_num_ = 0;
+}
+
+template <typename T>
+void SelectedRowsAccumulator::Reserve(int64_t row_num, phi::SelectedRows* dst) {
+  auto* value = dst->mutable_value();
+  int64_t width = value->dims()[1];
+  if (row_num > row_capacity_) {
+    // The unique rows expected, extrapolated from the gradients added so far,
+    // counting dst as one of them.
+    int64_t capacity =
+        std::max(row_num, row_num * static_cast<int64_t>(expected_add_num_) /
+                              static_cast<int64_t>(add_num_ + 1));
+    if (add_num_ + 1 < expected_add_num_) {
+      capacity = std::max(capacity, 2 * row_capacity_);
+    }
+    if (dst->height() > 0) {
+      capacity = std::max(row_num, std::min(capacity, dst->height()));
+    }
+    VLOG(6) << "Reserve " << capacity << " rows for SelectedRows of "
+            << row_num << " rows";
+
+    phi::DenseTensor reserved;
+    reserved.Resize(phi::make_ddim({capacity, width}));
+    auto* reserved_data = reserved.mutable_data<T>(value->place());
+    std::memcpy(reserved_data, value->data<T>(), value->numel() * sizeof(T));
+    *value = reserved;
+    row_capacity_ = capacity;
+  }
+  // The allocation is kept, as it has room for the rows.
+  value->Resize(phi::make_ddim({row_num, width}));
+  value->mutable_data<T>(value->place());
+}
+
+template <typename T>
+void SelectedRowsAccumulator::AddImpl(const phi::SelectedRows& src,
+                                      phi::SelectedRows* dst) {
+  if (!IsIndexed(*dst)) {
+    Index<T>(dst);
+  }
+  ++add_num_;
+
+  const auto& src_rows = src.rows();
+  auto* rows = dst->mutable_rows();
+  // The row of dst for each row of src, appended if it is new.
+  std::vector<int64_t> dst_row_ids(src_rows.size());
+  std::vector<bool> is_new_row(src_rows.size(), false);
+  for (size_t i = 0; i < src_rows.size(); ++i) {
+    auto pair =
+        row_index_.emplace(src_rows[i], static_cast<int64_t>(rows->size()));
+    if (pair.second) {
+      rows->emplace_back(src_rows[i]);
+      is_new_row[i] = true;
+    }
+    dst_row_ids[i] = pair.first->second;
+  }
+  Reserve<T>(rows->size(), dst);
+
+  auto* value = dst->mutable_value();
+  int64_t width = value->dims()[1];
+  T* data = value->data<T>();
+  const T* src_data = src.value().data<T>();
+  auto* dev_ctx = static_cast<platform::CPUDeviceContext*>(
+      platform::DeviceContextPool::Instance().Get(value->place()));
+  auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(*dev_ctx);
+  for (size_t i = 0; i < src_rows.size(); ++i) {
+    T* dst_row = data + dst_row_ids[i] * width;
+    if (is_new_row[i]) {
+      std::memcpy(dst_row, src_data + i * width, width * sizeof(T));
+    } else {
+      blas.AXPY(width, static_cast<T>(1), src_data + i * width, dst_row);
+    }
+  }
+  dst_data_ = value->data();
+}
+
+bool SelectedRowsAccumulator::Add(const phi::SelectedRows& src,
+                                  phi::SelectedRows* dst) {
+  if (!IsSupported(src) || !IsSupported(*dst) ||
+      src.value().dtype() != dst->value().dtype() ||
+      src.value().dims()[1] != dst->value().dims()[1] ||
+      src.height() != dst->height()) {
+    return false;
+  }
+  if (src.value().dtype() == phi::DataType::FLOAT32) {
+    AddImpl<float>(src, dst);
+  } else {
+    AddImpl<double>(src, dst);
+  }
+  return true;
+}
+
+template <typename T>
+void SelectedRowsAccumulator::Sort(phi::SelectedRows* dst) {
+  auto* rows = dst->mutable_rows();
+  if (std::is_sorted(rows->begin(), rows->end())) {
+    return;
+  }
+  // The rows of dst in the order of their ids, which are unique.
+  std::vector<int64_t> order(rows->size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [rows](int64_t lhs, int64_t rhs) {
+    return (*rows)[lhs] < (*rows)[rhs];
+  });
+
+  auto* value = dst->mutable_value();
+  int64_t row_num = value->dims()[0];
+  int64_t width = value->dims()[1];
+  // Sorted once the gradients are all added, so no room is kept for more rows.
+  phi::DenseTensor sorted;
+  sorted.Resize(phi::make_ddim({row_num, width}));
+  T* sorted_data = sorted.mutable_data<T>(value->place());
+  const T* data = value->data<T>();
+  std::vector<int64_t> sorted_rows(rows->size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::memcpy(sorted_data + i * width, data + order[i] * width,
+                width * sizeof(T));
+    sorted_rows[i] = (*rows)[order[i]];
+    row_index_[sorted_rows[i]] = static_cast<int64_t>(i);
+  }
+  VLOG(6) << "Sort " << row_num << " rows of SelectedRows";
+  *value = sorted;
+  row_capacity_ = row_num;
+  *rows = std::move(sorted_rows);
+  dst_data_ = value->data();
+}
+
+bool SelectedRowsAccumulator::Merge(phi::SelectedRows* dst) {
+  if (!IsSupported(*dst)) {
+    return false;
+  }
+  if (dst->value().dtype() == phi::DataType::FLOAT32) {
+    if (!IsIndexed(*dst)) {
+      Index<float>(dst);
+    }
+    Sort<float>(dst);
+  } else {
+    if (!IsIndexed(*dst)) {
+      Index<double>(dst);
+    }
+    Sort<double>(dst);
+  }
+  return true;
+}
+
+void SelectedRowsAccumulator::Reset() {
+  dst_ = nullptr;
+  dst_data_ = nullptr;
+  row_index_.clear();
+  row_capacity_ = 0;
+  add_num_ = 0;
+}
+
 void VariableWrapperAdd(std::shared_ptr<VariableWrapper> var,
-                        VariableWrapper* dst_var, bool unchange_input) {
+                        VariableWrapper* dst_var, bool unchange_input,
+                        SelectedRowsAccumulator* selected_rows_accumulator) {
   auto& src = var->Var();
   auto* dst = dst_var->MutableVar();
   if (dst->IsType<framework::LoDTensor>()) {
@@ -629,9 +836,20 @@ void VariableWrapperAdd(std::shared_ptr<VariableWrapper> var,
         SelectedRowsAddToTensor(*dst, src_mutable);
         *dst = std::move(*(var->MutableVar()));
       }
+      if (selected_rows_accumulator != nullptr) {
+        selected_rows_accumulator->Reset();
+      }
     } else if (src.IsType<phi::SelectedRows>()) {
-      auto temp = SelectedRowsMerge<VariableWrapper>(src, *dst);
-      *dst = std::move(*(temp->MutableVar()));
+      if (selected_rows_accumulator == nullptr ||
+          !selected_rows_accumulator->Add(
+              src.Get<phi::SelectedRows>(),
+              dst->GetMutable<phi::SelectedRows>())) {
+        auto temp = SelectedRowsMerge<VariableWrapper>(src, *dst);
+        *dst = std::move(*(temp->MutableVar()));
+        if (selected_rows_accumulator != nullptr) {
+          selected_rows_accumulator->Reset();
+        }
+      }
     } else {
       PADDLE_THROW(platform::errors::InvalidArgument(
           "Unexpected branch, output variable type is %s",
@@ -671,6 +889,8 @@ void GradientAccumulator::AccumulateGrad() {
                         "Interior var of Leaf tensor should be initialized."));
   auto* src = inner_var_->MutableVar();
   auto* dst = var_->MutableVar();
+  // The index of inner_var_ is dropped, and var_ is indexed instead.
+  selected_rows_accumulator_.Reset();
   if (!var_->IsEmpty()) {
     VLOG(6) << "Leaf Var(" << var_->Name()
             << ")'s Gradient has been initizlized, will accumulate on "
@@ -686,8 +906,17 @@ void GradientAccumulator::AccumulateGrad() {
         SelectedRowsAddToTensor(*dst, src);
         *dst = std::move(*src);
       } else if (src->IsType<phi::SelectedRows>()) {
-        auto temp = SelectedRowsMerge<VariableWrapper>(*src, *dst);
-        *dst = std::move(*(temp->MutableVar()));
+        selected_rows_accumulator_.SetExpectedAddNum(1);
+        if (selected_rows_accumulator_.Add(
+                src->Get<phi::SelectedRows>(),
+                dst->GetMutable<phi::SelectedRows>())) {
+          selected_rows_accumulator_.Merge(
+              dst->GetMutable<phi::SelectedRows>());
+        } else {
+          // MergeAdd sorts the rows.
+          auto temp = SelectedRowsMerge<VariableWrapper>(*src, *dst);
+          *dst = std::move(*(temp->MutableVar()));
+        }
       }
     } else {
       PADDLE_THROW(platform::errors::PermissionDenied(
@@ -698,11 +927,17 @@ void GradientAccumulator::AccumulateGrad() {
         << "Leaf Var(" << var_->Name()
         << ")'s Gradient has not been initialized, not accumulate. Just move";
     *(dst) = std::move(*src);
+    // The optimizers take the SelectedRows sorted without duplicated rows.
+    if (dst->IsType<phi::SelectedRows>()) {
+      selected_rows_accumulator_.Merge(dst->GetMutable<phi::SelectedRows>());
+    }
     var_->SetType(inner_var_->Type());
     var_->SetDataType(inner_var_->DataType());
     var_->SetIsEmpty(false);
   }
   inner_var_.reset();
+  // var_ is handed off, and may be cleared or changed out of the accumulator.
+  selected_rows_accumulator_.Reset();
 }
 
 void GradientAccumulator::CallGradientHooks() {
@@ -772,13 +1007,19 @@ void EagerGradientAccumulator::SumGrad(std::shared_ptr<VariableWrapper> var,
 
   auto* dst_var = Var();
   platform::Place place = GetPlaceOfVar(var);
+  selected_rows_accumulator_.SetExpectedAddNum(RefCnt());
+  if (CurCnt() == 0) {
+    // The gradient summed is replaced by the first one.
+    selected_rows_accumulator_.Reset();
+  }
   if (!dst_var->OverridedStopGradient()) {
     if (CurCnt() == 0) {
       MoveOrCopyVar(dst_var->MutableVar(), var->MutableVar(), unchange_input);
     } else {
       VLOG(6) << "Sum Gradient for: " << dst_var->Name()
               << " within this graph.";
-      VariableWrapperAdd(var, dst_var, unchange_input);
+      VariableWrapperAdd(var, dst_var, unchange_input,
+                         &selected_rows_accumulator_);
     }
   } else {
     if (!dst_var->Var().IsInitialized() ||
@@ -820,6 +1061,11 @@ void SortedGradientAccumulator::SumGrad(std::shared_ptr<VariableWrapper> var,
                                         size_t trace_id, bool unchange_input) {
   auto* dst_var = Var();
   platform::Place place = GetPlaceOfVar(var);
+  selected_rows_accumulator_.SetExpectedAddNum(RefCnt());
+  if (CurCnt() == 0) {
+    // The gradient summed is replaced by the first one.
+    selected_rows_accumulator_.Reset();
+  }
   if (!dst_var->OverridedStopGradient()) {
     if (ref_cnt_ == 1) {
       MoveOrCopyVar(dst_var->MutableVar(), var->MutableVar(),
@@ -860,7 +1106,8 @@ void SortedGradientAccumulator::SumGrad(std::shared_ptr<VariableWrapper> var,
             MoveOrCopyVar(dst_var->MutableVar(), var_info.var->MutableVar(),
                           var_info.unchange_input);
           } else {
-            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input);
+            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input,
+                               &selected_rows_accumulator_);
           }
 
           var_info.var = nullptr;
@@ -880,7 +1127,8 @@ void SortedGradientAccumulator::SumGrad(std::shared_ptr<VariableWrapper> var,
             MoveOrCopyVar(dst_var->MutableVar(), var_info.var->MutableVar(),
                           var_info.unchange_input);
           } else {
-            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input);
+            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input,
+                               &selected_rows_accumulator_);
           }
 
           var_info.var = nullptr;
@@ -903,7 +1151,8 @@ void SortedGradientAccumulator::SumGrad(std::shared_ptr<VariableWrapper> var,
             MoveOrCopyVar(dst_var->MutableVar(), var_info.var->MutableVar(),
                           var_info.unchange_input);
           } else {
-            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input);
+            VariableWrapperAdd(var_info.var, dst_var, var_info.unchange_input,
+                               &selected_rows_accumulator_);
           }
           var_info.var = nullptr;
           // Increase count
@@ -15,16 +15,78 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "paddle/fluid/eager/eager_tensor.h"
 #include "paddle/fluid/imperative/hooks.h"
 #include "paddle/fluid/imperative/layer.h"
 #include "paddle/phi/api/include/tensor.h"
+#include "paddle/phi/core/selected_rows.h"
 
 namespace paddle {
 namespace imperative {
 
+/**
+ * Accumulates the SelectedRows gradients on CPU in place.
+ *
+ * MergeAdd merges all the rows again for every gradient added, sorting the
+ * ids and copying the rows. Instead, the rows of the same id are merged here
+ * by a hash index from the id to the row of the accumulated SelectedRows,
+ * whose value is allocated with room for the rows expected, so that the new
+ * rows are appended in place. Merge sorts the rows by id once the
+ * accumulation is done, so the optimizers take them without MergeAdd.
+ *
+ * The index is only valid for the SelectedRows it was built on, so Reset must
+ * be called whenever that SelectedRows is replaced, moved or handed off.
+ */
+class SelectedRowsAccumulator {
+ public:
+  // The number of gradients expected to be added, by which the rows are
+  // reserved.
+  void SetExpectedAddNum(size_t add_num) { expected_add_num_ = add_num; }
+
+  // Adds src to dst. Returns false, leaving dst unchanged, if they are not
+  // supported, i.e. not float or double SelectedRows on CPU of the same
+  // shape.
+  bool Add(const phi::SelectedRows& src, phi::SelectedRows* dst);
+
+  // Merges the duplicated rows of dst in place and sorts them by id, if it is
+  // supported. The optimizers on CPU skip MergeAdd for the rows sorted
+  // without duplicates.
+  bool Merge(phi::SelectedRows* dst);
+
+  // Drops the index of the SelectedRows accumulated.
+  void Reset();
+
+ private:
+  static bool IsSupported(const phi::SelectedRows& selected_rows);
+
+  template <typename T>
+  void Index(phi::SelectedRows* dst);
+
+  template <typename T>
+  void Sort(phi::SelectedRows* dst);
+
+  template <typename T>
+  void AddImpl(const phi::SelectedRows& src, phi::SelectedRows* dst);
+
+  template <typename T>
+  void Reserve(int64_t row_num, phi::SelectedRows* dst);
+
+  bool IsIndexed(const phi::SelectedRows& dst) const;
+
+ private:
+  const phi::SelectedRows* dst_{nullptr};
+  const void* dst_data_{nullptr};
+  // From the id to the row of dst.
+  std::unordered_map<int64_t, int64_t> row_index_;
+  // The rows the value of dst has room for.
+  int64_t row_capacity_{0};
+  size_t expected_add_num_{1};
+  size_t add_num_{0};
+};
+
 class GradientAccumulator {
  public:
   explicit GradientAccumulator(VariableWrapper* var) {
@@ -131,6 +193,7 @@ class GradientAccumulator {
   std::shared_ptr<VariableWrapper> inner_var_;
   size_t ref_cnt_{0};
   size_t cur_cnt_{0};
+  SelectedRowsAccumulator selected_rows_accumulator_;
 };
 
 class EagerGradientAccumulator : public GradientAccumulator {
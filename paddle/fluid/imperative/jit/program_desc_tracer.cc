@@ -126,7 +126,8 @@ void ProgramDescTracer::InsertOp(const std::string &type,
                                  const NameVarBaseMap &inputs,
                                  const NameVarBaseMap &outputs,
                                  const framework::AttributeMap &attrs) {
-  ops_.emplace_back(new OpDescMeta(type, inputs, outputs, attrs));
+  ops_.emplace_back(new OpDescMeta(type, Canonicalize(inputs),
+                                   Canonicalize(outputs), attrs));
   auto &new_op = ops_.back();
   for (auto &pair : new_op->Inputs()) {
     for (auto &var : pair.second) {
@@ -148,6 +149,104 @@ void ProgramDescTracer::InsertOp(const std::string &type,
   // TODO(jiabin): Support this later.
 }
 
+void ProgramDescTracer::InsertGradOp(const std::string &type,
+                                     const NameVarMap<VariableWrapper> &inputs,
+                                     const NameVarMap<VariableWrapper> &outputs,
+                                     const framework::AttributeMap &attrs) {
+  auto to_var_base_map = [this](const NameVarMap<VariableWrapper> &vars) {
+    NameVarBaseMap var_bases;
+    for (auto &pair : vars) {
+      auto &var_base_list = var_bases[pair.first];
+      for (auto &var : pair.second) {
+        if (IsTraceable(var)) {
+          var_base_list.emplace_back(VarOf(var));
+        }
+      }
+    }
+    return var_bases;
+  };
+  VLOG(5) << "Trace grad op " << type << " into ProgramDesc";
+  InsertOp(type, to_var_base_map(inputs), to_var_base_map(outputs), attrs);
+}
+
+void ProgramDescTracer::InsertGradSum(
+    const std::shared_ptr<VariableWrapper> &src,
+    const std::shared_ptr<VariableWrapper> &dst, bool accumulate) {
+  // The src may be moved to dst already, so it is traced only if it is not
+  // output by the grad ops traced.
+  auto src_var = VarOf(src);
+  if (!IsTraceable(dst) || (vars_.count(src_var) == 0 && !IsTraceable(src))) {
+    return;
+  }
+  auto dst_var = VarOf(dst);
+  if (accumulate) {
+    InsertOp("sum", {{"X", {dst_var, src_var}}}, {{"Out", {dst_var}}}, {});
+  } else {
+    InsertOp("assign", {{"X", {src_var}}}, {{"Out", {dst_var}}}, {});
+  }
+}
+
+void ProgramDescTracer::InsertGradFill(
+    const std::shared_ptr<VariableWrapper> &var, float value) {
+  if (!IsTraceable(var)) {
+    return;
+  }
+  const auto &tensor = var->Var().Get<framework::LoDTensor>();
+  framework::AttributeMap attrs;
+  attrs["shape"] = phi::vectorize<int64_t>(tensor.dims());
+  attrs["dtype"] =
+      static_cast<int>(framework::TransToProtoVarType(tensor.dtype()));
+  attrs["value"] = value;
+  InsertOp("fill_constant", {}, {{"Out", {VarOf(var)}}}, attrs);
+}
+
+void ProgramDescTracer::SetUncapturable(const std::string &reason) {
+  if (uncapturable_reason_.empty()) {
+    VLOG(3) << "The ops traced cannot be captured: " << reason;
+    uncapturable_reason_ = reason;
+  }
+}
+
+std::shared_ptr<VarBase> ProgramDescTracer::VarOf(
+    const std::shared_ptr<VariableWrapper> &var) {
+  auto &var_base = wrapper_vars_[var.get()];
+  if (!var_base) {
+    var_base = std::make_shared<VarBase>(var);
+  }
+  return var_base;
+}
+
+NameVarBaseMap ProgramDescTracer::Canonicalize(const NameVarBaseMap &vars) {
+  NameVarBaseMap canonical_vars(vars);
+  for (auto &pair : canonical_vars) {
+    for (auto &var : pair.second) {
+      if (!var) {
+        continue;
+      }
+      auto &var_base = wrapper_vars_[var->SharedVar().get()];
+      if (!var_base) {
+        var_base = var;
+      } else {
+        var = var_base;
+      }
+    }
+  }
+  return canonical_vars;
+}
+
+bool ProgramDescTracer::IsTraceable(
+    const std::shared_ptr<VariableWrapper> &var) {
+  if (!var || !var->Var().IsInitialized()) {
+    return false;
+  }
+  if (!var->Var().IsType<framework::LoDTensor>()) {
+    SetUncapturable("the grad var " + var->Name() + " is of type " +
+                    framework::ToTypeName(var->Var().Type()));
+    return false;
+  }
+  return var->Var().Get<framework::LoDTensor>().IsInitialized();
+}
+
 TracedProgramTuple ProgramDescTracer::CreateProgramDesc(
     const std::vector<std::shared_ptr<VarBase>> &feed_vars,
     const std::string &feed_prefix,
@@ -269,6 +368,8 @@ void ProgramDescTracer::Reset() {
   ops_.clear();
   vars_.clear();
   non_exist_input_vars_.clear();
+  wrapper_vars_.clear();
+  uncapturable_reason_.clear();
 }
 
 }  // namespace jit
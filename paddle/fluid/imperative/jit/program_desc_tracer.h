@@ -19,6 +19,7 @@
 #include <set>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -65,6 +66,31 @@ class ProgramDescTracer {
                 const NameTensorMap &outputs,
                 const framework::AttributeMap &attrs);
 
+  // Records a grad op run by the BasicEngine. The vars not initialized are
+  // left out, since a grad op may not compute all of its outputs.
+  void InsertGradOp(const std::string &type,
+                    const NameVarMap<VariableWrapper> &inputs,
+                    const NameVarMap<VariableWrapper> &outputs,
+                    const framework::AttributeMap &attrs);
+
+  // Records summing the grad src into the grad dst, or assigning src to dst
+  // if accumulate is false. It is called after the BasicEngine does it.
+  void InsertGradSum(const std::shared_ptr<VariableWrapper> &src,
+                     const std::shared_ptr<VariableWrapper> &dst,
+                     bool accumulate);
+
+  // Records filling the grad var with the value, e.g. the grad of the loss.
+  void InsertGradFill(const std::shared_ptr<VariableWrapper> &var,
+                      float value);
+
+  // Marks the ops traced as not able to be run without the tracer, e.g.
+  // since the backward runs the hooks of the user.
+  void SetUncapturable(const std::string &reason);
+
+  const std::string &UncapturableReason() const {
+    return uncapturable_reason_;
+  }
+
   TracedProgramTuple CreateProgramDesc(
       const std::vector<std::shared_ptr<VarBase>> &feed_vars,
       const std::string &feed_prefix,
@@ -77,10 +103,23 @@ class ProgramDescTracer {
   void InsertVarIfNotExist(const std::shared_ptr<VarBase> &new_var,
                            bool is_input);
 
+  // Returns the VarBase traced for the VariableWrapper, so that the ops on
+  // the same var are traced on the same VarBase.
+  std::shared_ptr<VarBase> VarOf(const std::shared_ptr<VariableWrapper> &var);
+
+  NameVarBaseMap Canonicalize(const NameVarBaseMap &vars);
+
+  bool IsTraceable(const std::shared_ptr<VariableWrapper> &var);
+
  private:
   std::vector<std::unique_ptr<OpDescMeta>> ops_;
   VarDescMetaMap vars_;
   VarBaseSet non_exist_input_vars_;
+  // Holds the vars traced until Reset, since the backward refers to the
+  // forward vars by their VariableWrappers after the VarBases are released.
+  std::unordered_map<const VariableWrapper *, std::shared_ptr<VarBase>>
+      wrapper_vars_;
+  std::string uncapturable_reason_;
 };
 
 }  // namespace jit
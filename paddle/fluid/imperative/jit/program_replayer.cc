@@ -0,0 +1,224 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/imperative/jit/program_replayer.h"
+
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+#include "paddle/fluid/framework/new_executor/standalone_executor.h"
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/imperative/tracer.h"
+
+namespace paddle {
+namespace imperative {
+namespace jit {
+
+struct ProgramReplayer::CapturedProgram {
+  platform::Place place;
+  framework::ProgramDesc startup_program;
+  std::unique_ptr<framework::ProgramDesc> program;
+  // The feeds not used by the step are left out of the program.
+  std::vector<size_t> feed_indices;
+  std::vector<std::string> feed_names;
+  std::vector<std::string> fetch_names;
+  std::vector<std::shared_ptr<VarBase>> persistable_vars;
+  std::vector<std::string> persistable_signatures;
+  framework::Scope scope;
+  std::unique_ptr<framework::StandaloneExecutor> executor;
+};
+
+static std::string TensorSignature(const VarBase &var) {
+  const auto &inner_var = var.Var();
+  if (!inner_var.IsInitialized() ||
+      !inner_var.IsType<framework::LoDTensor>()) {
+    return "-";
+  }
+  const auto &tensor = inner_var.Get<framework::LoDTensor>();
+  if (!tensor.IsInitialized()) {
+    return "-";
+  }
+  std::ostringstream os;
+  os << tensor.dims() << ";" << tensor.dtype() << ";" << tensor.place();
+  return os.str();
+}
+
+ProgramReplayer::ProgramReplayer(const StepFunction &step,
+                                 size_t max_program_num)
+    : step_(step), max_program_num_(max_program_num) {}
+
+ProgramReplayer::~ProgramReplayer() = default;
+
+size_t ProgramReplayer::ProgramNum() const {
+  size_t num = 0;
+  for (auto &pair : programs_) {
+    if (pair.second) {
+      ++num;
+    }
+  }
+  return num;
+}
+
+std::vector<std::shared_ptr<VarBase>> ProgramReplayer::Run(
+    const std::vector<std::shared_ptr<VarBase>> &feeds,
+    const std::string &key) {
+  auto &tracer = GetCurrentTracer();
+  PADDLE_ENFORCE_NOT_NULL(
+      tracer, platform::errors::PreconditionNotMet(
+                  "ProgramReplayer runs the step in dygraph mode only."));
+
+  std::ostringstream os;
+  os << key << "|" << tracer->HasGrad() << "|"
+     << static_cast<int>(tracer->GetAmpLevel());
+  for (auto &feed : feeds) {
+    os << "|" << TensorSignature(*feed);
+  }
+  auto signature = os.str();
+
+  auto iter = programs_.find(signature);
+  if (iter == programs_.end()) {
+    if (programs_.size() >= max_program_num_) {
+      VLOG(3) << "Run the step eagerly, since " << programs_.size()
+              << " signatures are captured already";
+      return step_(feeds);
+    }
+    return Capture(signature, feeds);
+  }
+
+  auto *captured = iter->second.get();
+  if (captured == nullptr) {
+    return step_(feeds);
+  }
+  for (size_t i = 0; i < captured->persistable_vars.size(); ++i) {
+    auto &var = captured->persistable_vars[i];
+    if (TensorSignature(*var) != captured->persistable_signatures[i]) {
+      VLOG(3) << "Run the step eagerly, since " << var->Name()
+              << " has changed from " << captured->persistable_signatures[i]
+              << " to " << TensorSignature(*var);
+      return step_(feeds);
+    }
+  }
+  return Replay(captured, feeds);
+}
+
+std::vector<std::shared_ptr<VarBase>> ProgramReplayer::Capture(
+    const std::string &signature,
+    const std::vector<std::shared_ptr<VarBase>> &feeds) {
+  auto &tracer = GetCurrentTracer();
+  // Traced by the TracedLayer outside.
+  if (tracer->IsProgramDescTracingEnabled()) {
+    return step_(feeds);
+  }
+
+  auto *program_desc_tracer = tracer->GetProgramDescTracer();
+  program_desc_tracer->Reset();
+  tracer->SetEnableProgramDescTracing(true);
+  std::vector<std::shared_ptr<VarBase>> outs;
+  try {
+    outs = step_(feeds);
+  } catch (...) {
+    tracer->SetEnableProgramDescTracing(false);
+    program_desc_tracer->Reset();
+    throw;
+  }
+  tracer->SetEnableProgramDescTracing(false);
+
+  auto reason = program_desc_tracer->UncapturableReason();
+  for (auto &out : outs) {
+    if (reason.empty() && (!out || !program_desc_tracer->ContainVar(out))) {
+      reason = "an output is not computed by the ops traced";
+    }
+  }
+  auto &captured = programs_[signature];
+  if (!reason.empty()) {
+    LOG(WARNING) << "The step is run eagerly, since " << reason;
+    program_desc_tracer->Reset();
+    return outs;
+  }
+
+  captured.reset(new CapturedProgram());
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    if (program_desc_tracer->ContainVar(feeds[i])) {
+      captured->feed_indices.emplace_back(i);
+    }
+  }
+  auto traced = program_desc_tracer->CreateProgramDesc(feeds, "feed_", outs,
+                                                       "fetch_", "tmp_");
+  program_desc_tracer->Reset();
+  captured->program = std::move(std::get<0>(traced));
+  captured->feed_names = std::move(std::get<1>(traced));
+  captured->fetch_names = std::move(std::get<2>(traced));
+  captured->persistable_vars = std::move(std::get<3>(traced));
+  for (auto &var : captured->persistable_vars) {
+    captured->persistable_signatures.emplace_back(TensorSignature(*var));
+    // Created before the executor, which syncs the vars of the scope.
+    captured->scope.Var(var->Name())->GetMutable<framework::LoDTensor>();
+  }
+  captured->place = tracer->ExpectedPlace();
+  captured->executor.reset(new framework::StandaloneExecutor(
+      captured->place, captured->startup_program, *captured->program,
+      &captured->scope));
+  VLOG(3) << "Capture the step of " << captured->program->Block(0).OpSize()
+          << " ops for " << signature;
+  return outs;
+}
+
+std::vector<std::shared_ptr<VarBase>> ProgramReplayer::Replay(
+    CapturedProgram *captured,
+    const std::vector<std::shared_ptr<VarBase>> &feeds) {
+  auto &persistable_vars = captured->persistable_vars;
+  std::vector<framework::LoDTensor *> persistable_tensors;
+  persistable_tensors.reserve(persistable_vars.size());
+  for (auto &var : persistable_vars) {
+    auto *tensor = captured->scope.FindVar(var->Name())
+                       ->GetMutable<framework::LoDTensor>();
+    tensor->ShareDataWith(var->Var().Get<framework::LoDTensor>());
+    persistable_tensors.emplace_back(tensor);
+  }
+
+  std::vector<framework::LoDTensor> feed_tensors;
+  feed_tensors.reserve(captured->feed_indices.size());
+  for (auto i : captured->feed_indices) {
+    feed_tensors.emplace_back(feeds[i]->Var().Get<framework::LoDTensor>());
+  }
+
+  auto fetches = captured->executor->Run(captured->feed_names, feed_tensors,
+                                         captured->fetch_names);
+  ++replay_num_;
+
+  // The ops writing the vars in place may reallocate them.
+  for (size_t i = 0; i < persistable_vars.size(); ++i) {
+    persistable_vars[i]
+        ->MutableVar()
+        ->GetMutable<framework::LoDTensor>()
+        ->ShareDataWith(*persistable_tensors[i]);
+  }
+
+  auto &tracer = GetCurrentTracer();
+  std::vector<std::shared_ptr<VarBase>> outs;
+  outs.reserve(fetches.size());
+  for (auto &fetch : fetches) {
+    auto out = std::make_shared<VarBase>(false, tracer->GenerateUniqueName());
+    *out->MutableVar()->GetMutable<framework::LoDTensor>() =
+        BOOST_GET_CONST(framework::LoDTensor, fetch);
+    outs.emplace_back(std::move(out));
+  }
+  return outs;
+}
+
+}  // namespace jit
+}  // namespace imperative
+}  // namespace paddle
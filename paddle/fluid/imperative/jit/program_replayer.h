@@ -0,0 +1,88 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/imperative/layer.h"
+#include "paddle/fluid/platform/macros.h"
+
+namespace paddle {
+namespace imperative {
+namespace jit {
+
+using StepFunction = std::function<std::vector<std::shared_ptr<VarBase>>(
+    const std::vector<std::shared_ptr<VarBase>> &)>;
+
+// Runs a training step of static shapes without tracing its ops one by one.
+// The first run with the feeds of a signature, i.e. their dims, dtypes and
+// places along with the key, traces the forward, backward and optimizer ops
+// of the step into a program. The later runs with the feeds of the same
+// signature run the program by the StandaloneExecutor instead, binding the
+// feeds and the vars kept across the steps, e.g. the parameters, to it.
+//
+// The step is run eagerly if the signature is not captured and there are
+// max_program_num captured already, if the vars kept across the steps have
+// changed their dims or dtypes, or if the step cannot be captured, e.g.
+// since the backward runs hooks. The program does not follow the control
+// flow of the step, so the key should tell the control flows apart.
+//
+// The grads of the parameters are computed in the program, and are written
+// back only if they are accumulated across the steps, i.e. not cleared when
+// the step is captured. Clearing them is not traced, so it should be done
+// outside the step. The outputs replayed are fetched to the CPU.
+class ProgramReplayer {
+  DISABLE_COPY_AND_ASSIGN(ProgramReplayer);
+
+ public:
+  explicit ProgramReplayer(const StepFunction &step,
+                           size_t max_program_num = 4);
+
+  ~ProgramReplayer();
+
+  std::vector<std::shared_ptr<VarBase>> Run(
+      const std::vector<std::shared_ptr<VarBase>> &feeds,
+      const std::string &key = "");
+
+  size_t ProgramNum() const;
+
+  size_t ReplayNum() const { return replay_num_; }
+
+ private:
+  struct CapturedProgram;
+
+  std::vector<std::shared_ptr<VarBase>> Capture(
+      const std::string &signature,
+      const std::vector<std::shared_ptr<VarBase>> &feeds);
+
+  std::vector<std::shared_ptr<VarBase>> Replay(
+      CapturedProgram *captured,
+      const std::vector<std::shared_ptr<VarBase>> &feeds);
+
+ private:
+  StepFunction step_;
+  size_t max_program_num_;
+  size_t replay_num_{0};
+  // The programs by the signatures, nullptr if the step cannot be captured.
+  std::unordered_map<std::string, std::unique_ptr<CapturedProgram>> programs_;
+};
+
+}  // namespace jit
+}  // namespace imperative
+}  // namespace paddle
@@ -14,6 +14,8 @@
 
 #include "paddle/fluid/imperative/prepared_operator.h"
 
+#include <unordered_map>
+
 #include "paddle/fluid/eager/eager_tensor.h"
 #include "paddle/fluid/framework/data_type_transform.h"
 #include "paddle/fluid/framework/details/nan_inf_utils.h"
@@ -32,6 +34,7 @@
 DECLARE_bool(check_nan_inf);
 DECLARE_bool(benchmark);
 DECLARE_bool(run_kp_kernel);
+DECLARE_bool(dygraph_dispatch_cache);
 
 namespace paddle {
 namespace imperative {
@@ -125,30 +128,161 @@ PreparedOp::PreparedOp(const framework::OperatorBase& op,
       pt_kernel_signature_(kernel_signature),
       pt_kernel_(pt_kernel) {}
 
+namespace {
+
+// The kernel chosen for an op call.
+struct KernelChoice {
+  framework::OpKernelType kernel_type;
+  bool run_phi_kernel;
+  framework::KernelSignature kernel_signature;
+  phi::Kernel pt_kernel;
+  framework::OperatorWithKernel::OpKernelFunc func;
+  platform::DeviceContext* dev_ctx;
+};
+
+using DispatchSignature = paddle::SmallVector<size_t, 32>;
+
+// Appends the types of vars to signature. Returns false if the kernel choice
+// may depend on more than the types, e.g. the vars are tensor arrays.
 template <typename VarType>
-PreparedOp PrepareImpl(const NameVarMap<VarType>& ins,
-                       const NameVarMap<VarType>& outs,
-                       const framework::OperatorWithKernel& op,
-                       const platform::Place& place,
-                       const framework::AttributeMap& attrs,
-                       const framework::AttributeMap& default_attrs) {
-  platform::DeviceContextPool& pool = platform::DeviceContextPool::Instance();
-  auto* dev_ctx = pool.Get(place);
+bool AppendDispatchSignature(const NameVarMap<VarType>& vars,
+                             DispatchSignature* signature) {
+  for (auto& pair : vars) {
+    signature->push_back(std::hash<std::string>()(pair.first));
+    signature->push_back(pair.second.size());
+    for (auto& var : pair.second) {
+      if (var == nullptr || !var->Var().IsInitialized()) {
+        signature->push_back(0);
+        continue;
+      }
+      const auto* tensor = GetTensorFromVar(var->Var());
+      if (tensor == nullptr) {
+        return false;
+      }
+      signature->push_back(static_cast<size_t>(var->Var().Type()) + 1);
+      signature->push_back(tensor->IsInitialized());
+      if (tensor->IsInitialized()) {
+        signature->push_back(static_cast<size_t>(tensor->dtype()));
+        signature->push_back(static_cast<size_t>(tensor->layout()));
+        signature->push_back(static_cast<size_t>(tensor->place().GetType()));
+        signature->push_back(
+            static_cast<size_t>(tensor->place().GetDeviceId()));
+        signature->push_back(tensor->numel() == 0);
+      }
+    }
+  }
+  return true;
+}
 
-  framework::RuntimeContext ctx({}, {});
+// The kernels chosen for the op calls on the current thread. A later call of
+// the op with the same attributes, place and types of inputs and outputs
+// chooses the same kernel, so it reuses the choice.
+class DispatchCache {
+ public:
+  static DispatchCache& Instance() {
+    thread_local DispatchCache cache;
+    return cache;
+  }
 
-#ifdef PADDLE_WITH_MKLDNN
-  // MKLDNN variant of code reads attributes in some of GetKernelTypeForVar and
-  // GetKernelType functions, so we need to copy the attributes there.
-  // Const qualifier of Attrs had to be discarded to overwrite it.
-  if (FLAGS_use_mkldnn) {
-    auto& mutable_op_attrs = const_cast<framework::AttributeMap&>(op.Attrs());
-    mutable_op_attrs = default_attrs;
-    for (auto& attr : attrs) {
-      mutable_op_attrs[attr.first] = attr.second;
+  static size_t Key(const std::string& op_type, const platform::Place& place,
+                    const DispatchSignature& signature) {
+    size_t key = std::hash<std::string>()(op_type);
+    key = HashCombine(key, static_cast<size_t>(place.GetType()));
+    key = HashCombine(key, static_cast<size_t>(place.GetDeviceId()));
+    for (auto value : signature) {
+      key = HashCombine(key, value);
     }
+    return key;
   }
-#endif
+
+  const KernelChoice* Find(size_t key, const std::string& op_type,
+                           const platform::Place& place,
+                           const DispatchSignature& signature,
+                           const framework::AttributeMap& attrs) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return nullptr;
+    }
+    for (auto& entry : it->second) {
+      if (entry.op_type == op_type && entry.place == place &&
+          entry.signature == signature && entry.attrs == attrs) {
+        return &entry.choice;
+      }
+    }
+    return nullptr;
+  }
+
+  void Insert(size_t key, const std::string& op_type,
+              const platform::Place& place, const DispatchSignature& signature,
+              const framework::AttributeMap& attrs,
+              const KernelChoice& choice) {
+    if (size_ >= kMaxSize) {
+      Clear();
+    }
+    auto& entries = entries_[key];
+    // The calls differ in the attributes only, e.g. the offsets of slice,
+    // are not worth caching.
+    if (entries.size() >= kMaxEntriesPerKey) {
+      return;
+    }
+    entries.push_back(Entry{op_type, place, signature, attrs, choice});
+    ++size_;
+  }
+
+  size_t Size() const { return size_; }
+
+  void Clear() {
+    entries_.clear();
+    size_ = 0;
+  }
+
+ private:
+  static constexpr size_t kMaxSize = 4096;
+  static constexpr size_t kMaxEntriesPerKey = 8;
+
+  struct Entry {
+    std::string op_type;
+    platform::Place place;
+    DispatchSignature signature;
+    framework::AttributeMap attrs;
+    KernelChoice choice;
+  };
+
+  static size_t HashCombine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+  }
+
+  std::unordered_map<size_t, std::vector<Entry>> entries_;
+  size_t size_{0};
+};
+
+PreparedOp MakePreparedOp(const framework::OperatorWithKernel& op,
+                          const framework::RuntimeContext& ctx,
+                          const KernelChoice& choice) {
+  if (choice.run_phi_kernel) {
+    return PreparedOp(op, ctx, choice.kernel_type, choice.kernel_signature,
+                      choice.pt_kernel, choice.dev_ctx);
+  }
+  return PreparedOp(op, ctx, choice.kernel_type, choice.func, choice.dev_ctx);
+}
+
+}  // namespace
+
+size_t DygraphDispatchCacheSize() { return DispatchCache::Instance().Size(); }
+
+void ClearDygraphDispatchCache() { DispatchCache::Instance().Clear(); }
+
+template <typename VarType>
+static KernelChoice ChooseKernel(const NameVarMap<VarType>& ins,
+                                 const NameVarMap<VarType>& outs,
+                                 const framework::OperatorWithKernel& op,
+                                 const platform::Place& place,
+                                 const framework::AttributeMap& attrs,
+                                 const framework::AttributeMap& default_attrs,
+                                 const framework::RuntimeContext& ctx) {
+  platform::DeviceContextPool& pool = platform::DeviceContextPool::Instance();
+  auto* dev_ctx = pool.Get(place);
+
   // NOTE(zhiqiu): for kernels on given device, for example NPU, the order to
   // choose is:
   // phi npu kernel > fluid npu kernel > phi cpu kernel > fluid cpu kernel
@@ -191,8 +325,8 @@ PreparedOp PrepareImpl(const NameVarMap<VarType>& ins,
       }
 
       // TODO(chenweihang): using CPUKernel when miss device kernel case
-      return PreparedOp(op, ctx, expected_kernel_key, pt_kernel_signature,
-                        pt_kernel, dev_ctx);
+      return KernelChoice{expected_kernel_key, true, pt_kernel_signature,
+                          pt_kernel, nullptr, dev_ctx};
     } else {
       VLOG(6) << "Dynamic mode ChoosePhiKernel - kernel `" << pt_kernel_name
               << "` not found.";
@@ -220,8 +354,8 @@ PreparedOp PrepareImpl(const NameVarMap<VarType>& ins,
                 << " | kernel key: " << pt_cpu_kernel_key
                 << " | kernel: " << pt_cpu_kernel;
         auto* cpu_ctx = pool.Get(paddle::platform::CPUPlace());
-        return PreparedOp(op, ctx, expected_kernel_key, pt_kernel_signature,
-                          pt_cpu_kernel, cpu_ctx);
+        return KernelChoice{expected_kernel_key, true, pt_kernel_signature,
+                            pt_cpu_kernel, nullptr, cpu_ctx};
       }
     }
   }
@@ -310,7 +444,57 @@ PreparedOp PrepareImpl(const NameVarMap<VarType>& ins,
     dev_ctx = pool.Get(expected_kernel_key.place_);
   }
 
-  return PreparedOp(op, ctx, expected_kernel_key, kernel_iter->second, dev_ctx);
+  return KernelChoice{expected_kernel_key, false, framework::KernelSignature(),
+                      phi::Kernel(), kernel_iter->second, dev_ctx};
+}
+
+template <typename VarType>
+PreparedOp PrepareImpl(const NameVarMap<VarType>& ins,
+                       const NameVarMap<VarType>& outs,
+                       const framework::OperatorWithKernel& op,
+                       const platform::Place& place,
+                       const framework::AttributeMap& attrs,
+                       const framework::AttributeMap& default_attrs) {
+  framework::RuntimeContext ctx({}, {});
+
+#ifdef PADDLE_WITH_MKLDNN
+  // MKLDNN variant of code reads attributes in some of GetKernelTypeForVar and
+  // GetKernelType functions, so we need to copy the attributes there.
+  // Const qualifier of Attrs had to be discarded to overwrite it.
+  if (FLAGS_use_mkldnn) {
+    auto& mutable_op_attrs = const_cast<framework::AttributeMap&>(op.Attrs());
+    mutable_op_attrs = default_attrs;
+    for (auto& attr : attrs) {
+      mutable_op_attrs[attr.first] = attr.second;
+    }
+  }
+#endif
+
+  // The MKLDNN kernels are chosen by the thread local states besides the
+  // types of the inputs, so they are not cached.
+  DispatchSignature signature;
+  bool use_cache = FLAGS_dygraph_dispatch_cache && !FLAGS_use_mkldnn &&
+                   AppendDispatchSignature(ins, &signature) &&
+                   AppendDispatchSignature(outs, &signature);
+  size_t key = 0;
+  if (use_cache) {
+    key = DispatchCache::Key(op.Type(), place, signature);
+    auto* choice = DispatchCache::Instance().Find(key, op.Type(), place,
+                                                  signature, attrs);
+    if (choice != nullptr) {
+      VLOG(6) << "Dynamic mode PrepareImpl - reuse the kernel of "
+              << op.Type() << " | kernel key: " << choice->kernel_type;
+      return MakePreparedOp(op, ctx, *choice);
+    }
+  }
+
+  auto choice =
+      ChooseKernel<VarType>(ins, outs, op, place, attrs, default_attrs, ctx);
+  if (use_cache) {
+    DispatchCache::Instance().Insert(key, op.Type(), place, signature, attrs,
+                                     choice);
+  }
+  return MakePreparedOp(op, ctx, choice);
 }
 
 PreparedOp PreparedOp::Prepare(const NameVarMap<VarBase>& ins,
@@ -209,6 +209,12 @@ class PreparedOp {
   phi::Kernel pt_kernel_;
 };
 
+// The number of the kernel choices cached for the op calls on the current
+// thread, see FLAGS_dygraph_dispatch_cache.
+size_t DygraphDispatchCacheSize();
+
+void ClearDygraphDispatchCache();
+
 const inline framework::Attribute& GetAttr(
     const framework::AttributeMap& attrs,
     const framework::AttributeMap& default_attrs, const std::string& name) {
@@ -14,6 +14,7 @@
 
 #include "paddle/fluid/imperative/reducer.h"
 
+#include <chrono>  // NOLINT
 #include <iostream>
 
 #include "paddle/fluid/framework/tensor_util.h"
@@ -25,7 +26,20 @@
 
 #include "paddle/fluid/imperative/parallel_context.h"
 
+#include "paddle/fluid/platform/flags.h"
 #include "paddle/phi/core/dense_tensor.h"
+
+PADDLE_DEFINE_EXPORTED_bool(
+    reducer_grad_as_group_view, false,
+    "Whether the dense gradients reduced by Gloo on CPU are kept as the views "
+    "of the fused tensors of their groups, which saves copying them. The "
+    "gradients of a group are then overwritten by the next step.");
+PADDLE_DEFINE_EXPORTED_int32(
+    reducer_adaptive_group_steps, 0,
+    "The number of steps to measure the allreduce time of Gloo on CPU in, "
+    "before regrouping the gradients by the group size fitted to it. 0 means "
+    "the groups are not adapted.");
+
 namespace paddle {
 namespace imperative {
 
@@ -379,6 +393,31 @@ void Group::SplitTensors(const platform::DeviceContext &context) {
   }
 }
 
+void Group::ConcatTensorsExceptViews(const platform::DeviceContext &context) {
+  auto *contents = dense_contents_.GetMutable<framework::LoDTensor>();
+  int64_t offset = 0;
+  for (size_t i = 0; i < dense_tensors_.size(); ++i) {
+    const auto length = static_cast<int64_t>(length_[i]);
+    auto slice = contents->Slice(offset, offset + length);
+    const auto &tensor = dense_tensors_[i];
+    if (tensor.Holder() != slice.Holder() ||
+        tensor.offset() != slice.offset()) {
+      framework::TensorCopy(tensor, context.GetPlace(), context, &slice);
+    }
+    offset += length;
+  }
+}
+
+void Group::ViewTensorsInContents() {
+  const auto &contents = dense_contents_.Get<framework::LoDTensor>();
+  int64_t offset = 0;
+  for (size_t i = 0; i < dense_tensors_.size(); ++i) {
+    const auto length = static_cast<int64_t>(length_[i]);
+    dense_tensors_[i].ShareDataWith(contents.Slice(offset, offset + length));
+    offset += length;
+  }
+}
+
 std::ostream &operator<<(std::ostream &out, const Group &group) {
   const auto &vars = group.variable_indices_;
   out << "numel: " << group.all_length_ << " ;is_sparse: " << group.is_sparse_
@@ -415,6 +454,12 @@ Reducer::Reducer(const std::vector<std::shared_ptr<imperative::VarBase>> &vars,
 #ifdef PADDLE_WITH_XPU_BKCL
   comm_pool_.reset(new ::ThreadPool(1));
   comm_op_count_ = 0;
+#elif defined(PADDLE_WITH_GLOO)
+  if (platform::is_cpu_place(parallel_ctx->GetDeviceContext(0)->GetPlace())) {
+    comm_pool_.reset(new ::ThreadPool(1));
+    grad_as_group_view_ = FLAGS_reducer_grad_as_group_view;
+    adaptive_group_steps_ = FLAGS_reducer_adaptive_group_steps;
+  }
 #endif
   // initialize groups
   InitializeGroups(group_indices);
@@ -737,8 +782,9 @@ void Reducer::AddDistHook(size_t var_index) {
 
   local_used_vars_[var_index] = 1;
 
-  // rebuild group when find_unused_vars_each_step_ is false
-  if (NeedRebuildGroup()) {
+  // rebuild group when find_unused_vars_each_step_ is false, or when the
+  // groups are adapted after this step
+  if (NeedRebuildGroup() || NeedAdaptGroupSize()) {
     rebuild_vars_.push_back(vars_[var_index]);
     rebuild_var_indices_.push_back(var_index);
   }
@@ -906,27 +952,16 @@ void Reducer::MarkGroupReady(size_t group_index) {
     // it here.
     parallel_ctx_->WaitCompute(run_order);
 #ifdef PADDLE_WITH_XPU_BKCL
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      comm_op_count_ += 1;  // lock
-    }
-    // TODO(liuyuhui): Add try catch to deal with exception later,
-    // otherwise the main thread will continue to run when an exception is
-    // thrown in comm_pool_.
-    auto next_group = next_group_;
-    comm_pool_->enqueue([this, run_order, next_group, &group] {
-      auto dev_id = place_.device;
-      platform::SetXPUDeviceId(dev_id);
-      FusedAllReduceSchedule(run_order, group, next_group);
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        comm_op_count_ -= 1;  // lock
-        cv_.notify_all();
-      }
-    });
+    EnqueueFusedAllReduce(run_order, &group, next_group_);
 #elif defined(PADDLE_WITH_RCCL) || defined(PADDLE_WITH_NCCL) ||    \
     defined(PADDLE_WITH_GLOO) || defined(PADDLE_WITH_ASCEND_CL) || \
     defined(PADDLE_WITH_CNCL)
+#ifdef PADDLE_WITH_GLOO
+    if (comm_pool_ != nullptr) {
+      EnqueueFusedAllReduce(run_order, &group, next_group_);
+      continue;
+    }
+#endif
     FusedAllReduceSchedule(run_order, group, next_group_);
 #else
     PADDLE_THROW(platform::errors::PreconditionNotMet(
@@ -935,6 +970,44 @@ void Reducer::MarkGroupReady(size_t group_index) {
   }
 }
 
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
+void Reducer::EnqueueFusedAllReduce(const int run_order, Group *group,
+                                    const int curr_group_index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    comm_op_count_ += 1;  // lock
+  }
+  comm_pool_->enqueue([this, run_order, group, curr_group_index] {
+#ifdef PADDLE_WITH_XPU_BKCL
+    auto dev_id = place_.device;
+    platform::SetXPUDeviceId(dev_id);
+#endif
+    std::exception_ptr exception = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exception = comm_exception_;
+    }
+    // The groups after a failed one are not reduced, since the ranks may be
+    // out of step.
+    if (exception == nullptr) {
+      try {
+        FusedAllReduceSchedule(run_order, *group, curr_group_index);
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (comm_exception_ == nullptr) {
+        comm_exception_ = exception;
+      }
+      comm_op_count_ -= 1;  // lock
+      cv_.notify_all();
+    }
+  });
+}
+#endif
+
 void Reducer::FusedAllReduceSchedule(const int run_order, Group &group,
                                      const int curr_group_index) {
   // The overall timeline: concat > div_nranks > allreduce > split
@@ -951,7 +1024,11 @@ void Reducer::FusedAllReduceSchedule(const int run_order, Group &group,
             << "] start allreduce in ring[" << run_order << "]";
     // Select common commstream to concat tensors
     // group.dense_tensors ---> group.dense_contents_
-    group.ConcatTensors(dev_context);
+    if (grad_as_group_view_) {
+      group.ConcatTensorsExceptViews(dev_context);
+    } else {
+      group.ConcatTensors(dev_context);
+    }
 
 // NOTE(liuyuhui): ConcatTensors use communication stream, but BKCL only support
 // default stream for communicating, so there exist some problems in
@@ -966,16 +1043,43 @@ void Reducer::FusedAllReduceSchedule(const int run_order, Group &group,
 
     group.DivNRanks(dev_context, nranks_);
     // Start allreduce
+    auto start = std::chrono::steady_clock::now();
     parallel_ctx_->AllReduceByStream(
         group.dense_contents_, &(group.dense_contents_), run_order, false);
+    if (finished_steps_ < adaptive_group_steps_) {
+      // The allreduce of Gloo is synchronous, so it is timed here.
+      std::chrono::duration<double> time =
+          std::chrono::steady_clock::now() - start;
+      double bytes = static_cast<double>(group.all_length_) *
+                     framework::SizeOfType(group.dtype_);
+      allreduce_samples_.emplace_back(bytes, time.count());
+    }
 
-    // Select communication stream to split tensors
-    // group.dense_contents_ ---> group.dense_tensors
-    group.SplitTensors(dev_context);
+    if (grad_as_group_view_) {
+      // The gradients become the views of group.dense_contents_
+      group.ViewTensorsInContents();
+      for (size_t i = 0; i < group.variable_indices_.size(); ++i) {
+        const auto var_index = group.variable_indices_[i];
+        if (!HasGrad(var_index)) {
+          continue;
+        }
+        auto *grad_tensor = vars_[var_index]
+                                ->GradVarBase()
+                                ->MutableVar()
+                                ->GetMutable<framework::LoDTensor>();
+        auto dims = grad_tensor->dims();
+        grad_tensor->ShareDataWith(group.dense_tensors_[i]).Resize(dims);
+      }
+    } else {
+      // Select communication stream to split tensors
+      // group.dense_contents_ ---> group.dense_tensors
+      group.SplitTensors(dev_context);
+    }
   }
 }
 
-std::vector<std::vector<size_t>> Reducer::RebuildGruops() {
+std::vector<std::vector<size_t>> Reducer::RebuildGruops(
+    const std::vector<size_t> &group_size_limits) {
   VLOG(3) << "The order of parameter arrival: "
           << string::join_strings(rebuild_var_indices_, ',');
 
@@ -988,7 +1092,7 @@ std::vector<std::vector<size_t>> Reducer::RebuildGruops() {
   std::reverse(rebuild_vars_.begin(), rebuild_vars_.end());
   std::reverse(rebuild_var_indices_.begin(), rebuild_var_indices_.end());
   auto rebuild_group_indices =
-      AssignGroupBySize(rebuild_vars_, is_sparse_gradient_, group_size_limits_,
+      AssignGroupBySize(rebuild_vars_, is_sparse_gradient_, group_size_limits,
                         rebuild_var_indices_);
   has_rebuilt_group_ = true;
   rebuild_vars_.clear();
@@ -1063,6 +1167,87 @@ void Reducer::ProcessUnusedDenseVars() {
   }
 }
 
+// Fit the allreduce time t = latency + bytes / bandwidth to the samples, and
+// return the group size whose latency is 10% of its allreduce time, or 0 if
+// the samples can not be fitted.
+size_t FitGroupSize(
+    const std::vector<std::pair<double, double>> &samples) {
+  if (samples.size() < 2) {
+    return 0;
+  }
+  double mean_bytes = 0, mean_time = 0;
+  for (const auto &sample : samples) {
+    mean_bytes += sample.first;
+    mean_time += sample.second;
+  }
+  mean_bytes /= samples.size();
+  mean_time /= samples.size();
+  double var_bytes = 0, cov = 0;
+  for (const auto &sample : samples) {
+    var_bytes += (sample.first - mean_bytes) * (sample.first - mean_bytes);
+    cov += (sample.first - mean_bytes) * (sample.second - mean_time);
+  }
+  if (var_bytes <= 0 || cov <= 0) {
+    return 0;
+  }
+  double time_per_byte = cov / var_bytes;
+  double latency = mean_time - time_per_byte * mean_bytes;
+  if (latency <= 0) {
+    return 0;
+  }
+  return static_cast<size_t>(9 * latency / time_per_byte);
+}
+
+void Reducer::AdaptGroupSize() {
+  const size_t kMinGroupSize = 64 * 1024;
+  const size_t kMaxGroupSize = 256 * 1024 * 1024;
+  size_t group_size = FitGroupSize(allreduce_samples_);
+  allreduce_samples_.clear();
+
+  // The ranks must have the same groups, so they use the mean of the group
+  // sizes fitted by them.
+  std::vector<int64_t> sizes = {static_cast<int64_t>(group_size),
+                                group_size > 0 ? 1 : 0};
+  framework::Variable sizes_var;
+  auto *sizes_tensor = sizes_var.GetMutable<framework::LoDTensor>();
+  framework::TensorFromVector<int64_t>(sizes, sizes_tensor);
+  parallel_ctx_->AllReduceByStream(sizes_var, &sizes_var, 0, true);
+  framework::TensorToVector<int64_t>(*sizes_tensor, &sizes);
+  std::vector<size_t> group_size_limits = group_size_limits_;
+  if (sizes[1] == 0) {
+    VLOG(3) << "The allreduce time can not be fitted, keep the group size.";
+  } else {
+    group_size = static_cast<size_t>(sizes[0] / sizes[1]);
+    group_size =
+        (std::min)((std::max)(group_size, kMinGroupSize), kMaxGroupSize);
+    VLOG(3) << "Regroup the vars by the fitted group size " << group_size;
+    group_size_limits = {group_size_limits_.front(), group_size};
+  }
+
+  bool regroup = true;
+  if (rebuild_vars_.size() == vars_.size()) {
+    // The vars are grouped in the arrival order of their gradients in the
+    // last step measured, as RebuildGruops does.
+    group_indices_ = RebuildGruops(group_size_limits);
+  } else if (sizes[1] != 0) {
+    // Some gradients did not arrive, so the vars are grouped in their own
+    // order. Same as the groups made by DataParallel, the first vars, whose
+    // gradients are ready last, are in the last group, limited by the first
+    // size.
+    auto group_indices =
+        AssignGroupBySize(vars_, is_sparse_gradient_, group_size_limits);
+    std::reverse(group_indices.begin(), group_indices.end());
+    group_indices_ = std::move(group_indices);
+  } else {
+    regroup = false;
+  }
+  rebuild_vars_.clear();
+  rebuild_var_indices_.clear();
+  if (regroup) {
+    InitializeGroups(group_indices_);
+  }
+}
+
 bool Reducer::HasGrad(size_t var_index) {
   const auto grad_var = vars_[var_index]->GradVarBase();
   if (!grad_var || !grad_var->Var().IsInitialized()) {
@@ -1088,10 +1273,15 @@ bool Reducer::HasGrad(size_t var_index) {
 void Reducer::FinalizeBackward() {
   groups_need_finalize_ = false;
   grad_need_hooks_ = false;
-#ifdef PADDLE_WITH_XPU_BKCL
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
   {
     std::unique_lock<std::mutex> lock(mutex_);
     cv_.wait(lock, [&] { return comm_op_count_ == 0; });
+    if (comm_exception_ != nullptr) {
+      auto exception = comm_exception_;
+      comm_exception_ = nullptr;
+      std::rethrow_exception(exception);
+    }
   }
 #endif
 
@@ -1100,9 +1290,16 @@ void Reducer::FinalizeBackward() {
     parallel_ctx_->WaitComm(i);
   }
 
-  if (NeedRebuildGroup()) {
+  // The groups adapted in this step are rebuilt by AdaptGroupSize.
+  const bool adapt_group_size = NeedAdaptGroupSize();
+  if (finished_steps_ < adaptive_group_steps_) {
+    ++finished_steps_;
+  }
+  if (adapt_group_size) {
+    AdaptGroupSize();
+  } else if (NeedRebuildGroup()) {
     VLOG(3) << "Start rebuilding the groups";
-    auto rebuild_group_indices = RebuildGruops();
+    auto rebuild_group_indices = RebuildGruops(group_size_limits_);
     group_indices_ = std::move(rebuild_group_indices);
     InitializeGroups(group_indices_);
   }
@@ -15,6 +15,7 @@
 #pragma once
 #include <ThreadPool.h>
 #include <algorithm>
+#include <exception>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -108,6 +109,14 @@ class Group {
   // context is used to select the stream for split
   void SplitTensors(const platform::DeviceContext& context);
 
+  // For CPU, only the dense_tensors_ which are not the views of
+  // dense_contents_ are copied into it.
+  void ConcatTensorsExceptViews(const platform::DeviceContext& context);
+
+  // For CPU, let the dense_tensors_ be the views of dense_contents_ instead
+  // of splitting dense_contents_ into them.
+  void ViewTensorsInContents();
+
   // use it in CUDA
   void DivNRanks(framework::Tensor* tensor, int64_t nranks,
                  const platform::DeviceContext& context);
@@ -153,16 +162,35 @@ class Reducer {
   void FusedAllReduceSchedule(const int run_order, Group& group,  // NOLINT
                               const int curr_group_index);
 
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
+  // Run FusedAllReduceSchedule on comm_pool_, the exception thrown there is
+  // rethrown by FinalizeBackward.
+  void EnqueueFusedAllReduce(const int run_order, Group* group,
+                             const int curr_group_index);
+#endif
+
   void FinalizeBackward();
 
-  std::vector<std::vector<size_t>> RebuildGruops();
+  std::vector<std::vector<size_t>> RebuildGruops(
+      const std::vector<size_t>& group_size_limits);
 
   inline bool NeedRebuildGroup() {
     return !has_rebuilt_group_ && !find_unused_vars_each_step_;
   }
 
+  // Whether the groups are adapted after the current step, the last one
+  // measured.
+  inline bool NeedAdaptGroupSize() {
+    return adaptive_group_steps_ > 0 &&
+           finished_steps_ + 1 == adaptive_group_steps_;
+  }
+
   void ProcessUnusedDenseVars();
 
+  // Regroup the vars by the group size fitted to the measured allreduce
+  // time, the same on all the ranks.
+  void AdaptGroupSize();
+
   bool HasGrad(size_t var_index);
 
   void TraverseBackwardGraph(
@@ -197,14 +225,30 @@ class Reducer {
   bool find_unused_vars_each_step_{false};
   bool find_unused_vars_once_{true};
   bool groups_need_finalize_{false};
-#ifdef PADDLE_WITH_XPU_BKCL
-  // comm_pool_ is used for scheduling allreduce in multi Kunlun cards training.
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
+  // comm_pool_ is used for scheduling allreduce in multi Kunlun cards training,
+  // and in CPU training with Gloo, whose allreduce blocks the caller, to
+  // overlap it with the backward of the groups not ready yet.
   std::unique_ptr<::ThreadPool> comm_pool_{nullptr};
-  uint32_t comm_op_count_;
+  uint32_t comm_op_count_{0};
+  std::exception_ptr comm_exception_{nullptr};
   std::mutex mutex_;
   std::condition_variable cv_;
 #endif
 
+  // For CPU, the dense gradients are kept as the views of the fused
+  // contents of their groups after allreduce, so that they need not be split
+  // out of the contents, and the ones accumulated in place in the next step
+  // need not be concatenated, see FLAGS_reducer_grad_as_group_view.
+  bool grad_as_group_view_{false};
+
+  // Following variables are to help adapt the group size to the allreduce
+  // time measured in the first steps, see FLAGS_reducer_adaptive_group_steps.
+  int adaptive_group_steps_{0};
+  int finished_steps_{0};
+  // The bytes and the seconds of the allreduce of the dense groups.
+  std::vector<std::pair<double, double>> allreduce_samples_;
+
   // grad_need_hooks_ is used to mark whether gradient synchronization is
   // required across process. The default value is false. When backward()
   // is called, grad_need_hooks_ will be assigned to true during preparation
@@ -230,6 +274,10 @@ std::vector<std::vector<size_t>> AssignGroupBySize(
     const std::vector<bool>& is_sparse_gradient,
     const std::vector<size_t>& group_size_limits,
     const std::vector<int64_t>& tensor_indices = {});
+
+// Returns the group size fitted to the samples of the bytes and the seconds
+// of allreduce, or 0 if they can not be fitted.
+size_t FitGroupSize(const std::vector<std::pair<double, double>>& samples);
 #endif
 
 }  // namespace imperative
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -78,6 +80,67 @@ TEST(Test__SelectedRowsMerge_Test, SelectedRowsMerge) {
   }
 }
 
+TEST(Test__SelectedRowsAccumulator_Test, SelectedRowsAccumulator) {
+  phi::CPUPlace cpu;
+  int64_t table_size = 10;
+  int64_t embedding_width = 8;
+
+  // Each row is filled with its id.
+  auto make_selected_rows = [&](const std::vector<int64_t>& rows) {
+    phi::SelectedRows selected_rows(rows, table_size);
+    auto* value = selected_rows.mutable_value();
+    value->Resize(phi::make_ddim(
+        {static_cast<int64_t>(rows.size()), embedding_width}));
+    auto* data = value->mutable_data<float>(cpu);
+    for (size_t i = 0; i < rows.size(); ++i) {
+      for (int64_t j = 0; j < embedding_width; ++j) {
+        data[i * embedding_width + j] = static_cast<float>(rows[i]);
+      }
+    }
+    return selected_rows;
+  };
+
+  auto dst = make_selected_rows({3, 1, 3});
+  auto src1 = make_selected_rows({1, 5, 5});
+  auto src2 = make_selected_rows({7, 3});
+
+  SelectedRowsAccumulator accumulator;
+  accumulator.SetExpectedAddNum(3);
+  ASSERT_TRUE(accumulator.Add(src1, &dst));
+  ASSERT_TRUE(accumulator.Add(src2, &dst));
+
+  // The duplicated rows are merged in the order they are added.
+  std::vector<int64_t> expected_rows{3, 1, 5, 7};
+  std::vector<float> expected_values{9, 2, 10, 7};
+  ASSERT_EQ(dst.rows(), expected_rows);
+  ASSERT_EQ(dst.value().dims(), phi::make_ddim({4, embedding_width}));
+  auto* data = dst.value().data<float>();
+  for (size_t i = 0; i < expected_rows.size(); ++i) {
+    for (int64_t j = 0; j < embedding_width; ++j) {
+      EXPECT_EQ(data[i * embedding_width + j], expected_values[i]);
+    }
+  }
+
+  // The rows are sorted by id when the accumulation is done.
+  ASSERT_TRUE(accumulator.Merge(&dst));
+  std::vector<int64_t> sorted_rows{1, 3, 5, 7};
+  std::vector<float> sorted_values{2, 9, 10, 7};
+  ASSERT_EQ(dst.rows(), sorted_rows);
+  // No room is kept for more rows once the rows are sorted.
+  EXPECT_EQ(dst.value().Holder()->size(),
+            sorted_rows.size() * embedding_width * sizeof(float));
+  data = dst.value().data<float>();
+  for (size_t i = 0; i < sorted_rows.size(); ++i) {
+    for (int64_t j = 0; j < embedding_width; ++j) {
+      EXPECT_EQ(data[i * embedding_width + j], sorted_values[i]);
+    }
+  }
+
+  // Only the float and double SelectedRows on CPU are accumulated.
+  phi::SelectedRows empty({}, table_size);
+  EXPECT_FALSE(accumulator.Add(empty, &dst));
+}
+
 template <typename Place1, typename Place2, typename T>
 int TensorddTest(Place1 place1, Place2 place2, T t1, T t2) {
   framework::Variable var1;
@@ -472,6 +535,83 @@ static void TestGradientAccumulatorTestUnchangeInput(
   }
 }
 
+// The optimizers on CPU skip MergeAdd for the rows sorted without duplicates.
+static bool IsStrictSorted(const std::vector<int64_t>& rows) {
+  for (size_t i = 1; i < rows.size(); ++i) {
+    if (rows[i - 1] >= rows[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(test_gradient_accumulator, test_selected_rows_sorted) {
+  int64_t height = 10;
+  int64_t width = 4;
+  // Each row of the gradient is filled with its id.
+  auto create_var = [&](const std::string& name,
+                        const std::vector<int64_t>& rows) {
+    auto var = std::make_shared<VariableWrapper>(name);
+    auto* selected_rows = var->MutableVar()->GetMutable<phi::SelectedRows>();
+    selected_rows->set_height(height);
+    *selected_rows->mutable_rows() = rows;
+    auto* value = selected_rows->mutable_value();
+    value->Resize(phi::make_ddim({static_cast<int64_t>(rows.size()), width}));
+    auto* data = value->mutable_data<float>(platform::CPUPlace());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      std::fill(data + i * width, data + (i + 1) * width,
+                static_cast<float>(rows[i]));
+    }
+    var->SetType(framework::proto::VarType::SELECTED_ROWS);
+    var->SetDataType(framework::proto::VarType::FP32);
+    return var;
+  };
+  auto expect_var = [&](const VariableWrapper& var,
+                        const std::vector<int64_t>& rows,
+                        const std::vector<float>& values) {
+    const auto& selected_rows = var.Var().Get<phi::SelectedRows>();
+    EXPECT_TRUE(IsStrictSorted(selected_rows.rows()));
+    ASSERT_EQ(selected_rows.rows(), rows);
+    const float* data = selected_rows.value().data<float>();
+    for (size_t i = 0; i < rows.size(); ++i) {
+      for (int64_t j = 0; j < width; ++j) {
+        EXPECT_EQ(data[i * width + j], values[i]);
+      }
+    }
+  };
+
+  for (auto sort_gradient : {false, true}) {
+    auto g_var = std::make_shared<VariableWrapper>("g_var");
+    g_var->SetOverridedStopGradient(false);
+
+    // The gradients summed in this graph are moved to the leaf gradient.
+    auto g_accum = CreateAccumulator(g_var, sort_gradient);
+    g_accum->IncreaseRefCnt();
+    g_accum->IncreaseRefCnt();
+    g_accum->SumGrad(create_var("g1", {7, 2, 7}), 0, false);
+    g_accum->SumGrad(create_var("g2", {5, 2}), 1, false);
+    ASSERT_TRUE(g_accum->SumGradCompleted());
+    g_accum->AccumulateGrad();
+    expect_var(*g_var, {2, 5, 7}, {4, 5, 14});
+
+    // A single gradient is merged and sorted as well.
+    auto g_var_single = std::make_shared<VariableWrapper>("g_var_single");
+    g_var_single->SetOverridedStopGradient(false);
+    auto g_accum_single = CreateAccumulator(g_var_single, sort_gradient);
+    g_accum_single->IncreaseRefCnt();
+    g_accum_single->SumGrad(create_var("g3", {9, 0, 9}), 0, false);
+    g_accum_single->AccumulateGrad();
+    expect_var(*g_var_single, {0, 9}, {0, 18});
+
+    // The gradient of another graph is accumulated on the leaf gradient.
+    g_accum = CreateAccumulator(g_var, sort_gradient);
+    g_accum->IncreaseRefCnt();
+    g_accum->SumGrad(create_var("g4", {8, 1, 5}), 0, false);
+    g_accum->AccumulateGrad();
+    expect_var(*g_var, {1, 2, 5, 7, 8}, {1, 4, 10, 14, 8});
+  }
+}
+
 TEST(test_gradient_accumulator, test_unchange_input) {
   for (auto sort_gradient : {false, true}) {
     TestGradientAccumulatorTestUnchangeInput(platform::CPUPlace(),
@@ -12,11 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <mutex>   // NOLINT
 #include <sstream>
 #include <string>
+#include <thread>  // NOLINT
 #include "gtest/gtest.h"
 
+#include "paddle/fluid/imperative/parallel_context.h"
 #include "paddle/fluid/imperative/reducer.h"
+#include "paddle/fluid/imperative/tracer.h"
+#include "paddle/phi/core/kernel_registry.h"
+
+#if defined(PADDLE_WITH_GLOO) && !defined(PADDLE_WITH_XPU_BKCL)
+PD_DECLARE_KERNEL(add, CPU, ALL_LAYOUT);
+PD_DECLARE_KERNEL(add_grad, CPU, ALL_LAYOUT);
+
+DECLARE_int32(reducer_adaptive_group_steps);
+#endif
 
 namespace paddle {
 namespace imperative {
@@ -135,6 +150,34 @@ void GroupConcatSplit(Place place, size_t size) {
   }
 }
 
+TEST(TestGroup, TestConcatExceptViews) {
+  platform::CPUPlace place;
+  auto* dev_ctx = platform::DeviceContextPool::Instance().Get(place);
+  Group group;
+  group.length_ = {2, 3};
+  group.all_length_ = 5;
+  group.dtype_ = framework::proto::VarType::FP32;
+  group.dense_tensors_.resize(2);
+  auto* contents = group.dense_contents_.GetMutable<framework::LoDTensor>();
+  contents->Resize({5}).mutable_data<float>(place);
+
+  // [[1.0, 1.0], [2.0, 2.0, 2.0]], only the first one is a view of contents
+  group.ViewTensorsInContents();
+  auto* view_data = group.dense_tensors_[0].data<float>();
+  ASSERT_EQ(view_data, contents->data<float>());
+  std::fill(view_data, view_data + 2, 1.0f);
+  framework::Tensor other;
+  auto* other_data = other.Resize({3}).mutable_data<float>(place);
+  std::fill(other_data, other_data + 3, 2.0f);
+  group.dense_tensors_[1].ShareDataWith(other);
+
+  group.ConcatTensorsExceptViews(*dev_ctx);
+  std::vector<float> expected = {1.0f, 1.0f, 2.0f, 2.0f, 2.0f};
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(contents->data<float>()[i], expected[i]);
+  }
+}
+
 #if defined(PADDLE_WITH_NCCL) || defined(PADDLE_WITH_RCCL)
 TEST(TestGroup, TestConcatSplit) {
   platform::CUDAPlace cuda_place(0);
@@ -196,5 +239,222 @@ TEST(TestGroup, TestMLUConcatSplit) {
   GroupConcatSplit<float>(mlu_place, size);
 }
 #endif
+
+#if defined(PADDLE_WITH_GLOO) && !defined(PADDLE_WITH_XPU_BKCL)
+TEST(TestGroup, TestFitGroupSize) {
+  // t = 1e-4 + 1e-9 * bytes, whose latency is 10% of the time of 9e5 bytes
+  std::vector<std::pair<double, double>> samples;
+  for (double bytes : {1e4, 1e5, 1e6, 4e6}) {
+    samples.emplace_back(bytes, 1e-4 + 1e-9 * bytes);
+  }
+  EXPECT_NEAR(static_cast<double>(FitGroupSize(samples)), 9e5, 1.0);
+
+  // too few samples
+  EXPECT_EQ(FitGroupSize({{1e4, 1e-4}}), 0UL);
+  // the same bytes
+  EXPECT_EQ(FitGroupSize({{1e4, 1e-4}, {1e4, 2e-4}}), 0UL);
+  // no latency
+  EXPECT_EQ(FitGroupSize({{1e4, 1e-6}, {1e5, 1e-4}}), 0UL);
+}
+
+// A CPU context of one rank, whose dense allreduce records the values in the
+// groups, and can be blocked until released or fail, as Gloo does.
+class FakeGlooContext : public ParallelContext {
+ public:
+  FakeGlooContext()
+      : ParallelContext(ParallelStrategy(), platform::CPUPlace()) {}
+
+  void Init() override {}
+
+  void InitWithRingID(int ring_id) override {}
+
+  void AllReduceByStream(const framework::Variable& src,
+                         framework::Variable* dst, int ring_id,
+                         bool use_calc_stream) override {
+    const auto& tensor = src.Get<framework::LoDTensor>();
+    if (use_calc_stream) {
+      // the group size fitted by all the ranks
+      if (framework::TransToProtoVarType(tensor.dtype()) ==
+              framework::proto::VarType::INT64 &&
+          tensor.numel() == 2) {
+        auto* sizes = dst->GetMutable<framework::LoDTensor>();
+        sizes->mutable_data<int64_t>(platform::CPUPlace())[0] = fitted_size_;
+        sizes->mutable_data<int64_t>(platform::CPUPlace())[1] = 1;
+      }
+      return;
+    }
+    if (release_.valid()) {
+      release_.wait_for(std::chrono::seconds(10));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_ids_.push_back(std::this_thread::get_id());
+    PADDLE_ENFORCE_EQ(fail_, false, platform::errors::Unavailable(
+                                        "The allreduce is failed."));
+    // the distinct values of the vars in the group in turn
+    std::vector<float> values;
+    const float* data = tensor.data<float>();
+    for (int64_t i = 0; i < tensor.numel(); ++i) {
+      if (values.empty() || values.back() != data[i]) {
+        values.push_back(data[i]);
+      }
+    }
+    groups_.push_back(values);
+  }
+
+  void Broadcast(framework::Variable* src, int ring_id) override {}
+
+  platform::DeviceContext* GetDeviceContext(int ring_id) override {
+    return platform::DeviceContextPool::Instance().Get(platform::CPUPlace());
+  }
+
+  void WaitCompute(int ring_id) override {}
+
+  void WaitComm(int ring_id) override {}
+
+  void SynchronizeCompute() override {}
+
+  std::vector<std::vector<float>> Groups() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return groups_;
+  }
+
+  std::vector<std::thread::id> ThreadIds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return thread_ids_;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    groups_.clear();
+    thread_ids_.clear();
+  }
+
+  std::shared_future<void> release_;
+  bool fail_{false};
+  int64_t fitted_size_{0};
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::vector<float>> groups_;
+  std::vector<std::thread::id> thread_ids_;
+};
+
+// The vars of numel each, whose gradients are filled with their indices, and
+// the outputs of the forward using them.
+static void PrepareVars(size_t var_num, int64_t numel,
+                        std::vector<std::shared_ptr<VarBase>>* vars,
+                        std::vector<std::shared_ptr<VarBase>>* outputs) {
+  platform::CPUPlace place;
+  Tracer tracer;
+  framework::AttributeMap attrs;
+  attrs["use_mkldnn"] = false;
+  std::shared_ptr<VarBase> bias(new VarBase(false, "bias"));
+  bias->MutableVar()->GetMutable<framework::LoDTensor>()->Resize({numel});
+  bias->MutableVar()->GetMutable<framework::LoDTensor>()->mutable_data<float>(
+      place);
+  for (size_t i = 0; i < var_num; ++i) {
+    std::shared_ptr<VarBase> var(new VarBase(true, "x" + std::to_string(i)));
+    var->SetOverridedStopGradient(false);
+    auto* tensor = var->MutableVar()->GetMutable<framework::LoDTensor>();
+    tensor->Resize({numel});
+    tensor->mutable_data<float>(place);
+    std::shared_ptr<VarBase> out(new VarBase(true, "out" + std::to_string(i)));
+    tracer.TraceOp<VarBase>("elementwise_add", {{"X", {var}}, {"Y", {bias}}},
+                            {{"Out", {out}}}, attrs, place, true);
+
+    auto* grad = var->MutableGradVarBase()
+                     ->MutableVar()
+                     ->GetMutable<framework::LoDTensor>();
+    grad->Resize({numel});
+    float* grad_data = grad->mutable_data<float>(place);
+    std::fill(grad_data, grad_data + numel, static_cast<float>(i));
+    vars->push_back(var);
+    outputs->push_back(out);
+  }
+}
+
+TEST(TestGroup, TestGlooAllReduceOverlapBackward) {
+  std::vector<std::shared_ptr<VarBase>> vars, outputs;
+  PrepareVars(2, 4, &vars, &outputs);
+  auto ctx = std::make_shared<FakeGlooContext>();
+  std::promise<void> release;
+  ctx->release_ = release.get_future().share();
+  Reducer reducer(vars, {{0}, {1}}, {false, false}, ctx, {1024}, false);
+
+  reducer.PrepareForBackward(outputs);
+  // The allreduce of the first group is blocked, but the backward goes on.
+  reducer.AddDistHook(0);
+  EXPECT_TRUE(ctx->Groups().empty());
+  release.set_value();
+  // The last group waits for all the allreduce.
+  reducer.AddDistHook(1);
+  auto groups = ctx->Groups();
+  ASSERT_EQ(groups.size(), 2UL);
+  EXPECT_EQ(groups[0], std::vector<float>({0.f}));
+  EXPECT_EQ(groups[1], std::vector<float>({1.f}));
+  for (auto thread_id : ctx->ThreadIds()) {
+    EXPECT_NE(thread_id, std::this_thread::get_id());
+  }
+}
+
+TEST(TestGroup, TestGlooAllReduceException) {
+  std::vector<std::shared_ptr<VarBase>> vars, outputs;
+  PrepareVars(2, 4, &vars, &outputs);
+  auto ctx = std::make_shared<FakeGlooContext>();
+  Reducer reducer(vars, {{0}, {1}}, {false, false}, ctx, {1024}, false);
+
+  ctx->fail_ = true;
+  reducer.PrepareForBackward(outputs);
+  reducer.AddDistHook(0);
+  // The error of the allreduce is rethrown at the end of the backward, and
+  // the groups after the failed one are not reduced.
+  EXPECT_THROW(reducer.AddDistHook(1), platform::EnforceNotMet);
+  EXPECT_EQ(ctx->ThreadIds().size(), 1UL);
+
+  // The error is not rethrown by the next step.
+  ctx->fail_ = false;
+  ctx->Clear();
+  reducer.PrepareForBackward(outputs);
+  reducer.AddDistHook(0);
+  EXPECT_NO_THROW(reducer.AddDistHook(1));
+  EXPECT_EQ(ctx->Groups().size(), 2UL);
+}
+
+TEST(TestGroup, TestGlooAdaptGroupSize) {
+  int adaptive_group_steps = FLAGS_reducer_adaptive_group_steps;
+  FLAGS_reducer_adaptive_group_steps = 1;
+  // 64KB each
+  std::vector<std::shared_ptr<VarBase>> vars, outputs;
+  PrepareVars(4, 16 * 1024, &vars, &outputs);
+  auto ctx = std::make_shared<FakeGlooContext>();
+  ctx->fitted_size_ = 128 * 1024;
+  Reducer reducer(vars, {{0}, {1}, {2}, {3}}, std::vector<bool>(4, false),
+                  ctx, {64 * 1024}, false);
+  FLAGS_reducer_adaptive_group_steps = adaptive_group_steps;
+
+  const std::vector<size_t> arrival_order = {1, 3, 0, 2};
+  reducer.PrepareForBackward(outputs);
+  for (auto var_index : arrival_order) {
+    reducer.AddDistHook(var_index);
+  }
+  EXPECT_EQ(ctx->Groups().size(), 4UL);
+
+  // The vars are regrouped in the arrival order of their gradients, the
+  // first group limited by the first size, and the others by the fitted one.
+  ctx->Clear();
+  reducer.PrepareForBackward(outputs);
+  for (auto var_index : arrival_order) {
+    reducer.AddDistHook(var_index);
+  }
+  EXPECT_EQ(ctx->Groups(), std::vector<std::vector<float>>(
+                               {{1.f}, {0.f, 3.f}, {2.f}}));
+}
+#endif
+
 }  // namespace imperative
 }  // namespace paddle
+
+#if defined(PADDLE_WITH_GLOO) && !defined(PADDLE_WITH_XPU_BKCL)
+USE_OP_ITSELF(elementwise_add);
+USE_OP_ITSELF(elementwise_add_grad);
+#endif
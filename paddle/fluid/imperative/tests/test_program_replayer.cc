@@ -0,0 +1,235 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/imperative/basic_engine.h"
+#include "paddle/fluid/imperative/jit/program_desc_tracer.h"
+#include "paddle/fluid/imperative/jit/program_replayer.h"
+#include "paddle/fluid/imperative/tracer.h"
+#include "paddle/phi/core/kernel_registry.h"
+
+PD_DECLARE_KERNEL(sgd, CPU, ALL_LAYOUT);
+
+namespace paddle {
+namespace imperative {
+namespace jit {
+
+using vb_vector = std::vector<std::shared_ptr<VarBase>>;
+
+// Refills the tensor of var in place with the new dims.
+static void ResetVar(VarBase* var, const std::vector<int64_t>& dims,
+                     float value, float delta = 0.f) {
+  auto* tensor = var->MutableVar()->GetMutable<framework::LoDTensor>();
+  tensor->Resize(phi::make_ddim(dims));
+  auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = value + delta * i;
+  }
+}
+
+static std::shared_ptr<VarBase> CreateVar(const std::string& name,
+                                          const std::vector<int64_t>& dims,
+                                          float value, float delta = 0.f) {
+  std::shared_ptr<VarBase> var(new VarBase(true, name));
+  ResetVar(var.get(), dims, value, delta);
+  return var;
+}
+
+static std::vector<float> ToVector(const VarBase& var) {
+  const auto& tensor = var.Var().Get<framework::LoDTensor>();
+  return std::vector<float>(tensor.data<float>(),
+                            tensor.data<float>() + tensor.numel());
+}
+
+// loss = reduce_sum(x * w), w -= lr * dloss / dw, returning the loss.
+static vb_vector SgdStep(const std::shared_ptr<VarBase>& w,
+                         const std::shared_ptr<VarBase>& lr,
+                         const vb_vector& feeds) {
+  auto& tracer = GetCurrentTracer();
+  platform::CPUPlace place;
+  std::shared_ptr<VarBase> out(new VarBase(true, "out"));
+  framework::AttributeMap mul_attrs;
+  mul_attrs["use_mkldnn"] = false;
+  tracer->TraceOp<VarBase>("mul", {{"X", {feeds[0]}}, {"Y", {w}}},
+                           {{"Out", {out}}}, mul_attrs, place, true);
+  std::shared_ptr<VarBase> loss(new VarBase(true, "loss"));
+  framework::AttributeMap reduce_attrs;
+  reduce_attrs["reduce_all"] = true;
+  tracer->TraceOp<VarBase>("reduce_sum", {{"X", {out}}}, {{"Out", {loss}}},
+                           reduce_attrs, place, true);
+
+  auto* engine = tracer->GetEngine();
+  engine->Init({loss}, {nullptr}, false);
+  engine->Execute();
+
+  tracer->TraceOp<VarBase>(
+      "sgd",
+      {{"Param", {w}}, {"Grad", {w->GradVarBase()}}, {"LearningRate", {lr}}},
+      {{"ParamOut", {w}}}, framework::AttributeMap(), place, false);
+  return {loss};
+}
+
+class ProgramReplayerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    prev_tracer_ = GetCurrentTracer();
+    SetCurrentTracer(std::make_shared<Tracer>());
+    lr_ = CreateVar("lr", {1}, 0.1f);
+    lr_->SetOverridedStopGradient(true);
+  }
+
+  void TearDown() override { SetCurrentTracer(prev_tracer_); }
+
+  std::shared_ptr<VarBase> CreateParam(const std::string& name,
+                                       const std::vector<int64_t>& dims) {
+    auto w = CreateVar(name, dims, 0.5f, 0.1f);
+    w->SetOverridedStopGradient(false);
+    w->SetPersistable(true);
+    return w;
+  }
+
+  // Runs the step on w_eager eagerly and on w_replay by the replayer, and
+  // checks that their losses are the same.
+  void RunBoth(ProgramReplayer* replayer,
+               const std::shared_ptr<VarBase>& w_eager,
+               const std::shared_ptr<VarBase>& w_replay,
+               const std::vector<int64_t>& x_dims, float x_value) {
+    auto eager_loss = SgdStep(w_eager, lr_, {CreateVar("x", x_dims, x_value)});
+    auto replay_loss = replayer->Run({CreateVar("x", x_dims, x_value)});
+    // Cleared out of the step, which is not traced.
+    w_eager->ClearGradient(false);
+    w_replay->ClearGradient(false);
+    ASSERT_EQ(replay_loss.size(), 1UL);
+    EXPECT_EQ(ToVector(*eager_loss[0]), ToVector(*replay_loss[0]));
+  }
+
+  std::shared_ptr<Tracer> prev_tracer_;
+  std::shared_ptr<VarBase> lr_;
+};
+
+TEST_F(ProgramReplayerTest, ReplaySameAsEager) {
+  auto w_eager = CreateParam("w_eager", {3, 2});
+  auto w_replay = CreateParam("w_replay", {3, 2});
+  ProgramReplayer replayer(
+      [&](const vb_vector& feeds) { return SgdStep(w_replay, lr_, feeds); });
+
+  for (int step = 0; step < 4; ++step) {
+    RunBoth(&replayer, w_eager, w_replay, {2, 3}, 1.f + step);
+  }
+  // captured by the first step, and replayed by the others
+  EXPECT_EQ(replayer.ProgramNum(), 1UL);
+  EXPECT_EQ(replayer.ReplayNum(), 3UL);
+  EXPECT_EQ(ToVector(*w_eager), ToVector(*w_replay));
+
+  // The feeds of other dims are captured in another program.
+  RunBoth(&replayer, w_eager, w_replay, {4, 3}, 1.f);
+  RunBoth(&replayer, w_eager, w_replay, {4, 3}, 2.f);
+  EXPECT_EQ(replayer.ProgramNum(), 2UL);
+  EXPECT_EQ(replayer.ReplayNum(), 4UL);
+  EXPECT_EQ(ToVector(*w_eager), ToVector(*w_replay));
+}
+
+TEST_F(ProgramReplayerTest, FallbackToEager) {
+  auto w_eager = CreateParam("w_eager", {3, 2});
+  auto w_replay = CreateParam("w_replay", {3, 2});
+  ProgramReplayer replayer(
+      [&](const vb_vector& feeds) { return SgdStep(w_replay, lr_, feeds); },
+      1 /*max_program_num*/);
+
+  RunBoth(&replayer, w_eager, w_replay, {2, 3}, 1.f);
+  RunBoth(&replayer, w_eager, w_replay, {2, 3}, 2.f);
+  EXPECT_EQ(replayer.ProgramNum(), 1UL);
+  EXPECT_EQ(replayer.ReplayNum(), 1UL);
+
+  // No more programs are captured.
+  RunBoth(&replayer, w_eager, w_replay, {4, 3}, 1.f);
+  RunBoth(&replayer, w_eager, w_replay, {4, 3}, 2.f);
+  EXPECT_EQ(replayer.ProgramNum(), 1UL);
+  EXPECT_EQ(replayer.ReplayNum(), 1UL);
+
+  // The parameter changed to other dims misses the guard of the program.
+  ResetVar(w_eager.get(), {3, 4}, 0.5f, 0.1f);
+  ResetVar(w_replay.get(), {3, 4}, 0.5f, 0.1f);
+  RunBoth(&replayer, w_eager, w_replay, {2, 3}, 1.f);
+  EXPECT_EQ(replayer.ReplayNum(), 1UL);
+  EXPECT_EQ(ToVector(*w_eager), ToVector(*w_replay));
+}
+
+TEST_F(ProgramReplayerTest, HooksNotCapturable) {
+  auto w_eager = CreateParam("w_eager", {3, 2});
+  auto w_replay = CreateParam("w_replay", {3, 2});
+  int hook_num = 0;
+  w_replay->GradVarBase()->AddVoidHook(
+      std::make_shared<std::function<void()>>([&]() { ++hook_num; }));
+  ProgramReplayer replayer(
+      [&](const vb_vector& feeds) { return SgdStep(w_replay, lr_, feeds); });
+
+  for (int step = 0; step < 3; ++step) {
+    RunBoth(&replayer, w_eager, w_replay, {2, 3}, 1.f + step);
+  }
+  // The hook runs in every step, which is run eagerly.
+  EXPECT_EQ(hook_num, 3);
+  EXPECT_EQ(replayer.ProgramNum(), 0UL);
+  EXPECT_EQ(replayer.ReplayNum(), 0UL);
+  EXPECT_EQ(ToVector(*w_eager), ToVector(*w_replay));
+}
+
+// The forward traced by TracedLayer is not changed by the backward run after
+// the tracing.
+TEST_F(ProgramReplayerTest, TracedLayerForwardOnly) {
+  auto& tracer = GetCurrentTracer();
+  auto w = CreateParam("w", {3, 2});
+  auto x = CreateVar("x", {2, 3}, 1.f);
+  platform::CPUPlace place;
+
+  tracer->GetProgramDescTracer()->Reset();
+  tracer->SetEnableProgramDescTracing(true);
+  std::shared_ptr<VarBase> out(new VarBase(true, "out"));
+  framework::AttributeMap mul_attrs;
+  mul_attrs["use_mkldnn"] = false;
+  tracer->TraceOp<VarBase>("mul", {{"X", {x}}, {"Y", {w}}}, {{"Out", {out}}},
+                           mul_attrs, place, true);
+  tracer->SetEnableProgramDescTracing(false);
+
+  auto* engine = tracer->GetEngine();
+  engine->Init({out}, {nullptr}, false);
+  engine->Execute();
+
+  auto traced = tracer->GetProgramDescTracer()->CreateProgramDesc(
+      {x}, "feed_", {out}, "fetch_", "tmp_");
+  tracer->GetProgramDescTracer()->Reset();
+  auto& block = std::get<0>(traced)->Block(0);
+  ASSERT_EQ(block.OpSize(), 1UL);
+  EXPECT_EQ(block.Op(0)->Type(), "mul");
+  EXPECT_EQ(std::get<1>(traced).size(), 1UL);
+  EXPECT_EQ(std::get<2>(traced).size(), 1UL);
+  ASSERT_EQ(std::get<3>(traced).size(), 1UL);
+  EXPECT_EQ(std::get<3>(traced)[0]->Name(), "w");
+}
+
+}  // namespace jit
+}  // namespace imperative
+}  // namespace paddle
+
+USE_OP(mul);
+USE_OP(mul_grad);
+USE_OP_ITSELF(reduce_sum);
+USE_OP_ITSELF(reduce_sum_grad);
+USE_OP_ITSELF(sgd);
@@ -16,6 +16,7 @@
 // Created by Jiabin on 2019-08-16.
 //
 
+#include <chrono>  // NOLINT
 #include <memory>
 #include <set>
 #include <string>
@@ -25,6 +26,7 @@
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/imperative/basic_engine.h"
 #include "paddle/fluid/imperative/execution_context.h"
+#include "paddle/fluid/imperative/prepared_operator.h"
 #include "paddle/fluid/imperative/tracer.h"
 #include "paddle/fluid/memory/memcpy.h"
 #include "paddle/fluid/platform/device_context.h"
@@ -37,6 +39,8 @@ PD_DECLARE_KERNEL(add_grad, GPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(sum_grad, GPU, ALL_LAYOUT);
 #endif
 
+DECLARE_bool(dygraph_dispatch_cache);
+
 namespace imperative = paddle::imperative;
 namespace platform = paddle::platform;
 namespace framework = paddle::framework;
@@ -555,6 +559,75 @@ TEST(test_tracer, test_execution_context) {
   ASSERT_EQ(dy_ctx.OutputName("Out"), framework::kEmptyVarName);
 }
 
+TEST(test_tracer, test_dispatch_cache) {
+  // Trace the same mul many times, choosing the kernel for every call or
+  // reusing the one chosen for the first call.
+  imperative::Tracer tracer;
+  std::shared_ptr<imperative::VarBase> x_in(
+      new imperative::VarBase(true, "x_in"));
+  std::shared_ptr<imperative::VarBase> y_in(
+      new imperative::VarBase(true, "y_in"));
+  std::shared_ptr<imperative::VarBase> vout(
+      new imperative::VarBase(true, "vout"));
+  platform::CPUPlace place;
+  std::vector<float> src_data(10, 2.0);
+  std::vector<int64_t> dims1 = {2, 5};
+  std::vector<int64_t> dims2 = {5, 2};
+
+  auto* x_in_tensor = x_in->MutableVar()->GetMutable<framework::LoDTensor>();
+  auto* y_in_tensor = y_in->MutableVar()->GetMutable<framework::LoDTensor>();
+  x_in_tensor->Resize(phi::make_ddim(dims1));
+  auto* mutable_x = x_in_tensor->mutable_data<float>(place);
+  paddle::memory::Copy(place, mutable_x, place, src_data.data(),
+                       sizeof(float) * src_data.size());
+  y_in_tensor->Resize(phi::make_ddim(dims2));
+  auto* mutable_y = y_in_tensor->mutable_data<float>(place);
+  paddle::memory::Copy(place, mutable_y, place, src_data.data(),
+                       sizeof(float) * src_data.size());
+
+  var_pair x_pair = var_pair("X", vb_vector(1, x_in));
+  var_pair y_pair = var_pair("Y", vb_vector(1, y_in));
+  var_pair out_pair = var_pair("Out", vb_vector(1, vout));
+  imperative::NameVarBaseMap ins = {x_pair, y_pair};
+  imperative::NameVarBaseMap outs = {out_pair};
+  framework::AttributeMap mul_attr_map;
+  mul_attr_map["use_mkldnn"] = false;
+
+  // Returns the time of a call in microseconds.
+  auto trace = [&](bool use_cache) {
+    const int repeat = 1000;
+    FLAGS_dygraph_dispatch_cache = use_cache;
+    ClearDygraphDispatchCache();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      tracer.TraceOp<VarBase>("mul", ins, outs, mul_attr_map, place, false);
+    }
+    std::chrono::duration<double, std::micro> time =
+        std::chrono::steady_clock::now() - start;
+    return time.count() / repeat;
+  };
+
+  double uncached_us = trace(false);
+  ASSERT_EQ(DygraphDispatchCacheSize(), 0UL);
+  double cached_us = trace(true);
+  ASSERT_EQ(DygraphDispatchCacheSize(), 1UL);
+  LOG(INFO) << "Tracing mul takes " << uncached_us << " us per call, and "
+            << cached_us << " us with the dispatch cache.";
+
+  const auto& out_tensor = vout->Var().Get<framework::LoDTensor>();
+  for (int i = 0; i < out_tensor.numel(); i++) {
+    ASSERT_EQ(out_tensor.data<float>()[i], 20.0);
+  }
+
+  // The calls with other attributes choose the kernel again.
+  mul_attr_map["x_num_col_dims"] = 1;
+  tracer.TraceOp<VarBase>("mul", ins, outs, mul_attr_map, place, false);
+  ASSERT_EQ(DygraphDispatchCacheSize(), 2UL);
+
+  FLAGS_dygraph_dispatch_cache = false;
+  ClearDygraphDispatchCache();
+}
+
 TEST(test_tracer, eager_tracer) {
   // Doing an mul
   imperative::Tracer tracer;
@@ -161,6 +161,13 @@ struct Argument {
   // whether to mute all logs in inference.
   DECL_ARGUMENT_FIELD(disable_logs, DisableLogs, bool);
 
+  // The file to write the cost and the effect of every ir pass to, in JSON.
+  DECL_ARGUMENT_FIELD(ir_pass_report_path, IrPassReportPath, std::string);
+  // Whether to apply the ir passes to the sub-blocks too.
+  DECL_ARGUMENT_FIELD(ir_sub_block_optim, IrSubBlockOptim, bool);
+  // Whether to reuse the program optimized for the same model and config.
+  DECL_ARGUMENT_FIELD(optim_program_cache, OptimProgramCache, bool);
+
   // Pass a set of op types to enable its mkldnn kernel
   DECL_ARGUMENT_FIELD(mkldnn_enabled_op_types, MKLDNNEnabledOpTypes,
                       std::unordered_set<std::string>);
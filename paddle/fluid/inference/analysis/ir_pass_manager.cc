@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include "paddle/fluid/inference/analysis/ir_pass_manager.h"
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -23,6 +26,7 @@
 #include "paddle/fluid/framework/ir/fuse_pass_base.h"
 #include "paddle/fluid/framework/ir/graph.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/framework/threadpool.h"
 #include "paddle/fluid/inference/analysis/argument.h"
 #include "paddle/fluid/string/pretty_log.h"
 
@@ -33,6 +37,48 @@ using string::PrettyLogEndl;
 using string::PrettyLog;
 using string::Style;
 
+namespace {
+
+int64_t EdgeNum(const Graph &graph) {
+  int64_t edge_num = 0;
+  for (auto *node : graph.Nodes()) {
+    edge_num += node->outputs.size();
+  }
+  return edge_num;
+}
+
+// The passes which need the whole program or change the parameters can not
+// be applied to a sub-block.
+bool IsSubBlockPass(const std::string &pass_name) {
+  const std::string subgraph_suffix = "_subgraph_pass";
+  bool is_subgraph_pass =
+      pass_name.size() >= subgraph_suffix.size() &&
+      pass_name.compare(pass_name.size() - subgraph_suffix.size(),
+                        subgraph_suffix.size(), subgraph_suffix) == 0;
+  return !is_subgraph_pass && pass_name != "graph_viz_pass";
+}
+
+// Apply the pass to the graph, and record its cost and its effect.
+Graph *ApplyAndRecord(const Pass &pass, Graph *graph, size_t block_id,
+                      std::vector<IrPassStat> *report) {
+  IrPassStat stat;
+  stat.pass = pass.Type();
+  stat.block_id = block_id;
+  int64_t node_num = graph->Nodes().size();
+  int64_t edge_num = EdgeNum(*graph);
+  auto start = std::chrono::steady_clock::now();
+  graph = pass.Apply(graph);
+  stat.time_ms = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  stat.node_delta = static_cast<int64_t>(graph->Nodes().size()) - node_num;
+  stat.edge_delta = EdgeNum(*graph) - edge_num;
+  report->push_back(stat);
+  return graph;
+}
+
+}  // namespace
+
 IRPassManager::IRPassManager(Argument *argument) {
   ARGUMENT_CHECK_FIELD(argument, main_program);
   graph_ = std::unique_ptr<Graph>(new Graph(argument->main_program()));
@@ -45,11 +91,30 @@ IRPassManager::IRPassManager(Argument *argument) {
   }
 
   ARGUMENT_CHECK_FIELD(argument, ir_analysis_passes);
-  CreatePasses(argument, argument->ir_analysis_passes());
+  passes_ = CreatePasses(argument, argument->ir_analysis_passes());
+
+  size_t block_num = argument->main_program().Size();
+  if (argument->ir_sub_block_optim_valid() &&
+      argument->ir_sub_block_optim() && FLAGS_convert_all_blocks &&
+      block_num > 1) {
+    std::vector<std::string> sub_block_pass_names;
+    for (auto &pass_name : argument->ir_analysis_passes()) {
+      if (IsSubBlockPass(pass_name)) {
+        sub_block_pass_names.push_back(pass_name);
+      }
+    }
+    // The passes keep states, e.g. whether they have been applied, so every
+    // sub-block needs its own passes.
+    sub_block_passes_.resize(block_num);
+    for (size_t idx = 1; idx < block_num; ++idx) {
+      sub_block_passes_[idx] = CreatePasses(argument, sub_block_pass_names);
+    }
+  }
 }
 
-void IRPassManager::CreatePasses(Argument *argument,
-                                 const std::vector<std::string> &passes) {
+std::vector<std::unique_ptr<Pass>> IRPassManager::CreatePasses(
+    Argument *argument, const std::vector<std::string> &passes) const {
+  std::vector<std::unique_ptr<Pass>> created_passes;
   std::string pre_pass;
   int pass_num = 0;
   for (const std::string &pass_name : passes) {
@@ -249,8 +314,9 @@ void IRPassManager::CreatePasses(Argument *argument,
     }
     pre_pass = pass_name;
 
-    passes_.emplace_back(std::move(pass));
+    created_passes.emplace_back(std::move(pass));
   }
+  return created_passes;
 }
 
 std::unique_ptr<Graph> IRPassManager::Apply(std::unique_ptr<Graph> graph) {
@@ -259,16 +325,100 @@ std::unique_ptr<Graph> IRPassManager::Apply(std::unique_ptr<Graph> graph) {
   }
   PADDLE_ENFORCE_NOT_NULL(graph.get(), platform::errors::PreconditionNotMet(
                                            "Graph cannot be NULL."));
+  report_.clear();
+
+  // The graphs of the blocks are disjoint, so the sub-blocks are optimized
+  // in the thread pool while the main block is optimized here.
+  std::vector<std::vector<IrPassStat>> sub_block_reports(
+      sub_block_passes_.size());
+  std::vector<std::future<std::unique_ptr<platform::EnforceNotMet>>> futures;
+  if (!sub_block_passes_.empty()) {
+    PADDLE_ENFORCE_EQ(
+        graph->IsMainGraph() &&
+            graph->SubGraphsSize() == sub_block_passes_.size(),
+        true, platform::errors::PreconditionNotMet(
+                  "The graph does not match the program with %d blocks.",
+                  sub_block_passes_.size()));
+  }
+  for (size_t idx = 1; idx < sub_block_passes_.size(); ++idx) {
+    auto *main_graph = graph.get();
+    auto *sub_block_report = &sub_block_reports[idx];
+    futures.emplace_back(framework::ThreadPool::GetInstance()
+                             ->RunAndGetException([=] {
+                               ApplyToSubBlock(main_graph, idx,
+                                               sub_block_report);
+                             }));
+  }
+
   // Apply all the passes
-  for (const auto &pass : passes_) {
-    if (pass->Type() != "graph_viz_pass" && !disable_logs_) {
-      PrettyLogEndl(Style::H2(), "--- Running IR pass [%s]", pass->Type());
+  std::exception_ptr main_block_error;
+  try {
+    for (const auto &pass : passes_) {
+      if (pass->Type() != "graph_viz_pass" && !disable_logs_) {
+        PrettyLogEndl(Style::H2(), "--- Running IR pass [%s]", pass->Type());
+      }
+      graph.reset(ApplyAndRecord(*pass, graph.release(), 0, &report_));
+    }
+  } catch (...) {
+    main_block_error = std::current_exception();
+  }
+  // The tasks refer to the graph, wait for all of them before leaving.
+  std::vector<std::unique_ptr<platform::EnforceNotMet>> errors;
+  for (auto &future : futures) {
+    errors.emplace_back(future.get());
+  }
+  if (main_block_error) {
+    std::rethrow_exception(main_block_error);
+  }
+  for (auto &error : errors) {
+    if (error != nullptr) {
+      throw *error;
     }
-    graph.reset(pass->Apply(graph.release()));
+  }
+  for (auto &sub_block_report : sub_block_reports) {
+    report_.insert(report_.end(), sub_block_report.begin(),
+                   sub_block_report.end());
   }
   return graph;
 }
 
+void IRPassManager::ApplyToSubBlock(Graph *graph, size_t idx,
+                                    std::vector<IrPassStat> *report) const {
+  for (const auto &pass : sub_block_passes_[idx]) {
+    VLOG(3) << "Running IR pass [" << pass->Type() << "] on block " << idx;
+    auto backup = graph->CloneSubGraph(idx);
+    try {
+      ApplyAndRecord(*pass, graph->GetSubGraph(idx), idx, report);
+    } catch (platform::EnforceNotMet &ex) {
+      VLOG(3) << "Roll back IR pass [" << pass->Type() << "] on block " << idx
+              << ": " << ex.what();
+      graph->ReplaceSubGraph(idx, std::move(backup));
+      IrPassStat stat;
+      stat.pass = pass->Type();
+      stat.block_id = idx;
+      stat.applied = false;
+      report->push_back(stat);
+    }
+  }
+}
+
+std::string IRPassManager::ReportToJson(
+    const std::vector<IrPassStat> &report) {
+  std::stringstream ss;
+  ss << "[";
+  for (size_t i = 0; i < report.size(); ++i) {
+    auto &stat = report[i];
+    ss << (i == 0 ? "" : ",") << "\n  {\"pass\": \"" << stat.pass
+       << "\", \"block_id\": " << stat.block_id
+       << ", \"time_ms\": " << stat.time_ms
+       << ", \"node_delta\": " << stat.node_delta
+       << ", \"edge_delta\": " << stat.edge_delta
+       << ", \"applied\": " << (stat.applied ? "true" : "false") << "}";
+  }
+  ss << (report.empty() ? "]" : "\n]");
+  return ss.str();
+}
+
 framework::proto::ProgramDesc IRPassManager::AcquireProgram(
     std::unique_ptr<Graph> *graph, ProgramDesc *program) const {
   auto pass =
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -41,6 +42,17 @@ using framework::ProgramDesc;
 using framework::ir::Graph;
 using framework::ir::Pass;
 
+// The cost and the effect of applying an IR pass to the graph of a block.
+struct IrPassStat {
+  std::string pass;
+  size_t block_id{0};
+  double time_ms{0.};
+  int64_t node_delta{0};
+  int64_t edge_delta{0};
+  // False if the pass failed on a sub-block and the graph was rolled back.
+  bool applied{true};
+};
+
 class IRPassManager final {
  public:
   explicit IRPassManager(Argument *argument);
@@ -52,11 +64,28 @@ class IRPassManager final {
 
   framework::ir::Graph &graph() const { return *graph_; }
 
+  // The stats of the passes applied by Apply(), the ones of the main block
+  // first, and then the ones of the sub-blocks in the order of the blocks.
+  const std::vector<IrPassStat> &report() const { return report_; }
+
+  // The report in JSON, to be consumed by tools.
+  static std::string ReportToJson(const std::vector<IrPassStat> &report);
+
  private:
-  void CreatePasses(Argument *argument, const std::vector<std::string> &passes);
+  std::vector<std::unique_ptr<Pass>> CreatePasses(
+      Argument *argument, const std::vector<std::string> &passes) const;
+
+  // Apply the passes of the sub-block idx to its graph. The passes which
+  // fail on it, e.g. the ones need the parameters, are rolled back.
+  void ApplyToSubBlock(Graph *graph, size_t idx,
+                       std::vector<IrPassStat> *report) const;
 
   std::unique_ptr<Graph> graph_;
   std::vector<std::unique_ptr<Pass>> passes_;
+  // The passes of every sub-block, indexed by the block id, empty if the
+  // sub-blocks are not optimized.
+  std::vector<std::vector<std::unique_ptr<Pass>>> sub_block_passes_;
+  std::vector<IrPassStat> report_;
   bool disable_logs_{false};
 };
 
@@ -13,15 +13,223 @@
 // limitations under the License.
 
 #include "paddle/fluid/inference/analysis/passes/ir_analysis_pass.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <string>
 #include <utility>
+#include <vector>
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/ir/fuse_pass_base.h"
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/inference/analysis/helper.h"
 #include "paddle/fluid/inference/analysis/ir_pass_manager.h"
+#include "paddle/fluid/platform/os_info.h"
+#include "xxhash.h"  // NOLINT
 
 namespace paddle {
 namespace inference {
 namespace analysis {
 
+namespace {
+
+// The names of the initialized persistable tensors of the program, sorted.
+std::vector<std::string> PersistableTensors(
+    const framework::ProgramDesc& program, const framework::Scope& scope) {
+  std::set<std::string> names;
+  for (size_t i = 0; i < program.Size(); ++i) {
+    for (auto* var : program.Block(i).AllVars()) {
+      if (!var->Persistable() ||
+          var->GetType() != framework::proto::VarType::LOD_TENSOR) {
+        continue;
+      }
+      auto* scope_var = scope.FindVar(var->Name());
+      if (scope_var != nullptr && scope_var->IsType<framework::LoDTensor>() &&
+          scope_var->Get<framework::LoDTensor>().IsInitialized()) {
+        names.insert(var->Name());
+      }
+    }
+  }
+  return std::vector<std::string>(names.begin(), names.end());
+}
+
+// The optimized program depends on the program, the parameters and the
+// passes with their settings, so a hash of them keys the cache.
+std::string OptimProgramCacheKey(Argument* argument) {
+  XXH64_state_t* state = XXH64_createState();
+  XXH64_reset(state, 0);
+  auto update = [state](const std::string& data) {
+    XXH64_update(state, data.data(), data.size());
+    XXH64_update(state, ";", 1);
+  };
+
+  auto& program = argument->main_program();
+  update(program.Proto()->SerializeAsString());
+  for (auto& pass : argument->ir_analysis_passes()) update(pass);
+  update(std::to_string(argument->use_gpu()));
+  update(std::to_string(argument->use_fc_padding_valid() &&
+                        argument->use_fc_padding()));
+  if (argument->mkldnn_enabled_op_types_valid()) {
+    std::set<std::string> op_types(argument->mkldnn_enabled_op_types().begin(),
+                                   argument->mkldnn_enabled_op_types().end());
+    for (auto& op_type : op_types) update(op_type);
+  }
+#ifdef PADDLE_WITH_MKLDNN
+  if (argument->bfloat16_enabled_op_types_valid()) {
+    std::set<std::string> op_types(
+        argument->bfloat16_enabled_op_types().begin(),
+        argument->bfloat16_enabled_op_types().end());
+    for (auto& op_type : op_types) update(op_type);
+  }
+#endif
+
+  auto& scope = argument->scope();
+  for (auto& name : PersistableTensors(program, scope)) {
+    auto& tensor = scope.FindVar(name)->Get<framework::LoDTensor>();
+    update(name);
+    update(tensor.dims().to_str());
+    auto type = framework::TransToProtoVarType(tensor.dtype());
+    update(std::to_string(static_cast<int>(type)));
+    if (platform::is_cpu_place(tensor.place())) {
+      XXH64_update(state, tensor.data(),
+                   tensor.numel() * framework::SizeOfType(type));
+    }
+  }
+
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx",
+           static_cast<unsigned long long>(XXH64_digest(state)));  // NOLINT
+  XXH64_freeState(state);
+  return key;
+}
+
+// Returns the directory to cache the optimized program in, empty if the
+// optimized program should not be cached.
+std::string OptimProgramCacheDir(Argument* argument) {
+  if (!argument->optim_program_cache_valid() ||
+      !argument->optim_program_cache()) {
+    return "";
+  }
+  // The sub-graph engines keep their own caches, and the quantization scales
+  // computed at runtime are not covered by the key.
+  // The weights packed by fc_weight_pack_pass are specific to the CPU.
+  for (auto& pass : argument->ir_analysis_passes()) {
+    if (pass.find("_subgraph_pass") != std::string::npos) return "";
+    if (pass == "fc_weight_pack_pass") return "";
+  }
+  if (argument->use_ipu_valid() && argument->use_ipu()) return "";
+#ifdef PADDLE_WITH_MKLDNN
+  if (argument->quant_var_scales_valid()) return "";
+#endif
+
+  std::string optim_cache_dir =
+      argument->optim_cache_dir_valid() ? argument->optim_cache_dir() : "";
+  if (!optim_cache_dir.empty()) {
+    MakeDirIfNotExists(optim_cache_dir);
+    return optim_cache_dir;
+  }
+  if (argument->model_from_memory_valid() && argument->model_from_memory()) {
+    LOG(WARNING) << "The optimized program of the model loaded from memory "
+                    "is cached only if the optim_cache_dir is set.";
+    return "";
+  }
+  return GetOrCreateModelOptCacheDir(
+      argument->model_dir_valid() ? argument->model_dir()
+                                  : GetDirRoot(argument->model_program_path()));
+}
+
+// Write to a temporary file and rename it, so that the predictors created
+// concurrently never read a partial file. The temporary file is named by the
+// process and thread, so that the concurrent writers do not share it.
+void WriteFileAtomically(const std::string& path, const std::string& data) {
+  std::string tmp_path =
+      path + "." + std::to_string(platform::GetProcessId()) + "." +
+      std::to_string(platform::GetCurrentThreadSysId()) + ".tmp";
+  std::ofstream fout(tmp_path, std::ios::binary);
+  PADDLE_ENFORCE_EQ(fout.is_open(), true,
+                    platform::errors::Unavailable(
+                        "Cannot open file %s to write.", tmp_path));
+  fout.write(data.data(), data.size());
+  fout.close();
+  PADDLE_ENFORCE_EQ(std::rename(tmp_path.c_str(), path.c_str()), 0,
+                    platform::errors::Unavailable(
+                        "Cannot rename file %s to %s.", tmp_path, path));
+}
+
+void SaveOptimProgram(framework::ProgramDesc* program,
+                      const framework::Scope& scope,
+                      const std::string& path_prefix) {
+  auto names = PersistableTensors(*program, scope);
+  std::ostringstream os;
+  uint64_t num = names.size();
+  os.write(reinterpret_cast<const char*>(&num), sizeof(num));
+  for (auto& name : names) {
+    uint64_t size = name.size();
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(name.data(), size);
+    framework::SerializeToStream(
+        os, scope.FindVar(name)->Get<framework::LoDTensor>());
+  }
+  WriteFileAtomically(path_prefix + ".pdiparams", os.str());
+  WriteFileAtomically(path_prefix + ".pdmodel",
+                      program->Proto()->SerializeAsString());
+}
+
+// Returns false if the optimized program is not cached. The scope is not
+// touched unless all the parameters are loaded.
+bool LoadOptimProgram(const std::string& path_prefix, framework::Scope* scope,
+                      framework::proto::ProgramDesc* program) {
+  std::string params_path = path_prefix + ".pdiparams";
+  std::string program_path = path_prefix + ".pdmodel";
+  if (!FileExists(params_path) || !FileExists(program_path)) {
+    return false;
+  }
+  std::map<std::string, framework::LoDTensor> tensors;
+  try {
+    std::ifstream is(params_path, std::ios::binary);
+    uint64_t num = 0;
+    is.read(reinterpret_cast<char*>(&num), sizeof(num));
+    for (uint64_t i = 0; i < num && is; ++i) {
+      uint64_t size = 0;
+      is.read(reinterpret_cast<char*>(&size), sizeof(size));
+      std::string name(size, ' ');
+      is.read(&name[0], size);
+      framework::DeserializeFromStream(is, &tensors[name]);
+    }
+    PADDLE_ENFORCE_EQ(
+        is.good() && tensors.size() == num, true,
+        platform::errors::DataLoss("The file %s is broken.", params_path));
+    *program = LoadProgramDesc(program_path);
+  } catch (platform::EnforceNotMet& ex) {
+    LOG(WARNING) << "Failed to load the optimized program " << path_prefix
+                 << ", optimize it again: " << ex.what();
+    return false;
+  }
+  for (auto& item : tensors) {
+    *scope->Var(item.first)->GetMutable<framework::LoDTensor>() =
+        std::move(item.second);
+  }
+  return true;
+}
+
+void WriteIrPassReport(const std::string& path, const std::string& cache,
+                       const std::vector<IrPassStat>& report) {
+  std::ofstream fout(path);
+  if (!fout.is_open()) {
+    LOG(WARNING) << "Cannot open file " << path << " to write the report.";
+    return;
+  }
+  fout << "{\n\"optim_program_cache\": \"" << cache << "\",\n\"passes\": "
+       << IRPassManager::ReportToJson(report) << "\n}\n";
+}
+
+}  // namespace
+
 void IrAnalysisPass::RunImpl(Argument* argument) {
   ARGUMENT_CHECK_FIELD(argument, ir_analysis_passes);
   ARGUMENT_CHECK_FIELD(argument, main_program);
@@ -30,15 +238,49 @@ void IrAnalysisPass::RunImpl(Argument* argument) {
   auto* the_graph = argument->ReleaseMainGraph();
   auto graph = std::unique_ptr<Graph>(the_graph);
 
-  // Apply passes.
-  IRPassManager the_ir_manager(argument);
-  graph = the_ir_manager.Apply(std::move(graph));
+  std::string cache_status = "off";
+  std::string cache_path_prefix;
+  std::string cache_dir = OptimProgramCacheDir(argument);
+  if (!cache_dir.empty()) {
+    cache_path_prefix =
+        cache_dir + "/optim_program_" + OptimProgramCacheKey(argument);
+    framework::proto::ProgramDesc cached_program;
+    if (LoadOptimProgram(cache_path_prefix, argument->scope_ptr(),
+                         &cached_program)) {
+      LOG(INFO) << "Load the optimized program from " << cache_path_prefix;
+      argument->SetMainProgram(new framework::ProgramDesc(cached_program));
+      graph.reset(new Graph(argument->main_program()));
+      graph->SetNotOwned(framework::ir::kParamScopeAttr, argument->scope_ptr());
+      cache_status = "hit";
+    } else {
+      cache_status = "miss";
+    }
+  }
+
+  std::vector<IrPassStat> report;
+  if (cache_status != "hit") {
+    // Apply passes.
+    IRPassManager the_ir_manager(argument);
+    graph = the_ir_manager.Apply(std::move(graph));
+    report = the_ir_manager.report();
+    if (cache_status == "miss") {
+      framework::ProgramDesc optimized_program(the_ir_manager.AcquireProgram(
+          &graph, &argument->main_program()));
+      SaveOptimProgram(&optimized_program, argument->scope(),
+                       cache_path_prefix);
+    }
+  }
   PADDLE_ENFORCE_GT(
       graph->Nodes().size(), 0,
       platform::errors::PreconditionNotMet(
           "The graph nodes size should be greater than 0, but got 0"));
   argument->SetMainGraph(graph.release());
   CollectFusionStatis(argument);
+
+  if (argument->ir_pass_report_path_valid() &&
+      !argument->ir_pass_report_path().empty()) {
+    WriteIrPassReport(argument->ir_pass_report_path(), cache_status, report);
+  }
 }
 
 void IrAnalysisPass::CollectFusionStatis(Argument* argument) {
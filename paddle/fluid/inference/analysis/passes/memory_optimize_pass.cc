@@ -19,6 +19,7 @@
 
 #include "glog/logging.h"
 #include "paddle/fluid/framework/ir/graph_helper.h"
+#include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/platform/enforce.h"
 
 namespace paddle {
@@ -55,8 +56,14 @@ void MemoryOptimizePass::CollectLifeCycle(
     Graph* graph, std::unordered_map<std::string, lifecycle_t>* lifecycles,
     int sort_kind) const {
   int max_lifecycle = 0;
-  for (auto* op_node : framework::ir::TopologyVarientSort(
-           *graph, static_cast<framework::ir::SortKind>(sort_kind))) {
+  // The ops reordered by memory_schedule_pass are saved to the program in
+  // their desc orders, the lifecycles should follow the same order.
+  auto op_nodes =
+      graph->Has(framework::ir::kGraphOpsScheduledByDescOrder)
+          ? framework::ir::TopologySortGraphByDescOrder(*graph)
+          : TopologyVarientSort(
+                *graph, static_cast<framework::ir::SortKind>(sort_kind));
+  for (auto* op_node : op_nodes) {
     if (!op_node->IsOp()) continue;
     auto reads = op_node->inputs;
     auto writes = op_node->outputs;
@@ -315,6 +322,10 @@ void MemoryOptimizePass::RunImpl(Argument* argument) {
   std::unordered_map<std::string, std::string> node2cluster;
   std::unordered_map<std::string, int> cluster_size;
 
+  // Lower the peak memory by reordering the ops before making the reuse plan.
+  framework::ir::PassRegistry::Instance()
+      .Get("memory_schedule_pass")
+      ->Apply(graph);
   CollectLifeCycle(graph, &lifecycles, sort_kind);
   CollectVarMemorySize(graph, &space_table);
   MakeSimpleReusePlan(lifecycles, space_table, &node2cluster, &cluster_size);
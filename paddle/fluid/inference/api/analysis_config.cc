@@ -208,6 +208,7 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(params_file_);
 
   CP_MEMBER(use_fc_padding_);
+  CP_MEMBER(use_batched_fc_fuse_);
   // GPU related.
   CP_MEMBER(use_gpu_);
   CP_MEMBER(use_cudnn_);
@@ -282,6 +283,9 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(enable_ir_optim_);
   CP_MEMBER(use_feed_fetch_ops_);
   CP_MEMBER(ir_debug_);
+  CP_MEMBER(ir_pass_report_path_);
+  CP_MEMBER(ir_sub_block_optim_);
+  CP_MEMBER(optim_program_cache_);
   CP_MEMBER(specify_input_name_);
 
   CP_MEMBER(cpu_math_library_num_threads_);
@@ -563,6 +567,17 @@ void AnalysisConfig::Update() {
     }
   }
 
+  if (use_batched_fc_fuse_ && !use_gpu() && !use_xpu() && !use_npu() &&
+      !use_ipu()) {
+    // Batch the independent fcs before is_test_pass, like the other fusions.
+    const auto &passes = pass_builder()->AllPasses();
+    if (std::find(passes.begin(), passes.end(), "batched_fc_fuse_pass") ==
+        passes.end()) {
+      auto it = std::find(passes.begin(), passes.end(), "is_test_pass");
+      pass_builder()->InsertPass(it - passes.begin(), "batched_fc_fuse_pass");
+    }
+  }
+
   if (use_gpu() && use_cudnn_) {
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
     if (!enable_ir_optim_) {
@@ -670,6 +685,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
 
   ss << use_gpu_;
   ss << use_fc_padding_;
+  ss << use_batched_fc_fuse_;
   ss << gpu_device_id_;
   ss << xpu_device_id_;
   ss << memory_pool_init_size_mb_;
@@ -708,6 +724,9 @@ std::string AnalysisConfig::SerializeInfoCache() {
   ss << enable_ir_optim_;
   ss << use_feed_fetch_ops_;
   ss << ir_debug_;
+  ss << ir_pass_report_path_;
+  ss << ir_sub_block_optim_;
+  ss << optim_program_cache_;
 
   ss << specify_input_name_;
   ss << cpu_math_library_num_threads_;
@@ -801,6 +820,29 @@ void AnalysisConfig::SwitchIrDebug(int x) {
   Update();
 }
 
+void AnalysisConfig::SetIrPassReportPath(const std::string &path) {
+  ir_pass_report_path_ = path;
+  Update();
+}
+
+void AnalysisConfig::SwitchBatchedFCFuse(bool x) {
+  use_batched_fc_fuse_ = x;
+  if (!x && pass_builder_) {
+    pass_builder_->DeletePass("batched_fc_fuse_pass");
+  }
+  Update();
+}
+
+void AnalysisConfig::SwitchIrSubBlockOptim(bool x) {
+  ir_sub_block_optim_ = x;
+  Update();
+}
+
+void AnalysisConfig::EnableOptimProgramCache(bool x) {
+  optim_program_cache_ = x;
+  Update();
+}
+
 void AnalysisConfig::EnableProfile() {
   with_profile_ = true;
   Update();
@@ -942,6 +984,14 @@ std::string AnalysisConfig::Summary() {
   // ir info
   os.InsertRow({"ir_optim", enable_ir_optim_ ? "true" : "false"});
   os.InsertRow({"ir_debug", ir_debug_ ? "true" : "false"});
+  if (!ir_pass_report_path_.empty()) {
+    os.InsertRow({"ir_pass_report_path", ir_pass_report_path_});
+  }
+  os.InsertRow({"batched_fc_fuse", use_batched_fc_fuse_ ? "true" : "false"});
+  os.InsertRow(
+      {"ir_sub_block_optim", ir_sub_block_optim_ ? "true" : "false"});
+  os.InsertRow(
+      {"optim_program_cache", optim_program_cache_ ? "true" : "false"});
   os.InsertRow({"memory_optim", enable_memory_optim_ ? "true" : "false"});
   os.InsertRow({"enable_profile", with_profile_ ? "true" : "false"});
   os.InsertRow({"enable_log", with_glog_info_ ? "true" : "false"});
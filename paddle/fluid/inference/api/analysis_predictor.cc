@@ -27,6 +27,7 @@
 #include "paddle/fluid//platform/device/gpu/gpu_types.h"
 #include "paddle/fluid/framework/feed_fetch_method.h"
 #include "paddle/fluid/framework/feed_fetch_type.h"
+#include "paddle/fluid/framework/ir/fc_weight_pack_pass.h"
 #include "paddle/fluid/framework/ir/fuse_pass_base.h"
 #include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/framework/naive_executor.h"
@@ -950,7 +951,25 @@ void AnalysisPredictor::PrepareArgument() {
     passes.clear();
     LOG(INFO) << "ir_optim is turned off, no IR pass will be executed";
   }
+#ifdef PADDLE_WITH_MKLDNN
+  // The layouts are planned after the MKL-DNN ops are placed, fused,
+  // quantized or converted to bf16, but the bf16 and the quantizer passes
+  // are appended after the MKL-DNN ones, so the layout pass is moved to the
+  // end. With the quantizer, the quantize passes run after the calibration
+  // and the layout pass is run there, see MkldnnQuantizer::PrepareArgument.
+  auto layout_pass = std::find(passes.begin(), passes.end(),
+                               "mkldnn_layout_propagation_pass");
+  if (layout_pass != passes.end()) {
+    passes.erase(layout_pass);
+    if (!config_.mkldnn_quantizer_enabled()) {
+      passes.push_back("mkldnn_layout_propagation_pass");
+    }
+  }
+#endif
   argument_.SetDisableLogs(config_.glog_info_disabled());
+  argument_.SetIrPassReportPath(config_.ir_pass_report_path());
+  argument_.SetIrSubBlockOptim(config_.ir_sub_block_optim());
+  argument_.SetOptimProgramCache(config_.optim_program_cache_enabled());
   argument_.SetIrAnalysisPasses(passes);
   argument_.SetAnalysisPasses(config_.pass_builder()->AnalysisPasses());
   argument_.SetScopeNotOwned(scope_.get());
@@ -1653,13 +1672,16 @@ void AnalysisPredictor::SaveOptimModel(const std::string &dir) {
   std::string model_name = dir + "/model";
   std::ofstream outfile;
   outfile.open(model_name, std::ios::out | std::ios::binary);
-  std::string inference_prog_desc = GetSerializedProgram();
+  // The packed weights are specific to this CPU, and are packed again when
+  // the saved model is loaded.
+  framework::ProgramDesc main_program(*inference_program_);
+  framework::ir::FCWeightPackPass::RemovePackedW(&main_program);
+  std::string inference_prog_desc = main_program.Proto()->SerializeAsString();
   outfile << inference_prog_desc;
   // save params
   framework::ProgramDesc save_program;
   auto *save_block = save_program.MutableBlock(0);
 
-  const framework::ProgramDesc &main_program = program();
   const framework::BlockDesc &global_block = main_program.Block(0);
   std::vector<std::string> save_var_list;
   for (framework::VarDesc *var : global_block.AllVars()) {
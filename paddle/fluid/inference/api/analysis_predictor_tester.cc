@@ -18,9 +18,15 @@
 #endif
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
 #include <thread>  // NOLINT
 #include "paddle/fluid/framework/ir/pass.h"
+#include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/tensor.h"
+#include "paddle/fluid/inference/analysis/helper.h"
 #include "paddle/fluid/inference/api/helper.h"
 #include "paddle/fluid/inference/api/paddle_api.h"
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
@@ -162,6 +168,203 @@ TEST(AnalysisPredictor, ZeroCopy) {
   predictor->TryShrinkMemory();
 }
 
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream fin(path);
+  std::stringstream buffer;
+  buffer << fin.rdbuf();
+  return buffer.str();
+}
+
+void RemoveTestDir(const std::string& dir) {
+#ifdef _WIN32
+  std::string cmd = "rmdir /s /q \"" + dir + "\" 2>nul";
+#else
+  std::string cmd = "rm -rf \"" + dir + "\"";
+#endif
+  if (std::system(cmd.c_str()) != 0) {
+    LOG(WARNING) << "Failed to remove the test directory " << dir;
+  }
+}
+
+// A fresh directory for the files written by a test, which should be
+// removed by RemoveTestDir at the end of the test.
+std::string MakeTestDir(const std::string& name) {
+  std::string dir = ::testing::TempDir() + name;
+  RemoveTestDir(dir);
+  inference::analysis::MakeDirIfNotExists(dir);
+  return dir;
+}
+
+// Saves the model of out = (x * 2) * 3 + 1, in which the last two scale
+// ops are in the sub-block of a conditional_block whose condition is true.
+void SaveConditionalBlockModel(const std::string& dir) {
+  framework::ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  auto* feed = block->Var("feed");
+  feed->SetType(framework::proto::VarType::FEED_MINIBATCH);
+  feed->SetPersistable(true);
+  auto* fetch = block->Var("fetch");
+  fetch->SetType(framework::proto::VarType::FETCH_LIST);
+  fetch->SetPersistable(true);
+  auto add_tensor = [](framework::BlockDesc* block, const std::string& name,
+                       framework::proto::VarType::Type dtype,
+                       const std::vector<int64_t>& shape) {
+    auto* var = block->Var(name);
+    var->SetType(framework::proto::VarType::LOD_TENSOR);
+    var->SetDataType(dtype);
+    var->SetShape(shape);
+  };
+  for (auto& name : {"x", "y", "out"}) {
+    add_tensor(block, name, framework::proto::VarType::FP32, {-1, 4});
+  }
+  add_tensor(block, "cond", framework::proto::VarType::BOOL, {1});
+  block->Var("scope")->SetType(framework::proto::VarType::STEP_SCOPES);
+  auto* sub_block = program.AppendBlock(*block);
+  add_tensor(sub_block, "t", framework::proto::VarType::FP32, {-1, 4});
+
+  auto append_scale = [](framework::BlockDesc* block, const std::string& x,
+                         const std::string& out, float scale, float bias) {
+    auto* op = block->AppendOp();
+    op->SetType("scale");
+    op->SetInput("X", {x});
+    op->SetOutput("Out", {out});
+    op->SetAttr("scale", scale);
+    op->SetAttr("bias", bias);
+  };
+  auto* op = block->AppendOp();
+  op->SetType("feed");
+  op->SetInput("X", {"feed"});
+  op->SetOutput("Out", {"x"});
+  op->SetAttr("col", 0);
+  op = block->AppendOp();
+  op->SetType("fill_constant");
+  op->SetOutput("Out", {"cond"});
+  op->SetAttr("shape", std::vector<int64_t>({1}));
+  op->SetAttr("dtype", static_cast<int>(framework::proto::VarType::BOOL));
+  op->SetAttr("value", 1.0f);
+  append_scale(block, "x", "y", 2.f, 0.f);
+  op = block->AppendOp();
+  op->SetType("conditional_block");
+  op->SetInput("Cond", {"cond"});
+  op->SetInput("Input", {"y"});
+  op->SetOutput("Out", {"out"});
+  op->SetOutput("Scope", {"scope"});
+  op->SetBlockAttr("sub_block", sub_block);
+  op->SetAttr("is_scalar_condition", true);
+  append_scale(sub_block, "y", "t", 3.f, 0.f);
+  append_scale(sub_block, "t", "out", 1.f, 1.f);
+  op = block->AppendOp();
+  op->SetType("fetch");
+  op->SetInput("X", {"out"});
+  op->SetOutput("Out", {"fetch"});
+  op->SetAttr("col", 0);
+
+  std::ofstream fout(dir + "/__model__", std::ios::binary);
+  fout << program.Proto()->SerializeAsString();
+}
+
+}  // namespace
+
+TEST(AnalysisPredictor, OptimProgramCache) {
+  auto run = [](PaddlePredictor* predictor) {
+    for (auto& name : {"firstw", "secondw", "thirdw", "forthw"}) {
+      auto w = predictor->GetInputTensor(name);
+      w->Reshape({4, 1});
+      auto* w_data = w->mutable_data<int64_t>(PaddlePlace::kCPU);
+      for (int i = 0; i < 4; i++) {
+        w_data[i] = i;
+      }
+    }
+    predictor->ZeroCopyRun();
+    auto out = predictor->GetOutputTensor("fc_1.tmp_2");
+    PaddlePlace place;
+    int size = 0;
+    auto* out_data = out->data<float>(&place, &size);
+    return std::vector<float>(out_data, out_data + size / sizeof(float));
+  };
+
+  std::string test_dir = MakeTestDir("optim_program_cache_test");
+  std::string report_path = test_dir + "/ir_pass_report.json";
+  AnalysisConfig config;
+  config.SetModel(FLAGS_dirname);
+  config.SwitchUseFeedFetchOps(false);
+  config.SwitchIrSubBlockOptim();
+  config.SetOptimCacheDir(test_dir + "/optim_program_cache");
+  config.SetIrPassReportPath(report_path);
+  config.EnableOptimProgramCache();
+  ASSERT_TRUE(config.optim_program_cache_enabled());
+  LOG(INFO) << config.Summary();
+
+  // The first predictor optimizes the program, and the second one loads it.
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  auto report = ReadFile(report_path);
+  ASSERT_NE(report.find("\"optim_program_cache\": \"miss\""),
+            std::string::npos);
+  ASSERT_NE(report.find("\"time_ms\""), std::string::npos);
+  auto cached_predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  ASSERT_NE(ReadFile(report_path).find("\"optim_program_cache\": \"hit\""),
+            std::string::npos);
+
+  auto out = run(cached_predictor.get());
+  auto ref_out = run(predictor.get());
+  ASSERT_EQ(out.size(), ref_out.size());
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_NEAR(out[i], ref_out[i], 1e-6);
+  }
+  RemoveTestDir(test_dir);
+}
+
+TEST(AnalysisPredictor, OptimProgramCacheWithSubBlock) {
+  auto run = [](PaddlePredictor* predictor) {
+    auto x = predictor->GetInputTensor("x");
+    x->Reshape({2, 4});
+    auto* x_data = x->mutable_data<float>(PaddlePlace::kCPU);
+    for (int i = 0; i < 8; i++) {
+      x_data[i] = i;
+    }
+    predictor->ZeroCopyRun();
+    auto out = predictor->GetOutputTensor("out");
+    PaddlePlace place;
+    int size = 0;
+    auto* out_data = out->data<float>(&place, &size);
+    return std::vector<float>(out_data, out_data + size / sizeof(float));
+  };
+
+  std::string test_dir = MakeTestDir("optim_program_cache_sub_block_test");
+  std::string model_dir = test_dir + "/model";
+  inference::analysis::MakeDirIfNotExists(model_dir);
+  SaveConditionalBlockModel(model_dir);
+  std::string report_path = test_dir + "/ir_pass_report.json";
+  AnalysisConfig config;
+  config.SetModel(model_dir);
+  config.SwitchUseFeedFetchOps(false);
+  config.SwitchIrSubBlockOptim();
+  config.SetOptimCacheDir(test_dir + "/optim_program_cache");
+  config.SetIrPassReportPath(report_path);
+  config.EnableOptimProgramCache();
+
+  // The passes are applied to the sub-block in the thread pool.
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  auto report = ReadFile(report_path);
+  ASSERT_NE(report.find("\"optim_program_cache\": \"miss\""),
+            std::string::npos);
+  ASSERT_NE(report.find("\"block_id\": 1"), std::string::npos);
+  auto cached_predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  ASSERT_NE(ReadFile(report_path).find("\"optim_program_cache\": \"hit\""),
+            std::string::npos);
+
+  for (auto* p : {predictor.get(), cached_predictor.get()}) {
+    auto out = run(p);
+    ASSERT_EQ(out.size(), 8UL);
+    for (int i = 0; i < 8; ++i) {
+      EXPECT_NEAR(out[i], i * 6.f + 1.f, 1e-6);
+    }
+  }
+  RemoveTestDir(test_dir);
+}
+
 TEST(AnalysisPredictor, CollectShapeRangeInfo) {
   AnalysisConfig config;
   config.SetModel(FLAGS_dirname);
@@ -346,6 +549,44 @@ TEST(AnalysisPredictor, bf16_pass_strategy) {
   passStrategy.EnableMkldnnBfloat16();
 }
 
+#ifdef PADDLE_WITH_MKLDNN
+TEST(AnalysisPredictor, mkldnn_layout_propagation_pass_order) {
+  auto layout_pass_pos = [](const std::vector<std::string>& passes) {
+    return std::find(passes.begin(), passes.end(),
+                     "mkldnn_layout_propagation_pass") -
+           passes.begin();
+  };
+
+  AnalysisConfig config;
+  config.SetModel(FLAGS_dirname);
+  config.EnableMKLDNN();
+  config.EnableMkldnnBfloat16();
+  auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+  auto& passes = static_cast<AnalysisPredictor*>(predictor.get())
+                     ->analysis_argument()
+                     .ir_analysis_passes();
+  // The layouts are planned after the bf16 ops are placed.
+  ASSERT_EQ(layout_pass_pos(passes), static_cast<int64_t>(passes.size()) - 1);
+  if (config.mkldnn_bfloat16_enabled()) {
+    ASSERT_LT(std::find(passes.begin(), passes.end(), "cpu_bfloat16_pass") -
+                  passes.begin(),
+              layout_pass_pos(passes));
+  }
+
+  // With the quantizer, the layouts are planned after the calibration.
+  AnalysisConfig int8_config;
+  int8_config.SetModel(FLAGS_dirname);
+  int8_config.EnableMKLDNN();
+  int8_config.EnableMkldnnQuantizer();
+  auto int8_predictor = CreatePaddlePredictor<AnalysisConfig>(int8_config);
+  auto& int8_passes = static_cast<AnalysisPredictor*>(int8_predictor.get())
+                          ->analysis_argument()
+                          .ir_analysis_passes();
+  ASSERT_EQ(layout_pass_pos(int8_passes),
+            static_cast<int64_t>(int8_passes.size()));
+}
+#endif
+
 #ifdef PADDLE_WITH_XPU
 TEST(AnalysisPredictor, set_xpu_device_id) {
   AnalysisConfig config;
@@ -569,9 +569,18 @@ void AnalysisPredictor::MkldnnQuantizer::PrepareArgument() const {
   arg.main_graph().SetNotOwned(framework::ir::kParamScopeAttr, scope_ptr);
 
   auto* builder = predictor_.config_.pass_builder();
+  // The layouts are planned after the ops are quantized, see
+  // AnalysisPredictor::PrepareArgument.
+  auto all_passes = builder->AllPasses();
+  bool layout_propagation =
+      std::find(all_passes.begin(), all_passes.end(),
+                "mkldnn_layout_propagation_pass") != all_passes.end();
   builder->SetPasses({
       "cpu_quantize_pass", "cpu_quantize_squash_pass",
   });
+  if (layout_propagation) {
+    builder->AppendPass("mkldnn_layout_propagation_pass");
+  }
   if (predictor_.config_.ir_debug_) builder->TurnOnDebug();
   auto passes = builder->AllPasses();
   predictor_.argument_.SetIrAnalysisPasses(passes);
@@ -238,6 +238,19 @@ struct PD_INFER_DECL AnalysisConfig {
   /// \return bool Whether fc padding is used.
   ///
   bool use_fc_padding() const { return use_fc_padding_; }
+  ///
+  /// \brief Control whether to batch the independent fcs with the same weight
+  /// shape by batched_fc_fuse_pass on CPU. It is off by default.
+  ///
+  /// \param x whether to apply batched_fc_fuse_pass.
+  ///
+  void SwitchBatchedFCFuse(bool x = true);
+  ///
+  /// \brief A boolean state telling whether batched_fc_fuse_pass is applied.
+  ///
+  /// \return bool Whether batched_fc_fuse_pass is applied.
+  ///
+  bool batched_fc_fuse_enabled() const { return use_batched_fc_fuse_; }
 
   // GPU related.
 
@@ -640,6 +653,57 @@ struct PD_INFER_DECL AnalysisConfig {
   ///
   void SwitchIrDebug(int x = true);
 
+  ///
+  /// \brief Write the time cost and the node and edge deltas of every IR pass
+  /// applied in the analysis phase to a file, in JSON.
+  ///
+  /// \param path the report file path, empty to write no report.
+  ///
+  void SetIrPassReportPath(const std::string& path);
+  ///
+  /// \brief Get the IR pass report file path.
+  ///
+  /// \return const std::string& The IR pass report file path.
+  ///
+  const std::string& ir_pass_report_path() const {
+    return ir_pass_report_path_;
+  }
+
+  ///
+  /// \brief Control whether to apply the IR passes to the sub-blocks of the
+  /// control flow ops too. The sub-blocks are optimized concurrently with the
+  /// main block. The passes which need the parameters or the whole program,
+  /// e.g. the fusions changing the weights and the sub-graph engines, are
+  /// skipped in the sub-blocks.
+  ///
+  /// \param x whether to optimize the sub-blocks.
+  ///
+  void SwitchIrSubBlockOptim(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the sub-blocks are optimized.
+  ///
+  /// \return bool Whether the sub-blocks are optimized.
+  ///
+  bool ir_sub_block_optim() const { return ir_sub_block_optim_; }
+
+  ///
+  /// \brief Turn on the cache of the optimized program. The program and the
+  /// parameters optimized by the IR passes are saved in the optimization
+  /// cache directory, keyed by a hash of the model, the parameters and the
+  /// passes, so that the next predictor for the same model and config loads
+  /// them instead of running the passes again. It has no effect with the
+  /// sub-graph engines, e.g. TensorRT, which keep their own caches.
+  ///
+  /// \param x whether to cache the optimized program.
+  ///
+  void EnableOptimProgramCache(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the optimized program is cached.
+  ///
+  /// \return bool Whether the optimized program is cached.
+  ///
+  bool optim_program_cache_enabled() const { return optim_program_cache_; }
+
   ///
   /// \brief Turn on MKLDNN.
   ///
@@ -872,6 +936,7 @@ struct PD_INFER_DECL AnalysisConfig {
 
   // Padding related
   bool use_fc_padding_{true};
+  bool use_batched_fc_fuse_{false};
 
   // TensorRT related.
   bool use_tensorrt_{false};
@@ -926,6 +991,9 @@ struct PD_INFER_DECL AnalysisConfig {
   bool enable_ir_optim_{true};
   bool use_feed_fetch_ops_{true};
   bool ir_debug_{false};
+  std::string ir_pass_report_path_;
+  bool ir_sub_block_optim_{false};
+  bool optim_program_cache_{false};
 
   bool specify_input_name_{false};
 
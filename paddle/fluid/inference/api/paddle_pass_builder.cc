@@ -187,6 +187,10 @@ void GpuPassStrategy::EnableMkldnnBfloat16() {
 CpuPassStrategy::CpuPassStrategy() : PassStrategy({}) {
   // NOTE the large fusions should be located in the front, so that they will
   // not be damaged by smaller ones.
+  // NOTE constant_folding_pass and fc_weight_pack_pass are not enabled by
+  // default. To enable them, insert constant_folding_pass in the front and
+  // append fc_weight_pack_pass, which should be after all the passes which
+  // fuse or rewrite fc.
   passes_.assign({"simplify_with_basic_ops_pass",  //
                   "layer_norm_fuse_pass",
                   "attention_lstm_fuse_pass",       //
@@ -263,6 +267,10 @@ void CpuPassStrategy::EnableMKLDNN() {
              "batch_norm_act_fuse_pass",              //
              "softplus_activation_mkldnn_fuse_pass",  //
              "elt_act_mkldnn_fuse_pass",              //
+             // mkldnn_layout_propagation_pass should be after all the
+             // passes which place, fuse or quantize the MKL-DNN ops, so the
+             // predictor moves it to the end of the passes when it is built.
+             "mkldnn_layout_propagation_pass",  //
              // TODO(intel): Please fix the bug on windows.
              // https://github.com/PaddlePaddle/Paddle/issues/29710
              // "mkldnn_inplace_pass",  // This pass should be activated after
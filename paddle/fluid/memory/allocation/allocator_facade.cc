@@ -22,6 +22,7 @@
 #include "paddle/fluid/memory/allocation/cpu_allocator.h"
 #include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
 #include "paddle/fluid/memory/allocation/retry_allocator.h"
+#include "paddle/fluid/memory/allocation/step_cached_allocator.h"
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/platform/place.h"
 
@@ -91,6 +92,14 @@ PADDLE_DEFINE_EXPORTED_bool(use_cuda_managed_memory, false,
                             "managed memory, only available for auto_growth "
                             "strategy");
 
+PADDLE_DEFINE_EXPORTED_int64(
+    cpu_step_cached_bytes, 0,
+    "The max bytes of the CPU allocations freed in a training step and "
+    "cached for the same allocations of the next step, e.g. the outermost "
+    "backward of the eager mode starts a step. No cache if this value is not "
+    "greater than 0. It is read once when the allocators are created at the "
+    "first allocation, so it should be set by the environment variable");
+
 DECLARE_string(allocator_strategy);
 
 namespace paddle {
@@ -292,6 +301,10 @@ class AllocatorFacadePrivate {
       WrapCUDARetryAllocator(FLAGS_gpu_allocator_retry_time);
     }
 
+    if (FLAGS_cpu_step_cached_bytes > 0) {
+      WrapStepCachedCPUAllocator(FLAGS_cpu_step_cached_bytes);
+    }
+
     CheckAllocThreadSafe();
 
 #ifdef PADDLE_WITH_CUDA
@@ -820,6 +833,12 @@ class AllocatorFacadePrivate {
     }
   }
 
+  void WrapStepCachedCPUAllocator(size_t max_cached_bytes) {
+    auto& allocator = allocators_[platform::CPUPlace()];
+    allocator =
+        std::make_shared<StepCachedAllocator>(allocator, max_cached_bytes);
+  }
+
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
   // a standalone CUDA allocator to support multi-stream GC in new executor
   CUDAAllocatorMap cuda_allocators_;
@@ -942,6 +961,19 @@ uint64_t AllocatorFacade::Release(const platform::Place& place) {
       ->Release(place);
 }
 
+void AllocatorFacade::NextStep(const platform::Place& place) {
+  auto* allocator =
+      dynamic_cast<StepCachedAllocator*>(GetAllocator(place).get());
+  if (allocator) {
+    allocator->NextStep();
+  } else if (FLAGS_cpu_step_cached_bytes > 0 && platform::is_cpu_place(place)) {
+    LOG_FIRST_N(WARNING, 1)
+        << "FLAGS_cpu_step_cached_bytes is set after the allocators are "
+           "created, so the CPU allocations are not cached across the steps. "
+           "Set it by the environment variable instead.";
+  }
+}
+
 std::shared_ptr<phi::Allocation> AllocatorFacade::AllocShared(
     const platform::Place& place, size_t size, const phi::Stream& stream) {
   PADDLE_ENFORCE_EQ(
@@ -70,6 +70,9 @@ class AllocatorFacade {
   AllocationPtr Alloc(const platform::Place& place, size_t size);
   // Release unused memory pool.
   uint64_t Release(const platform::Place& place);
+  // Starts the next training step of the allocations cached across the
+  // steps, if FLAGS_cpu_step_cached_bytes enabled the cache of place.
+  void NextStep(const platform::Place& place);
 
   std::shared_ptr<Allocation> AllocShared(const platform::Place& place,
                                           size_t size,
@@ -0,0 +1,160 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/step_cached_allocator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "glog/logging.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+StepCachedAllocator::StepCachedAllocator(std::shared_ptr<Allocator> allocator,
+                                         size_t max_cached_bytes)
+    : underlying_allocator_(std::move(allocator)),
+      max_cached_bytes_(max_cached_bytes) {
+  PADDLE_ENFORCE_NOT_NULL(
+      underlying_allocator_,
+      platform::errors::InvalidArgument(
+          "Underlying allocator of StepCachedAllocator is NULL"));
+  PADDLE_ENFORCE_EQ(
+      underlying_allocator_->IsAllocThreadSafe(), true,
+      platform::errors::PreconditionNotMet(
+          "Underlying allocator of StepCachedAllocator is not thread-safe"));
+}
+
+size_t StepCachedAllocator::SizeClass(size_t size) {
+  constexpr size_t kMinSizeClass = 256;
+  if (size <= kMinSizeClass) {
+    return kMinSizeClass;
+  }
+  // The largest power of 2 less than size.
+  size_t pow2 = kMinSizeClass;
+  while (pow2 * 2 < size) {
+    pow2 *= 2;
+  }
+  return AlignedSize(size, pow2 / 8);
+}
+
+phi::Allocation *StepCachedAllocator::AllocateImpl(size_t size) {
+  size_t size_class = SizeClass(size);
+  {
+    std::lock_guard<std::mutex> guard(mtx_);
+    auto iter = allocations_.find(size_class);
+    if (iter != allocations_.end() && !iter->second.empty()) {
+      auto allocation = std::move(iter->second.back().allocation);
+      iter->second.pop_back();
+      stats_.cached_bytes -= allocation->size();
+      ++stats_.hit_num;
+      return allocation.release();
+    }
+    ++stats_.miss_num;
+  }
+
+  try {
+    return underlying_allocator_->Allocate(size_class).release();
+  } catch (BadAlloc &) {
+    VLOG(2) << "Free the cached allocations to allocate " << size_class
+            << " bytes";
+    std::vector<AllocationPtr> stale;
+    {
+      std::lock_guard<std::mutex> guard(mtx_);
+      TakeStale(std::numeric_limits<uint64_t>::max(), &stale);
+    }
+    stale.clear();
+    return underlying_allocator_->Allocate(size_class).release();
+  }
+}
+
+void StepCachedAllocator::FreeImpl(phi::Allocation *allocation) {
+  // Freed to the underlying allocator if not cached.
+  AllocationPtr ptr(allocation, Allocator::AllocationDeleter);
+  // The size is the size class allocated by AllocateImpl.
+  size_t size = allocation->size();
+  {
+    std::lock_guard<std::mutex> guard(mtx_);
+    if (stats_.cached_bytes + size <= max_cached_bytes_) {
+      allocations_[size].push_back(CachedAllocation{std::move(ptr), step_});
+      stats_.cached_bytes += size;
+      stats_.peak_cached_bytes =
+          std::max(stats_.peak_cached_bytes, stats_.cached_bytes);
+      return;
+    }
+    stats_.released_bytes += size;
+  }
+}
+
+void StepCachedAllocator::NextStep() {
+  std::vector<AllocationPtr> stale;
+  {
+    std::lock_guard<std::mutex> guard(mtx_);
+    ++step_;
+    // The allocations freed before the last step and not reused in it.
+    TakeStale(step_ - 1, &stale);
+    VLOG(4) << "StepCachedAllocator starts step " << step_ << ", hit "
+            << stats_.hit_num << ", miss " << stats_.miss_num << ", cached "
+            << stats_.cached_bytes << " bytes, peak cached "
+            << stats_.peak_cached_bytes << " bytes, released "
+            << stats_.released_bytes << " bytes";
+  }
+}
+
+StepCachedAllocator::Stats StepCachedAllocator::GetStats() const {
+  std::lock_guard<std::mutex> guard(mtx_);
+  return stats_;
+}
+
+void StepCachedAllocator::TakeStale(uint64_t min_step,
+                                    std::vector<AllocationPtr> *stale) {
+  for (auto iter = allocations_.begin(); iter != allocations_.end();) {
+    auto &cached = iter->second;
+    // Ordered by the steps freed.
+    size_t stale_num = 0;
+    while (stale_num < cached.size() && cached[stale_num].step < min_step) {
+      auto &allocation = cached[stale_num].allocation;
+      stats_.cached_bytes -= allocation->size();
+      stats_.released_bytes += allocation->size();
+      stale->emplace_back(std::move(allocation));
+      ++stale_num;
+    }
+    cached.erase(cached.begin(), cached.begin() + stale_num);
+    if (cached.empty()) {
+      iter = allocations_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+uint64_t StepCachedAllocator::ReleaseImpl(const platform::Place &place) {
+  std::vector<AllocationPtr> stale;
+  {
+    std::lock_guard<std::mutex> guard(mtx_);
+    TakeStale(std::numeric_limits<uint64_t>::max(), &stale);
+  }
+  uint64_t released_bytes = 0;
+  for (auto &allocation : stale) {
+    released_bytes += allocation->size();
+  }
+  stale.clear();
+  return released_bytes + underlying_allocator_->Release(place);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// StepCachedAllocator keeps the allocations freed in a step of a training
+// loop, and reuses them for the allocations of the same size class in the
+// next step, since the steps allocate and free the same sequence of tensors.
+// The sizes are rounded up to the classes of 8 per power of 2, which wastes
+// 12.5% at most.
+//
+// The allocations cached but not reused in a whole step are freed when the
+// next step starts, and the ones freed when max_cached_bytes are cached
+// already are freed at once, so that the cache does not grow without bound.
+class StepCachedAllocator : public Allocator {
+ public:
+  struct Stats {
+    // The allocations reused from the cache, and the ones not.
+    uint64_t hit_num{0};
+    uint64_t miss_num{0};
+    uint64_t cached_bytes{0};
+    uint64_t peak_cached_bytes{0};
+    // The bytes freed to the underlying allocator, since they are not reused
+    // in a step or the cache is full.
+    uint64_t released_bytes{0};
+  };
+
+  StepCachedAllocator(std::shared_ptr<Allocator> allocator,
+                      size_t max_cached_bytes);
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  // Starts the next step, freeing the allocations cached but not reused
+  // during the last step.
+  void NextStep();
+
+  Stats GetStats() const;
+
+  static size_t SizeClass(size_t size);
+
+ protected:
+  phi::Allocation *AllocateImpl(size_t size) override;
+  void FreeImpl(phi::Allocation *allocation) override;
+  uint64_t ReleaseImpl(const platform::Place &place) override;
+
+ private:
+  struct CachedAllocation {
+    AllocationPtr allocation;
+    uint64_t step;
+  };
+
+  // Takes the allocations to be freed out of the cache, which are freed out
+  // of the lock.
+  void TakeStale(uint64_t min_step, std::vector<AllocationPtr> *stale);
+
+  std::shared_ptr<Allocator> underlying_allocator_;
+  size_t max_cached_bytes_;
+
+  mutable std::mutex mtx_;
+  uint64_t step_{0};
+  // The cached allocations by the size classes, with the last freed at the
+  // back.
+  std::unordered_map<size_t, std::vector<CachedAllocation>> allocations_;
+  Stats stats_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,102 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/step_cached_allocator.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(StepCachedAllocator, SizeClass) {
+  EXPECT_EQ(StepCachedAllocator::SizeClass(1), 256UL);
+  EXPECT_EQ(StepCachedAllocator::SizeClass(256), 256UL);
+  EXPECT_EQ(StepCachedAllocator::SizeClass(257), 288UL);
+  EXPECT_EQ(StepCachedAllocator::SizeClass(1000), 1024UL);
+  EXPECT_EQ(StepCachedAllocator::SizeClass(1025), 1152UL);
+  for (size_t size = 1; size < (1 << 20); size = size * 3 / 2 + 1) {
+    size_t size_class = StepCachedAllocator::SizeClass(size);
+    EXPECT_GE(size_class, size);
+    EXPECT_EQ(StepCachedAllocator::SizeClass(size_class), size_class);
+  }
+}
+
+TEST(StepCachedAllocator, ReuseAcrossSteps) {
+  auto allocator = std::make_shared<StepCachedAllocator>(
+      std::make_shared<CPUAllocator>(), 1 << 20);
+  std::vector<size_t> sizes = {1000, 4096, 100, 1000};
+
+  std::vector<void *> ptrs;
+  for (int step = 0; step < 3; ++step) {
+    allocator->NextStep();
+    std::vector<AllocationPtr> allocations;
+    for (auto size : sizes) {
+      allocations.emplace_back(allocator->Allocate(size));
+      EXPECT_GE(allocations.back()->size(), size);
+    }
+    std::vector<void *> step_ptrs;
+    for (auto &allocation : allocations) {
+      step_ptrs.push_back(allocation->ptr());
+    }
+    if (step > 0) {
+      // The buffers freed in the last step, the last freed first for the
+      // same size class.
+      EXPECT_EQ(step_ptrs[0], ptrs[3]);
+      EXPECT_EQ(step_ptrs[1], ptrs[1]);
+      EXPECT_EQ(step_ptrs[2], ptrs[2]);
+      EXPECT_EQ(step_ptrs[3], ptrs[0]);
+    }
+    ptrs = step_ptrs;
+    for (auto &allocation : allocations) {
+      allocation.reset();
+    }
+  }
+
+  auto stats = allocator->GetStats();
+  EXPECT_EQ(stats.miss_num, sizes.size());
+  EXPECT_EQ(stats.hit_num, 2 * sizes.size());
+  EXPECT_EQ(stats.released_bytes, 0UL);
+  EXPECT_EQ(stats.cached_bytes, stats.peak_cached_bytes);
+}
+
+TEST(StepCachedAllocator, Release) {
+  auto allocator = std::make_shared<StepCachedAllocator>(
+      std::make_shared<CPUAllocator>(), 4096);
+  allocator->Allocate(1024);
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 1024UL);
+
+  // Not cached beyond the max bytes.
+  allocator->Allocate(4000);
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 1024UL);
+  EXPECT_EQ(allocator->GetStats().released_bytes, 4096UL);
+
+  // Released if not reused in a whole step.
+  allocator->NextStep();
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 1024UL);
+  allocator->NextStep();
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 0UL);
+  EXPECT_EQ(allocator->GetStats().released_bytes, 4096UL + 1024UL);
+
+  allocator->Allocate(2048);
+  EXPECT_EQ(allocator->Release(platform::CPUPlace()), 2048UL);
+  EXPECT_EQ(allocator->GetStats().cached_bytes, 0UL);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -34,6 +34,10 @@ uint64_t Release(const platform::Place& place) {
   return allocation::AllocatorFacade::Instance().Release(place);
 }
 
+void NextStep(const platform::Place& place) {
+  allocation::AllocatorFacade::Instance().NextStep(place);
+}
+
 std::shared_ptr<Allocation> AllocShared(const platform::Place& place,
                                         size_t size,
                                         const phi::Stream& stream) {
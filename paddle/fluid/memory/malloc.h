@@ -37,6 +37,10 @@ extern AllocationPtr Alloc(const phi::DeviceContext& dev_ctx, size_t size);
 
 extern uint64_t Release(const platform::Place& place);
 
+// Starts the next training step of the allocations of place cached across
+// the steps, see FLAGS_cpu_step_cached_bytes.
+extern void NextStep(const platform::Place& place);
+
 extern std::shared_ptr<Allocation> AllocShared(const platform::Place& place,
                                                size_t size,
                                                const phi::Stream& stream);
@@ -17,6 +17,8 @@
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/operators/controlflow/while_op_helper.h"
 
+DECLARE_bool(while_op_reuse_step_buffers);
+
 namespace paddle {
 namespace framework {
 class InferShapeContext;
@@ -106,7 +108,16 @@ class WhileOp : public framework::OperatorBase {
                           "The Output(StepScope) of WhileOp should be empty."));
 
     bool cond_data = GetCondData(cond);
-    auto &skip_vars = Attr<std::vector<std::string>>(kSkipEagerDeletionVars);
+    auto skip_vars = Attr<std::vector<std::string>>(kSkipEagerDeletionVars);
+    if (is_test) {
+      // All the iterations run in the same scope, so the buffers kept from
+      // being released are reused by the next iteration, and released with
+      // the scope after the loop.
+      auto buffer_vars =
+          GetWhileStepBufferVars(*block, FLAGS_while_op_reuse_step_buffers);
+      skip_vars.insert(skip_vars.end(), buffer_vars.begin(),
+                       buffer_vars.end());
+    }
     VLOG(2) << GetSkipEagerDeletionVarsDebugString(skip_vars);
 
     auto ctx = executor.Prepare(*program, block->ID(), skip_vars);
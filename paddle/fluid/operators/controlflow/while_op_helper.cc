@@ -14,7 +14,9 @@
 
 #include "paddle/fluid/operators/controlflow/while_op_helper.h"
 
+#include <set>
 #include <string>
+#include <unordered_set>
 #include "paddle/fluid/string/string_helper.h"
 
 namespace paddle {
@@ -227,6 +229,40 @@ bool GetCondData(const framework::LoDTensor &cond) {
   return cpu_cond->data<bool>()[0];
 }
 
+std::vector<std::string> GetWhileStepBufferVars(
+    const framework::BlockDesc &block, bool reuse_temporaries) {
+  std::unordered_set<std::string> written;
+  std::unordered_set<std::string> read_first;
+  for (auto *op : block.AllOps()) {
+    for (auto &name : op->InputArgumentNames()) {
+      if (written.count(name) == 0) {
+        read_first.insert(name);
+      }
+    }
+    for (auto &name : op->OutputArgumentNames()) {
+      written.insert(name);
+    }
+  }
+
+  std::set<std::string> buffer_vars;
+  for (auto *var : block.AllVars()) {
+    auto &name = var->Name();
+    if (name == framework::kEmptyVarName || var->Persistable() ||
+        var->GetType() != framework::proto::VarType::LOD_TENSOR ||
+        written.count(name) == 0) {
+      continue;
+    }
+    bool loop_carried = read_first.count(name) > 0;
+    if (loop_carried || reuse_temporaries) {
+      VLOG(4) << "Keep the buffer of the "
+              << (loop_carried ? "loop-carried" : "temporary") << " var "
+              << name << " for the whole loop";
+      buffer_vars.insert(name);
+    }
+  }
+  return std::vector<std::string>(buffer_vars.begin(), buffer_vars.end());
+}
+
 bool StrInVaraiableNameMap(const std::string &name,
                            const framework::VariableNameMap &var_names) {
   for (auto &ipt : var_names) {
@@ -28,6 +28,7 @@ class DenseTensor;
 
 namespace paddle {
 namespace framework {
+class BlockDesc;
 class ProgramDesc;
 }  // namespace framework
 }  // namespace paddle
@@ -55,6 +56,16 @@ void PrepareSafeEagerDeletionOnWhileOpAndWhileGradOp(
 
 bool GetCondData(const framework::LoDTensor &cond);
 
+// Returns the tensors declared in the step block of the while op for
+// inference whose buffers should live through the whole loop, rather than
+// being released by the garbage collector inside an iteration:
+//  1. The loop-carried tensors, read by an iteration before it writes them,
+//     so they hold the values written by the previous iteration.
+//  2. If reuse_temporaries is true, the other temporaries, so that every
+//     iteration reuses the buffers allocated by the previous one.
+std::vector<std::string> GetWhileStepBufferVars(
+    const framework::BlockDesc &block, bool reuse_temporaries);
+
 bool StrInVaraiableNameMap(const std::string &,
                            const framework::VariableNameMap &);
 
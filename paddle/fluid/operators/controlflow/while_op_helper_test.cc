@@ -0,0 +1,50 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/operators/controlflow/while_op_helper.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+using BlockDesc = paddle::framework::BlockDesc;
+using ProgramDesc = paddle::framework::ProgramDesc;
+
+static void AppendOp(BlockDesc* block, const std::string& x,
+                     const std::string& out) {
+  auto* op = block->AppendOp();
+  op->SetType("scale");
+  op->SetInput("X", {x});
+  op->SetOutput("Out", {out});
+}
+
+TEST(WhileOpHelper, GetWhileStepBufferVars) {
+  ProgramDesc program;
+  auto* block = program.AppendBlock(program.Block(0));
+  // state is loop-carried, tmp is a temporary, weight is persistable and
+  // outer lives in the parent block.
+  block->Var("state");
+  block->Var("tmp");
+  block->Var("weight")->SetPersistable(true);
+  AppendOp(block, "state", "tmp");
+  AppendOp(block, "tmp", "state");
+  AppendOp(block, "weight", "outer");
+
+  EXPECT_EQ(paddle::operators::GetWhileStepBufferVars(*block, false),
+            std::vector<std::string>({"state"}));
+  EXPECT_EQ(paddle::operators::GetWhileStepBufferVars(*block, true),
+            std::vector<std::string>({"state", "tmp"}));
+}
@@ -0,0 +1,142 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/framework/scope.h"
+
+USE_NO_KERNEL_OP(while);
+USE_OP_ITSELF(less_than);
+USE_OP_ITSELF(scale);
+PD_DECLARE_KERNEL(less_than, CPU, ALL_LAYOUT);
+PD_DECLARE_KERNEL(scale, CPU, ALL_LAYOUT);
+
+DECLARE_bool(while_op_reuse_step_buffers);
+
+namespace paddle {
+namespace operators {
+
+using LoDTensor = framework::LoDTensor;
+
+// Whether the var named by the attribute var_name holds a buffer when the
+// op runs, recorded without reading the var, so that the op does not change
+// the lifetime of the var.
+static std::vector<bool> g_buffer_held;
+
+class RecordBufferHeldOp : public framework::OperatorBase {
+ public:
+  RecordBufferHeldOp(const std::string &type,
+                     const framework::VariableNameMap &inputs,
+                     const framework::VariableNameMap &outputs,
+                     const framework::AttributeMap &attrs)
+      : framework::OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const framework::Scope &scope,
+               const platform::Place &place) const override {
+    auto *var = scope.FindVar(Attr<std::string>("var_name"));
+    g_buffer_held.push_back(var != nullptr && var->IsType<LoDTensor>() &&
+                            var->Get<LoDTensor>().IsInitialized());
+  }
+};
+
+class RecordBufferHeldOpMaker : public framework::OpProtoAndCheckerMaker {
+ public:
+  void Make() override {
+    AddAttr<std::string>("var_name", "The name of the var to check.");
+    AddComment("Records whether a var holds a buffer, for the tests only.");
+  }
+};
+
+// Runs i = 0; while (i < 5) { tmp = i + 1; i = tmp; } for inference, and
+// records whether tmp holds a buffer at the start of every iteration.
+static float RunCountingLoop() {
+  framework::ProgramDesc program;
+  auto *block = program.MutableBlock(0);
+  auto *step_block = program.AppendBlock(*block);
+  step_block->Var("tmp")->SetType(framework::proto::VarType::LOD_TENSOR);
+
+  auto *op = step_block->AppendOp();
+  op->SetType("record_buffer_held");
+  op->SetAttr("var_name", std::string("tmp"));
+  op = step_block->AppendOp();
+  op->SetType("scale");
+  op->SetInput("X", {"i"});
+  op->SetOutput("Out", {"tmp"});
+  op->SetAttr("scale", 1.f);
+  op->SetAttr("bias", 1.f);
+  op = step_block->AppendOp();
+  op->SetType("scale");
+  op->SetInput("X", {"tmp"});
+  op->SetOutput("Out", {"i"});
+  op->SetAttr("scale", 1.f);
+  op->SetAttr("bias", 0.f);
+  op = step_block->AppendOp();
+  op->SetType("less_than");
+  op->SetInput("X", {"i"});
+  op->SetInput("Y", {"limit"});
+  op->SetOutput("Out", {"cond"});
+
+  platform::CPUPlace place;
+  framework::Scope scope;
+  auto set_value = [&](const std::string &name, float value) {
+    scope.Var(name)->GetMutable<LoDTensor>()->mutable_data<float>(
+        phi::make_ddim({1}), place)[0] = value;
+  };
+  set_value("i", 0.f);
+  set_value("limit", 5.f);
+  scope.Var("cond")->GetMutable<LoDTensor>()->mutable_data<bool>(
+      phi::make_ddim({1}), place)[0] = true;
+  scope.Var("step_scopes");
+
+  framework::AttributeMap attrs;
+  attrs["sub_block"] = step_block;
+  attrs["is_test"] = true;
+  attrs["skip_eager_deletion_vars"] = std::vector<std::string>();
+  auto while_op = framework::OpRegistry::CreateOp(
+      "while", {{"X", {"i", "limit"}}, {"Condition", {"cond"}}},
+      {{"Out", {"i", "cond"}}, {"StepScopes", {"step_scopes"}}}, attrs);
+  g_buffer_held.clear();
+  while_op->Run(scope, place);
+  return scope.FindVar("i")->Get<LoDTensor>().data<float>()[0];
+}
+
+TEST(WhileOp, ReuseStepBuffers) {
+  bool reuse_step_buffers = FLAGS_while_op_reuse_step_buffers;
+
+  // The temporary is released inside every iteration by default.
+  FLAGS_while_op_reuse_step_buffers = false;
+  EXPECT_EQ(RunCountingLoop(), 5.f);
+  EXPECT_EQ(g_buffer_held, std::vector<bool>(5, false));
+
+  // The buffer of the temporary is kept for the next iteration.
+  FLAGS_while_op_reuse_step_buffers = true;
+  EXPECT_EQ(RunCountingLoop(), 5.f);
+  EXPECT_EQ(g_buffer_held,
+            std::vector<bool>({false, true, true, true, true}));
+
+  FLAGS_while_op_reuse_step_buffers = reuse_step_buffers;
+}
+
+}  // namespace operators
+}  // namespace paddle
+
+REGISTER_OPERATOR(record_buffer_held,
+                  paddle::operators::RecordBufferHeldOp,
+                  paddle::operators::RecordBufferHeldOpMaker);
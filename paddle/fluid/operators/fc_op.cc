@@ -137,6 +137,11 @@ class FCOpMaker : public framework::OpProtoAndCheckerMaker {
     AddInput("W", "(Tensor), The weight fc op with shape (I, O).");
     AddInput("Bias", "(Tensor, optional) Bias vector with shape (1 x O")
         .AsDispensable();
+    AddInput("PackedW",
+             "(Tensor, optional) W packed by the BLAS library on CPU, which "
+             "is added by fc_weight_pack_pass and used instead of W in GEMM.")
+        .AsDispensable()
+        .AsExtra();
     AddOutput("Out",
               "(Tensor) The output tensor of fully connected operator. ");
     AddAttr<int>("in_num_col_dims",
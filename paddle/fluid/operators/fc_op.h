@@ -56,6 +56,7 @@ class FCOpKernel : public framework::OpKernel<T> {
     auto* input = ctx.Input<framework::LoDTensor>("Input");
     auto* w = ctx.Input<Tensor>("W");
     auto* bias = ctx.Input<Tensor>("Bias");
+    auto* packed_w = ctx.Input<Tensor>("PackedW");
     auto* output = ctx.Output<framework::LoDTensor>("Out");
     int in_num_col_dims = ctx.Attr<int>("in_num_col_dims");
     bool with_relu =
@@ -82,7 +83,8 @@ class FCOpKernel : public framework::OpKernel<T> {
     auto& dev_ctx = ctx.template device_context<DeviceContext>();
     math::FCFunctor<DeviceContext, T> fc;
     fc(dev_ctx, M, w_dims1, w_dims0, input_data, w_data, output_data,
-       bias ? bias->data<T>() : NULL, with_relu, padding_weights);
+       bias ? bias->data<T>() : NULL, with_relu, padding_weights,
+       packed_w ? packed_w->data<T>() : NULL);
   }
 };
 
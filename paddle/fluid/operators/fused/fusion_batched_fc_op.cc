@@ -0,0 +1,191 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/fused/fusion_batched_fc_op.h"
+#include <string>
+#include <vector>
+#include "paddle/fluid/operators/fc_op.h"
+#include "paddle/fluid/operators/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/blas/blas.h"
+
+namespace paddle {
+namespace operators {
+
+void FusionBatchedFCOp::InferShape(framework::InferShapeContext* ctx) const {
+  OP_INOUT_CHECK(ctx->HasInputs("X"), "Input", "X", "FusionBatchedFC");
+  OP_INOUT_CHECK(ctx->HasInputs("W"), "Input", "W", "FusionBatchedFC");
+  OP_INOUT_CHECK(ctx->HasOutputs("Out"), "Output", "Out", "FusionBatchedFC");
+  auto x_dims = ctx->GetInputsDim("X");
+  auto w_dims = ctx->GetInputsDim("W");
+  size_t sz = x_dims.size();
+  PADDLE_ENFORCE_EQ(
+      w_dims.size(), sz,
+      platform::errors::InvalidArgument(
+          "Size of inputs(W) of FusionBatchedFCOp should be equal to inputs(X) "
+          "size %d, but received value is %d.",
+          sz, w_dims.size()));
+  PADDLE_ENFORCE_EQ(
+      ctx->Outputs("Out").size(), sz,
+      platform::errors::InvalidArgument(
+          "Size of outputs(Out) of FusionBatchedFCOp should be equal to "
+          "inputs(X) size %d, but received value is %d.",
+          sz, ctx->Outputs("Out").size()));
+  if (ctx->HasInputs("Bias")) {
+    auto b_dims = ctx->GetInputsDim("Bias");
+    PADDLE_ENFORCE_EQ(
+        b_dims.size(), sz,
+        platform::errors::InvalidArgument(
+            "Size of inputs(Bias) of FusionBatchedFCOp should be equal to "
+            "inputs(X) size %d, but received value is %d.",
+            sz, b_dims.size()));
+    for (size_t i = 0; i < sz; ++i) {
+      PADDLE_ENFORCE_EQ(
+          phi::product(b_dims[i]), w_dims[i][1],
+          platform::errors::InvalidArgument(
+              "The length of Bias must be equal with w_dims[1], but received "
+              "product(b_dims[%d]) = %d, w_dims[%d][1] = %d.",
+              i, phi::product(b_dims[i]), i, w_dims[i][1]));
+    }
+  }
+
+  int in_num_col_dims = ctx->Attrs().Get<int>("in_num_col_dims");
+  std::vector<framework::DDim> out_dims(sz);
+  for (size_t i = 0; i < sz; ++i) {
+    PADDLE_ENFORCE_EQ(
+        w_dims[i], w_dims[0],
+        platform::errors::InvalidArgument(
+            "All the weights of FusionBatchedFCOp should be in the same "
+            "shape, but w_dims[%d] is %s and w_dims[0] is %s.",
+            i, w_dims[i], w_dims[0]));
+    std::vector<int64_t> output_dims;
+    FCOutputSize(x_dims[i], w_dims[i], output_dims, in_num_col_dims, false);
+    out_dims[i] = phi::make_ddim(output_dims);
+  }
+  ctx->SetOutputsDim("Out", out_dims);
+  for (size_t i = 0; i < sz; ++i) {
+    ctx->ShareLoD("X", /*->*/ "Out", i, i);
+  }
+}
+
+framework::OpKernelType FusionBatchedFCOp::GetExpectedKernelType(
+    const framework::ExecutionContext& ctx) const {
+  return framework::OpKernelType(
+      OperatorWithKernel::IndicateVarDataType(ctx, "X"), ctx.GetPlace());
+}
+
+void FusionBatchedFCOpMaker::Make() {
+  AddInput("X", "(LoDTensor) Input tensors of every fc.").AsDuplicable();
+  AddInput("W", "(Tensor) The weight tensors of every fc, in the same shape.")
+      .AsDuplicable();
+  AddInput("Bias", "(Tensor, optional) The bias tensors of every fc.")
+      .AsDuplicable()
+      .AsDispensable();
+  AddOutput("Out", "(LoDTensor) Output tensors of every fc.").AsDuplicable();
+  AddAttr<int>("in_num_col_dims",
+               "(int, default 1), The dimensions of every X flattened into "
+               "the rows of its GEMM.")
+      .SetDefault(1);
+  AddAttr<std::string>("activation_type",
+                       "Activation type used in every fc.")
+      .SetDefault("");
+  AddComment(R"DOC(
+  Fusion Batched FC Operator.
+
+  Computes Out[i] = activation(X[i] * W[i] + Bias[i]) for the independent fc
+  ops in the same shape, which are batched by batched_fc_fuse_pass. When all
+  X[i] have the same rows, the GEMMs run as one batched GEMM.
+)DOC");
+}
+
+template <typename T>
+class FusionBatchedFCKernel : public framework::OpKernel<T> {
+ public:
+  void Compute(const framework::ExecutionContext& ctx) const override {
+    auto xs = ctx.MultiInput<LoDTensor>("X");
+    auto weights = ctx.MultiInput<Tensor>("W");
+    auto biases = ctx.MultiInput<Tensor>("Bias");
+    auto outs = ctx.MultiOutput<LoDTensor>("Out");
+    int in_num_col_dims = ctx.Attr<int>("in_num_col_dims");
+    bool with_relu = ctx.Attr<std::string>("activation_type") == "relu";
+    auto place = ctx.GetPlace();
+    int batch_size = static_cast<int>(xs.size());
+
+    auto w_dims = weights[0]->dims();
+    int K = w_dims[0];
+    int N = w_dims[1];
+    std::vector<int> rows(batch_size);
+    std::vector<const T*> x_data(batch_size);
+    std::vector<const T*> w_data(batch_size);
+    std::vector<T*> out_data(batch_size);
+    bool same_rows = true;
+    for (int i = 0; i < batch_size; ++i) {
+      std::vector<int64_t> output_dims;
+      FCOutputSize(xs[i]->dims(), weights[i]->dims(), output_dims,
+                   in_num_col_dims, false);
+      outs[i]->Resize(phi::make_ddim(output_dims));
+      outs[i]->set_lod(xs[i]->lod());
+      rows[i] = phi::product(outs[i]->dims()) / N;
+      same_rows = same_rows && rows[i] == rows[0];
+      x_data[i] = xs[i]->data<T>();
+      w_data[i] = weights[i]->data<T>();
+      out_data[i] = outs[i]->mutable_data<T>(place);
+    }
+
+    auto& dev_ctx = ctx.template device_context<platform::CPUDeviceContext>();
+    auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(dev_ctx);
+    if (same_rows) {
+      blas.BatchedGEMM(CblasNoTrans, CblasNoTrans, rows[0], N, K,
+                       static_cast<T>(1.0), x_data.data(), w_data.data(),
+                       static_cast<T>(0.0), out_data.data(), batch_size);
+    } else {
+      for (int i = 0; i < batch_size; ++i) {
+        blas.MatMul(rows[i], N, K, x_data[i], w_data[i], out_data[i]);
+      }
+    }
+
+    if (biases.empty()) {
+      PADDLE_ENFORCE_EQ(with_relu, false,
+                        platform::errors::PermissionDenied(
+                            "When bias is NULL, relu can not be true."));
+      return;
+    }
+    auto compute =
+        with_relu
+            ? jit::KernelFuncs<jit::VAddReluTuple<T>,
+                               platform::CPUPlace>::Cache()
+                  .At(N)
+            : jit::KernelFuncs<jit::VAddTuple<T>, platform::CPUPlace>::Cache()
+                  .At(N);
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < batch_size; ++i) {
+      const T* bias = biases[i]->data<T>();
+      for (int j = 0; j < rows[i]; ++j) {
+        T* dst = out_data[i] + j * N;
+        compute(bias, dst, dst, N);
+      }
+    }
+  }
+};
+
+}  // namespace operators
+}  // namespace paddle
+
+namespace ops = paddle::operators;
+REGISTER_OPERATOR(fusion_batched_fc, ops::FusionBatchedFCOp,
+                  ops::FusionBatchedFCOpMaker);
+
+REGISTER_OP_CPU_KERNEL(fusion_batched_fc, ops::FusionBatchedFCKernel<float>,
+                       ops::FusionBatchedFCKernel<double>);
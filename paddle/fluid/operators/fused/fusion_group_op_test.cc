@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/ir/fusion_group/cpu_device_code.h"
 #include "paddle/fluid/framework/op_desc.h"
 #include "paddle/fluid/framework/op_proto_maker.h"
 #include "paddle/fluid/framework/op_registry.h"
@@ -90,13 +91,21 @@ framework::OpDesc* CreateFusionGroupOp(
 }
 
 void PrepareDeviceCode(platform::Place place, std::string func_name,
-                       std::string cuda_kernel_str) {
+                       std::string kernel_str) {
   paddle::platform::DeviceCodePool& pool =
       paddle::platform::DeviceCodePool::Init({place});
 
-  std::unique_ptr<paddle::platform::DeviceCode> code(
-      new paddle::platform::CUDADeviceCode(place, func_name, cuda_kernel_str));
-  code->Compile();
+  std::unique_ptr<paddle::platform::DeviceCode> code;
+  if (platform::is_cpu_place(place)) {
+    code.reset(new framework::ir::fusion_group::CPUDeviceCode(place, func_name,
+                                                              kernel_str));
+  } else {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    code.reset(
+        new paddle::platform::CUDADeviceCode(place, func_name, kernel_str));
+#endif
+  }
+  EXPECT_EQ(code->Compile(), true);
   pool.Set(std::move(code));
 }
 
@@ -137,12 +146,10 @@ void CheckOutputs(framework::Scope* scope,
 void TestMain(const std::vector<std::string>& input_names,
               const std::vector<std::vector<int64_t>>& input_shapes,
               const std::vector<std::string>& output_names, int type,
-              std::string func_name, std::string cuda_kernel_str,
-              CPUKernelFunc cpu_kernel_func) {
+              std::string func_name, std::string kernel_str,
+              CPUKernelFunc cpu_kernel_func, const platform::Place& place) {
   // Compile the device code
-  paddle::framework::InitDevices({0});
-  platform::CUDAPlace place = platform::CUDAPlace(0);
-  PrepareDeviceCode(place, func_name, cuda_kernel_str);
+  PrepareDeviceCode(place, func_name, kernel_str);
 
   // Create a ProgramDesc that has a fusion_group_op.
   framework::ProgramDesc program;
@@ -177,6 +184,21 @@ void TestMain(const std::vector<std::string>& input_names,
                cpu_kernel_func);
 }
 
+// z = relu(x + y)
+void ElementwiseCPUKernel(size_t n, std::vector<void*> args) {
+  float* x = static_cast<float*>(args[0]);
+  float* y = static_cast<float*>(args[1]);
+  float* z = static_cast<float*>(args[2]);
+  for (size_t i = 0; i < n; ++i) {
+    float tmp_0 = x[i];
+    float tmp_1 = y[i];
+    float tmp_2 = tmp_0 + tmp_1;
+    float tmp_3 = tmp_2 > 0 ? tmp_2 : 0;
+    z[i] = tmp_3;
+  }
+}
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 TEST(FusionGroupOp, elementwise) {
   if (!platform::dynload::HasNVRTC() || !platform::dynload::HasCUDADriver()) {
     return;
@@ -203,25 +225,37 @@ void elementwise_cuda_kernel_0(size_t n, float *x, float* y, float* z) {
   }
 })";
 
-  auto elementwise_cpu_kernel_0 = [](size_t n,
-                                     std::vector<void*> args) -> void {
-    float* x = static_cast<float*>(args[0]);
-    float* y = static_cast<float*>(args[1]);
-    float* z = static_cast<float*>(args[2]);
-    for (size_t i = 0; i < n; ++i) {
-      float tmp_0 = x[i];
-      float tmp_1 = y[i];
-      float tmp_2 = tmp_0 + tmp_1;
-      float tmp_3 = tmp_2 > 0 ? tmp_2 : 0;
-      z[i] = tmp_3;
-    }
-  };
+  paddle::framework::InitDevices({0});
+  TestMain(input_names, input_shapes, output_names, 0,
+           "elementwise_cuda_kernel_0", kernel, ElementwiseCPUKernel,
+           platform::CUDAPlace(0));
+}
+#endif
+
+TEST(FusionGroupOp, elementwise_cpu) {
+  if (!framework::ir::fusion_group::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  // z = relu(x + y)
+  std::vector<std::string> input_names = {"x", "y"};
+  std::vector<std::string> output_names = {"z"};
+  std::vector<std::vector<int64_t>> input_shapes = {{256, 256}, {256, 256}};
+  constexpr auto kernel = R"(
+elementwise_cpu_kernel_0(x, y, z) {
+  float tmp_0 = x[idx];
+  float tmp_1 = y[idx];
+  float tmp_2 = tmp_0 + tmp_1;
+  float tmp_3 = tmp_2 > 0 ? tmp_2 : 0.0;
+  z[idx] = tmp_3;
+})";
 
   TestMain(input_names, input_shapes, output_names, 0,
-           "elementwise_cuda_kernel_0", kernel, elementwise_cpu_kernel_0);
+           "elementwise_cpu_kernel_0", kernel, ElementwiseCPUKernel,
+           platform::CPUPlace());
 }
 
 }  // namespace operators
 }  // namespace paddle
 
-USE_CUDA_ONLY_OP(fusion_group);
+USE_OP(fusion_group);
@@ -0,0 +1,146 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/gen/fused_elementwise.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace gen {
+
+void FusedElementwiseJitCode::mainCode(const fused_instr_t& instr) {
+  switch (instr.type) {
+    case kFusedLoad:
+      mov(reg_ptr_arg, ptr[param_args + instr.arg * sizeof(float*)]);
+      vmovups(ymm_dst, ptr[reg_ptr_arg + reg_i * sizeof(float)]);
+      vmovups(slot(instr.dst), ymm_dst);
+      return;
+    case kFusedStore:
+      mov(reg_ptr_arg, ptr[param_args + instr.arg * sizeof(float*)]);
+      vmovups(ymm_src0, slot(instr.src0));
+      vmovups(ptr[reg_ptr_arg + reg_i * sizeof(float)], ymm_src0);
+      return;
+    case kFusedConst:
+      // Set before the loop.
+      return;
+    case kFusedSqrt:
+      vmovups(ymm_src0, slot(instr.src0));
+      vsqrtps(ymm_dst, ymm_src0);
+      break;
+    case kFusedExp:
+      vmovups(ymm_src0, slot(instr.src0));
+      exp_jmm<ymm_t>(ymm_dst, ymm_src0);
+      break;
+    case kFusedSelect:
+      vmovups(ymm_dst, slot(instr.src0));
+      vxorps(ymm_src0, ymm_src0, ymm_src0);
+      vcmpneqps(ymm_dst, ymm_dst, ymm_src0);
+      vmovups(ymm_src1, slot(instr.src1));
+      vmovups(ymm_src2, slot(instr.src2));
+      vblendvps(ymm_dst, ymm_src2, ymm_src1, ymm_dst);
+      break;
+    default:
+      vmovups(ymm_src0, slot(instr.src0));
+      vmovups(ymm_src1, slot(instr.src1));
+      switch (instr.type) {
+        case kFusedAdd:
+          vaddps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedSub:
+          vsubps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedMul:
+          vmulps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedDiv:
+          vdivps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedMax:
+          vmaxps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedMin:
+          vminps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedLT:
+          vcmpltps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedLE:
+          vcmpleps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedGT:
+          vcmpltps(ymm_dst, ymm_src1, ymm_src0);
+          break;
+        case kFusedGE:
+          vcmpleps(ymm_dst, ymm_src1, ymm_src0);
+          break;
+        case kFusedEQ:
+          vcmpeqps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        case kFusedNE:
+          vcmpneqps(ymm_dst, ymm_src0, ymm_src1);
+          break;
+        default:
+          PADDLE_THROW(platform::errors::Unimplemented(
+              "Unsupported fused elementwise operation %d.", instr.type));
+      }
+      if (instr.type >= kFusedLT && instr.type <= kFusedNE) {
+        vbroadcastss(ymm_src2, ptr[reg_ptr_consts + (consts_.size() - 1) *
+                                                        sizeof(float)]);
+        vandps(ymm_dst, ymm_dst, ymm_src2);
+      }
+      break;
+  }
+  vmovups(slot(instr.dst), ymm_dst);
+}
+
+void FusedElementwiseJitCode::genCode() {
+  preCode();
+  const size_t slots_size =
+      program_.num_slots * YMM_FLOAT_BLOCK * sizeof(float);
+  sub(rsp, slots_size);
+  mov(reg_ptr_slots, rsp);
+  mov(reg_ptr_consts, reinterpret_cast<size_t>(consts_.data()));
+
+  // The constants do not change between the iterations.
+  size_t const_idx = 0;
+  for (auto& instr : program_.instrs) {
+    if (instr.type == kFusedConst) {
+      vbroadcastss(ymm_dst, ptr[reg_ptr_consts + const_idx * sizeof(float)]);
+      vmovups(slot(instr.dst), ymm_dst);
+      ++const_idx;
+    }
+  }
+
+  Label l_next;
+  Label l_end;
+  xor_(reg_i, reg_i);
+  L(l_next);
+  {
+    cmp(reg_i, param_n);
+    jae(l_end, T_NEAR);
+    for (auto& instr : program_.instrs) {
+      mainCode(instr);
+    }
+    add(reg_i, YMM_FLOAT_BLOCK);
+    jmp(l_next, T_NEAR);
+  }
+  L(l_end);
+  add(rsp, slots_size);
+  postCode();
+}
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
@@ -0,0 +1,124 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/fluid/operators/jit/gen/act.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace gen {
+
+typedef enum {
+  kFusedLoad = 0,  // slot[dst] = args[arg][i]
+  kFusedStore,     // args[arg][i] = slot[src0]
+  kFusedConst,     // slot[dst] = value
+  kFusedAdd,
+  kFusedSub,
+  kFusedMul,
+  kFusedDiv,
+  kFusedMax,
+  kFusedMin,
+  kFusedSqrt,
+  kFusedExp,
+  kFusedLT,  // slot[dst] = slot[src0] < slot[src1] ? 1 : 0, and so on
+  kFusedLE,
+  kFusedGT,
+  kFusedGE,
+  kFusedEQ,
+  kFusedNE,
+  kFusedSelect,  // slot[dst] = slot[src0] != 0 ? slot[src1] : slot[src2]
+} fused_op_type;
+
+struct fused_instr_t {
+  fused_op_type type;
+  int dst{0};
+  int src0{0};
+  int src1{0};
+  int src2{0};
+  int arg{0};
+  float value{0.f};
+};
+
+// A fused elementwise program works on slots of YMM_FLOAT_BLOCK floats. Every
+// instruction writes a new slot, so the slots are never overwritten inside
+// one iteration.
+struct fused_program_t {
+  std::vector<fused_instr_t> instrs;
+  int num_slots{0};
+};
+
+// Runs the program over n floats, where n must be a multiple of
+// YMM_FLOAT_BLOCK, and args holds the data pointers of the program.
+typedef void (*FusedElementwiseFunc)(size_t n, float** args);
+
+class FusedElementwiseJitCode : public VActFunc {
+ public:
+  explicit FusedElementwiseJitCode(const fused_program_t& program,
+                                   size_t code_size, void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr), program_(program) {
+    for (auto& instr : program_.instrs) {
+      if (instr.type == kFusedConst) {
+        consts_.push_back(instr.value);
+      }
+    }
+    // The mask of the comparison is turned into 1.0 with the last constant.
+    consts_.push_back(1.f);
+    this->genCode();
+  }
+
+  DECLARE_JIT_CODE(FusedElementwiseJitCode);
+  void genCode() override;
+
+  static size_t CodeSize(const fused_program_t& program) {
+    // The exp with AVX only takes about 400 bytes, others less than 64.
+    return 512 + program.instrs.size() * 512;
+  }
+
+ private:
+  Xbyak::Address slot(int i) {
+    return ptr[reg_ptr_slots + i * YMM_FLOAT_BLOCK * sizeof(float)];
+  }
+  void mainCode(const fused_instr_t& instr);
+
+  fused_program_t program_;
+  // The constants must live as long as the code, which reloads them from
+  // here on every call.
+  std::vector<float> consts_;
+
+  reg64_t param_n{abi_param1};
+  reg64_t param_args{abi_param2};
+
+  reg64_t reg_ptr_arg{r8};
+  reg64_t reg_i{r13};
+  reg64_t reg_ptr_consts{r14};
+  reg64_t reg_ptr_slots{r15};
+
+  // ymm11~15 are used by exp_jmm.
+  ymm_t ymm_dst = ymm_t(0);
+  ymm_t ymm_src0 = ymm_t(1);
+  ymm_t ymm_src1 = ymm_t(2);
+  ymm_t ymm_src2 = ymm_t(3);
+};
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
@@ -27,7 +27,7 @@ class FCFunctor<platform::CPUDeviceContext, T> {
   void operator()(const platform::CPUDeviceContext& context, const int M,
                   const int N, const int K, const T* X, const T* W, T* Y,
                   const T* B = nullptr, bool relu = false,
-                  bool padding_weights = false) {
+                  bool padding_weights = false, const T* packed_W = nullptr) {
     auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(context);
     framework::Tensor Y1;
     T* Y1_data = nullptr;
@@ -45,6 +45,14 @@ class FCFunctor<platform::CPUDeviceContext, T> {
       }
       blas.GEMM(false, false, M, N, K, static_cast<T>(1.0), X1_data, KK, W, NN,
                 static_cast<T>(0.0), Y1_data, NN);
+    } else if (packed_W != nullptr) {
+#ifdef PADDLE_WITH_MKLML
+      blas.GEMM_COMPUTE(CblasNoTrans, CblasPacked, M, N, K, X, K, packed_W, N,
+                        static_cast<T>(0.0), Y, N);
+#else
+      PADDLE_THROW(platform::errors::Unimplemented(
+          "Packed weight in fc is only supported with MKLML."));
+#endif
     } else {
       blas.MatMul(M, N, K, X, W, Y);
     }
@@ -80,8 +88,38 @@ class FCFunctor<platform::CPUDeviceContext, T> {
   }
 };
 
+template <typename T>
+class FCWeightPacker<platform::CPUDeviceContext, T> {
+ public:
+  static int64_t PackedNumel(const platform::CPUDeviceContext& context,
+                             const int N, const int K) {
+#ifdef PADDLE_WITH_MKLML
+    auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(context);
+    size_t bytes = blas.GEMM_PACK_GET_SIZE(CblasBMatrix, 1, N, K);
+    return static_cast<int64_t>((bytes + sizeof(T) - 1) / sizeof(T));
+#else
+    return 0;
+#endif
+  }
+
+  static void Pack(const platform::CPUDeviceContext& context, const int N,
+                   const int K, const T* W, T* packed_W) {
+#ifdef PADDLE_WITH_MKLML
+    auto blas = phi::funcs::GetBlas<platform::CPUDeviceContext, T>(context);
+    // The packed B matrix does not depend on M, the rows of the input.
+    blas.GEMM_PACK(CblasBMatrix, CblasNoTrans, 1, N, K, static_cast<T>(1.0), W,
+                   N, packed_W);
+#else
+    PADDLE_THROW(platform::errors::Unimplemented(
+        "Packing the weight of fc is only supported with MKLML."));
+#endif
+  }
+};
+
 template class FCFunctor<platform::CPUDeviceContext, float>;
 template class FCFunctor<platform::CPUDeviceContext, double>;
+template class FCWeightPacker<platform::CPUDeviceContext, float>;
+template class FCWeightPacker<platform::CPUDeviceContext, double>;
 
 }  // namespace math
 }  // namespace operators
@@ -27,7 +27,21 @@ class FCFunctor {
   void operator()(const DeviceContext& context, const int M, const int N,
                   const int K, const T* X, const T* W, T* Y,
                   const T* B = nullptr, bool relu = false,
-                  bool weight_pass = false);
+                  bool weight_pass = false, const T* packed_W = nullptr);
+};
+
+// Packs the K x N weight of FCFunctor into the opaque layout of the BLAS
+// library once, and the packed weight can be passed to FCFunctor as
+// packed_W to skip the packing done inside every GEMM call.
+template <typename DeviceContext, typename T>
+class FCWeightPacker {
+ public:
+  // The number of T needed to hold the packed weight, 0 if packing is not
+  // supported.
+  static int64_t PackedNumel(const DeviceContext& context, const int N,
+                             const int K);
+  static void Pack(const DeviceContext& context, const int N, const int K,
+                   const T* W, T* packed_W);
 };
 
 }  // namespace math
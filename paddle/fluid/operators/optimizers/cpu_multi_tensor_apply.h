@@ -0,0 +1,66 @@
+// Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace paddle {
+namespace operators {
+
+// The elements [offset, offset + numel) of the tensor_id-th tensor updated by
+// a merged optimizer on CPU.
+struct TensorChunk {
+  size_t tensor_id;
+  int64_t offset;
+  int64_t numel;
+};
+
+// Splits the tensors of the numels into the chunks of chunk_size elements at
+// most, so that the small tensors are updated together and the large ones
+// are split, instead of updating the tensors one by one.
+inline std::vector<TensorChunk> SplitTensorChunks(
+    const std::vector<int64_t>& numels, int64_t chunk_size) {
+  size_t chunk_num = 0;
+  for (auto numel : numels) {
+    chunk_num += (numel + chunk_size - 1) / chunk_size;
+  }
+  std::vector<TensorChunk> chunks;
+  chunks.reserve(chunk_num);
+  for (size_t i = 0; i < numels.size(); ++i) {
+    for (int64_t offset = 0; offset < numels[i]; offset += chunk_size) {
+      chunks.push_back({i, offset, std::min(chunk_size, numels[i] - offset)});
+    }
+  }
+  return chunks;
+}
+
+// Runs func on each chunk, in parallel if OpenMP is enabled. func is called
+// concurrently, so it should not get the kernels from the jit caches, which
+// are not thread safe.
+template <typename Func>
+void RunTensorChunks(const std::vector<TensorChunk>& chunks, Func&& func) {
+  const int64_t chunk_num = static_cast<int64_t>(chunks.size());
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+  for (int64_t i = 0; i < chunk_num; ++i) {
+    func(chunks[i]);
+  }
+}
+
+}  // namespace operators
+}  // namespace paddle
@@ -123,6 +123,25 @@ $$
   }
 };
 
+class MergedAdamWOpMaker : public MergedAdamOpMaker {
+ public:
+  void Make() override {
+    MergedAdamOpMaker::Make();
+    AddAttr<float>("lr_ratio",
+                   "(float, default 1.0) "
+                   "layerwise learning rate decay")
+        .SetDefault(1.0f);
+    AddAttr<float>("coeff",
+                   "(float, default 0.01) "
+                   "coeff of the weight decay")
+        .SetDefault(0.01f);
+    AddAttr<bool>("with_decay",
+                  "(bool, default false) "
+                  "whether to do weight decay")
+        .SetDefault(false);
+  }
+};
+
 }  // namespace operators
 }  // namespace paddle
 
@@ -130,9 +149,14 @@ namespace ops = paddle::operators;
 REGISTER_OP_WITHOUT_GRADIENT(merged_adam, ops::MergedAdamOp,
                              ops::MergedAdamOpMaker);
 REGISTER_OP_WITHOUT_GRADIENT(merged_adamw, ops::MergedAdamOp,
-                             ops::MergedAdamOpMaker);
+                             ops::MergedAdamWOpMaker);
 
 REGISTER_OP_CPU_KERNEL(
     merged_adam,
     ops::MergedAdamOpKernel<paddle::platform::CPUDeviceContext, float>,
     ops::MergedAdamOpKernel<paddle::platform::CPUDeviceContext, double>);
+
+REGISTER_OP_CPU_KERNEL(
+    merged_adamw,
+    ops::MergedAdamWOpKernel<paddle::platform::CPUDeviceContext, float>,
+    ops::MergedAdamWOpKernel<paddle::platform::CPUDeviceContext, double>);
@@ -10,8 +10,11 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #pragma once
+#include <vector>
 #include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/optimizers/adam_op.h"
+#include "paddle/fluid/operators/optimizers/cpu_multi_tensor_apply.h"
 
 namespace paddle {
 namespace operators {
@@ -22,6 +25,11 @@ template <typename DeviceContext, typename T>
 class MergedAdamOpKernel : public framework::OpKernel<T> {
  public:
   void Compute(const framework::ExecutionContext& ctx) const override {
+    Update(ctx, false);
+  }
+
+ protected:
+  void Update(const framework::ExecutionContext& ctx, bool with_decay) const {
     auto param = ctx.MultiInput<framework::Tensor>("Param");
     size_t n = param.size();
     auto grad = ctx.MultiInput<framework::Tensor>("Grad");
@@ -80,17 +88,64 @@ class MergedAdamOpKernel : public framework::OpKernel<T> {
     bool use_global_beta_pow = ctx.Attr<bool>("use_global_beta_pow");
     VLOG(4) << "use_global_beta_pow:" << use_global_beta_pow;
 
-    size_t param_num = param.size();
-    for (size_t idx = 0; idx < param_num; idx++) {
-      AdamFunctor<T, CPUAdam> functor(
-          beta1, beta2, epsilon, beta1_pow[idx]->data<T>(),
-          beta2_pow[idx]->data<T>(), mom1[idx]->data<T>(),
-          mom1_out[idx]->mutable_data<T>(ctx.GetPlace()), mom2[idx]->data<T>(),
-          mom2_out[idx]->mutable_data<T>(ctx.GetPlace()), lr[idx]->data<T>(),
-          grad[idx]->data<T>(), param[idx]->data<T>(),
-          param_out[idx]->mutable_data<T>(ctx.GetPlace()));
-      functor(param[idx]->numel());
-      if (!use_global_beta_pow) {
+    // Decays the params before updating them, as AdamW does.
+    T coeff = static_cast<T>(0);
+    T lr_ratio = static_cast<T>(1);
+    if (with_decay) {
+      coeff = static_cast<T>(ctx.Attr<float>("coeff"));
+      lr_ratio = static_cast<T>(ctx.Attr<float>("lr_ratio"));
+    }
+
+    std::vector<T> learning_rates(n), epsilons(n), decays(n);
+    std::vector<int64_t> numels(n);
+    std::vector<const T*> param_ptrs(n), grad_ptrs(n), mom1_ptrs(n),
+        mom2_ptrs(n);
+    std::vector<T*> param_out_ptrs(n), mom1_out_ptrs(n), mom2_out_ptrs(n);
+    for (size_t idx = 0; idx < n; idx++) {
+      T beta1_p = beta1_pow[idx]->data<T>()[0];
+      T beta2_p = beta2_pow[idx]->data<T>()[0];
+      T lr_value = lr[idx]->data<T>()[0];
+      learning_rates[idx] = lr_value * (sqrt(1 - beta2_p) / (1 - beta1_p));
+      epsilons[idx] = epsilon * sqrt(1 - beta2_p);
+      decays[idx] = lr_value * lr_ratio * coeff;
+      numels[idx] = param[idx]->numel();
+      param_ptrs[idx] = param[idx]->data<T>();
+      grad_ptrs[idx] = grad[idx]->data<T>();
+      mom1_ptrs[idx] = mom1[idx]->data<T>();
+      mom2_ptrs[idx] = mom2[idx]->data<T>();
+      param_out_ptrs[idx] = param_out[idx]->mutable_data<T>(ctx.GetPlace());
+      mom1_out_ptrs[idx] = mom1_out[idx]->mutable_data<T>(ctx.GetPlace());
+      mom2_out_ptrs[idx] = mom2_out[idx]->mutable_data<T>(ctx.GetPlace());
+    }
+
+    // The chunks of all the params are updated by one parallel loop, so that
+    // the small params do not leave the threads idle.
+    static constexpr int64_t chunk_size = 512;
+    auto chunks = SplitTensorChunks(numels, chunk_size);
+    auto adam =
+        jit::KernelFuncs<jit::AdamTuple<T>, platform::CPUPlace>::Cache().At(
+            jit::adam_attr_t(beta1, beta2));
+    RunTensorChunks(chunks, [&](const TensorChunk& chunk) {
+      size_t idx = chunk.tensor_id;
+      int64_t offset = chunk.offset;
+      const T* param_ptr = param_ptrs[idx] + offset;
+      T* param_out_ptr = param_out_ptrs[idx] + offset;
+      if (with_decay) {
+        for (int64_t i = 0; i < chunk.numel; ++i) {
+          param_out_ptr[i] = param_ptr[i] - decays[idx] * param_ptr[i];
+        }
+        param_ptr = param_out_ptr;
+      }
+      adam(beta1, beta2, -learning_rates[idx], epsilons[idx], chunk.numel,
+           grad_ptrs[idx] + offset, mom1_ptrs[idx] + offset,
+           mom2_ptrs[idx] + offset, param_ptr, mom1_out_ptrs[idx] + offset,
+           mom2_out_ptrs[idx] + offset, param_out_ptr);
+    });
+    VLOG(10) << "Update " << n << " params of " << chunks.size()
+             << " chunks by MergedAdam cpu kernel.";
+
+    if (!use_global_beta_pow) {
+      for (size_t idx = 0; idx < n; idx++) {
         beta1_pow_out[idx]->mutable_data<T>(ctx.GetPlace())[0] =
             beta1 * beta1_pow[idx]->data<T>()[0];
         beta2_pow_out[idx]->mutable_data<T>(ctx.GetPlace())[0] =
@@ -100,5 +155,13 @@ class MergedAdamOpKernel : public framework::OpKernel<T> {
   }
 };
 
+template <typename DeviceContext, typename T>
+class MergedAdamWOpKernel : public MergedAdamOpKernel<DeviceContext, T> {
+ public:
+  void Compute(const framework::ExecutionContext& ctx) const override {
+    this->Update(ctx, ctx.Attr<bool>("with_decay"));
+  }
+};
+
 }  // namespace operators
 }  // namespace paddle
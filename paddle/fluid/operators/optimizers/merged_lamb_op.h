@@ -0,0 +1,174 @@
+/* Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+#include <math.h>
+#include <string>
+#include <vector>
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/operators/optimizers/cpu_multi_tensor_apply.h"
+
+namespace paddle {
+namespace operators {
+
+template <typename DeviceContext, typename T>
+class MergedLambOpKernel : public framework::OpKernel<T> {
+ public:
+  void Compute(const framework::ExecutionContext& ctx) const override {
+    auto param = ctx.MultiInput<framework::Tensor>("Param");
+    size_t n = param.size();
+    for (std::string name : {"Grad", "LearningRate", "Moment1", "Moment2",
+                             "Beta1Pow", "Beta2Pow"}) {
+      auto size = ctx.MultiInput<framework::Tensor>(name).size();
+      PADDLE_ENFORCE_EQ(n, size,
+                        platform::errors::InvalidArgument(
+                            "The size of Input(%s) must be equal to "
+                            "Input(Param), but got the size of Input(%s) "
+                            "is %d, the size of Input(Param) is %d.",
+                            name, name, size, n));
+    }
+    auto grad = ctx.MultiInput<framework::Tensor>("Grad");
+    auto lr = ctx.MultiInput<framework::Tensor>("LearningRate");
+    auto mom1 = ctx.MultiInput<framework::Tensor>("Moment1");
+    auto mom2 = ctx.MultiInput<framework::Tensor>("Moment2");
+    auto beta1_pow = ctx.MultiInput<framework::Tensor>("Beta1Pow");
+    auto beta2_pow = ctx.MultiInput<framework::Tensor>("Beta2Pow");
+
+    auto param_out = ctx.MultiOutput<framework::Tensor>("ParamOut");
+    auto mom1_out = ctx.MultiOutput<framework::Tensor>("Moment1Out");
+    auto mom2_out = ctx.MultiOutput<framework::Tensor>("Moment2Out");
+    auto beta1_pow_out = ctx.MultiOutput<framework::Tensor>("Beta1PowOut");
+    auto beta2_pow_out = ctx.MultiOutput<framework::Tensor>("Beta2PowOut");
+
+    T beta1 = static_cast<T>(ctx.Attr<float>("beta1"));
+    T beta2 = static_cast<T>(ctx.Attr<float>("beta2"));
+    T epsilon = static_cast<T>(ctx.Attr<float>("epsilon"));
+    auto weight_decays = ctx.Attr<std::vector<float>>("weight_decay");
+    if (weight_decays.size() != 0) {
+      PADDLE_ENFORCE_EQ(
+          n, weight_decays.size(),
+          platform::errors::InvalidArgument(
+              "The size of Attr(weight_decay) must be equal to "
+              "Input(Param), but got the size of Attr(weight_decay) "
+              "is %d, the size of Input(Param) is %d.",
+              weight_decays.size(), n));
+    }
+
+    std::vector<int64_t> numels(n), offsets(n);
+    std::vector<T> decays(n), beta1_corrections(n), beta2_corrections(n);
+    std::vector<const T*> param_ptrs(n), grad_ptrs(n), mom1_ptrs(n),
+        mom2_ptrs(n);
+    std::vector<T*> param_out_ptrs(n), mom1_out_ptrs(n), mom2_out_ptrs(n);
+    int64_t total_numel = 0;
+    for (size_t idx = 0; idx < n; idx++) {
+      numels[idx] = param[idx]->numel();
+      offsets[idx] = total_numel;
+      total_numel += numels[idx];
+      decays[idx] = weight_decays.size() != 0
+                        ? static_cast<T>(weight_decays[idx])
+                        : static_cast<T>(0);
+      beta1_corrections[idx] = 1 - beta1_pow[idx]->data<T>()[0];
+      beta2_corrections[idx] = 1 - beta2_pow[idx]->data<T>()[0];
+      param_ptrs[idx] = param[idx]->data<T>();
+      grad_ptrs[idx] = grad[idx]->data<T>();
+      mom1_ptrs[idx] = mom1[idx]->data<T>();
+      mom2_ptrs[idx] = mom2[idx]->data<T>();
+      param_out_ptrs[idx] = param_out[idx]->mutable_data<T>(ctx.GetPlace());
+      mom1_out_ptrs[idx] = mom1_out[idx]->mutable_data<T>(ctx.GetPlace());
+      mom2_out_ptrs[idx] = mom2_out[idx]->mutable_data<T>(ctx.GetPlace());
+    }
+
+    auto& dev_ctx = ctx.template device_context<DeviceContext>();
+    auto trust_ratio_div =
+        ctx.AllocateTmpTensor<T, DeviceContext>({total_numel}, dev_ctx);
+    T* trust_ratio_div_ptr = trust_ratio_div.template data<T>();
+
+    auto chunks = SplitTensorChunks(numels, 512);
+    // The squared norms of the chunks, which are summed up by the params in
+    // order, so that the results do not depend on the number of threads.
+    std::vector<T> chunk_param_norms(chunks.size());
+    std::vector<T> chunk_trust_ratio_div_norms(chunks.size());
+
+    // Update moments
+    RunTensorChunks(chunks, [&](const TensorChunk& chunk) {
+      size_t idx = chunk.tensor_id;
+      int64_t offset = chunk.offset;
+      const T* param_ptr = param_ptrs[idx] + offset;
+      const T* grad_ptr = grad_ptrs[idx] + offset;
+      const T* mom1_ptr = mom1_ptrs[idx] + offset;
+      const T* mom2_ptr = mom2_ptrs[idx] + offset;
+      T* mom1_out_ptr = mom1_out_ptrs[idx] + offset;
+      T* mom2_out_ptr = mom2_out_ptrs[idx] + offset;
+      T* trust_ratio_div_chunk = trust_ratio_div_ptr + offsets[idx] + offset;
+      T param_norm = static_cast<T>(0);
+      T trust_ratio_div_norm = static_cast<T>(0);
+      for (int64_t i = 0; i < chunk.numel; ++i) {
+        T g = grad_ptr[i];
+        T p = param_ptr[i];
+        T m1 = beta1 * mom1_ptr[i] + (1 - beta1) * g;
+        T m2 = beta2 * mom2_ptr[i] + (1 - beta2) * g * g;
+        mom1_out_ptr[i] = m1;
+        mom2_out_ptr[i] = m2;
+        T div = (m1 / beta1_corrections[idx]) /
+                    (sqrt(m2 / beta2_corrections[idx]) + epsilon) +
+                decays[idx] * p;
+        trust_ratio_div_chunk[i] = div;
+        param_norm += p * p;
+        trust_ratio_div_norm += div * div;
+      }
+      size_t chunk_id = &chunk - chunks.data();
+      chunk_param_norms[chunk_id] = param_norm;
+      chunk_trust_ratio_div_norms[chunk_id] = trust_ratio_div_norm;
+    });
+
+    std::vector<T> param_norms(n), trust_ratio_div_norms(n);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      param_norms[chunks[i].tensor_id] += chunk_param_norms[i];
+      trust_ratio_div_norms[chunks[i].tensor_id] +=
+          chunk_trust_ratio_div_norms[i];
+    }
+    std::vector<T> learning_rates(n);
+    for (size_t idx = 0; idx < n; idx++) {
+      T pn = sqrt(param_norms[idx]);
+      T tn = sqrt(trust_ratio_div_norms[idx]);
+      T r = (pn > static_cast<T>(0) && tn > static_cast<T>(0))
+                ? pn / tn
+                : static_cast<T>(1);
+      learning_rates[idx] = lr[idx]->data<T>()[0] * r;
+    }
+
+    // Update parameter
+    RunTensorChunks(chunks, [&](const TensorChunk& chunk) {
+      size_t idx = chunk.tensor_id;
+      int64_t offset = chunk.offset;
+      const T* param_ptr = param_ptrs[idx] + offset;
+      T* param_out_ptr = param_out_ptrs[idx] + offset;
+      const T* trust_ratio_div_chunk =
+          trust_ratio_div_ptr + offsets[idx] + offset;
+      for (int64_t i = 0; i < chunk.numel; ++i) {
+        param_out_ptr[i] =
+            param_ptr[i] - learning_rates[idx] * trust_ratio_div_chunk[i];
+      }
+    });
+    VLOG(10) << "Update " << n << " params of " << chunks.size()
+             << " chunks by MergedLamb cpu kernel.";
+
+    for (size_t idx = 0; idx < n; idx++) {
+      beta1_pow_out[idx]->mutable_data<T>(ctx.GetPlace())[0] =
+          beta1 * beta1_pow[idx]->data<T>()[0];
+      beta2_pow_out[idx]->mutable_data<T>(ctx.GetPlace())[0] =
+          beta2 * beta2_pow[idx]->data<T>()[0];
+    }
+  }
+};
+
+}  // namespace operators
+}  // namespace paddle
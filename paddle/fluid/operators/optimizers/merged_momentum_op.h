@@ -18,6 +18,7 @@
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/framework/tensor.h"
 #include "paddle/fluid/operators/amp/fp16_type_traits.h"
+#include "paddle/fluid/operators/optimizers/cpu_multi_tensor_apply.h"
 #include "paddle/fluid/operators/optimizers/momentum_op.h"
 #include "paddle/fluid/platform/for_range.h"
 #include "paddle/fluid/platform/macros.h"
@@ -79,6 +80,22 @@ struct MergedMomentumKernelParam
   }
 };
 
+template <typename T, bool kUseNesterov>
+static void CPUMergedMomentumUpdate(T *param, const T *grad, T *velocity,
+                                    int64_t numel, T lr, T mu, T rescale_grad,
+                                    T regularization_coeff) {
+  for (int64_t i = 0; i < numel; ++i) {
+    const T grad_val = grad[i] * rescale_grad + regularization_coeff * param[i];
+    const T velocity_out = velocity[i] * mu + grad_val;
+    velocity[i] = velocity_out;
+    if (kUseNesterov) {
+      param[i] -= (grad_val + velocity_out * mu) * lr;
+    } else {
+      param[i] -= lr * velocity_out;
+    }
+  }
+}
+
 template <typename DeviceContext, typename T>
 class MergedMomentumOpKernel : public framework::OpKernel<T> {
   using MPType = typename operators::details::MPTypeTrait<T>::Type;
@@ -221,6 +238,39 @@ class MergedMomentumOpKernel : public framework::OpKernel<T> {
 
     auto &dev_ctx = ctx.template device_context<DeviceContext>();
 
+    if (platform::is_cpu_place(ctx.GetPlace()) && !multi_precision) {
+      // The chunks of all the params are updated by one parallel loop.
+      std::vector<int64_t> numels(n);
+      std::vector<T *> param_ptrs(n), velocity_ptrs(n);
+      std::vector<const T *> grad_ptrs(n);
+      std::vector<T> lr_values(n), coeffs(n, static_cast<T>(0));
+      for (size_t idx = 0; idx < n; ++idx) {
+        numels[idx] = params_out[idx]->numel();
+        param_ptrs[idx] = params_out[idx]->data<T>();
+        velocity_ptrs[idx] = velocitys_out[idx]->data<T>();
+        grad_ptrs[idx] = grads[idx]->data<T>();
+        auto lr_temp = lrs.size() > 1 ? lrs[idx] : lrs[0];
+        lr_values[idx] = static_cast<T>(lr_temp->data<MPType>()[0]);
+        if (regularization_methods.size() > 0 &&
+            regularization_methods[idx] == "l2_decay") {
+          coeffs[idx] = static_cast<T>(regularization_coeffs[idx]);
+        }
+      }
+      auto chunks = SplitTensorChunks(numels, 512);
+      RunTensorChunks(chunks, [&](const TensorChunk &chunk) {
+        size_t idx = chunk.tensor_id;
+        auto update = use_nesterov ? CPUMergedMomentumUpdate<T, true>
+                                   : CPUMergedMomentumUpdate<T, false>;
+        update(param_ptrs[idx] + chunk.offset, grad_ptrs[idx] + chunk.offset,
+               velocity_ptrs[idx] + chunk.offset, chunk.numel,
+               lr_values[idx], static_cast<T>(mu),
+               static_cast<T>(rescale_grad), coeffs[idx]);
+      });
+      VLOG(10) << "Launch MergedMomentum cpu kernel of " << chunks.size()
+               << " chunks.";
+      return;
+    }
+
     if (lrs.size() == 1 && use_nesterov == false &&
         regularization_methods.size() == 0) {
 #define PADDLE_LAUNCH_MERGED_MOMENTUM_KERNEL(kMultiPrecision)            \
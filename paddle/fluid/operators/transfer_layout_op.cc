@@ -96,7 +96,8 @@ class TransferLayoutKernel {
     auto *out = ctx.OutputVar("Out");
     auto &dev_ctx = ctx.device_context();
     auto dst_layout = ctx.Attr<int>("dst_layout");
-    TransferLayoutFunctor(x, out, dev_ctx, dst_layout)();
+    auto src_layout = ctx.Attr<int>("src_layout");
+    TransferLayoutFunctor(x, out, dev_ctx, dst_layout, src_layout)();
   }
 };
 
@@ -107,6 +108,10 @@ class TransferLayoutOpProtoMaker : public framework::OpProtoAndCheckerMaker {
     AddOutput("Out", "(LoDTensor) The Output Tensor with desired layout");
     AddAttr<int>("dst_layout",
                  "kAnyLayout = 0, kNHWC = 1, kNCHW = 2, kMKLDNN = 3");
+    AddAttr<int>("src_layout",
+                 "kAnyLayout = 0, kNHWC = 1, kNCHW = 2, kMKLDNN = 3. The input "
+                 "in another layout is not transformed. Any layout if -1.")
+        .SetDefault(-1);
     AddComment(R"DOC(
     TransferLayout Operator)DOC");
   }
@@ -39,14 +39,30 @@ class TransferLayoutFunctor {
  public:
   TransferLayoutFunctor(const framework::Variable *in, framework::Variable *out,
                         const platform::DeviceContext &dev_ctx,
-                        const int dst_layout)
-      : in_(in), out_(out), dev_ctx_(dev_ctx), dst_layout_(dst_layout) {}
+                        const int dst_layout, const int src_layout = -1)
+      : in_(in),
+        out_(out),
+        dev_ctx_(dev_ctx),
+        dst_layout_(dst_layout),
+        src_layout_(src_layout) {}
 
   void operator()() const {
     auto &in_tensor = *framework::GetLoDTensorOrSelectedRowsValueFromVar(*in_);
     framework::LoDTensor out_tensor;
 
     auto out_layout = static_cast<DataLayout>(dst_layout_);
+    // No transform if the input is in the layout already, or not in the
+    // src_layout expected, e.g. the producer planned to run on MKL-DNN ran
+    // the native kernel and wrote a plain tensor.
+    if (in_tensor.layout() == out_layout ||
+        (src_layout_ >= 0 &&
+         in_tensor.layout() != static_cast<DataLayout>(src_layout_))) {
+      VLOG(4) << "No layout transform needed for the input in "
+              << in_tensor.layout();
+      out_tensor.ShareDataWith(in_tensor);
+      framework::SetTensorToVariable(*in_, out_tensor, out_);
+      return;
+    }
     out_tensor.set_layout(out_layout);
 
 #ifdef PADDLE_WITH_MKLDNN
@@ -124,6 +140,7 @@ class TransferLayoutFunctor {
   framework::Variable *out_;
   const platform::DeviceContext &dev_ctx_;
   const int dst_layout_;
+  const int src_layout_;
 };
 
 }  // namespace operators
@@ -352,6 +352,24 @@ PADDLE_DEFINE_EXPORTED_double(
     "only the FLAGS_memory_fraction_of_eager_deletion of the largest "
     "variables would be deleted.");
 
+/**
+ * Memory related FLAG
+ * Name: FLAGS_while_op_reuse_step_buffers
+ * Since Version: 2.3.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_while_op_reuse_step_buffers=true keeps the buffers.
+ * Note: Whether the while op for inference keeps the buffers of the
+ *       temporary variables of its step block for the whole loop, so that
+ *       every iteration reuses the buffers of the previous one instead of
+ *       allocating and releasing them again. It trades the memory released
+ *       by the garbage collector inside an iteration for fewer allocations,
+ *       so the peak memory of the loop may grow.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    while_op_reuse_step_buffers, false,
+    "Whether the while op for inference reuses the buffers of the "
+    "temporary variables of its step block across the iterations.");
+
 /**
  * Allocator related FLAG
  * Name: FLAGS_allocator_strategy
@@ -548,6 +566,22 @@ PADDLE_DEFINE_EXPORTED_bool(use_mkldnn, false, "Use MKLDNN to run");
 
 PADDLE_DEFINE_EXPORTED_bool(use_curand, false, "Random OP use CURAND");
 
+/**
+ * Dygraph related FLAG
+ * Name: FLAGS_dygraph_dispatch_cache
+ * Since Version: 2.3.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_dygraph_dispatch_cache=true
+ * Note: Whether an op call in dygraph mode reuses the kernel chosen for an
+ *       earlier call of the op with the same attributes, place and types of
+ *       inputs and outputs, skipping GetExpectedKernelType, the argument
+ *       mapping and the kernel selection. It is not used with MKLDNN.
+ */
+PADDLE_DEFINE_EXPORTED_bool(
+    dygraph_dispatch_cache, false,
+    "Whether to reuse the kernels chosen for the earlier calls of the ops "
+    "with the same attributes and types of inputs in dygraph mode.");
+
 /**
  * Debug related FLAG
  * Name: FLAGS_call_stack_level
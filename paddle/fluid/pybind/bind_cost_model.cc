@@ -30,7 +30,11 @@ void BindCostModel(py::module* m) {
   py::class_<CostData>(*m, "CostData")
       .def(py::init<>())
       .def("get_whole_time_ms", &CostData::GetWholeTimeMs)
-      .def("get_op_time_ms", &CostData::GetOpTimeMs);
+      .def("get_op_time_ms", &CostData::GetOpTimeMs)
+      .def("save_op_costs",
+           [](const CostData& self, const std::string& path) {
+             return self.GetOpCostTable().Save(path);
+           });
 
   py::class_<CostModel>(*m, "CostModel")
       .def(py::init<>())
@@ -22,6 +22,7 @@ limitations under the License. */
 #include "paddle/fluid/eager/autograd_meta.h"
 #include "paddle/fluid/eager/backward.h"
 #include "paddle/fluid/eager/custom_operator/custom_operator_node.h"
+#include "paddle/fluid/eager/recompute/recompute_node.h"
 #include "paddle/fluid/eager/utils.h"
 #include "paddle/fluid/framework/convert_utils.h"
 #include "paddle/fluid/framework/custom_operator.h"
@@ -40,6 +41,8 @@ limitations under the License. */
 #include "paddle/phi/common/data_type.h"
 #include "paddle/phi/core/compat/convert_utils.h"
 #include "paddle/phi/core/dense_tensor.h"
+DECLARE_int32(eager_backward_num_threads);
+
 namespace paddle {
 namespace pybind {
 
@@ -122,13 +125,82 @@ static PyObject* eager_api_run_backward(PyObject* self, PyObject* args,
   EAGER_TRY
   auto tensors = CastPyArg2VectorOfTensor(PyTuple_GET_ITEM(args, 0), 0);
   auto grad_tensors = CastPyArg2VectorOfTensor(PyTuple_GET_ITEM(args, 1), 1);
-  egr::RunBackward(tensors, grad_tensors,
-                   CastPyArg2AttrBoolean(PyTuple_GET_ITEM(args, 2), 2));
+  bool retain_graph = CastPyArg2AttrBoolean(PyTuple_GET_ITEM(args, 2), 2);
+  {
+    // The grad nodes calling Python, e.g. the hooks and the recomputed
+    // functions, run on the backward threads then.
+    std::unique_ptr<py::gil_scoped_release> gil_release;
+    if (FLAGS_eager_backward_num_threads > 1) {
+      gil_release.reset(new py::gil_scoped_release());
+    }
+    egr::RunBackward(tensors, grad_tensors, retain_graph);
+  }
   Py_INCREF(Py_None);
   return Py_None;
   EAGER_CATCH_AND_THROW_RETURN_NULL
 }
 
+// Calls a Python function of a list of Tensors returning a Tensor or a
+// list of Tensors, as the segment of egr::Recompute.
+class PyRecomputeFunction {
+ public:
+  explicit PyRecomputeFunction(PyObject* func) : py_func_(func) {
+    Py_INCREF(py_func_);
+  }
+
+  ~PyRecomputeFunction() {
+    py::gil_scoped_acquire gil;
+    Py_DECREF(py_func_);
+  }
+
+  std::vector<paddle::experimental::Tensor> operator()(
+      const std::vector<paddle::experimental::Tensor>& inputs) {
+    py::gil_scoped_acquire gil;
+    PyObject* py_inputs = ToPyObject(inputs);
+    PyObject* res = PyObject_CallFunctionObjArgs(py_func_, py_inputs, nullptr);
+    Py_DECREF(py_inputs);
+    if (res == nullptr) {
+      // Fetches and clears the Python error.
+      py::error_already_set error;
+      PADDLE_THROW(platform::errors::Unavailable(
+          "The recomputed function raises an exception: %s.", error.what()));
+    }
+    std::vector<paddle::experimental::Tensor> outputs;
+    try {
+      if (PyObject_IsInstance(res,
+                              reinterpret_cast<PyObject*>(p_tensor_type))) {
+        outputs.emplace_back(reinterpret_cast<TensorObject*>(res)->tensor);
+      } else {
+        outputs = CastPyArg2VectorOfTensor(res, 0);
+      }
+    } catch (...) {
+      Py_DECREF(res);
+      throw;
+    }
+    Py_DECREF(res);
+    return outputs;
+  }
+
+ private:
+  PyObject* py_func_;
+};
+
+static PyObject* eager_api_recompute(PyObject* self, PyObject* args,
+                                     PyObject* kwargs) {
+  EAGER_TRY
+  auto py_func = std::make_shared<PyRecomputeFunction>(
+      PyTuple_GET_ITEM(args, 0));
+  auto inputs = CastPyArg2VectorOfTensor(PyTuple_GET_ITEM(args, 1), 1);
+  bool preserve_rng_state =
+      CastPyArg2AttrBoolean(PyTuple_GET_ITEM(args, 2), 2);
+  egr::RecomputeFunction fn =
+      [py_func](const std::vector<paddle::experimental::Tensor>& inputs) {
+        return (*py_func)(inputs);
+      };
+  return ToPyObject(egr::Recompute(fn, inputs, preserve_rng_state));
+  EAGER_CATCH_AND_THROW_RETURN_NULL
+}
+
 static PyObject* eager_api_tensor_copy(PyObject* self, PyObject* args,
                                        PyObject* kwargs) {
   EAGER_TRY
@@ -454,6 +526,8 @@ PyMethodDef variable_functions[] = {
      METH_VARARGS | METH_KEYWORDS, NULL},
     {"_run_custom_op", (PyCFunction)(void (*)(void))eager_api_run_costum_op,
      METH_VARARGS | METH_KEYWORDS, NULL},
+    {"_recompute", (PyCFunction)(void (*)(void))eager_api_recompute,
+     METH_VARARGS | METH_KEYWORDS, NULL},
     {"tensor_copy", (PyCFunction)(void (*)(void))eager_api_tensor_copy,
      METH_VARARGS | METH_KEYWORDS, NULL},
     {"read_next_tensor_list",
@@ -42,6 +42,7 @@ limitations under the License. */
 #include "paddle/fluid/imperative/hccl_context.h"
 #include "paddle/fluid/imperative/heter_ccl_context.h"
 #include "paddle/fluid/imperative/hooks.h"
+#include "paddle/fluid/imperative/jit/program_replayer.h"
 #include "paddle/fluid/imperative/layer.h"
 #include "paddle/fluid/imperative/nccl_context.h"
 #include "paddle/fluid/imperative/partial_grad_engine.h"
@@ -1968,6 +1969,14 @@ void BindImperative(py::module *m_ptr) {
            &imperative::jit::ProgramDescTracer::CreateProgramDesc)
       .def("reset", &imperative::jit::ProgramDescTracer::Reset);
 
+  py::class_<imperative::jit::ProgramReplayer>(m, "ProgramReplayer", "")
+      .def(py::init<const imperative::jit::StepFunction &, size_t>(),
+           py::arg("step"), py::arg("max_program_num") = 4)
+      .def("run", &imperative::jit::ProgramReplayer::Run, py::arg("feeds"),
+           py::arg("key") = "")
+      .def("program_num", &imperative::jit::ProgramReplayer::ProgramNum)
+      .def("replay_num", &imperative::jit::ProgramReplayer::ReplayNum);
+
   py::enum_<paddle::imperative::AmpLevel>(m, "AmpLevel", py::arithmetic())
       .value("O0", paddle::imperative::AmpLevel::O0)
       .value("O1", paddle::imperative::AmpLevel::O1)
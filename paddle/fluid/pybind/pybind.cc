@@ -3755,6 +3755,32 @@ All parameter, weight, gradient are variables in Paddle.
                         build_strategy = static.BuildStrategy()
                         build_strategy.debug_graphviz_path = "./graph"
                     )DOC")
+      .def_property(
+          "cost_data_path",
+          [](const BuildStrategy &self) { return self.cost_data_path_; },
+          [](BuildStrategy &self, const std::string &path) {
+            PADDLE_ENFORCE_NE(self.IsFinalized(), true,
+                              platform::errors::PreconditionNotMet(
+                                  "BuildStrategy has been finlaized, cannot be "
+                                  "configured again."));
+            self.cost_data_path_ = path;
+          },
+          R"DOC((str, optional): cost_data_path indicates the file of op costs
+                saved by CostData.save_op_costs. If set, passes such as
+                mkldnn placement and auto fusion make decisions by the measured
+                costs. Default is empty string, that is, ""
+
+                Examples:
+                    .. code-block:: python
+
+                        import paddle
+                        import paddle.static as static
+
+                        paddle.enable_static()
+
+                        build_strategy = static.BuildStrategy()
+                        build_strategy.cost_data_path = "./op_costs.txt"
+                    )DOC")
       .def_property(
           "enable_sequential_execution",
           [](const BuildStrategy &self) {
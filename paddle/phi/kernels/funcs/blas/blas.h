@@ -131,6 +131,12 @@ class Blas {
                 const int N,
                 const int K) const;
 
+  template <typename T>
+  size_t GEMM_PACK_GET_SIZE(const CBLAS_IDENTIFIER id,
+                            const int M,
+                            const int N,
+                            const int K) const;
+
   template <typename T>
   void GEMM_PACK(const CBLAS_IDENTIFIER id,
                  const CBLAS_TRANSPOSE trans,
@@ -426,6 +432,11 @@ class BlasT : private Blas<DeviceContext> {
     return Base()->template GEMM_ALLOC<T>(args...);
   }
 
+  template <typename... ARGS>
+  size_t GEMM_PACK_GET_SIZE(ARGS... args) const {
+    return Base()->template GEMM_PACK_GET_SIZE<T>(args...);
+  }
+
   template <typename... ARGS>
   void GEMM_PACK(ARGS... args) const {
     Base()->template GEMM_PACK<T>(args...);
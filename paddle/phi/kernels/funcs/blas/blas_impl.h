@@ -121,6 +121,11 @@ struct CBlas<float> {
     return paddle::platform::dynload::cblas_sgemm_alloc(args...);
   }
 
+  template <typename... ARGS>
+  static size_t GEMM_PACK_GET_SIZE(ARGS... args) {
+    return paddle::platform::dynload::cblas_sgemm_pack_get_size(args...);
+  }
+
   template <typename... ARGS>
   static void GEMM_PACK(ARGS... args) {
     paddle::platform::dynload::cblas_sgemm_pack(args...);
@@ -247,6 +252,11 @@ struct CBlas<double> {
     return paddle::platform::dynload::cblas_dgemm_alloc(args...);
   }
 
+  template <typename... ARGS>
+  static size_t GEMM_PACK_GET_SIZE(ARGS... args) {
+    return paddle::platform::dynload::cblas_dgemm_pack_get_size(args...);
+  }
+
   template <typename... ARGS>
   static void GEMM_PACK(ARGS... args) {
     paddle::platform::dynload::cblas_dgemm_pack(args...);
@@ -1016,6 +1026,21 @@ T *Blas<phi::CPUContext>::GEMM_ALLOC(const CBLAS_IDENTIFIER id,
   return CBlas<T>::GEMM_ALLOC(id, M, N, K);
 }
 
+template <>
+template <typename T>
+size_t Blas<paddle::platform::CPUDeviceContext>::GEMM_PACK_GET_SIZE(
+    const CBLAS_IDENTIFIER id, const int M, const int N, const int K) const {
+  return CBlas<T>::GEMM_PACK_GET_SIZE(id, M, N, K);
+}
+template <>
+template <typename T>
+size_t Blas<phi::CPUContext>::GEMM_PACK_GET_SIZE(const CBLAS_IDENTIFIER id,
+                                                 const int M,
+                                                 const int N,
+                                                 const int K) const {
+  return CBlas<T>::GEMM_PACK_GET_SIZE(id, M, N, K);
+}
+
 template <>
 template <typename T>
 void Blas<paddle::platform::CPUDeviceContext>::GEMM_PACK(
@@ -238,6 +238,8 @@ class DownpourSGD(DeviceWorker):
                                                        "DownpourWorker")
         pull_thread = trainer_desc.pull_dense_param
         pull_thread.device_num = trainer_desc.thread_num
+        pull_thread.double_buffer = opt_info.get("pull_dense_double_buffer",
+                                                 False)
         if opt_info.get("program_id_to_worker") is None:
             raise ValueError("opt_info must have program_id_to_worker")
         prog_id_to_worker = opt_info["program_id_to_worker"]
@@ -0,0 +1,72 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+
+import paddle
+import paddle.nn.functional as F
+from paddle.fluid import core
+from paddle.fluid.framework import _test_eager_guard
+
+
+class TestEagerRecompute(unittest.TestCase):
+    def run_model(self, use_recompute):
+        paddle.seed(2022)
+        with _test_eager_guard():
+            linear1 = paddle.nn.Linear(8, 16)
+            linear2 = paddle.nn.Linear(16, 4)
+            x = paddle.rand([4, 8])
+            x.stop_gradient = False
+            self.num_runs = 0
+
+            def segment(inputs):
+                self.num_runs += 1
+                hidden = F.dropout(F.relu(linear1(inputs[0])), 0.5)
+                return [linear2(hidden)]
+
+            if use_recompute:
+                out = core.eager._recompute(segment, [x], True)[0]
+            else:
+                out = segment([x])[0]
+            loss = out.mean()
+            loss.backward()
+            return [
+                loss.numpy(), x.grad.numpy(), linear1.weight.grad.numpy(),
+                linear2.bias.grad.numpy()
+            ]
+
+    def test_same_as_no_recompute(self):
+        expected = self.run_model(False)
+        self.assertEqual(self.num_runs, 1)
+        results = self.run_model(True)
+        # run again in the backward, with the same dropout masks
+        self.assertEqual(self.num_runs, 2)
+        for result, expect in zip(results, expected):
+            self.assertTrue(np.allclose(result, expect))
+
+    def test_exception(self):
+        def segment(inputs):
+            raise ValueError("failed segment")
+
+        with _test_eager_guard():
+            x = paddle.rand([4, 8])
+            x.stop_gradient = False
+            with self.assertRaises(RuntimeError):
+                core.eager._recompute(segment, [x], True)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,75 @@
+#   Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import unittest
+import numpy as np
+from op_test import OpTest
+from test_fc_op import fc_refer, MatrixGenerate
+
+
+class TestFusionBatchedFCOp(OpTest):
+    def setUp(self):
+        self.bs = [3, 3, 3]
+        self.ic = 9
+        self.oc = 4
+        self.with_bias = True
+        self.with_relu = True
+        self.set_conf()
+        self.op_type = 'fusion_batched_fc'
+
+        inputs = []
+        weights = []
+        biases = []
+        outs = []
+        for i, bs in enumerate(self.bs):
+            matrix = MatrixGenerate(bs, self.ic, self.oc, 1, 1)
+            inputs.append(('X_{0}'.format(i),
+                           np.reshape(matrix.input, [bs, self.ic])))
+            weights.append(('W_{0}'.format(i), matrix.weights))
+            biases.append(('B_{0}'.format(i), matrix.bias))
+            outs.append(('Out_{0}'.format(i),
+                         fc_refer(matrix, self.with_bias, self.with_relu)))
+
+        self.inputs = {'X': inputs, 'W': weights}
+        if self.with_bias:
+            self.inputs['Bias'] = biases
+        self.attrs = {
+            'in_num_col_dims': 1,
+            'activation_type': 'relu' if self.with_relu else ''
+        }
+        self.outputs = {'Out': outs}
+
+    def test_check_output(self):
+        self.check_output()
+
+    def set_conf(self):
+        pass
+
+
+class TestFusionBatchedFCOpDifferentRows(TestFusionBatchedFCOp):
+    def set_conf(self):
+        self.bs = [1, 5, 2, 7]
+        self.oc = 16
+
+
+class TestFusionBatchedFCOpNoBias(TestFusionBatchedFCOp):
+    def set_conf(self):
+        self.with_bias = False
+        self.with_relu = False
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,89 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+
+import numpy as np
+
+import paddle
+import paddle.fluid as fluid
+import paddle.nn.functional as F
+from paddle.fluid import core
+
+
+class SimpleNet(paddle.nn.Layer):
+    def __init__(self):
+        super(SimpleNet, self).__init__()
+        self._linear1 = paddle.nn.Linear(8, 16)
+        self._linear2 = paddle.nn.Linear(16, 4)
+
+    def forward(self, x):
+        return self._linear2(F.relu(self._linear1(x)))
+
+
+class TestProgramReplayer(unittest.TestCase):
+    def setUp(self):
+        self.steps = 6
+        np.random.seed(2022)
+        # the second half of the steps run with another batch size
+        self.batches = []
+        for i in range(self.steps):
+            batch_size = 4 if i < self.steps // 2 else 2
+            self.batches.append(
+                (np.random.random((batch_size, 8)).astype('float32'),
+                 np.random.random((batch_size, 4)).astype('float32')))
+
+    def train(self, use_replay):
+        paddle.seed(2022)
+        with fluid.dygraph.guard(fluid.CPUPlace()):
+            model = SimpleNet()
+            opt = paddle.optimizer.SGD(learning_rate=0.1,
+                                       parameters=model.parameters())
+
+            def step(feeds):
+                x, y = feeds
+                loss = F.mse_loss(model(x), y)
+                loss.backward()
+                opt.step()
+                return [loss]
+
+            replayer = core.ProgramReplayer(step)
+            losses = []
+            for x, y in self.batches:
+                feeds = [paddle.to_tensor(x), paddle.to_tensor(y)]
+                if use_replay:
+                    loss = replayer.run(feeds)[0]
+                else:
+                    loss = step(feeds)[0]
+                # not traced, so cleared out of the step
+                opt.clear_grad()
+                losses.append(loss.numpy())
+            params = [param.numpy() for param in model.parameters()]
+            return losses, params, replayer
+
+    def test_same_as_eager(self):
+        eager_losses, eager_params, _ = self.train(False)
+        losses, params, replayer = self.train(True)
+
+        # a program for each batch size, replayed by the other steps
+        self.assertEqual(replayer.program_num(), 2)
+        self.assertEqual(replayer.replay_num(), self.steps - 2)
+        for loss, eager_loss in zip(losses, eager_losses):
+            self.assertTrue(np.allclose(loss, eager_loss, atol=1e-6))
+        for param, eager_param in zip(params, eager_params):
+            self.assertTrue(np.allclose(param, eager_param, atol=1e-6))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -153,5 +153,52 @@ class TestMergedAdam(unittest.TestCase):
                 self.check_with_place(place, multi_precision)
 
 
+class TestMergedAdamW(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        # Large enough to be split into chunks.
+        self.shapes = [[3, 4], [2, 7], [50, 60], [7, 8]]
+        self.seed = 10
+
+    def run_adamw_op(self, data, use_merged):
+        paddle.set_device('cpu')
+        param_vars, grad_vars, lr_vars, moment1_vars, moment2_vars, \
+            beta1_pow_vars, beta2_pow_vars = [
+                [paddle.to_tensor(t) for t in ts] for ts in data]
+        attrs = ('epsilon', 1e-8, 'beta1', 0.9, 'beta2', 0.99, 'with_decay',
+                 True, 'coeff', 0.01, 'lr_ratio', 0.5)
+        if not use_merged:
+            for i in range(len(param_vars)):
+                _C_ops.adamw(param_vars[i], grad_vars[i], lr_vars[i],
+                             moment1_vars[i], moment2_vars[i],
+                             beta1_pow_vars[i], beta2_pow_vars[i], None,
+                             param_vars[i], moment1_vars[i], moment2_vars[i],
+                             beta1_pow_vars[i], beta2_pow_vars[i], None,
+                             *attrs)
+        else:
+            _C_ops.merged_adamw(param_vars, grad_vars, lr_vars, moment1_vars,
+                                moment2_vars, beta1_pow_vars, beta2_pow_vars,
+                                None, param_vars, moment1_vars, moment2_vars,
+                                beta1_pow_vars, beta2_pow_vars, None, *attrs)
+        return [param_vars, moment1_vars, moment2_vars, beta1_pow_vars,
+                beta2_pow_vars]
+
+    def test_main(self):
+        np.random.seed(self.seed)
+        n = len(self.shapes)
+        data = [
+            [np.random.random(s).astype(np.float32) for s in shapes]
+            for shapes in [self.shapes, self.shapes, [[1]] * n, self.shapes,
+                           self.shapes, [[1]] * n, [[1]] * n]
+        ]
+        outs1 = self.run_adamw_op(data, True)
+        outs2 = self.run_adamw_op(data, False)
+        for value1, value2 in zip(outs1, outs2):
+            for i in range(len(value1)):
+                self.assertTrue(
+                    np.allclose(
+                        value1[i].numpy(), value2[i].numpy(), atol=1e-7))
+
+
 if __name__ == "__main__":
     unittest.main()
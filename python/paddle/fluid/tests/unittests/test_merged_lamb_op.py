@@ -0,0 +1,101 @@
+# Copyright (c) 2022 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+import paddle
+import numpy as np
+from paddle import _C_ops
+
+
+def run_lamb_op(params, grads, lrs, moment1s, moment2s, beta1_pows,
+                beta2_pows, weight_decays, epsilon, beta1, beta2, use_merged):
+    paddle.disable_static()
+    paddle.set_device('cpu')
+
+    param_vars = [paddle.to_tensor(p) for p in params]
+    grad_vars = [paddle.to_tensor(g) for g in grads]
+    lr_vars = [paddle.to_tensor(l) for l in lrs]
+    moment1_vars = [paddle.to_tensor(m) for m in moment1s]
+    moment2_vars = [paddle.to_tensor(m) for m in moment2s]
+    beta1_pow_vars = [paddle.to_tensor(b) for b in beta1_pows]
+    beta2_pow_vars = [paddle.to_tensor(b) for b in beta2_pows]
+
+    if not use_merged:
+        for i in range(len(param_vars)):
+            _C_ops.lamb(param_vars[i], grad_vars[i], lr_vars[i],
+                        moment1_vars[i], moment2_vars[i], beta1_pow_vars[i],
+                        beta2_pow_vars[i], None, param_vars[i],
+                        moment1_vars[i], moment2_vars[i], beta1_pow_vars[i],
+                        beta2_pow_vars[i], None, 'beta1', beta1, 'beta2',
+                        beta2, 'epsilon', epsilon, 'weight_decay',
+                        weight_decays[i])
+    else:
+        _C_ops.merged_lamb(param_vars, grad_vars, lr_vars, moment1_vars,
+                           moment2_vars, beta1_pow_vars, beta2_pow_vars,
+                           param_vars, moment1_vars, moment2_vars,
+                           beta1_pow_vars, beta2_pow_vars, 'beta1', beta1,
+                           'beta2', beta2, 'epsilon', epsilon,
+                           'weight_decay', weight_decays)
+
+    return {
+        'ParamOut': param_vars,
+        'Moment1Out': moment1_vars,
+        'Moment2Out': moment2_vars,
+        'Beta1PowOut': beta1_pow_vars,
+        'Beta2PowOut': beta2_pow_vars
+    }
+
+
+class TestMergedLamb(unittest.TestCase):
+    def setUp(self):
+        paddle.disable_static()
+        # Large enough to be split into chunks.
+        self.shapes = [[3, 4], [2, 7], [50, 60], [7, 8]]
+        self.weight_decays = [0.01, 0.0, 0.02, 0.01]
+        self.seed = 10
+
+    def gen_rand_data(self, shapes, dtype):
+        return [np.random.random(s).astype(dtype) for s in shapes]
+
+    def test_main(self):
+        np.random.seed(self.seed)
+        dtype = np.float32
+        n = len(self.shapes)
+        params = self.gen_rand_data(self.shapes, dtype)
+        grads = self.gen_rand_data(self.shapes, dtype)
+        lrs = self.gen_rand_data([[1]] * n, dtype)
+        moment1s = self.gen_rand_data(self.shapes, dtype)
+        moment2s = self.gen_rand_data(self.shapes, dtype)
+        beta1_pows = self.gen_rand_data([[1]] * n, dtype)
+        beta2_pows = self.gen_rand_data([[1]] * n, dtype)
+
+        def run_op(use_merged):
+            return run_lamb_op(params, grads, lrs, moment1s, moment2s,
+                               beta1_pows, beta2_pows, self.weight_decays,
+                               1e-6, 0.9, 0.99, use_merged)
+
+        outs1 = run_op(True)
+        outs2 = run_op(False)
+        self.assertEqual(len(outs1), len(outs2))
+        for key in outs1.keys():
+            value1 = outs1[key]
+            value2 = outs2[key]
+            for i in range(len(value1)):
+                self.assertTrue(
+                    np.allclose(
+                        value1[i].numpy(), value2[i].numpy(), atol=1e-6))
+
+
+if __name__ == "__main__":
+    unittest.main()